@@ -0,0 +1,81 @@
+#!/usr/bin/env python3
+"""
+Converts a repeater packet trace (see src/helpers/PacketTraceLog.h) to a pcap file.
+
+Input is either the binary '/packet_log' file copied from node storage, or the text
+captured from the 'log hex' CLI command (one hex record per line).
+
+Each pcap packet is the 24 byte trace record, followed by any raw (wire format) bytes that
+were kept, using link type USER0 (147).
+
+  usage:  trace2pcap.py <input> <output.pcap>
+"""
+import re
+import struct
+import sys
+
+TRACE_FILE_MAGIC = 0x5254434D
+RECORD_FMT = '<IIHBB4sbbBBBB2s'
+RECORD_SIZE = struct.calcsize(RECORD_FMT)   # 24
+HEADER_FMT = '<IBBHII'
+HEADER_SIZE = struct.calcsize(HEADER_FMT)   # 16
+LINKTYPE_USER0 = 147
+
+
+def read_binary(data):
+    magic, version, _, slot_size, num_slots, _ = struct.unpack_from(HEADER_FMT, data, 0)
+    if magic != TRACE_FILE_MAGIC:
+        return None
+    if version != 1 or slot_size < RECORD_SIZE:
+        raise ValueError('unsupported trace file version %d' % version)
+    slots = []
+    for i in range(num_slots):
+        ofs = HEADER_SIZE + i * slot_size
+        slot = data[ofs:ofs + slot_size]
+        if len(slot) < slot_size:
+            break
+        slots.append(slot)
+    return slots
+
+
+def read_hex(text):
+    slots = []
+    for line in text.splitlines():
+        line = line.strip()
+        if len(line) >= RECORD_SIZE * 2 and len(line) % 2 == 0 and re.fullmatch(r'[0-9A-Fa-f]+', line):
+            slots.append(bytes.fromhex(line))
+    return slots
+
+
+def main():
+    if len(sys.argv) != 3:
+        print(__doc__.strip())
+        return 1
+
+    with open(sys.argv[1], 'rb') as f:
+        data = f.read()
+    slots = read_binary(data) if len(data) >= HEADER_SIZE else None
+    if slots is None:
+        slots = read_hex(data.decode('ascii', 'ignore'))
+
+    records = []
+    for slot in slots:
+        seq, timestamp, millis, event, header, hash, snr, rssi, score, length, path_len, raw_len, _ = \
+            struct.unpack_from(RECORD_FMT, slot, 0)
+        if seq == 0:
+            continue   # empty slot
+        records.append((seq, timestamp, millis, slot[:RECORD_SIZE + raw_len]))
+    records.sort()
+
+    with open(sys.argv[2], 'wb') as out:
+        out.write(struct.pack('<IHHiIII', 0xa1b2c3d4, 2, 4, 0, 0, 65535, LINKTYPE_USER0))
+        for seq, timestamp, millis, pkt in records:
+            out.write(struct.pack('<IIII', timestamp, (millis % 1000) * 1000, len(pkt), len(pkt)))
+            out.write(pkt)
+
+    print('%d records written' % len(records))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1,12 +1,6 @@
 #include <Arduino.h>
 #include "DataStore.h"
 
-#if defined(EXTRAFS) || defined(QSPIFLASH)
-  #define MAX_BLOBRECS 100
-#else
-  #define MAX_BLOBRECS 20
-#endif
-
 DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra(nullptr), _clock(&clock),
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
     identity_store(fs, "")
@@ -15,7 +9,11 @@ DataStore::DataStore(FILESYSTEM& fs, mesh::RTCClock& clock) : _fs(&fs), _fsExtra
 #else
     identity_store(fs, "/identity")
 #endif
+#if defined(ESP32) || defined(RP2040_PLATFORM)
+    , _blobs("/blobs", "/blobs.tmp", MAX_CONTACTS*2)
+#endif
 {
+  initSummaries();
 }
 
 #if defined(EXTRAFS) || defined(QSPIFLASH)
@@ -27,7 +25,11 @@ DataStore::DataStore(FILESYSTEM& fs, FILESYSTEM& fsExtra, mesh::RTCClock& clock)
 #else
     identity_store(fs, "/identity")
 #endif
+#if defined(ESP32) || defined(RP2040_PLATFORM)
+    , _blobs("/blobs", "/blobs.tmp", MAX_CONTACTS*2)
+#endif
 {
+  initSummaries();
 }
 #endif
 
@@ -57,9 +59,16 @@ void DataStore::begin() {
   #if defined(EXTRAFS) || defined(QSPIFLASH)
   migrateToSecondaryFS();
   #endif
+  loadBlobIndex();
 #else
-  // init 'blob store' support
-  _fs->mkdir("/bl");
+  _blobs.begin(_fs);
+  migrateBlobDir();
+#endif
+}
+
+void DataStore::loop() {
+#if defined(ESP32) || defined(RP2040_PLATFORM)
+  _blobs.loop(millis());
 #endif
 }
 
@@ -164,17 +173,22 @@ bool DataStore::removeFile(FILESYSTEM* fs, const char* filename) {
 }
 
 bool DataStore::formatFileSystem() {
+  _contacts_synced = _channels_synced = false;   // next saves must write full snapshots
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  _blob_index_valid = false;
   if (_fsExtra == nullptr) {
     return _fs->format();
   } else {
     return _fs->format() && _fsExtra->format();
   }
 #elif defined(RP2040_PLATFORM)
-  return LittleFS.format();
+  bool success = LittleFS.format();
+  _blobs.begin(_fs);   // reset to empty
+  return success;
 #elif defined(ESP32)
   bool fs_success = ((fs::SPIFFSFS *)_fs)->format();
   esp_err_t nvs_err = nvs_flash_erase(); // no need to reinit, will be done by reboot
+  _blobs.begin(_fs);   // reset to empty
   return fs_success && (nvs_err == ESP_OK);
 #else
   #error "need to implement format()"
@@ -278,112 +292,474 @@ void DataStore::savePrefs(const NodePrefs& _prefs, double node_lat, double node_
   }
 }
 
-void DataStore::loadContacts(DataStoreHost* host) {
-File file = openRead(_getContactsChannelsFS(), "/contacts3");
-    if (file) {
-      bool full = false;
-      while (!full) {
+#define IO_BUF_SIZE          (4*CONTACT_REC_SIZE)
+
+static File openAppend(FILESYSTEM* fs, const char* filename) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return fs->open(filename, FILE_O_WRITE);   // NOTE: positions at end of file
+#elif defined(RP2040_PLATFORM)
+  return fs->open(filename, "a");
+#else
+  return fs->open(filename, "a", true);
+#endif
+}
+
+class BufferedReader {
+  File& _file;
+  uint8_t _buf[IO_BUF_SIZE];
+  int _len, _pos;
+
+public:
+  BufferedReader(File& file) : _file(file) { _len = _pos = 0; }
+
+  // returns next 'n' bytes (valid until next call), or NULL if EOF
+  const uint8_t* next(int n) {
+    if (_pos + n > _len) {
+      memmove(_buf, &_buf[_pos], _len - _pos);
+      _len -= _pos;
+      _pos = 0;
+      while (_len < n) {
+        int r = _file.read(&_buf[_len], sizeof(_buf) - _len);
+        if (r <= 0) return NULL;
+        _len += r;
+      }
+    }
+    const uint8_t* p = &_buf[_pos];
+    _pos += n;
+    return p;
+  }
+};
+
+static void packContact(uint8_t* dest, const ContactInfo& c) {
+  uint8_t* dp = dest;
+  memcpy(dp, c.id.pub_key, 32); dp += 32;
+  memcpy(dp, c.name, 32); dp += 32;
+  *dp++ = c.type;
+  *dp++ = c.flags;
+  *dp++ = 0;   // unused
+  memcpy(dp, &c.sync_since, 4); dp += 4;   // was 'reserved'
+  *dp++ = c.out_path_len;
+  memcpy(dp, &c.last_advert_timestamp, 4); dp += 4;
+  memcpy(dp, c.out_path, 64); dp += 64;
+  memcpy(dp, &c.lastmod, 4); dp += 4;
+  memcpy(dp, &c.gps_lat, 4); dp += 4;
+  memcpy(dp, &c.gps_lon, 4);
+}
+
+static void unpackContact(ContactInfo& c, const uint8_t* src) {
+  const uint8_t* sp = src;
+  c.id = mesh::Identity(sp); sp += 32;
+  memcpy(c.name, sp, 32); sp += 32;
+  c.type = *sp++;
+  c.flags = *sp++;
+  sp++;   // unused
+  memcpy(&c.sync_since, sp, 4); sp += 4;
+  c.out_path_len = *sp++;
+  memcpy(&c.last_advert_timestamp, sp, 4); sp += 4;
+  memcpy(c.out_path, sp, 64); sp += 64;
+  memcpy(&c.lastmod, sp, 4); sp += 4;
+  memcpy(&c.gps_lat, sp, 4); sp += 4;
+  memcpy(&c.gps_lon, sp, 4);
+  c.shared_secret_valid = false;
+}
+
+static void packChannel(uint8_t* dest, const ChannelDetails& ch) {
+  memset(dest, 0, 4);   // unused
+  memcpy(&dest[4], ch.name, 32);
+  memcpy(&dest[36], ch.channel.secret, 32);
+}
+
+static void unpackChannel(ChannelDetails& ch, const uint8_t* src) {
+  memset(&ch, 0, sizeof(ch));
+  memcpy(ch.name, &src[4], 32);
+  memcpy(ch.channel.secret, &src[36], 32);
+}
+
+#define FNV_OFFSET_BASIS     2166136261UL
+
+static uint32_t recordHash(const uint8_t* rec, int len, uint32_t h = FNV_OFFSET_BASIS) {   // FNV-1a
+  for (int i = 0; i < len; i++) {
+    h ^= rec[i];
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+static uint16_t journalCheck(const uint8_t* rec, int payload_len) {   // Fletcher-16 of header (excl. check) + payload
+  uint16_t a = 0, b = 0;
+  for (int i = 0; i < JNL_HEADER_SIZE + payload_len; i++) {
+    if (i == 6 || i == 7) continue;   // the check field itself
+    a = (a + rec[i]) % 255;
+    b = (b + a) % 255;
+  }
+  return (b << 8) | a;
+}
+
+void DataStore::initSummaries() {
+  _contact_sums = new RecordSum[MAX_CONTACTS];
+  _num_contact_sums = _num_channel_hashes = 0;
+  _contacts_synced = _channels_synced = false;
+  _contacts_jnl_size = _channels_jnl_size = 0;
+  _jnl_seq = 0;
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  _num_blob_slots = 0;
+  _blob_index_valid = false;
+#endif
+}
+
+bool DataStore::appendJournal(File& file, uint32_t& jnl_size, uint8_t type, const uint8_t* payload, int len) {
+  uint8_t rec[JNL_HEADER_SIZE + JNL_MAX_PAYLOAD];
+  uint32_t seq = ++_jnl_seq;
+  memcpy(rec, &seq, 4);
+  rec[4] = type;
+  rec[5] = len;
+  memcpy(&rec[JNL_HEADER_SIZE], payload, len);
+  uint16_t check = journalCheck(rec, len);
+  memcpy(&rec[6], &check, 2);
+
+  int n = JNL_HEADER_SIZE + len;
+  if ((int) file.write(rec, n) != n) return false;   // write failed
+  jnl_size += n;
+  return true;
+}
+
+uint32_t DataStore::replayJournal(DataStoreHost* host, const char* filename, uint32_t snap_size, uint32_t snap_hash, bool& valid) {
+  uint32_t size = 0;
+  File file = openRead(_getContactsChannelsFS(), filename);
+  if (file) {
+    BufferedReader reader(file);
+    uint8_t rec[JNL_HEADER_SIZE + JNL_MAX_PAYLOAD];
+    uint32_t last_seq = 0;
+    const uint8_t* hdr;
+    while ((hdr = reader.next(JNL_HEADER_SIZE)) != NULL) {
+      memcpy(rec, hdr, JNL_HEADER_SIZE);
+      uint32_t seq;
+      uint16_t check;
+      memcpy(&seq, rec, 4);
+      memcpy(&check, &rec[6], 2);
+      uint8_t type = rec[4];
+      int len = rec[5];
+
+      const uint8_t* payload = len <= JNL_MAX_PAYLOAD ? reader.next(len) : NULL;
+      if (payload) memcpy(&rec[JNL_HEADER_SIZE], payload, len);
+      if (payload == NULL || seq <= last_seq || journalCheck(rec, len) != check) {
+        MESH_DEBUG_PRINTLN("replayJournal: %s, bad record at offset %d", filename, (int) size);   // eg. power lost mid-write
+        valid = false;   // compact on next save
+        break;
+      }
+      if (last_seq == 0) {   // first record, must be for the current snapshot
+        uint32_t snap[2];
+        if (type == JNL_SNAPSHOT && len == sizeof(snap)) memcpy(snap, &rec[JNL_HEADER_SIZE], sizeof(snap));
+        if (type != JNL_SNAPSHOT || len != sizeof(snap) || snap[0] != snap_size || snap[1] != snap_hash) {
+          MESH_DEBUG_PRINTLN("replayJournal: %s, not for current snapshot", filename);
+          valid = false;
+          break;
+        }
+      }
+      last_seq = seq;
+      if (seq > _jnl_seq) _jnl_seq = seq;
+      size += JNL_HEADER_SIZE + len;
+
+      if (type == JNL_CONTACT_PUT && len == CONTACT_REC_SIZE) {
         ContactInfo c;
-        uint8_t pub_key[32];
-        uint8_t unused;
-
-        bool success = (file.read(pub_key, 32) == 32);
-        success = success && (file.read((uint8_t *)&c.name, 32) == 32);
-        success = success && (file.read(&c.type, 1) == 1);
-        success = success && (file.read(&c.flags, 1) == 1);
-        success = success && (file.read(&unused, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.sync_since, 4) == 4); // was 'reserved'
-        success = success && (file.read((uint8_t *)&c.out_path_len, 1) == 1);
-        success = success && (file.read((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-        success = success && (file.read(c.out_path, 64) == 64);
-        success = success && (file.read((uint8_t *)&c.lastmod, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lat, 4) == 4);
-        success = success && (file.read((uint8_t *)&c.gps_lon, 4) == 4);
-
-        if (!success) break; // EOF
-
-        c.id = mesh::Identity(pub_key);
-        if (!host->onContactLoaded(c)) full = true;
+        unpackContact(c, &rec[JNL_HEADER_SIZE]);
+        if (!host->onContactLoaded(c)) valid = false;  // full
+      } else if (type == JNL_CONTACT_DEL && len == CONTACT_KEY_LEN) {
+        host->onContactDeleted(&rec[JNL_HEADER_SIZE], len);
+      } else if (type == JNL_CHANNEL_PUT && len == 1 + CHANNEL_REC_SIZE) {
+        ChannelDetails ch;
+        unpackChannel(ch, &rec[JNL_HEADER_SIZE + 1]);
+        if (!host->onChannelLoaded(rec[JNL_HEADER_SIZE], ch)) valid = false;
       }
-      file.close();
     }
+    file.close();
+  }
+  return size;
 }
 
-void DataStore::saveContacts(DataStoreHost* host, bool (*filter)(const ContactInfo& c)) {
-  File file = openWrite(_getContactsChannelsFS(), "/contacts3");
+static void recoverSnapshot(FILESYSTEM* fs, const char* filename, const char* tmp_filename) {
+  if (!fs->exists(filename) && fs->exists(tmp_filename)) {   // power lost between the remove and rename in commitSnapshot()
+    fs->rename(tmp_filename, filename);
+  }
+}
+
+bool DataStore::commitSnapshot(const char* filename, const char* tmp_filename, const char* jnl_filename,
+                               uint32_t snap_size, uint32_t snap_hash, uint32_t& jnl_size) {
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  fs->remove(filename);
+  if (!fs->rename(tmp_filename, filename)) return false;
+
+  File file = openWrite(fs, jnl_filename);   // the old journal only applies to the old snapshot
+  if (!file) return false;
+  uint32_t snap[2] = { snap_size, snap_hash };
+  jnl_size = 0;
+  bool success = appendJournal(file, jnl_size, JNL_SNAPSHOT, (uint8_t *) snap, sizeof(snap));
+  file.close();
+  return success;
+}
+
+bool DataStore::rebuildContactSums(DataStoreHost* host) {
+  uint8_t rec[CONTACT_REC_SIZE];
+  ContactInfo c;
+  _num_contact_sums = 0;
+  for (uint32_t idx = 0; host->getContactForSave(idx, c); idx++) {
+    if (_num_contact_sums >= MAX_CONTACTS) return false;
+    RecordSum* s = &_contact_sums[_num_contact_sums++];
+    packContact(rec, c);
+    memcpy(s->key, c.id.pub_key, CONTACT_KEY_LEN);
+    s->hash = recordHash(rec, sizeof(rec));
+  }
+  return true;
+}
+
+bool DataStore::rebuildChannelHashes(DataStoreHost* host) {
+  uint8_t rec[CHANNEL_REC_SIZE];
+  ChannelDetails ch;
+  _num_channel_hashes = 0;
+  for (uint8_t idx = 0; host->getChannelForSave(idx, ch); idx++) {
+    if (_num_channel_hashes >= STORE_JOURNAL_MAX_CHANNELS) return false;
+    packChannel(rec, ch);
+    _channel_hashes[_num_channel_hashes++] = recordHash(rec, sizeof(rec));
+  }
+  return true;
+}
+
+int DataStore::findContactSum(const uint8_t* pub_key, int hint) const {
+  if (hint < _num_contact_sums && memcmp(_contact_sums[hint].key, pub_key, CONTACT_KEY_LEN) == 0) return hint;
+
+  for (int i = 0; i < _num_contact_sums; i++) {
+    if (memcmp(_contact_sums[i].key, pub_key, CONTACT_KEY_LEN) == 0) return i;
+  }
+  return -1;  // not found
+}
+
+void DataStore::loadContacts(DataStoreHost* host) {
+  bool valid = true;
+  uint32_t snap_size = 0, snap_hash = FNV_OFFSET_BASIS;
+  recoverSnapshot(_getContactsChannelsFS(), "/contacts3", "/contacts3.tmp");
+  File file = openRead(_getContactsChannelsFS(), "/contacts3");
+  if (file) {
+    BufferedReader reader(file);
+    const uint8_t* rec;
+    while ((rec = reader.next(CONTACT_REC_SIZE)) != NULL) {
+      snap_size += CONTACT_REC_SIZE;
+      snap_hash = recordHash(rec, CONTACT_REC_SIZE, snap_hash);
+      if (!valid) continue;   // full, just hashing the rest
+
+      ContactInfo c;
+      unpackContact(c, rec);
+      if (!host->onContactLoaded(c)) valid = false;  // full
+    }
+    file.close();
+  } else {
+    valid = false;   // no snapshot yet
+  }
+  _contacts_jnl_size = replayJournal(host, "/contacts3.jnl", snap_size, snap_hash, valid);
+  _contacts_synced = rebuildContactSums(host) && valid;
+}
+
+void DataStore::writeContactsSnapshot(DataStoreHost* host, bool (*filter)(const ContactInfo& c)) {
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  _contacts_synced = false;
+
+  File file = openWrite(fs, "/contacts3.tmp");
   if (file) {
-    uint32_t idx = 0;
+    uint8_t buf[IO_BUF_SIZE];
+    int len = 0;
+    bool success = true, overflow = false;
+    uint32_t snap_size = 0, snap_hash = FNV_OFFSET_BASIS;
     ContactInfo c;
-    uint8_t unused = 0;
 
-    while (host->getContactForSave(idx, c)) {
-      if (filter && !filter(c)) {
-        idx++;  // advance to next contact
-        continue;
+    _num_contact_sums = 0;
+    for (uint32_t idx = 0; success && host->getContactForSave(idx, c); idx++) {
+      if (filter && !filter(c)) continue;
+
+      packContact(&buf[len], c);
+      if (_num_contact_sums < MAX_CONTACTS) {
+        RecordSum* s = &_contact_sums[_num_contact_sums++];
+        memcpy(s->key, c.id.pub_key, CONTACT_KEY_LEN);
+        s->hash = recordHash(&buf[len], CONTACT_REC_SIZE);
+      } else {
+        overflow = true;
+      }
+      snap_hash = recordHash(&buf[len], CONTACT_REC_SIZE, snap_hash);
+      snap_size += CONTACT_REC_SIZE;
+      len += CONTACT_REC_SIZE;
+      if (len + CONTACT_REC_SIZE > (int) sizeof(buf)) {
+        success = ((int) file.write(buf, len) == len);
+        len = 0;
       }
-      bool success = (file.write(c.id.pub_key, 32) == 32);
-      success = success && (file.write((uint8_t *)&c.name, 32) == 32);
-      success = success && (file.write(&c.type, 1) == 1);
-      success = success && (file.write(&c.flags, 1) == 1);
-      success = success && (file.write(&unused, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.sync_since, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.out_path_len, 1) == 1);
-      success = success && (file.write((uint8_t *)&c.last_advert_timestamp, 4) == 4);
-      success = success && (file.write(c.out_path, 64) == 64);
-      success = success && (file.write((uint8_t *)&c.lastmod, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lat, 4) == 4);
-      success = success && (file.write((uint8_t *)&c.gps_lon, 4) == 4);
-
-      if (!success) break; // write failed
-
-      idx++;  // advance to next contact
     }
+    if (success && len > 0) success = ((int) file.write(buf, len) == len);
     file.close();
+
+    if (success) {
+      success = commitSnapshot("/contacts3", "/contacts3.tmp", "/contacts3.jnl", snap_size, snap_hash, _contacts_jnl_size);
+    } else {
+      fs->remove("/contacts3.tmp");   // eg. FS full, old snapshot + journal still valid
+    }
+    _contacts_synced = success && !overflow;
   }
 }
 
-void DataStore::loadChannels(DataStoreHost* host) {
-    File file = openRead(_getContactsChannelsFS(), "/channels2");
-    if (file) {
-      bool full = false;
-      uint8_t channel_idx = 0;
-      while (!full) {
-        ChannelDetails ch;
-        uint8_t unused[4];
+void DataStore::saveContacts(DataStoreHost* host, bool (*filter)(const ContactInfo& c)) {
+  if (!_contacts_synced || _contacts_jnl_size >= STORE_JOURNAL_MAX_SIZE) {
+    writeContactsSnapshot(host, filter);
+    return;
+  }
+
+  File file = openAppend(_getContactsChannelsFS(), "/contacts3.jnl");
+  if (!file) {
+    writeContactsSnapshot(host, filter);
+    return;
+  }
+  for (int i = 0; i < _num_contact_sums; i++) _contact_sums[i].seen = 0;
+
+  bool success = true;
+  uint8_t rec[CONTACT_REC_SIZE];
+  ContactInfo c;
+  int hint = 0;
+  for (uint32_t idx = 0; success && host->getContactForSave(idx, c); idx++) {
+    if (filter && !filter(c)) continue;
+
+    packContact(rec, c);
+    uint32_t hash = recordHash(rec, sizeof(rec));
+    int i = findContactSum(c.id.pub_key, hint);
+    if (i < 0) {   // new contact
+      if (_num_contact_sums >= MAX_CONTACTS) {
+        success = false;
+        break;
+      }
+      i = _num_contact_sums++;
+      memcpy(_contact_sums[i].key, c.id.pub_key, CONTACT_KEY_LEN);
+      success = appendJournal(file, _contacts_jnl_size, JNL_CONTACT_PUT, rec, sizeof(rec));
+    } else if (_contact_sums[i].hash != hash) {   // modified
+      success = appendJournal(file, _contacts_jnl_size, JNL_CONTACT_PUT, rec, sizeof(rec));
+    }
+    _contact_sums[i].hash = hash;
+    _contact_sums[i].seen = 1;
+    hint = i + 1;   // contacts are usually in same order as last time
+  }
 
-        bool success = (file.read(unused, 4) == 4);
-        success = success && (file.read((uint8_t *)ch.name, 32) == 32);
-        success = success && (file.read((uint8_t *)ch.channel.secret, 32) == 32);
+  // now the ones which have been removed
+  int n = 0;
+  for (int i = 0; i < _num_contact_sums; i++) {
+    if (_contact_sums[i].seen) {
+      _contact_sums[n++] = _contact_sums[i];
+    } else if (success) {
+      success = appendJournal(file, _contacts_jnl_size, JNL_CONTACT_DEL, _contact_sums[i].key, CONTACT_KEY_LEN);
+    }
+  }
+  _num_contact_sums = n;
+  file.close();
 
-        if (!success) break; // EOF
+  if (!success) {
+    writeContactsSnapshot(host, filter);   // summary no longer matches file, so start over
+  }
+}
 
-        if (host->onChannelLoaded(channel_idx, ch)) {
-          channel_idx++;
-        } else {
-          full = true;
-        }
+void DataStore::loadChannels(DataStoreHost* host) {
+  bool valid = true;
+  uint32_t snap_size = 0, snap_hash = FNV_OFFSET_BASIS;
+  recoverSnapshot(_getContactsChannelsFS(), "/channels2", "/channels2.tmp");
+  File file = openRead(_getContactsChannelsFS(), "/channels2");
+  if (file) {
+    BufferedReader reader(file);
+    uint8_t channel_idx = 0;
+    const uint8_t* rec;
+    while ((rec = reader.next(CHANNEL_REC_SIZE)) != NULL) {
+      snap_size += CHANNEL_REC_SIZE;
+      snap_hash = recordHash(rec, CHANNEL_REC_SIZE, snap_hash);
+      if (!valid) continue;   // full, just hashing the rest
+
+      ChannelDetails ch;
+      unpackChannel(ch, rec);
+      if (host->onChannelLoaded(channel_idx, ch)) {
+        channel_idx++;
+      } else {  // full
+        valid = false;
       }
-      file.close();
     }
+    file.close();
+  } else {
+    valid = false;   // no snapshot yet
+  }
+  _channels_jnl_size = replayJournal(host, "/channels2.jnl", snap_size, snap_hash, valid);
+  _channels_synced = rebuildChannelHashes(host) && valid;
 }
 
-void DataStore::saveChannels(DataStoreHost* host) {
-  File file = openWrite(_getContactsChannelsFS(), "/channels2");
+void DataStore::writeChannelsSnapshot(DataStoreHost* host) {
+  FILESYSTEM* fs = _getContactsChannelsFS();
+  _channels_synced = false;
+
+  File file = openWrite(fs, "/channels2.tmp");
   if (file) {
-    uint8_t channel_idx = 0;
+    uint8_t buf[IO_BUF_SIZE];
+    int len = 0;
+    bool success = true, overflow = false;
+    uint32_t snap_size = 0, snap_hash = FNV_OFFSET_BASIS;
     ChannelDetails ch;
-    uint8_t unused[4];
-    memset(unused, 0, 4);
-
-    while (host->getChannelForSave(channel_idx, ch)) {
-      bool success = (file.write(unused, 4) == 4);
-      success = success && (file.write((uint8_t *)ch.name, 32) == 32);
-      success = success && (file.write((uint8_t *)ch.channel.secret, 32) == 32);
 
-      if (!success) break; // write failed
-      channel_idx++;
+    _num_channel_hashes = 0;
+    for (uint8_t channel_idx = 0; success && host->getChannelForSave(channel_idx, ch); channel_idx++) {
+      packChannel(&buf[len], ch);
+      if (_num_channel_hashes < STORE_JOURNAL_MAX_CHANNELS) {
+        _channel_hashes[_num_channel_hashes++] = recordHash(&buf[len], CHANNEL_REC_SIZE);
+      } else {
+        overflow = true;
+      }
+      snap_hash = recordHash(&buf[len], CHANNEL_REC_SIZE, snap_hash);
+      snap_size += CHANNEL_REC_SIZE;
+      len += CHANNEL_REC_SIZE;
+      if (len + CHANNEL_REC_SIZE > (int) sizeof(buf)) {
+        success = ((int) file.write(buf, len) == len);
+        len = 0;
+      }
     }
+    if (success && len > 0) success = ((int) file.write(buf, len) == len);
     file.close();
+
+    if (success) {
+      success = commitSnapshot("/channels2", "/channels2.tmp", "/channels2.jnl", snap_size, snap_hash, _channels_jnl_size);
+    } else {
+      fs->remove("/channels2.tmp");
+    }
+    _channels_synced = success && !overflow;
+  }
+}
+
+void DataStore::saveChannels(DataStoreHost* host) {
+  if (!_channels_synced || _channels_jnl_size >= STORE_JOURNAL_MAX_SIZE) {
+    writeChannelsSnapshot(host);
+    return;
+  }
+
+  File file = openAppend(_getContactsChannelsFS(), "/channels2.jnl");
+  if (!file) {
+    writeChannelsSnapshot(host);
+    return;
+  }
+
+  bool success = true;
+  uint8_t rec[1 + CHANNEL_REC_SIZE];
+  ChannelDetails ch;
+  for (uint8_t channel_idx = 0; success && host->getChannelForSave(channel_idx, ch); channel_idx++) {
+    if (channel_idx >= _num_channel_hashes) {  // new slot, not in summary
+      success = false;
+      break;
+    }
+    rec[0] = channel_idx;
+    packChannel(&rec[1], ch);
+    uint32_t hash = recordHash(&rec[1], CHANNEL_REC_SIZE);
+    if (_channel_hashes[channel_idx] != hash) {
+      success = appendJournal(file, _channels_jnl_size, JNL_CHANNEL_PUT, rec, sizeof(rec));
+      _channel_hashes[channel_idx] = hash;
+    }
+  }
+  file.close();
+
+  if (!success) {
+    writeChannelsSnapshot(host);
   }
 }
 
@@ -520,17 +896,48 @@ void DataStore::migrateToSecondaryFS() {
   }
 }
 
+void DataStore::loadBlobIndex() {
+  _num_blob_slots = 0;
+  File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
+  if (file) {
+    BlobRec tmp;
+    int hdr_len = offsetof(BlobRec, len);   // just timestamp + key
+    while (_num_blob_slots < MAX_BLOBRECS) {
+      file.seek(_num_blob_slots * sizeof(BlobRec));
+      if (file.read((uint8_t *) &tmp, hdr_len) != hdr_len) break;  // EOF
+
+      BlobIndexEntry* e = &_blob_index[_num_blob_slots++];
+      e->timestamp = tmp.timestamp;
+      memcpy(e->key, tmp.key, sizeof(e->key));
+    }
+    file.close();
+    _blob_index_valid = true;
+  }
+}
+
+int DataStore::findBlobSlot(const uint8_t key[]) const {
+  for (int i = 0; i < _num_blob_slots; i++) {
+    if (memcmp(key, _blob_index[i].key, sizeof(_blob_index[i].key)) == 0) return i;  // only match by 7 byte prefix
+  }
+  return -1;  // not found
+}
+
 uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
+  if (!_blob_index_valid) loadBlobIndex();
+
+  int slot = findBlobSlot(key);
+  if (slot < 0) return 0;  // not found
+
   File file = openRead(_getContactsChannelsFS(), "/adv_blobs");
-  uint8_t len = 0;  // 0 = not found
+  uint8_t len = 0;
   if (file) {
     BlobRec tmp;
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        len = tmp.len;
-        memcpy(dest_buf, tmp.data, len);
-        break;
-      }
+    file.seek(slot * sizeof(BlobRec));
+    if (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp) && memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {
+      len = tmp.len;
+      memcpy(dest_buf, tmp.data, len);
+    } else {
+      _blob_index_valid = false;   // file out of sync with index, rebuild next time
     }
     file.close();
   }
@@ -539,38 +946,44 @@ uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_b
 
 bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
   if (len < PUB_KEY_SIZE+4+SIGNATURE_SIZE || len > MAX_ADVERT_PKT_LEN) return false;
-  checkAdvBlobFile();
-  File file = _getContactsChannelsFS()->open("/adv_blobs", FILE_O_WRITE);
-  if (file) {
-    uint32_t pos = 0, found_pos = 0;
-    uint32_t min_timestamp = 0xFFFFFFFF;
+  if (!_blob_index_valid) {
+    checkAdvBlobFile();
+    loadBlobIndex();
+    if (_num_blob_slots == 0) return false;  // error
+  }
 
-    // search for matching key OR evict by oldest timestmap
-    BlobRec tmp;
-    file.seek(0);
-    while (file.read((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp)) {
-      if (memcmp(key, tmp.key, sizeof(tmp.key)) == 0) {  // only match by 7 byte prefix
-        found_pos = pos;
-        break;
-      }
-      if (tmp.timestamp < min_timestamp) {
-        min_timestamp = tmp.timestamp;
-        found_pos = pos;
+  // search for matching key OR evict by oldest timestamp
+  int slot = findBlobSlot(key);
+  if (slot < 0) {
+    uint32_t min_timestamp = 0xFFFFFFFF;
+    for (int i = 0; i < _num_blob_slots; i++) {
+      if (_blob_index[i].timestamp < min_timestamp) {
+        min_timestamp = _blob_index[i].timestamp;
+        slot = i;
       }
-
-      pos += sizeof(tmp);
     }
+    if (slot < 0) slot = 0;
+  }
 
+  File file = _getContactsChannelsFS()->open("/adv_blobs", FILE_O_WRITE);
+  if (file) {
+    BlobRec tmp;
     memcpy(tmp.key, key, sizeof(tmp.key));  // just record 7 byte prefix of key
     memcpy(tmp.data, src_buf, len);
     tmp.len = len;
     tmp.timestamp = _clock->getCurrentTime();
 
-    file.seek(found_pos);
-    file.write((uint8_t *) &tmp, sizeof(tmp));
-
+    file.seek(slot * sizeof(BlobRec));
+    bool success = (file.write((uint8_t *) &tmp, sizeof(tmp)) == sizeof(tmp));
     file.close();
-    return true;
+
+    if (success) {
+      _blob_index[slot].timestamp = tmp.timestamp;
+      memcpy(_blob_index[slot].key, tmp.key, sizeof(tmp.key));
+    } else {
+      _blob_index_valid = false;
+    }
+    return success;
   }
   return false; // error
 }
@@ -578,49 +991,74 @@ bool DataStore::deleteBlobByKey(const uint8_t key[], int key_len) {
   return true; // this is just a stub on NRF52/STM32 platforms
 }
 #else
-inline void makeBlobPath(const uint8_t key[], int key_len, char* path, size_t path_size) {
-  char fname[18];
-  if (key_len > 8) key_len = 8; // just use first 8 bytes (prefix)
-  mesh::Utils::toHex(fname, key, key_len);
-  sprintf(path, "/bl/%s", fname);
-}
-
-uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
-  char path[64];
-  makeBlobPath(key, key_len, path, sizeof(path));
+#define OLD_BLOB_PATH_SIZE   24   // '/bl/' + 16 hex chars, and null
+
+void DataStore::migrateBlobDir() {
+  // older firmware kept one file per key, in the '/bl' dir. Once the log exists, this has been done.
+  // NOTE: can't rely on just exists("/bl"), as that is always true on SPIFFS (no real dirs)
+  if (_fs->exists("/blobs")) return;
+
+  int count = 0, num_files = 0;
+  File dir = openRead(_fs, "/bl");
+  if (dir) {
+    uint8_t buf[BLOB_MAX_LEN], key[BLOB_KEY_SIZE];
+    File f = dir.openNextFile();
+    while (f) {
+      const char* name = strrchr(f.name(), '/');   // some cores return the full path
+      name = name ? name + 1 : f.name();
+      int len = f.isDirectory() ? 0 : f.read(buf, sizeof(buf));
+      if (len > 0 && strlen(name) == BLOB_KEY_SIZE*2 && mesh::Utils::fromHex(key, BLOB_KEY_SIZE, name)) {
+        _blobs.put(key, BLOB_KEY_SIZE, buf, len);
+        count++;
+      }
+      num_files++;
+      f.close();
+      f = dir.openNextFile();
+    }
+    dir.close();
+    _blobs.flush();
+    MESH_DEBUG_PRINTLN("migrateBlobDir: %d blobs migrated", count);
+  }
 
-  if (_fs->exists(path)) {
-    File f = openRead(_fs, path);
-    if (f) {
-      int len = f.read(dest_buf, 255); // currently MAX 255 byte blob len supported!!
+  // now remove old files. Names are collected in one pass first, as can't remove while iterating dir
+  char* paths = num_files > 0 ? new char[num_files * OLD_BLOB_PATH_SIZE] : NULL;
+  int num_paths = 0;
+  dir = paths ? openRead(_fs, "/bl") : File();
+  if (dir) {
+    File f = dir.openNextFile();
+    while (f && num_paths < num_files) {
+      const char* name = strrchr(f.name(), '/');
+      name = name ? name + 1 : f.name();
+      if (strlen(name) + 5 <= OLD_BLOB_PATH_SIZE) {
+        sprintf(&paths[num_paths++ * OLD_BLOB_PATH_SIZE], "/bl/%s", name);
+      }
       f.close();
-      return len;
+      f = dir.openNextFile();
     }
+    dir.close();
   }
-  return 0; // not found
-}
+  for (int i = 0; i < num_paths; i++) {
+    _fs->remove(&paths[i * OLD_BLOB_PATH_SIZE]);
+  }
+  delete[] paths;
+  _fs->rmdir("/bl");
 
-bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
-  char path[64];
-  makeBlobPath(key, key_len, path, sizeof(path));
+  if (!_fs->exists("/blobs")) {   // nothing was migrated, but still mark as done
+    File file = openWrite(_fs, "/blobs");
+    file.close();
+  }
+}
 
-  File f = openWrite(_fs, path);
-  if (f) {
-    int n = f.write(src_buf, len);
-    f.close();
-    if (n == len) return true; // success!
+uint8_t DataStore::getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
+  return _blobs.get(key, key_len, dest_buf);
+}
 
-    _fs->remove(path); // blob was only partially written!
-  }
-  return false; // error
+bool DataStore::putBlobByKey(const uint8_t key[], int key_len, const uint8_t src_buf[], uint8_t len) {
+  return _blobs.put(key, key_len, src_buf, len);
 }
 
 bool DataStore::deleteBlobByKey(const uint8_t key[], int key_len) {
-  char path[64];
-  makeBlobPath(key, key_len, path, sizeof(path));
-
-  _fs->remove(path);
-  
-  return true; // return true even if file did not exist
+  _blobs.remove(key, key_len);
+  return true; // return true even if key did not exist
 }
 #endif
@@ -3,31 +3,112 @@
 #include <helpers/IdentityStore.h>
 #include <helpers/ContactInfo.h>
 #include <helpers/ChannelDetails.h>
+#include <helpers/BlobLogStore.h>
 #include "NodePrefs.h"
 
 class DataStoreHost {
 public:
-  virtual bool onContactLoaded(const ContactInfo& contact) =0;
+  virtual bool onContactLoaded(const ContactInfo& contact) =0;   // NOTE: must replace any existing contact with same pub_key
+  virtual bool onContactDeleted(const uint8_t* pub_key_prefix, int prefix_len) =0;
   virtual bool getContactForSave(uint32_t idx, ContactInfo& contact) =0;
   virtual bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) =0;
   virtual bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) =0;
 };
 
+#ifndef MAX_CONTACTS
+  #define MAX_CONTACTS         100
+#endif
+
+#ifndef STORE_JOURNAL_MAX_SIZE
+  #define STORE_JOURNAL_MAX_SIZE   (16*1024)   // journal is compacted into a new snapshot beyond this size
+#endif
+
+#define STORE_JOURNAL_MAX_CHANNELS   64
+
+#if defined(EXTRAFS) || defined(QSPIFLASH)
+  #define MAX_BLOBRECS 100
+#else
+  #define MAX_BLOBRECS 20
+#endif
+
+/*
+  Contacts and channels are kept as a snapshot file (same format as always), plus an append-only journal of the
+  changes since. A save only appends records for the entries which have actually changed (detected via a hash of
+  each record), and the journal is compacted into a new snapshot once it grows past STORE_JOURNAL_MAX_SIZE.
+
+  A new snapshot is written to a '.tmp' file, then renamed over the old one, and only then is the journal reset.
+  The journal starts with a JNL_SNAPSHOT record (size + hash of the snapshot it applies to), so a journal left
+  over from an older snapshot (ie. power lost just after the rename) is never replayed onto the new one.
+
+  journal record:  seq(4) type(1) len(1) check(2) payload(len)
+*/
+#define CONTACT_REC_SIZE     152
+#define CHANNEL_REC_SIZE      68
+
+#define JNL_HEADER_SIZE        8
+#define JNL_MAX_PAYLOAD      CONTACT_REC_SIZE
+#define JNL_CONTACT_PUT        1    // payload: contact record
+#define JNL_CONTACT_DEL        2    // payload: pub_key prefix
+#define JNL_CHANNEL_PUT        3    // payload: channel_idx, channel record
+#define JNL_SNAPSHOT           4    // payload: size(4), hash(4) of the snapshot file, always the first record
+
+#define CONTACT_KEY_LEN        7
+
 class DataStore {
   FILESYSTEM* _fs;
   FILESYSTEM* _fsExtra;
   mesh::RTCClock* _clock;
   IdentityStore identity_store;
 
+  // summary of what's in the contacts and channels files (snapshot + journal), for only writing the changes
+  struct RecordSum {
+    uint8_t key[CONTACT_KEY_LEN];   // pub_key prefix
+    uint8_t seen;
+    uint32_t hash;
+  };
+  RecordSum* _contact_sums;
+  int _num_contact_sums;
+  uint32_t _channel_hashes[STORE_JOURNAL_MAX_CHANNELS];
+  int _num_channel_hashes;
+  bool _contacts_synced, _channels_synced;   // false = summary not valid, next save must write a new snapshot
+  uint32_t _contacts_jnl_size, _channels_jnl_size;
+  uint32_t _jnl_seq;
+
   void loadPrefsInt(const char *filename, NodePrefs& prefs, double& node_lat, double& node_lon);
+  void writeContactsSnapshot(DataStoreHost* host, bool (*filter)(const ContactInfo& c));
+  void writeChannelsSnapshot(DataStoreHost* host);
+  void initSummaries();
+  uint32_t replayJournal(DataStoreHost* host, const char* filename, uint32_t snap_size, uint32_t snap_hash, bool& valid);
+  bool commitSnapshot(const char* filename, const char* tmp_filename, const char* jnl_filename,
+                      uint32_t snap_size, uint32_t snap_hash, uint32_t& jnl_size);
+  bool appendJournal(File& file, uint32_t& jnl_size, uint8_t type, const uint8_t* payload, int len);
+  bool rebuildContactSums(DataStoreHost* host);
+  bool rebuildChannelHashes(DataStoreHost* host);
+  int findContactSum(const uint8_t* pub_key, int hint) const;
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  // RAM copy of the key + timestamp of each fixed slot in /adv_blobs (slot i is at offset i * sizeof(BlobRec))
+  struct BlobIndexEntry {
+    uint32_t timestamp;
+    uint8_t  key[7];
+  };
+  BlobIndexEntry _blob_index[MAX_BLOBRECS];
+  int _num_blob_slots;
+  bool _blob_index_valid;
+
   void checkAdvBlobFile();
+  void loadBlobIndex();
+  int findBlobSlot(const uint8_t key[]) const;
+#elif defined(ESP32) || defined(RP2040_PLATFORM)
+  BlobLogStore _blobs;
+
+  void migrateBlobDir();
 #endif
 
 public:
   DataStore(FILESYSTEM& fs, mesh::RTCClock& clock);
   DataStore(FILESYSTEM& fs, FILESYSTEM& fsExtra, mesh::RTCClock& clock);
   void begin();
+  void loop();
   bool formatFileSystem();
   FILESYSTEM* getPrimaryFS() const { return _fs; }
   FILESYSTEM* getSecondaryFS() const { return _fsExtra; }
@@ -62,11 +62,18 @@
 #define CMD_SET_DEFAULT_FLOOD_SCOPE   63
 #define CMD_GET_DEFAULT_FLOOD_SCOPE   64
 #define CMD_SEND_RAW_PACKET           65
+#define CMD_SYNC_MESSAGES             66   // bulk version of CMD_SYNC_NEXT_MESSAGE
+#define CMD_SET_FRAME_BATCHING        67   // only if DEVICE_CAP_FRAME_BATCHING
 
 // Stats sub-types for CMD_GET_STATS
 #define STATS_TYPE_CORE               0
 #define STATS_TYPE_RADIO              1
 #define STATS_TYPE_PACKETS             2
+#define STATS_TYPE_OFFLINE_QUEUE       3
+#define STATS_TYPE_LINK                4
+
+// capability bits, in RESP_CODE_DEVICE_INFO
+#define DEVICE_CAP_FRAME_BATCHING     0x01
 
 #define RESP_CODE_OK                  0
 #define RESP_CODE_ERR                 1
@@ -97,6 +104,10 @@
 #define RESP_ALLOWED_REPEAT_FREQ      26
 #define RESP_CODE_CHANNEL_DATA_RECV   27
 #define RESP_CODE_DEFAULT_FLOOD_SCOPE 28
+#define RESP_CODE_MSG_BATCH           29   // a reply to CMD_SYNC_MESSAGES
+
+#define MSG_BATCH_FLAG_MORE           0x01   // more RESP_CODE_MSG_BATCH frames follow
+#define MSG_BATCH_HEADER_SIZE         9
 
 #define MAX_CHANNEL_DATA_LENGTH       (MAX_FRAME_SIZE - 9)
 
@@ -211,47 +222,52 @@ void MyMesh::updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, co
   }
 }
 
-bool MyMesh::Frame::isChannelMsg() const {
-  return buf[0] == RESP_CODE_CHANNEL_MSG_RECV || buf[0] == RESP_CODE_CHANNEL_MSG_RECV_V3 ||
-         buf[0] == RESP_CODE_CHANNEL_DATA_RECV;
+static bool isChannelMsg(const uint8_t frame[]) {
+  return frame[0] == RESP_CODE_CHANNEL_MSG_RECV || frame[0] == RESP_CODE_CHANNEL_MSG_RECV_V3 ||
+         frame[0] == RESP_CODE_CHANNEL_DATA_RECV;
 }
 
 void MyMesh::addToOfflineQueue(const uint8_t frame[], int len) {
-  if (offline_queue_len >= OFFLINE_QUEUE_SIZE) {
-    MESH_DEBUG_PRINTLN("WARN: offline_queue is full!");
-    int pos = 0;
-    while (pos < offline_queue_len) {
-      if (offline_queue[pos].isChannelMsg()) {
-        for (int i = pos; i < offline_queue_len - 1; i++) { // delete oldest channel msg from queue
-          offline_queue[i] = offline_queue[i + 1];
-        }
-        MESH_DEBUG_PRINTLN("INFO: removed oldest channel message from queue.");
-        offline_queue[offline_queue_len - 1].len = len;
-        memcpy(offline_queue[offline_queue_len - 1].buf, frame, len);
-        return;
-      }
-      pos++;
-    }
-    MESH_DEBUG_PRINTLN("INFO: no channel messages to remove from queue.");
-  } else {
-    offline_queue[offline_queue_len].len = len;
-    memcpy(offline_queue[offline_queue_len].buf, frame, len);
-    offline_queue_len++;
-  }
+  offline_queue.add(frame, len, isChannelMsg(frame));
 }
 
 int MyMesh::getFromOfflineQueue(uint8_t frame[]) {
-  if (offline_queue_len > 0) {         // check offline queue
-    size_t len = offline_queue[0].len; // take from top of queue
-    memcpy(frame, offline_queue[0].buf, len);
+  return offline_queue.get(frame);
+}
 
-    offline_queue_len--;
-    for (int i = 0; i < offline_queue_len; i++) { // delete top item from queue
-      offline_queue[i] = offline_queue[i + 1];
+void MyMesh::writeMsgBatchFrame() {
+  int i = MSG_BATCH_HEADER_SIZE;
+  int count = 0;
+  QueuedFrame f;
+  while ((_sync_max == 0 || _sync_count < _sync_max) && offline_queue.readNext(f)) {
+    if (i + 1 + f.len > MAX_FRAME_SIZE) {
+      if (count == 0) {   // frame too big to pack, just send it as-is (will be acked by next batch frame)
+        _serial->writeFrame(f.buf, f.len);
+        _sync_token = f.seq;
+        _sync_count++;
+        return;
+      }
+      offline_queue.unreadLast();   // send in next batch frame
+      break;
     }
-    return len;
+    out_frame[i++] = f.len;
+    memcpy(&out_frame[i], f.buf, f.len); i += f.len;
+    _sync_token = f.seq;
+    _sync_count++;
+    count++;
   }
-  return 0; // queue is empty
+
+  int remaining = offline_queue.getNumUnread();
+  bool more = remaining > 0 && (_sync_max == 0 || _sync_count < _sync_max);
+  if (!more) _sync_started = false;
+
+  out_frame[0] = RESP_CODE_MSG_BATCH;
+  out_frame[1] = more ? MSG_BATCH_FLAG_MORE : 0;
+  out_frame[2] = count;
+  memcpy(&out_frame[3], &_sync_token, 4);
+  uint16_t rem = remaining > 0xFFFF ? 0xFFFF : remaining;
+  memcpy(&out_frame[7], &rem, 2);
+  _serial->writeFrame(out_frame, i);
 }
 
 float MyMesh::getAirtimeBudgetFactor() const {
@@ -465,7 +481,7 @@ void MyMesh::queueMessage(const ContactInfo &from, uint8_t txt_type, mesh::Packe
   // we only want to show text messages on display, not cli data
   bool should_display = txt_type == TXT_TYPE_PLAIN || txt_type == TXT_TYPE_SIGNED_PLAIN;
   if (should_display && _ui) {
-    _ui->newMsg(path_len, from.name, text, offline_queue_len);
+    _ui->newMsg(path_len, from.name, text, offline_queue.size());
     if (!_serial->isConnected()) {
       _ui->notify(UIEventType::contactMessage);
     }
@@ -582,7 +598,7 @@ void MyMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packe
   if (getChannel(channel_idx, channel_details)) {
     channel_name = channel_details.name;
   }
-  if (_ui) _ui->newMsg(path_len, channel_name, text, offline_queue_len);
+  if (_ui) _ui->newMsg(path_len, channel_name, text, offline_queue.size());
 #endif
 }
 
@@ -856,8 +872,9 @@ MyMesh::MyMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMe
     : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables),
       _serial(NULL), telemetry(MAX_PACKET_PAYLOAD - 4), _store(&store), _ui(ui) {
   _iter_started = false;
+  _sync_started = false;
+  _sync_token = 0;
   _cli_rescue = false;
-  offline_queue_len = 0;
   app_target_ver = 0;
   clearPendingReqs();
   next_ack_idx = 0;
@@ -955,6 +972,8 @@ void MyMesh::begin(bool has_display) {
   _active_ble_pin = 0;
 #endif
 
+  offline_queue.begin(_store);
+
   resetContacts();
   _store->loadContacts(this);
   bootstrapRTCfromContacts();
@@ -1025,6 +1044,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     i += 20;
     out_frame[i++] = _prefs.client_repeat;   // v9+
     out_frame[i++] = _prefs.path_hash_mode;  // v10+
+    out_frame[i++] = _serial->supportsFrameBatching() ? DEVICE_CAP_FRAME_BATCHING : 0;
     _serial->writeFrame(out_frame, i);
   } else if (cmd_frame[0] == CMD_APP_START &&
              len >= 8) { // sent when app establishes connection, respond with node ID
@@ -1034,6 +1054,7 @@ void MyMesh::handleCmdFrame(size_t len) {
     MESH_DEBUG_PRINTLN("App %s connected", app_name);
 
     _iter_started = false; // stop any left-over ContactsIterator
+    _sync_started = false;
     int i = 0;
     out_frame[i++] = RESP_CODE_SELF_INFO;
     out_frame[i++] = ADV_TYPE_CHAT; // what this node Advert identifies as (maybe node's pronouns too?? :-)
@@ -1356,12 +1377,39 @@ void MyMesh::handleCmdFrame(size_t len) {
     if ((out_len = getFromOfflineQueue(out_frame)) > 0) {
       _serial->writeFrame(out_frame, out_len);
 #ifdef DISPLAY_CLASS
-      if (_ui) _ui->msgRead(offline_queue_len);
+      if (_ui) _ui->msgRead(offline_queue.size());
 #endif
     } else {
       out_frame[0] = RESP_CODE_NO_MORE_MESSAGES;
       _serial->writeFrame(out_frame, 1);
     }
+  } else if (cmd_frame[0] == CMD_SYNC_MESSAGES && len >= 2) {
+    if (_sync_started) {
+      writeErrFrame(ERR_CODE_BAD_STATE); // previous sync still sending
+    } else {
+      if (len >= 6) { // has token from last RESP_CODE_MSG_BATCH, ie. app has stored msgs up to here
+        uint32_t token;
+        memcpy(&token, &cmd_frame[2], 4);
+        if (token != 0 && (int32_t)(token - _sync_token) <= 0) { // can only ack what has been sent
+          offline_queue.ack(token);
+#ifdef DISPLAY_CLASS
+          if (_ui) _ui->msgRead(offline_queue.size());
+#endif
+        }
+      }
+      offline_queue.rewind(); // anything not acked gets sent again
+      _sync_max = cmd_frame[1];   // 0 = no limit
+      _sync_count = 0;
+      _sync_started = true;
+      if (!_serial->isWriteBusy()) writeMsgBatchFrame();
+    }
+  } else if (cmd_frame[0] == CMD_SET_FRAME_BATCHING && len >= 2) {
+    if (cmd_frame[1] && !_serial->supportsFrameBatching()) {
+      writeErrFrame(ERR_CODE_UNSUPPORTED_CMD);
+    } else {
+      writeOKFrame();   // NOTE: this reply is still sent un-batched
+      _serial->setFrameBatching(cmd_frame[1] != 0);
+    }
   } else if (cmd_frame[0] == CMD_SET_RADIO_PARAMS) {
     int i = 1;
     uint32_t freq;
@@ -1890,6 +1938,41 @@ void MyMesh::handleCmdFrame(size_t len) {
       memcpy(&out_frame[i], &n_recv_direct, 4); i += 4;
       memcpy(&out_frame[i], &n_recv_errors, 4); i += 4;
       _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_OFFLINE_QUEUE) {
+      int i = 0;
+      out_frame[i++] = RESP_CODE_STATS;
+      out_frame[i++] = STATS_TYPE_OFFLINE_QUEUE;
+      uint16_t queued = offline_queue.size();
+      uint16_t queued_channel = offline_queue.getNumChannelMsgs();
+      uint16_t in_flash = offline_queue.getNumInFlash();
+      uint32_t dropped = offline_queue.getNumDropped();
+      uint32_t evicted = offline_queue.getNumEvicted();
+      uint32_t spilled = offline_queue.getNumSpilled();
+      memcpy(&out_frame[i], &queued, 2); i += 2;
+      memcpy(&out_frame[i], &queued_channel, 2); i += 2;
+      memcpy(&out_frame[i], &in_flash, 2); i += 2;
+      memcpy(&out_frame[i], &dropped, 4); i += 4;
+      memcpy(&out_frame[i], &evicted, 4); i += 4;
+      memcpy(&out_frame[i], &spilled, 4); i += 4;
+      _serial->writeFrame(out_frame, i);
+    } else if (stats_type == STATS_TYPE_LINK) {
+      SerialLinkStats link;
+      if (_serial->getLinkStats(link)) {
+        int i = 0;
+        out_frame[i++] = RESP_CODE_STATS;
+        out_frame[i++] = STATS_TYPE_LINK;
+        memcpy(&out_frame[i], &link.frames_sent, 4); i += 4;
+        memcpy(&out_frame[i], &link.frames_recv, 4); i += 4;
+        memcpy(&out_frame[i], &link.bytes_sent, 4); i += 4;
+        memcpy(&out_frame[i], &link.bytes_recv, 4); i += 4;
+        memcpy(&out_frame[i], &link.writes, 4); i += 4;
+        memcpy(&out_frame[i], &link.write_retries, 4); i += 4;
+        memcpy(&out_frame[i], &link.mtu, 2); i += 2;
+        memcpy(&out_frame[i], &link.interval_millis, 2); i += 2;
+        _serial->writeFrame(out_frame, i);
+      } else {
+        writeErrFrame(ERR_CODE_UNSUPPORTED_CMD);
+      }
     } else {
       writeErrFrame(ERR_CODE_ILLEGAL_ARG); // invalid stats sub-type
     }
@@ -2000,6 +2083,16 @@ void MyMesh::saveContacts() {
   _store->saveContacts(this, save_filter);
 }
 
+bool MyMesh::onContactLoaded(const ContactInfo& contact) {
+  ContactInfo* existing = lookupContactByPubKey(contact.id.pub_key, PUB_KEY_SIZE);
+  if (existing) {   // a later journal record for same contact
+    *existing = contact;
+    existing->shared_secret_valid = false;
+    return true;
+  }
+  return addContact(contact);
+}
+
 void MyMesh::enterCLIRescue() {
   _cli_rescue = true;
   cli_command[0] = 0;
@@ -2208,6 +2301,8 @@ void MyMesh::checkSerialInterface() {
       _serial->writeFrame(out_frame, 5);
       _iter_started = false;
     }
+  } else if (_sync_started && !_serial->isWriteBusy()) {
+    writeMsgBatchFrame();
   //} else if (!_serial->isWriteBusy()) {
   //  checkConnections();    // TODO - deprecate the 'Connections' stuff
   }
@@ -2227,6 +2322,7 @@ void MyMesh::loop() {
     saveContacts();
     dirty_contacts_expiry = 0;
   }
+  _store->loop();
 
 #ifdef DISPLAY_CLASS
   if (_ui) _ui->setHasConnection(_serial->isConnected());
@@ -2252,3 +2348,9 @@ bool MyMesh::advert() {
 bool MyMesh::hasPendingWork() const {
   return _mgr->getOutboundTotal() > 0 || dirty_contacts_expiry != 0;
 }
+
+unsigned long MyMesh::getNextWakeupMillis() const {
+  unsigned long next = BaseChatMesh::getNextWakeupMillis();
+  if (dirty_contacts_expiry) keepSooner(next, dirty_contacts_expiry);
+  return next;   // NOTE: serial/BLE interface still needs polling separately
+}
@@ -25,6 +25,7 @@
 
 #include "DataStore.h"
 #include "NodePrefs.h"
+#include "OfflineQueue.h"
 
 #include <RTClib.h>
 #include <helpers/ArduinoHelpers.h>
@@ -59,10 +60,6 @@
 #define MAX_CONTACTS 100
 #endif
 
-#ifndef OFFLINE_QUEUE_SIZE
-#define OFFLINE_QUEUE_SIZE 16
-#endif
-
 #ifndef BLE_NAME_PREFIX
 #define BLE_NAME_PREFIX "MeshCore-"
 #endif
@@ -117,6 +114,7 @@ protected:
   void sendFloodScoped(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t delay_millis=0) override;
 
   void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) override;
+  bool wantsRxRaw() const override { return _serial->isConnected(); }
   bool isAutoAddEnabled() const override;
   bool shouldAutoAddContactType(uint8_t type) const override;
   bool shouldOverwriteWhenFull() const override;
@@ -154,7 +152,11 @@ protected:
   void onSendTimeout() override;
 
   // DataStoreHost methods
-  bool onContactLoaded(const ContactInfo& contact) override { return addContact(contact); }
+  bool onContactLoaded(const ContactInfo& contact) override;
+  bool onContactDeleted(const uint8_t* pub_key_prefix, int prefix_len) override {
+    ContactInfo* c = lookupContactByPubKey(pub_key_prefix, prefix_len);
+    return c && removeContact(*c);
+  }
   bool getContactForSave(uint32_t idx, ContactInfo& contact) override { return getContactByIdx(idx, contact); }
   bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override { return setChannel(channel_idx, ch); }
   bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override { return getChannel(channel_idx, ch); }
@@ -179,6 +181,7 @@ public:
 
   // To check if there is pending work
   bool hasPendingWork() const;
+  unsigned long getNextWakeupMillis() const override;
 
 private:
   void writeOKFrame();
@@ -188,6 +191,7 @@ private:
   void updateContactFromFrame(ContactInfo &contact, uint32_t& last_mod, const uint8_t *frame, int len);
   void addToOfflineQueue(const uint8_t frame[], int len);
   int getFromOfflineQueue(uint8_t frame[]);
+  void writeMsgBatchFrame();
   int getBlobByKey(const uint8_t key[], int key_len, uint8_t dest_buf[]) override { 
     return _store->getBlobByKey(key, key_len, dest_buf);
   }
@@ -217,6 +221,10 @@ private:
   uint32_t _most_recent_lastmod;
   uint32_t _active_ble_pin;
   bool _iter_started;
+  bool _sync_started;    // a CMD_SYNC_MESSAGES is streaming RESP_CODE_MSG_BATCH frames
+  uint8_t _sync_max;
+  int _sync_count;
+  uint32_t _sync_token;  // seq of last queued frame sent to app
   bool _cli_rescue;
   bool send_unscoped;   // force un-scoped flood (instead of using send_scope)
   char cli_command[80];
@@ -231,14 +239,7 @@ private:
   uint8_t out_frame[MAX_FRAME_SIZE + 1];
   CayenneLPP telemetry;
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
-
-    bool isChannelMsg() const;
-  };
-  int offline_queue_len;
-  Frame offline_queue[OFFLINE_QUEUE_SIZE];
+  OfflineQueue offline_queue;
 
   struct AckTableEntry {
     unsigned long msg_sent;
@@ -0,0 +1,213 @@
+#include "OfflineQueue.h"
+
+FrameLane::FrameLane(int ram_size, const char* filename, int max_file_slots)
+    : _store(NULL), _fs(NULL), _filename(filename), _max_file_slots(max_file_slots)
+{
+  _ram_size = ram_size > 0 ? ram_size : 1;
+  _ram = new QueuedFrame[_ram_size];
+  _ram_head = _ram_count = 0;
+  _file_slots = _file_head = _file_count = 0;
+}
+
+void FrameLane::begin(DataStore* store) {
+  _store = store;
+  _fs = store->getSecondaryFS() ? store->getSecondaryFS() : store->getPrimaryFS();
+  if (_fs->exists(_filename)) {
+    _fs->remove(_filename);   // queue doesn't survive reboot, so discard stale frames
+  }
+  _file_slots = _file_head = _file_count = 0;
+}
+
+bool FrameLane::canGrowFile() const {
+  if (_file_slots >= _max_file_slots) return false;
+  if ((_file_slots % 16) != 0) return true;   // only check storage every 16 slots
+
+  uint32_t total_kb = _store->getStorageTotalKb();
+  return total_kb == 0 || total_kb - _store->getStorageUsedKb() > OFFLINE_SPILL_MIN_FREE_KB;  // leave room for contacts, etc
+}
+
+bool FrameLane::readSlot(int slot, QueuedFrame& dest) {
+  File file = _store->openRead(_fs, _filename);
+  if (!file) return false;
+
+  file.seek(slot * OFFLINE_SLOT_SIZE);
+  bool success = file.read((uint8_t *) &dest.seq, 4) == 4 && file.read(&dest.len, 1) == 1
+                && dest.len <= MAX_FRAME_SIZE && file.read(dest.buf, dest.len) == dest.len;
+  file.close();
+  return success;
+}
+
+bool FrameLane::writeSlot(int slot, const QueuedFrame& src, bool full_slot) {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  File file = _fs->open(_filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  File file = _fs->open(_filename, _file_slots > 0 ? "r+" : "w+");
+#else
+  File file = _fs->open(_filename, _file_slots > 0 ? "r+" : "w+", true);
+#endif
+  if (!file) return false;
+
+  int len = full_slot ? MAX_FRAME_SIZE : src.len;   // when growing, write whole slot so next slot offset is valid
+  file.seek(slot * OFFLINE_SLOT_SIZE);
+  bool success = file.write((const uint8_t *) &src.seq, 4) == 4 && file.write(&src.len, 1) == 1
+                && (int) file.write(src.buf, len) == len;
+  file.close();
+  return success;
+}
+
+bool FrameLane::push(const QueuedFrame& frame) {
+  if (_file_count == 0 && _ram_count < _ram_size) {
+    _ram[(_ram_head + _ram_count) % _ram_size] = frame;
+    _ram_count++;
+    return true;
+  }
+  if (_fs == NULL) return false;   // full
+
+  if (_file_count < _file_slots) {
+    if (!writeSlot((_file_head + _file_count) % _file_slots, frame, false)) return false;
+    _file_count++;
+    return true;
+  }
+
+  // all slots used, try to add one (only possible while ring hasn't wrapped)
+  if (_file_head != 0 || !canGrowFile()) return false;
+  if (!writeSlot(_file_slots, frame, true)) {
+    _max_file_slots = _file_slots;   // eg. storage full, don't keep trying
+    return false;
+  }
+  _file_slots++;
+  _file_count++;
+  return true;
+}
+
+bool FrameLane::pop(QueuedFrame& dest) {
+  if (_ram_count == 0) return false;  // empty
+
+  dest = _ram[_ram_head];
+  _ram_head = (_ram_head + 1) % _ram_size;
+  _ram_count--;
+
+  // move oldest from file into RAM. An unreadable slot is skipped, as RAM must only be empty when the file is too
+  while (_file_count > 0) {
+    bool success = readSlot(_file_head, _ram[(_ram_head + _ram_count) % _ram_size]);
+    if (!success) {
+      MESH_DEBUG_PRINTLN("FrameLane: unable to read slot %d of %s", _file_head, _filename);
+    }
+    _file_head = (_file_head + 1) % _file_slots;
+    _file_count--;
+    if (_file_count == 0) _file_head = 0;   // so file can grow again, if needed
+    if (success) {
+      _ram_count++;
+      break;
+    }
+  }
+  return true;
+}
+
+bool FrameLane::peekAt(int i, QueuedFrame& dest) {
+  if (i < 0 || i >= size()) return false;
+
+  if (i < _ram_count) {
+    dest = _ram[(_ram_head + i) % _ram_size];
+    return true;
+  }
+  return readSlot((_file_head + i - _ram_count) % _file_slots, dest);
+}
+
+OfflineQueue::OfflineQueue()
+    : _direct(OFFLINE_QUEUE_SIZE / 2, "/offline_q", OFFLINE_SPILL_FRAMES),
+      _channel(OFFLINE_QUEUE_SIZE / 2, "/offline_qc", OFFLINE_SPILL_FRAMES)
+{
+  _next_seq = 0;
+  _num_dropped = _num_evicted = _num_spilled = 0;
+  _read_direct = _read_channel = 0;
+  _last_read_channel = false;
+}
+
+void OfflineQueue::popLane(FrameLane& lane, QueuedFrame& dest) {
+  lane.pop(dest);
+  int& cursor = &lane == &_channel ? _read_channel : _read_direct;
+  if (cursor > 0) cursor--;   // keep read cursor on same frame
+  if (cursor > lane.size()) cursor = lane.size();   // unreadable frames were skipped
+}
+
+void OfflineQueue::begin(DataStore* store) {
+  _direct.begin(store);
+  _channel.begin(store);
+}
+
+bool OfflineQueue::add(const uint8_t frame[], int len, bool is_channel_msg) {
+  if (len <= 0 || len > MAX_FRAME_SIZE) return false;
+
+  QueuedFrame f;
+  f.seq = ++_next_seq;
+  f.len = len;
+  memcpy(f.buf, frame, len);
+
+  FrameLane& lane = is_channel_msg ? _channel : _direct;
+  int in_file = lane.getNumInFile();
+  if (!lane.push(f)) {
+    if (is_channel_msg && lane.size() > 0) {
+      QueuedFrame oldest;
+      popLane(lane, oldest);   // evict oldest channel msg
+      _num_evicted++;
+      MESH_DEBUG_PRINTLN("INFO: offline queue full, removed oldest channel message");
+      in_file = lane.getNumInFile();
+      if (lane.push(f)) {
+        if (lane.getNumInFile() > in_file) _num_spilled++;
+        return true;
+      }
+    }
+    _num_dropped++;
+    MESH_DEBUG_PRINTLN("WARN: offline queue is full, frame dropped");
+    return false;
+  }
+  if (lane.getNumInFile() > in_file) _num_spilled++;
+  return true;
+}
+
+int OfflineQueue::get(uint8_t frame[]) {
+  const QueuedFrame* d = _direct.peek();
+  const QueuedFrame* c = _channel.peek();
+  if (d == NULL && c == NULL) return 0;  // queue is empty
+
+  // take the earliest from either lane
+  FrameLane& lane = (c == NULL || (d && (int32_t)(d->seq - c->seq) < 0)) ? _direct : _channel;
+  QueuedFrame f;
+  if (lane.size() == 0) return 0;
+  popLane(lane, f);
+  memcpy(frame, f.buf, f.len);
+  return f.len;
+}
+
+bool OfflineQueue::readNext(QueuedFrame& dest) {
+  QueuedFrame c;
+  bool has_d = _direct.peekAt(_read_direct, dest);
+  bool has_c = _channel.peekAt(_read_channel, c);
+  if (!has_d && !has_c) return false;  // no more
+
+  if (has_d && (!has_c || (int32_t)(dest.seq - c.seq) < 0)) {
+    _read_direct++;
+    _last_read_channel = false;
+  } else {
+    dest = c;
+    _read_channel++;
+    _last_read_channel = true;
+  }
+  return true;
+}
+
+int OfflineQueue::ack(uint32_t seq) {
+  int n = 0;
+  QueuedFrame f;
+  const QueuedFrame* d;
+  while ((d = _direct.peek()) != NULL && (int32_t)(d->seq - seq) <= 0) {
+    popLane(_direct, f);
+    n++;
+  }
+  while ((d = _channel.peek()) != NULL && (int32_t)(d->seq - seq) <= 0) {
+    popLane(_channel, f);
+    n++;
+  }
+  return n;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Arduino.h>
+#include <helpers/BaseSerialInterface.h>
+#include "DataStore.h"
+
+#ifndef OFFLINE_QUEUE_SIZE
+  #define OFFLINE_QUEUE_SIZE 16    // frames held in RAM (split between the two lanes)
+#endif
+
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  #if defined(EXTRAFS) || defined(QSPIFLASH)
+    #define OFFLINE_SPILL_DEFAULT       512
+    #define OFFLINE_SPILL_MIN_FREE_KB    64
+  #else
+    #define OFFLINE_SPILL_DEFAULT        16    // InternalFS is small
+    #define OFFLINE_SPILL_MIN_FREE_KB     8
+  #endif
+#else
+  #define OFFLINE_SPILL_DEFAULT        1024
+  #define OFFLINE_SPILL_MIN_FREE_KB      64
+#endif
+
+#ifndef OFFLINE_SPILL_FRAMES
+  #define OFFLINE_SPILL_FRAMES  OFFLINE_SPILL_DEFAULT   // max frames per lane, in flash. File only grows as needed
+#endif
+
+#define OFFLINE_SLOT_HEADER_SIZE   5    // seq + len
+#define OFFLINE_SLOT_SIZE          (OFFLINE_SLOT_HEADER_SIZE + MAX_FRAME_SIZE)   // in the spill file
+
+struct QueuedFrame {
+  uint32_t seq;    // arrival order, across lanes
+  uint8_t len;
+  uint8_t buf[MAX_FRAME_SIZE];
+};
+
+/**
+ * \brief  FIFO of frames: a RAM ring holding the oldest frames, which overflows into a ring of fixed size
+ *       slots in a file. All push/pop are O(1), with at most one slot read or write.
+*/
+class FrameLane {
+  QueuedFrame* _ram;
+  int _ram_size, _ram_head, _ram_count;
+  DataStore* _store;
+  FILESYSTEM* _fs;
+  const char* _filename;
+  int _max_file_slots, _file_slots;   // file size is _file_slots, grown on demand
+  int _file_head, _file_count;
+
+  bool canGrowFile() const;
+  bool readSlot(int slot, QueuedFrame& dest);
+  bool writeSlot(int slot, const QueuedFrame& src, bool full_slot);
+
+public:
+  FrameLane(int ram_size, const char* filename, int max_file_slots);
+
+  void begin(DataStore* store);
+  bool push(const QueuedFrame& frame);    // returns false if full
+  bool pop(QueuedFrame& dest);
+  const QueuedFrame* peek() const { return _ram_count > 0 ? &_ram[_ram_head] : NULL; }
+  bool peekAt(int i, QueuedFrame& dest);   // i'th frame from head, without removing
+  int size() const { return _ram_count + _file_count; }
+  int getNumInFile() const { return _file_count; }
+};
+
+/**
+ * \brief  the companion's queue of frames (received msgs, etc) waiting for the app to sync them.
+ *       Retention when full: channel msgs evict the oldest channel msg, all other frames are kept in favour of
+ *       the newest (which is dropped), so that channel traffic can never push out direct msgs.
+*/
+class OfflineQueue {
+  FrameLane _direct, _channel;
+  uint32_t _next_seq;
+  uint32_t _num_dropped, _num_evicted, _num_spilled;
+  int _read_direct, _read_channel;   // read cursor (frames from head of each lane), for bulk sync
+  bool _last_read_channel;
+
+  void popLane(FrameLane& lane, QueuedFrame& dest);
+
+public:
+  OfflineQueue();
+
+  void begin(DataStore* store);
+  bool add(const uint8_t frame[], int len, bool is_channel_msg);
+  int get(uint8_t frame[]);   // returns len, or 0 if empty
+
+  /**
+   * \brief  reads frames in arrival order, from the read cursor, WITHOUT removing them. Frames are only removed
+   *       once the app acknowledges them with ack(), so a bulk sync interrupted by a disconnect loses nothing.
+  */
+  void rewind() { _read_direct = _read_channel = 0; }
+  bool readNext(QueuedFrame& dest);
+  void unreadLast() { if (_last_read_channel) _read_channel--; else _read_direct--; }
+
+  /**
+   * \brief  removes all frames with seq up to and including 'seq'
+   * \returns  number of frames removed
+  */
+  int ack(uint32_t seq);
+
+  int size() const { return _direct.size() + _channel.size(); }
+  int getNumUnread() const { return size() - _read_direct - _read_channel; }
+  int getNumChannelMsgs() const { return _channel.size(); }
+  int getNumInFlash() const { return _direct.getNumInFile() + _channel.getNumInFile(); }
+  uint32_t getNumDropped() const { return _num_dropped; }
+  uint32_t getNumEvicted() const { return _num_evicted; }
+  uint32_t getNumSpilled() const { return _num_spilled; }
+};
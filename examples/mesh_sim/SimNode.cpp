@@ -0,0 +1,85 @@
+#include "SimNode.h"
+#include "Simulator.h"
+#include <stdio.h>
+
+void SimRNG::random(uint8_t* dest, size_t sz) {
+  while (sz > 0) {
+    uint64_t x = (_state += 0x9e3779b97f4a7c15ULL);
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    x ^= (x >> 31);
+    for (int i = 0; i < 8 && sz > 0; i++, sz--) {
+      *dest++ = (uint8_t) x;
+      x >>= 8;
+    }
+  }
+}
+
+SimNode::SimNode(Simulator* sim, int id, bool repeat, const SimNodePrefs& prefs, const mesh::GroupChannel& channel,
+                 SimRadio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc,
+                 StaticPoolPacketManager& mgr, SimpleMeshTables& tables, SimpleNeighbourTable* neighbours)
+  : mesh::Mesh(radio, ms, rng, rtc, mgr, tables), _sim(sim), _id(id), _repeat(repeat), _prefs(prefs), _channel(channel)
+{
+  self_id = mesh::LocalIdentity(&rng);
+  setNeighbourTable(neighbours);
+}
+
+int SimNode::calcRxDelay(float score, uint32_t air_time) const {
+  if (_prefs.rx_delay_base <= 0.0f) return 0;
+  return (int)((pow(_prefs.rx_delay_base, 0.85f - score) - 1.0) * air_time);
+}
+
+bool SimNode::allowPacketForward(const mesh::Packet* packet) {
+  if (!_repeat) return false;
+  if (packet->isRouteFlood() && packet->getPathHashCount() >= _prefs.flood_max) return false;
+  return true;
+}
+
+uint32_t SimNode::getRetransmitDelay(const mesh::Packet* packet) {
+  uint32_t t = (_radio->getEstAirtimeFor(packet->getPathByteLen() + packet->payload_len + 2) * _prefs.tx_delay_factor);
+  uint8_t n = packet->getPathHashCount();
+  if (_prefs.flood_delay_snr && getNeighbours() && n >= 2) {   // path[n-2] is the neighbour it was heard from
+    uint8_t sz = packet->getPathHashSize();
+    const NeighbourInfo* from = getNeighbours()->lookup(&packet->path[(n - 2) * sz], sz);
+    if (from) {
+      float scale = 1.0f + from->snr_avg / 20.0f;
+      if (scale < 0.5f) scale = 0.5f;
+      if (scale > 1.5f) scale = 1.5f;
+      t = (uint32_t)(t * scale);
+    }
+  }
+  return getRNG()->nextInt(0, 5*t + 1);
+}
+uint32_t SimNode::getDirectRetransmitDelay(const mesh::Packet* packet) {
+  uint32_t t = (_radio->getEstAirtimeFor(packet->getPathByteLen() + packet->payload_len + 2) * _prefs.direct_tx_delay_factor);
+  return getRNG()->nextInt(0, 5*t + 1);
+}
+
+int SimNode::searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel channels[], int max_matches) {
+  if (max_matches < 1 || memcmp(hash, _channel.hash, PATH_HASH_SIZE) != 0) return 0;
+  channels[0] = _channel;
+  return 1;
+}
+
+void SimNode::onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) {
+  if (type != PAYLOAD_TYPE_GRP_TXT || len < 8) return;
+
+  uint32_t msg_id;
+  memcpy(&msg_id, &data[4], 4);    // after timestamp
+  _sim->onMessageRecv(_id, msg_id, packet->getPathHashCount());
+}
+
+bool SimNode::sendGroupMessage(uint32_t msg_id) {
+  uint8_t temp[8 + 32];
+  uint32_t timestamp = getRTCClock()->getCurrentTimeUnique();
+  memcpy(temp, &timestamp, 4);
+  memcpy(&temp[4], &msg_id, 4);
+  int len = 8 + sprintf((char *) &temp[8], "node%d: message %u", _id, msg_id);   // typical text length
+
+  auto pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_TXT, _channel, temp, len);
+  if (pkt) {
+    sendFlood(pkt);
+    return true;
+  }
+  return false;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <Mesh.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleNeighbourTable.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include "SimRadio.h"
+
+class Simulator;
+
+class SimMillis final : public mesh::MillisecondClock {
+  const unsigned long* _now;
+public:
+  SimMillis(const unsigned long* now) : _now(now) { }
+  unsigned long getMillis() override { return *_now; }
+};
+
+class SimRTC final : public mesh::RTCClock {
+  const unsigned long* _now;
+  uint32_t _base;
+public:
+  SimRTC(const unsigned long* now, uint32_t base) : _now(now), _base(base) { }
+  uint32_t getCurrentTime() override { return _base + *_now / 1000; }
+  void setCurrentTime(uint32_t time) override { _base = time - *_now / 1000; }
+};
+
+/**
+ * \brief  deterministic RNG (splitmix64), so that a given seed always reproduces the same run.
+*/
+class SimRNG final : public mesh::RNG {
+  uint64_t _state;
+public:
+  SimRNG(uint64_t seed) : _state(seed) { }
+  void random(uint8_t* dest, size_t sz) override;
+};
+
+struct SimNodePrefs {
+  float tx_delay_factor = 0.5f;
+  float direct_tx_delay_factor = 0.3f;
+  float rx_delay_base = 0.0f;
+  uint8_t flood_max = 64;
+  uint8_t flood_suppress = 0;
+  float flood_suppress_snr = -30.0f;
+  bool flood_delay_snr = false;     // scale flood retransmit delay by SNR of neighbour heard from (needs neighbour table)
+  float airtime_factor = 1.0f;
+};
+
+/**
+ * \brief  A simulated node. Flood forwarding policy (for repeaters) mirrors simple_repeater's MyMesh, and every
+ *       node is a member of one public group channel, which the Simulator's traffic is sent on.
+*/
+class SimNode final : public mesh::Mesh {
+  Simulator* _sim;
+  int _id;
+  bool _repeat;
+  SimNodePrefs _prefs;
+  mesh::GroupChannel _channel;
+
+protected:
+  float getAirtimeBudgetFactor() const override { return _prefs.airtime_factor; }
+  int calcRxDelay(float score, uint32_t air_time) const override;
+  bool allowPacketForward(const mesh::Packet* packet) override;
+  uint32_t getRetransmitDelay(const mesh::Packet* packet) override;
+  uint32_t getDirectRetransmitDelay(const mesh::Packet* packet) override;
+  uint8_t getFloodSuppressThreshold() const override { return _prefs.flood_suppress; }
+  float getFloodSuppressMinSNR() const override { return _prefs.flood_suppress_snr; }
+  int searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel channels[], int max_matches) override;
+  void onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) override;
+
+public:
+  SimNode(Simulator* sim, int id, bool repeat, const SimNodePrefs& prefs, const mesh::GroupChannel& channel,
+          SimRadio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc,
+          StaticPoolPacketManager& mgr, SimpleMeshTables& tables, SimpleNeighbourTable* neighbours = NULL);
+
+  int getId() const { return _id; }
+  bool isRepeater() const { return _repeat; }
+  StaticPoolPacketManager* getPacketManager() const { return (StaticPoolPacketManager *) _mgr; }
+  SimpleMeshTables* getSimpleTables() const { return (SimpleMeshTables *) getTables(); }
+  SimpleNeighbourTable* getNeighbours() const { return (SimpleNeighbourTable *) getNeighbourTable(); }
+
+  bool sendGroupMessage(uint32_t msg_id);
+};
@@ -0,0 +1,200 @@
+#include "SimRadio.h"
+#include <math.h>
+#include <string.h>
+
+// Approximate SNR threshold per SF for successful reception (same as RadioLibWrapper)
+static const float snr_threshold[] = {
+    -7.5,  // SF7
+    -10,   // SF8
+    -12.5, // SF9
+    -15,   // SF10
+    -17.5, // SF11
+    -20    // SF12
+};
+
+static uint64_t splitmix64(uint64_t x) {
+  x += 0x9e3779b97f4a7c15ULL;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// deterministic N(0,1) sample for the (unordered) pair a,b
+static float pairGaussian(uint32_t seed, int a, int b) {
+  if (a > b) { int t = a; a = b; b = t; }
+  uint64_t h = splitmix64(((uint64_t)seed << 32) ^ ((uint64_t)a << 16) ^ (uint64_t)b);
+  double u1 = ((h >> 11) + 1.0) / 9007199254740994.0;   // (0, 1]
+  double u2 = (splitmix64(h) >> 11) / 9007199254740992.0;
+  return (float) (sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2));
+}
+
+SimChannel::SimChannel(const SimRadioParams& params) : _params(params) {
+  _now = 0;
+  _num_nodes = 0;
+  _noise_dbm = -174.0f + 10.0f*log10f(params.bw_khz * 1000.0f) + params.noise_figure_db;
+  _min_snr = snr_threshold[params.sf - 7];
+  _num_frames = _num_delivered = _num_collisions = _num_half_duplex = 0;
+}
+
+void SimChannel::setTopology(const std::vector<float>& xs, const std::vector<float>& ys, uint32_t seed) {
+  int n = _num_nodes = xs.size();
+  _rx_dbm.assign(n*n, -300.0f);
+
+  float wavelength = 299.792458f / _params.freq_mhz;
+  float pl_1m = 20.0f*log10f(4.0f * (float)M_PI / wavelength);   // free-space loss at 1 metre
+  for (int i = 0; i < n; i++) {
+    for (int j = 0; j < n; j++) {
+      if (i == j) continue;
+      float dx = xs[i] - xs[j], dy = ys[i] - ys[j];
+      float d = sqrtf(dx*dx + dy*dy);
+      if (d < 1.0f) d = 1.0f;
+      float path_loss = pl_1m + 10.0f*_params.path_loss_exp*log10f(d) + _params.shadowing_db*pairGaussian(seed, i, j);
+      _rx_dbm[i*n + j] = _params.tx_power_dbm - path_loss;
+    }
+  }
+}
+
+float SimChannel::getAirtime(int len) const {
+  float t_sym = (float)(1 << _params.sf) / _params.bw_khz;   // millis
+  int preamble = _params.sf <= 8 ? 32 : 16;   // as per RadioLibWrapper::preambleLengthForSF()
+  int de = t_sym > 16.0f ? 1 : 0;             // low data rate optimise
+  float num = 8.0f*len - 4.0f*_params.sf + 28 + 16;   // explicit header, CRC on
+  int payload_syms = 8 + (int) fmaxf(ceilf(num / (4.0f*(_params.sf - 2*de))) * _params.cr, 0.0f);
+  return (preamble + 4.25f)*t_sym + payload_syms*t_sym;
+}
+
+unsigned long SimChannel::startTx(int sender, const uint8_t* bytes, int len) {
+  Frame f;
+  f.sender = sender;
+  memcpy(f.data, bytes, len);
+  f.len = len;
+  f.start = _now;
+  f.end = _now + (unsigned long) ceilf(getAirtime(len));
+  f.delivered = false;
+  _frames.push_back(f);
+  _num_frames++;
+  return f.end;
+}
+
+bool SimChannel::isBusy(int node) const {
+  for (size_t i = 0; i < _frames.size(); i++) {
+    const Frame& f = _frames[i];
+    if (f.end > _now && f.sender != node && canHear(f.sender, node)) return true;
+  }
+  return false;
+}
+
+bool SimChannel::isIdle() const {
+  for (size_t i = 0; i < _frames.size(); i++) {
+    if (_frames[i].end > _now) return false;
+  }
+  return true;
+}
+
+bool SimChannel::isDecodable(const Frame& f, int to) {
+  float power = getRxPower(f.sender, to);
+  for (size_t i = 0; i < _frames.size(); i++) {
+    const Frame& g = _frames[i];
+    if (&g == &f || !overlaps(f, g)) continue;
+
+    if (g.sender == to) {   // was transmitting itself
+      _num_half_duplex++;
+      return false;
+    }
+    if (getRxPower(g.sender, to) > power - _params.capture_db) {
+      _num_collisions++;
+      return false;
+    }
+  }
+  return true;
+}
+
+void SimChannel::update(unsigned long now) {
+  _now = now;
+
+  // deliver frames which have now ended (in order of starting)
+  bool any = false;
+  for (size_t i = 0; i < _frames.size(); i++) {
+    Frame& f = _frames[i];
+    if (f.delivered || f.end > now) continue;
+
+    for (size_t to = 0; to < _radios.size(); to++) {
+      if ((int)to == f.sender || !canHear(f.sender, to)) continue;
+      if (isDecodable(f, to)) {
+        _radios[to]->deliver(f.data, f.len, getSNR(f.sender, to), getRxPower(f.sender, to));
+        _num_delivered++;
+      }
+    }
+    f.delivered = any = true;
+  }
+  if (!any) return;
+
+  // ended frames are still needed while they overlap frames in the air
+  unsigned long first_start = now;
+  for (size_t i = 0; i < _frames.size(); i++) {
+    if (!_frames[i].delivered && _frames[i].start < first_start) first_start = _frames[i].start;
+  }
+  size_t keep = 0;
+  for (size_t i = 0; i < _frames.size(); i++) {
+    if (_frames[i].delivered && _frames[i].end <= first_start) continue;   // can't overlap anything any more
+    if (keep != i) _frames[keep] = _frames[i];
+    keep++;
+  }
+  _frames.resize(keep);
+}
+
+SimRadio::SimRadio(SimChannel& channel, int id) : _channel(&channel), _id(id) {
+  _rx_len = 0;
+  _rx_snr = _rx_rssi = 0;
+  _tx_end = 0;
+  _in_tx = false;
+  _n_rx_overwritten = 0;
+  channel.addRadio(this);
+}
+
+void SimRadio::deliver(const uint8_t* bytes, int len, float snr, float rssi) {
+  if (_rx_len > 0) _n_rx_overwritten++;   // previous one not read yet
+  memcpy(_rx_buf, bytes, len);
+  _rx_len = len;
+  _rx_snr = snr;
+  _rx_rssi = rssi;
+}
+
+int SimRadio::recvRaw(uint8_t* bytes, int sz) {
+  int len = _rx_len;
+  if (len > sz) len = sz;
+  memcpy(bytes, _rx_buf, len);
+  _rx_len = 0;
+  return len;
+}
+
+int SimRadio::recvPacket(mesh::Packet* pkt) {
+  int len = _rx_len;
+  _rx_len = 0;
+  if (pkt == NULL || len == 0) return 0;
+  return pkt->readFrom(_rx_buf, len) ? len : 0;
+}
+
+uint32_t SimRadio::getEstAirtimeFor(int len_bytes) {
+  return (uint32_t) _channel->getAirtime(len_bytes);
+}
+
+float SimRadio::packetScore(float snr, int packet_len) {
+  int sf = _channel->getParams().sf;
+  if (snr < snr_threshold[sf - 7]) return 0.0f;
+
+  float success_rate_based_on_snr = (snr - snr_threshold[sf - 7]) / 10.0f;
+  float collision_penalty = 1 - (packet_len / 256.0f);
+  return fmaxf(0.0f, fminf(1.0f, success_rate_based_on_snr * collision_penalty));
+}
+
+bool SimRadio::startSendRaw(const uint8_t* bytes, int len) {
+  if (_in_tx) return false;
+  _tx_end = _channel->startTx(_id, bytes, len);
+  _in_tx = true;
+  return true;
+}
+
+bool SimRadio::isSendComplete() {
+  return _in_tx && _channel->getNow() >= _tx_end;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Dispatcher.h>
+#include <vector>
+
+class SimRadio;
+
+struct SimRadioParams {
+  float freq_mhz = 869.618f;
+  float bw_khz = 62.5f;
+  uint8_t sf = 8;
+  uint8_t cr = 5;               // 4/cr coding rate
+  float tx_power_dbm = 22.0f;
+  float path_loss_exp = 3.5f;   // log-distance path loss exponent
+  float shadowing_db = 6.0f;    // std dev of (per link, static) log-normal shadowing
+  float noise_figure_db = 6.0f;
+  float capture_db = 6.0f;      // a frame survives overlap if this much stronger than every interferer
+};
+
+/**
+ * \brief  The shared radio medium. Frames are 'in the air' for their LoRa air-time, and are delivered at their end
+ *      to every radio which could hear them (by SNR), that wasn't transmitting itself, and where no overlapping
+ *      frame was within capture range.
+*/
+class SimChannel {
+  struct Frame {
+    int sender;
+    uint8_t data[MAX_TRANS_UNIT];
+    int len;
+    unsigned long start, end;
+    bool delivered;
+  };
+
+  SimRadioParams _params;
+  std::vector<SimRadio*> _radios;
+  std::vector<float> _rx_dbm;     // [from*_num_nodes + to]
+  int _num_nodes;
+  std::vector<Frame> _frames;     // in the air, or recently ended (still needed for overlap checks)
+  unsigned long _now;
+  float _noise_dbm, _min_snr;
+  uint32_t _num_frames, _num_delivered, _num_collisions, _num_half_duplex;
+
+  bool overlaps(const Frame& a, const Frame& b) const { return a.start < b.end && b.start < a.end; }
+  bool isDecodable(const Frame& f, int to);
+
+public:
+  SimChannel(const SimRadioParams& params);
+
+  const SimRadioParams& getParams() const { return _params; }
+
+  /**
+   * \brief  computes all link budgets, given node positions (metres). 'seed' is for the shadowing.
+   */
+  void setTopology(const std::vector<float>& xs, const std::vector<float>& ys, uint32_t seed);
+  void addRadio(SimRadio* radio) { _radios.push_back(radio); }
+
+  float getRxPower(int from, int to) const { return _rx_dbm[from*_num_nodes + to]; }
+  float getSNR(int from, int to) const { return getRxPower(from, to) - _noise_dbm; }
+  bool canHear(int from, int to) const { return getSNR(from, to) >= _min_snr; }
+  float getNoiseFloor() const { return _noise_dbm; }
+  float getMinSNR() const { return _min_snr; }
+
+  /**
+   * \returns  LoRa time-on-air, in millis
+   */
+  float getAirtime(int len) const;
+
+  unsigned long getNow() const { return _now; }
+  unsigned long startTx(int sender, const uint8_t* bytes, int len);
+  bool isBusy(int node) const;   // is some frame (audible to node) in the air?
+  bool isIdle() const;           // nothing in the air?
+
+  /**
+   * \brief  advance time, delivering any frames which have finished
+   */
+  void update(unsigned long now);
+
+  uint32_t getNumFrames() const { return _num_frames; }
+  uint32_t getNumDelivered() const { return _num_delivered; }
+  uint32_t getNumCollisions() const { return _num_collisions; }
+  uint32_t getNumHalfDuplexLost() const { return _num_half_duplex; }
+};
+
+/**
+ * \brief  A simulated LoRa radio, attached to a SimChannel. Supports both recvRaw() and direct recvPacket().
+*/
+class SimRadio final : public mesh::Radio {
+  SimChannel* _channel;
+  int _id;
+  uint8_t _rx_buf[MAX_TRANS_UNIT];
+  int _rx_len;
+  float _rx_snr, _rx_rssi;
+  unsigned long _tx_end;
+  bool _in_tx;
+  uint32_t _n_rx_overwritten;
+
+public:
+  SimRadio(SimChannel& channel, int id);
+
+  int getId() const { return _id; }
+
+  // called by SimChannel
+  void deliver(const uint8_t* bytes, int len, float snr, float rssi);
+
+  int recvRaw(uint8_t* bytes, int sz) override;
+  int getRecvLength() override { return _rx_len; }
+  int recvPacket(mesh::Packet* pkt) override;
+  uint32_t getEstAirtimeFor(int len_bytes) override;
+  float packetScore(float snr, int packet_len) override;
+  bool startSendRaw(const uint8_t* bytes, int len) override;
+  bool isSendComplete() override;
+  void onSendFinished() override { _in_tx = false; }
+  bool isInRecvMode() const override { return !_in_tx; }
+  bool isReceiving() override { return _channel->isBusy(_id); }
+  int getNoiseFloor() const override { return (int) _channel->getNoiseFloor(); }
+  float getLastRSSI() const override { return _rx_rssi; }
+  float getLastSNR() const override { return _rx_snr; }
+
+  bool isTransmitting() const { return _in_tx; }
+  uint32_t getNumRxOverwritten() const { return _n_rx_overwritten; }
+};
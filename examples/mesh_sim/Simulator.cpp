@@ -0,0 +1,203 @@
+#include "Simulator.h"
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+
+#define QUEUE_SAMPLE_INTERVAL   100   // millis
+
+Simulator::Simulator(const SimConfig& cfg) : _cfg(cfg), _channel(cfg.radio) {
+  _now = 0;
+  _num_delivered = _total_hops = 0;
+  _queue_sum = 0;
+  _queue_samples = 0;
+  _queue_max = 0;
+
+  SimRNG rng(cfg.seed);
+  float side = cfg.spacing * sqrtf((float) cfg.num_nodes);
+  for (int i = 0; i < cfg.num_nodes; i++) {
+    _xs.push_back(rng.nextInt(0, 1000000) * side / 1000000.0f);
+    _ys.push_back(rng.nextInt(0, 1000000) * side / 1000000.0f);
+  }
+  _channel.setTopology(_xs, _ys, cfg.seed);
+
+  mesh::GroupChannel channel;
+  memset(channel.secret, 0, sizeof(channel.secret));
+  rng.random(channel.secret, 16);
+  mesh::Utils::sha256(channel.hash, sizeof(channel.hash), channel.secret, 16);
+  mesh::Utils::calcMACKey(channel.mac_key, channel.secret);
+
+  for (int i = 0; i < cfg.num_nodes; i++) {
+    bool repeat = rng.nextInt(0, 1000) < (uint32_t)(cfg.repeater_fraction * 1000);
+
+    _radios.push_back(new SimRadio(_channel, i));
+    _clocks.push_back(new SimMillis(&_now));
+    _rtcs.push_back(new SimRTC(&_now, 1735689600));   // 2025-01-01
+    _rngs.push_back(new SimRNG(((uint64_t)cfg.seed << 32) ^ (i + 1)));
+    _tables.push_back(new SimNodeTables(cfg.pool_size, cfg.max_neighbours, *_rtcs[i]));
+    _nodes.push_back(new SimNode(this, i, repeat, cfg.prefs, channel, *_radios[i], *_clocks[i], *_rngs[i], *_rtcs[i], _tables[i]->mgr, _tables[i]->tables,
+                                 repeat && cfg.max_neighbours > 0 ? &_tables[i]->neighbours : NULL));
+  }
+
+  // repeaters know the other repeaters in range, as if from their zero-hop adverts. Mesh then keeps the SNRs updated
+  if (cfg.max_neighbours > 0) {
+    for (int i = 0; i < cfg.num_nodes; i++) {
+      if (!_nodes[i]->isRepeater()) continue;
+
+      for (int j = 0; j < cfg.num_nodes; j++) {
+        if (j == i || !_nodes[j]->isRepeater() || !_channel.canHear(j, i)) continue;
+        _tables[i]->neighbours.put(_nodes[j]->self_id, 0, _channel.getSNR(j, i), _channel.getRxPower(j, i));
+      }
+    }
+  }
+
+  // traffic schedule
+  for (int m = 0; m < cfg.num_msgs; m++) {
+    _msg_sent_at.push_back(1000 + m*cfg.msg_interval);
+    _msg_sender.push_back(rng.nextInt(0, cfg.num_nodes));
+  }
+  _first_rx.assign(cfg.num_msgs * cfg.num_nodes, 0);
+}
+
+Simulator::~Simulator() {
+  for (size_t i = 0; i < _nodes.size(); i++) {
+    delete _nodes[i];
+    delete _tables[i];
+    delete _rngs[i];
+    delete _rtcs[i];
+    delete _clocks[i];
+    delete _radios[i];
+  }
+}
+
+void Simulator::onMessageRecv(int node, uint32_t msg_id, int hops) {
+  if (msg_id >= _msg_sent_at.size() || node == _msg_sender[msg_id]) return;
+
+  unsigned long& rx = _first_rx[msg_id*_nodes.size() + node];
+  if (rx) return;   // already have it (can't normally happen, as Mesh filters dups)
+
+  rx = _now;
+  _num_delivered++;
+  _total_hops += hops;
+  _latencies.push_back(_now - _msg_sent_at[msg_id]);
+}
+
+bool Simulator::isQuiet() const {
+  if (!_channel.isIdle()) return false;
+  for (size_t i = 0; i < _nodes.size(); i++) {
+    if (_radios[i]->getRecvLength() > 0 || _radios[i]->isTransmitting()) return false;
+  }
+  return true;   // nothing on air, so only the nodes' own deadlines matter
+}
+
+void Simulator::sampleQueues(uint32_t weight) {
+  for (size_t i = 0; i < _nodes.size(); i++) {
+    int n = _tables[i]->mgr.getOutboundTotal();
+    _queue_sum += (double)n * weight;
+    if (n > _queue_max) _queue_max = n;
+  }
+  _queue_samples += weight;
+}
+
+SimReport Simulator::run() {
+  for (size_t i = 0; i < _nodes.size(); i++) {
+    _nodes[i]->begin();
+  }
+
+  unsigned long end_time = _msg_sent_at.empty() ? 0 : _msg_sent_at.back() + _cfg.drain_time;
+  size_t next_msg = 0;
+  while (_now <= end_time) {
+    _channel.update(_now);
+
+    while (next_msg < _msg_sent_at.size() && _msg_sent_at[next_msg] <= _now) {
+      _nodes[_msg_sender[next_msg]]->sendGroupMessage(next_msg);
+      next_msg++;
+    }
+    for (size_t i = 0; i < _nodes.size(); i++) {
+      _nodes[i]->loop();
+    }
+
+    if ((_now % QUEUE_SAMPLE_INTERVAL) == 0) sampleQueues(1);
+
+    unsigned long next = _now + 1;
+    if (isQuiet()) {   // jump straight to next deadline
+      next = next_msg < _msg_sent_at.size() ? _msg_sent_at[next_msg] : end_time + 1;
+      for (size_t i = 0; i < _nodes.size(); i++) {
+        unsigned long t = _nodes[i]->getNextWakeupMillis();
+        if (t < next) next = t;
+      }
+      if (next <= _now) next = _now + 1;
+
+      uint32_t skipped = (next - 1) / QUEUE_SAMPLE_INTERVAL - _now / QUEUE_SAMPLE_INTERVAL;
+      if (skipped > 0) sampleQueues(skipped);   // queues don't change while skipping
+    }
+    _now = next;
+  }
+
+  SimReport r;
+  memset(&r, 0, sizeof(r));
+  r.num_nodes = _nodes.size();
+  r.num_msgs = _msg_sent_at.size();
+  r.sim_millis = _now;
+
+  uint32_t links = 0;
+  for (int i = 0; i < r.num_nodes; i++) {
+    if (_nodes[i]->isRepeater()) r.num_repeaters++;
+    for (int j = 0; j < r.num_nodes; j++) {
+      if (i != j && _channel.canHear(i, j)) links++;
+    }
+  }
+  r.avg_neighbours = r.num_nodes > 0 ? (float)links / r.num_nodes : 0;
+
+  r.num_expected = r.num_msgs * (r.num_nodes - 1);
+  r.num_delivered = _num_delivered;
+  r.delivery_ratio = r.num_expected > 0 ? (float)r.num_delivered / r.num_expected : 0;
+  r.avg_hops = _num_delivered > 0 ? (float)_total_hops / _num_delivered : 0;
+
+  r.pool_min_free = _cfg.pool_size;
+  for (int i = 0; i < r.num_nodes; i++) {
+    r.total_tx_airtime += _nodes[i]->getTotalAirTime();
+    r.num_flood_recv += _nodes[i]->getNumRecvFlood();
+    r.num_flood_dups += _tables[i]->tables.getNumFloodDups();
+    r.num_relays_cancelled += _nodes[i]->getNumRelaysCancelled();
+    r.num_rx_overwritten += _radios[i]->getNumRxOverwritten();
+    if (_tables[i]->mgr.getMinFreeCount() < r.pool_min_free) r.pool_min_free = _tables[i]->mgr.getMinFreeCount();
+  }
+  r.airtime_per_msg = r.num_msgs > 0 ? (float)r.total_tx_airtime / r.num_msgs : 0;
+  r.airtime_per_delivery = r.num_delivered > 0 ? (float)r.total_tx_airtime / r.num_delivered : 0;
+  r.dup_rate = r.num_flood_recv > 0 ? (float)r.num_flood_dups / r.num_flood_recv : 0;
+
+  if (!_latencies.empty()) {
+    std::vector<uint32_t> sorted(_latencies);
+    std::sort(sorted.begin(), sorted.end());
+    int n = sorted.size();
+    r.latency_p50 = sorted[(n - 1) * 50 / 100];
+    r.latency_p90 = sorted[(n - 1) * 90 / 100];
+    r.latency_p99 = sorted[(n - 1) * 99 / 100];
+    r.latency_max = sorted[n - 1];
+  }
+  r.queue_mean = _queue_samples > 0 ? (float)(_queue_sum / ((double)_queue_samples * r.num_nodes)) : 0;
+  r.queue_max = _queue_max;
+
+  r.num_frames = _channel.getNumFrames();
+  r.num_collisions = _channel.getNumCollisions();
+  r.num_half_duplex_lost = _channel.getNumHalfDuplexLost();
+  return r;
+}
+
+void printReport(const SimConfig& cfg, const SimReport& r) {
+  printf("nodes: %d (%d repeaters), avg neighbours: %.1f, seed: %u\n", r.num_nodes, r.num_repeaters, r.avg_neighbours, cfg.seed);
+  printf("prefs: tx_delay_factor=%.2f rx_delay_base=%.2f flood_max=%d flood_suppress=%d (snr %.1f) flood_delay_snr=%s (neighbours %d), SF%d BW%.1f\n",
+    cfg.prefs.tx_delay_factor, cfg.prefs.rx_delay_base, cfg.prefs.flood_max, cfg.prefs.flood_suppress,
+    cfg.prefs.flood_suppress_snr, cfg.prefs.flood_delay_snr ? "on" : "off", cfg.max_neighbours, cfg.radio.sf, cfg.radio.bw_khz);
+  printf("messages: %d, delivered: %u / %u (%.1f%%), avg hops: %.2f\n", r.num_msgs, r.num_delivered, r.num_expected,
+    r.delivery_ratio * 100.0f, r.avg_hops);
+  printf("airtime: total %lu ms, per message %.0f ms, per delivery %.1f ms\n", r.total_tx_airtime, r.airtime_per_msg,
+    r.airtime_per_delivery);
+  printf("flood dups: %u / %u received (%.1f%%), relays cancelled: %u\n", r.num_flood_dups, r.num_flood_recv,
+    r.dup_rate * 100.0f, r.num_relays_cancelled);
+  printf("latency ms: p50 %u, p90 %u, p99 %u, max %u\n", r.latency_p50, r.latency_p90, r.latency_p99, r.latency_max);
+  printf("queue: mean %.2f, max %d, min free pool %d / %d\n", r.queue_mean, r.queue_max, r.pool_min_free, cfg.pool_size);
+  printf("channel: %u frames, receptions lost: %u collisions, %u half-duplex, %u rx overwritten\n", r.num_frames, r.num_collisions,
+    r.num_half_duplex_lost, r.num_rx_overwritten);
+  printf("simulated: %.1f s\n", r.sim_millis / 1000.0f);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "SimNode.h"
+#include <vector>
+
+struct SimConfig {
+  int num_nodes = 50;
+  uint32_t seed = 1;
+  float spacing = 1000.0f;          // metres. Nodes are placed uniformly in a square of side spacing*sqrt(num_nodes)
+  float repeater_fraction = 0.3f;   // others are companions (don't forward)
+  int num_msgs = 20;
+  uint32_t msg_interval = 20000;    // millis between messages (from random senders)
+  uint32_t drain_time = 60000;      // millis to keep running after last message
+  int pool_size = 32;               // packets per node
+  int max_neighbours = 0;           // neighbour table size per repeater, 0 = none. Seeded with the repeaters in range
+  SimRadioParams radio;
+  SimNodePrefs prefs;
+};
+
+struct SimReport {
+  int num_nodes, num_repeaters, num_msgs;
+  float avg_neighbours;
+  uint32_t num_expected, num_delivered;   // (message, receiver) pairs
+  float delivery_ratio;
+  unsigned long total_tx_airtime;         // millis, all nodes
+  float airtime_per_msg, airtime_per_delivery;
+  uint32_t num_flood_recv, num_flood_dups;
+  uint32_t num_relays_cancelled;
+  float dup_rate;
+  uint32_t latency_p50, latency_p90, latency_p99, latency_max;   // millis, sender to first receipt
+  float avg_hops;
+  float queue_mean;                       // mean outbound queue length, per node (sampled while mesh is busy)
+  int queue_max;
+  int pool_min_free;
+  uint32_t num_frames, num_collisions, num_half_duplex_lost, num_rx_overwritten;
+  unsigned long sim_millis;
+};
+
+/**
+ * \brief  a node's packet pool, seen table and neighbour table. Held by value, so they're destroyed as their
+ *       concrete types (none has a virtual destructor)
+*/
+struct SimNodeTables {
+  StaticPoolPacketManager mgr;
+  SimpleMeshTables tables;
+  SimpleNeighbourTable neighbours;
+
+  SimNodeTables(int pool_size, int max_neighbours, mesh::RTCClock& rtc)
+    : mgr(pool_size), neighbours(max_neighbours > 0 ? max_neighbours : 1, rtc) { }
+};
+
+/**
+ * \brief  Deterministic discrete-time simulation of a mesh of SimNodes, on a shared SimChannel. Time advances in
+ *       1 ms ticks while anything is in the air or queued, otherwise jumps straight to the next traffic event.
+ *       For a given SimConfig (including seed), results are always identical.
+*/
+class Simulator {
+  SimConfig _cfg;
+  unsigned long _now;
+  SimChannel _channel;
+  std::vector<float> _xs, _ys;
+  std::vector<SimRadio*> _radios;
+  std::vector<SimMillis*> _clocks;
+  std::vector<SimRTC*> _rtcs;
+  std::vector<SimRNG*> _rngs;
+  std::vector<SimNodeTables*> _tables;
+  std::vector<SimNode*> _nodes;
+
+  std::vector<unsigned long> _msg_sent_at;
+  std::vector<int> _msg_sender;
+  std::vector<unsigned long> _first_rx;    // [msg*num_nodes + node], or 0 if not received
+  std::vector<uint32_t> _latencies;
+  uint32_t _num_delivered, _total_hops;
+  double _queue_sum;
+  uint32_t _queue_samples;
+  int _queue_max;
+
+  bool isQuiet() const;
+  void sampleQueues(uint32_t weight);
+
+public:
+  Simulator(const SimConfig& cfg);
+  ~Simulator();
+
+  // called by SimNode
+  void onMessageRecv(int node, uint32_t msg_id, int hops);
+
+  SimReport run();
+
+  int getNumNodes() const { return _nodes.size(); }
+  SimNode* getNode(int i) const { return _nodes[i]; }
+  const SimChannel& getChannel() const { return _channel; }
+};
+
+void printReport(const SimConfig& cfg, const SimReport& r);
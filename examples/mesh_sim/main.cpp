@@ -0,0 +1,90 @@
+#include "Simulator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void usage(const char* prog) {
+  printf("usage: %s [options]\n", prog);
+  printf("  --nodes N              number of nodes (default 50)\n");
+  printf("  --seed N               random seed (default 1)\n");
+  printf("  --spacing M            mean node spacing, metres (default 1000)\n");
+  printf("  --repeaters F          fraction of nodes which are repeaters (default 0.3)\n");
+  printf("  --msgs N               number of group messages (default 20)\n");
+  printf("  --interval MS          millis between messages (default 20000)\n");
+  printf("  --pool N               packet pool size per node (default 32)\n");
+  printf("  --tx-delay-factor F    (default 0.5)\n");
+  printf("  --direct-tx-delay-factor F  (default 0.3)\n");
+  printf("  --rx-delay-base F      (default 0, ie. disabled)\n");
+  printf("  --flood-max N          (default 64)\n");
+  printf("  --flood-suppress N     relays heard before cancelling own (default 0, ie. disabled)\n");
+  printf("  --flood-suppress-snr F min SNR of relays which count (default -30)\n");
+  printf("  --neighbours N         neighbour table size per repeater (default 0, ie. none)\n");
+  printf("  --flood-delay-snr 0|1  scale flood retransmit delay by neighbour SNR (default 0, needs --neighbours)\n");
+  printf("  --sf N                 spreading factor (default 8)\n");
+  printf("  --bw KHZ               bandwidth (default 62.5)\n");
+}
+
+int main(int argc, char* argv[]) {
+  SimConfig cfg;
+
+  for (int i = 1; i < argc; i++) {
+    const char* opt = argv[i];
+    if (strcmp(opt, "--help") == 0 || strcmp(opt, "-h") == 0) {
+      usage(argv[0]);
+      return 0;
+    }
+    if (i + 1 >= argc) {
+      fprintf(stderr, "missing value for: %s\n", opt);
+      return 1;
+    }
+    const char* val = argv[++i];
+    if (strcmp(opt, "--nodes") == 0) {
+      cfg.num_nodes = atoi(val);
+    } else if (strcmp(opt, "--seed") == 0) {
+      cfg.seed = strtoul(val, NULL, 10);
+    } else if (strcmp(opt, "--spacing") == 0) {
+      cfg.spacing = atof(val);
+    } else if (strcmp(opt, "--repeaters") == 0) {
+      cfg.repeater_fraction = atof(val);
+    } else if (strcmp(opt, "--msgs") == 0) {
+      cfg.num_msgs = atoi(val);
+    } else if (strcmp(opt, "--interval") == 0) {
+      cfg.msg_interval = strtoul(val, NULL, 10);
+    } else if (strcmp(opt, "--pool") == 0) {
+      cfg.pool_size = atoi(val);
+    } else if (strcmp(opt, "--tx-delay-factor") == 0) {
+      cfg.prefs.tx_delay_factor = atof(val);
+    } else if (strcmp(opt, "--direct-tx-delay-factor") == 0) {
+      cfg.prefs.direct_tx_delay_factor = atof(val);
+    } else if (strcmp(opt, "--rx-delay-base") == 0) {
+      cfg.prefs.rx_delay_base = atof(val);
+    } else if (strcmp(opt, "--flood-max") == 0) {
+      cfg.prefs.flood_max = atoi(val);
+    } else if (strcmp(opt, "--flood-suppress") == 0) {
+      cfg.prefs.flood_suppress = atoi(val);
+    } else if (strcmp(opt, "--flood-suppress-snr") == 0) {
+      cfg.prefs.flood_suppress_snr = atof(val);
+    } else if (strcmp(opt, "--neighbours") == 0) {
+      cfg.max_neighbours = atoi(val);
+    } else if (strcmp(opt, "--flood-delay-snr") == 0) {
+      cfg.prefs.flood_delay_snr = atoi(val) != 0;
+    } else if (strcmp(opt, "--sf") == 0) {
+      cfg.radio.sf = atoi(val);
+    } else if (strcmp(opt, "--bw") == 0) {
+      cfg.radio.bw_khz = atof(val);
+    } else {
+      fprintf(stderr, "unknown option: %s\n", opt);
+      usage(argv[0]);
+      return 1;
+    }
+  }
+  if (cfg.num_nodes < 2 || cfg.radio.sf < 7 || cfg.radio.sf > 12 || cfg.pool_size < 1) {
+    fprintf(stderr, "invalid config\n");
+    return 1;
+  }
+
+  Simulator sim(cfg);
+  SimReport r = sim.run();
+  printReport(cfg, r);
+  return 0;
+}
@@ -0,0 +1,427 @@
+// Micro-benchmarks of the per-packet hot paths.
+//   native:     pio run -e native_bench && .pio/build/native_bench/program
+//   on target:  eg. pio run -e Heltec_v3_perf_bench -t upload, then open serial monitor (115200)
+//
+// NOTE: native builds use the mock SHA256/AES from test/mocks, so only compare like with like (cached vs uncached).
+
+#include <Utils.h>
+#include <AES.h>
+#include <helpers/ContactIndex.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/StaticPoolPacketManager.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef ARDUINO
+  #include <Arduino.h>
+
+  static unsigned long benchMicros() { return micros(); }
+  static void benchPrint(const char* line) { Serial.println(line); }
+  #if defined(ESP32)
+    static uint32_t benchCycles() { return ESP.getCycleCount(); }
+  #elif defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    static uint32_t benchCycles() { return DWT->CYCCNT; }
+  #else
+    static uint32_t benchCycles() { return 0; }   // derived from micros() below
+  #endif
+#else
+  #include <chrono>
+
+  static unsigned long benchMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+  static void benchPrint(const char* line) { puts(line); }
+  static uint32_t benchCycles() { return 0; }
+#endif
+
+#define NUM_ITERATIONS   2000
+
+typedef void (*BenchFunc)(int iter);
+
+static void report(const char* name, BenchFunc fn, int iterations = NUM_ITERATIONS) {
+  fn(0);   // warm up
+  unsigned long start = benchMicros();
+  uint32_t start_cycles = benchCycles();
+  for (int i = 0; i < iterations; i++) {
+    fn(i);
+  }
+  uint32_t cycles = benchCycles() - start_cycles;
+  unsigned long elapsed = benchMicros() - start;
+
+  float us = (float)elapsed / iterations;
+#if defined(ARDUINO) && defined(F_CPU)
+  if (cycles == 0) cycles = (uint32_t)((double)elapsed * (F_CPU / 1000000));
+#endif
+  char line[100];
+  if (cycles) {
+    snprintf(line, sizeof(line), "%-36s %9.2f us/op  %9lu cycles/op", name, us, (unsigned long)(cycles / iterations));
+  } else {
+    snprintf(line, sizeof(line), "%-36s %9.3f us/op", name, us);
+  }
+  benchPrint(line);
+}
+
+static uint8_t secret[PUB_KEY_SIZE];
+static mesh::MACKey mac_key;
+static uint8_t plain[64];
+static uint8_t packet[MAX_PACKET_PAYLOAD];
+static int packet_len;
+static uint8_t out[MAX_PACKET_PAYLOAD];
+static volatile int sink;
+
+static void benchVerifyUncached(int iter) {
+  packet[0] ^= iter;   // mostly invalid MACs, ie. the cost of each non-matching candidate
+  mesh::MACKey key;
+  mesh::Utils::calcMACKey(key, secret);   // what MACThenDecrypt() used to do, per candidate
+  sink += mesh::Utils::MACThenDecrypt(secret, key, out, packet, packet_len);
+}
+
+static void benchVerifyCacheHit(int iter) {
+  packet[0] ^= iter;
+  sink += mesh::Utils::MACThenDecrypt(secret, out, packet, packet_len);
+}
+
+static void benchVerifyCached(int iter) {
+  packet[0] ^= iter;
+  sink += mesh::Utils::MACThenDecrypt(secret, mac_key, out, packet, packet_len);
+}
+
+static void benchEncryptUncached(int iter) {
+  sink += mesh::Utils::encryptThenMAC(secret, out, plain, sizeof(plain));
+}
+
+static void benchEncryptCached(int iter) {
+  sink += mesh::Utils::encryptThenMAC(secret, mac_key, out, plain, sizeof(plain));
+}
+
+static void benchCalcMACKey(int iter) {
+  mesh::Utils::calcMACKey(mac_key, secret);
+}
+
+static void benchEncryptSetKey(int iter) {
+  AES128 aes;   // what Utils::encrypt() used to do, per packet
+  aes.setKey(secret, CIPHER_KEY_SIZE);
+  sink += mesh::Utils::encrypt(aes, out, plain, sizeof(plain));
+}
+
+static void benchEncryptCachedCipher(int iter) {
+  sink += mesh::Utils::encrypt(secret, out, plain, sizeof(plain));
+}
+
+#define NUM_MANY_SECRETS  ((CIPHER_CACHE_SIZE > MAC_KEY_CACHE_SIZE ? CIPHER_CACHE_SIZE : MAC_KEY_CACHE_SIZE) + 1)
+
+static uint8_t many_secrets[NUM_MANY_SECRETS][PUB_KEY_SIZE];
+
+static void benchEncryptCacheThrash(int iter) {
+  sink += mesh::Utils::encrypt(many_secrets[iter % (CIPHER_CACHE_SIZE + 1)], out, plain, sizeof(plain));
+}
+
+static void benchVerifyCacheThrash(int iter) {
+  packet[0] ^= iter;
+  sink += mesh::Utils::MACThenDecrypt(many_secrets[iter % (MAC_KEY_CACHE_SIZE + 1)], out, packet, packet_len);
+}
+
+// per-packet contact lookup (ie. BaseChatMesh::searchPeersByHash()), vs num of contacts
+#define MAX_BENCH_CONTACTS  2000
+
+static uint8_t contact_keys[MAX_BENCH_CONTACTS][PUB_KEY_SIZE];
+static int num_contacts;
+static ContactIndex contact_index(MAX_BENCH_CONTACTS);
+
+static void benchSearchLinear(int iter) {
+  uint8_t hash = iter * 37;
+  int n = 0;
+  for (int i = 0; i < num_contacts && n < 8; i++) {
+    if (memcmp(contact_keys[i], &hash, PATH_HASH_SIZE) == 0) n++;
+  }
+  sink += n;
+}
+
+static void benchSearchIndexed(int iter) {
+  uint8_t hash = iter * 37;
+  int n = 0;
+  for (int i = contact_index.first(hash); i >= 0 && n < 8; i = contact_index.next(i)) {
+    if (memcmp(contact_keys[i], &hash, PATH_HASH_SIZE) == 0) n++;
+  }
+  sink += n;
+}
+
+static void benchContactSearch(int count) {
+  num_contacts = count;
+  contact_index.clear();
+  for (int i = num_contacts - 1; i >= 0; i--) {
+    contact_index.add(i, contact_keys[i][0]);
+  }
+  char name[40];
+  snprintf(name, sizeof(name), "searchPeersByHash, linear (%d)", count);
+  report(name, benchSearchLinear);
+  snprintf(name, sizeof(name), "searchPeersByHash, indexed (%d)", count);
+  report(name, benchSearchIndexed);
+}
+
+// outbound queue add + get, at given depth: linear PacketQueue vs PacketScheduler (heaps)
+#define NUM_QUEUE_PACKETS   64
+
+static mesh::Packet queue_packets[NUM_QUEUE_PACKETS];
+static PacketQueue* linear_queue;
+static PacketScheduler* heap_queue;
+static uint32_t queue_now, queue_rand;
+
+static uint32_t queueRand() {
+  queue_rand = queue_rand*1103515245 + 12345;
+  return queue_rand >> 16;
+}
+
+static void benchQueueLinear(int iter) {
+  linear_queue->add(&queue_packets[iter % NUM_QUEUE_PACKETS], queueRand() % 8, queue_now + (queueRand() % 4000));
+  queue_now += 20;
+  while (linear_queue->countBefore(queue_now) == 0) queue_now += 20;   // ie. the old Dispatcher::checkSend()
+  linear_queue->get(queue_now);
+}
+
+static void benchQueueHeap(int iter) {
+  heap_queue->add(&queue_packets[iter % NUM_QUEUE_PACKETS], queueRand() % 8, queue_now + (queueRand() % 4000));
+  queue_now += 20;
+  while (!heap_queue->hasReady(queue_now)) queue_now += 20;   // ie. Dispatcher::checkSend()
+  heap_queue->get(queue_now);
+}
+
+static void benchQueues(int depth) {
+  linear_queue = new PacketQueue(depth);
+  heap_queue = new PacketScheduler(depth);
+  queue_rand = 42;
+  for (int i = 0; i < depth - 1; i++) {
+    linear_queue->add(&queue_packets[i % NUM_QUEUE_PACKETS], queueRand() % 8, queueRand() % 4000);
+  }
+  queue_rand = 42;
+  for (int i = 0; i < depth - 1; i++) {
+    heap_queue->add(&queue_packets[i % NUM_QUEUE_PACKETS], queueRand() % 8, queueRand() % 4000);
+  }
+
+  char name[40];
+  queue_now = 0;
+  snprintf(name, sizeof(name), "queue add+get, PacketQueue (%d)", depth);
+  report(name, benchQueueLinear);
+  queue_now = 0;
+  snprintf(name, sizeof(name), "queue add+get, PacketScheduler (%d)", depth);
+  report(name, benchQueueHeap);
+
+  delete linear_queue;
+  delete heap_queue;
+}
+
+// duplicate check (ie. MeshTables::hasSeen()), vs capacity: the old linear scan vs SimpleMeshTables
+class LinearTables {
+  uint8_t* _hashes;
+  int _size, _next_idx;
+public:
+  LinearTables(int size) : _size(size), _next_idx(0) {
+    _hashes = new uint8_t[size*MAX_HASH_SIZE];
+    memset(_hashes, 0, size*MAX_HASH_SIZE);
+  }
+  ~LinearTables() { delete[] _hashes; }
+  bool hasSeen(const mesh::Packet* packet) {
+    uint8_t hash[MAX_HASH_SIZE];
+    packet->calculatePacketHash(hash);
+    const uint8_t* sp = _hashes;
+    for (int i = 0; i < _size; i++, sp += MAX_HASH_SIZE) {
+      if (memcmp(hash, sp, MAX_HASH_SIZE) == 0) return true;
+    }
+    memcpy(&_hashes[_next_idx*MAX_HASH_SIZE], hash, MAX_HASH_SIZE);
+    _next_idx = (_next_idx + 1) % _size;
+    return false;
+  }
+};
+
+static LinearTables* linear_tables;
+static SimpleMeshTables* hashed_tables;
+static mesh::Packet seen_packet;
+static uint32_t seen_id;
+static int seen_capacity;
+
+static void makeSeenPacket(uint32_t id) {
+  seen_packet.invalidateHash();
+  seen_packet.header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  seen_packet.path_len = 0;
+  memcpy(seen_packet.payload, &id, 4);
+  seen_packet.payload_len = 4;
+}
+
+static void nextSeenPacket(int iter) {
+  makeSeenPacket((iter & 1) ? seen_id - 1 - (iter % seen_capacity) : seen_id++);   // mix of duplicates and new packets
+}
+
+static void benchSeenLinear(int iter) {
+  nextSeenPacket(iter);
+  sink += linear_tables->hasSeen(&seen_packet);
+}
+
+static void benchSeenHashed(int iter) {
+  nextSeenPacket(iter);
+  sink += hashed_tables->hasSeen(&seen_packet);
+}
+
+static void benchHasSeen(int capacity) {
+  seen_capacity = capacity;
+  linear_tables = new LinearTables(capacity);
+  hashed_tables = new SimpleMeshTables(capacity);
+  seen_id = 0;
+  for (int i = 0; i < capacity; i++) {   // fill the tables first
+    makeSeenPacket(seen_id++);
+    linear_tables->hasSeen(&seen_packet);
+    hashed_tables->hasSeen(&seen_packet);
+  }
+
+  uint32_t start_id = seen_id;
+  char name[40];
+  snprintf(name, sizeof(name), "hasSeen, linear scan (%d)", capacity);
+  report(name, benchSeenLinear);
+  seen_id = start_id;
+  snprintf(name, sizeof(name), "hasSeen, SimpleMeshTables (%d)", capacity);
+  report(name, benchSeenHashed);
+
+  delete linear_tables;
+  delete hashed_tables;
+}
+
+#if defined(ESP32) || !defined(ARDUINO)
+// advert blob storage, with 1000 blobs: one file per key (the old '/bl/' layout) vs BlobLogStore
+#include <helpers/BlobLogStore.h>
+#if defined(ESP32)
+  #include <SPIFFS.h>
+  #define BENCH_FS  SPIFFS
+#else
+  #include <LittleFS.h>   // the in-memory mock, ie. just the index and buffering costs
+  #define BENCH_FS  LittleFS
+#endif
+
+#define NUM_BENCH_BLOBS   1000
+
+static BlobLogStore bench_blobs("/bench_blobs", "/bench_blobs.tmp", NUM_BENCH_BLOBS);
+static uint8_t blob[150];
+
+static void blobPath(char* path, int i) {
+  char hex[17];
+  mesh::Utils::toHex(hex, contact_keys[i], 8);
+  sprintf(path, "/bb/%s", hex);
+}
+
+static void benchPutFile(int iter) {
+  char path[32];
+  blobPath(path, iter % NUM_BENCH_BLOBS);
+  File f = BENCH_FS.open(path, "w", true);
+  if (f) {
+    f.write(blob, sizeof(blob));
+    f.close();
+  }
+}
+
+static void benchGetFile(int iter) {
+  char path[32];
+  blobPath(path, (iter * 7) % NUM_BENCH_BLOBS);
+  if (BENCH_FS.exists(path)) {
+    File f = BENCH_FS.open(path, "r", false);
+    if (f) {
+      sink += f.read(out, MAX_PACKET_PAYLOAD);
+      f.close();
+    }
+  }
+}
+
+static void benchPutLog(int iter) {
+  bench_blobs.put(contact_keys[iter % NUM_BENCH_BLOBS], PUB_KEY_SIZE, blob, sizeof(blob));
+  bench_blobs.loop(millis());
+}
+
+static void benchGetLog(int iter) {
+  uint8_t dest[BLOB_MAX_LEN];
+  sink += bench_blobs.get(contact_keys[(iter * 7) % NUM_BENCH_BLOBS], PUB_KEY_SIZE, dest);
+}
+
+static void benchBlobStore() {
+#if defined(ESP32)
+  SPIFFS.begin(true);
+#endif
+  for (int i = 0; i < (int)sizeof(blob); i++) blob[i] = i;
+
+  report("blob put, file per key (1000)", benchPutFile, NUM_BENCH_BLOBS);
+  report("blob get, file per key (1000)", benchGetFile, NUM_BENCH_BLOBS);
+  for (int i = 0; i < NUM_BENCH_BLOBS; i++) {
+    char path[32];
+    blobPath(path, i);
+    BENCH_FS.remove(path);
+  }
+
+  bench_blobs.begin(&BENCH_FS);
+  report("blob put, BlobLogStore (1000)", benchPutLog, NUM_BENCH_BLOBS);
+  bench_blobs.flush();
+  report("blob get, BlobLogStore (1000)", benchGetLog, NUM_BENCH_BLOBS);
+  BENCH_FS.remove("/bench_blobs");
+}
+#endif
+
+static void runBenchmarks() {
+  for (int i = 0; i < PUB_KEY_SIZE; i++) secret[i] = i * 3;
+  for (int i = 0; i < (int)sizeof(plain); i++) plain[i] = i;
+  mesh::Utils::calcMACKey(mac_key, secret);
+  packet_len = mesh::Utils::encryptThenMAC(secret, packet, plain, sizeof(plain));
+  for (int i = 0; i < NUM_MANY_SECRETS; i++) {
+    memset(many_secrets[i], 0x80 + i, PUB_KEY_SIZE);
+  }
+  uint32_t x = 12345;
+  for (int i = 0; i < MAX_BENCH_CONTACTS; i++) {
+    for (int j = 0; j < PUB_KEY_SIZE; j++) {
+      x = x*1103515245 + 12345;
+      contact_keys[i][j] = x >> 16;
+    }
+  }
+
+  char line[80];
+  snprintf(line, sizeof(line), "perf_bench: %d iterations, %d byte payloads", NUM_ITERATIONS, (int)sizeof(plain));
+  benchPrint(line);
+  report("encrypt (setKey per packet)", benchEncryptSetKey);
+  report("encrypt (cached cipher)", benchEncryptCachedCipher);
+  report("encrypt (cache miss, LRU thrash)", benchEncryptCacheThrash);
+  report("calcMACKey", benchCalcMACKey);
+  report("MACThenDecrypt (calcMACKey each)", benchVerifyUncached);
+  report("MACThenDecrypt (cached MACKey)", benchVerifyCached);
+  report("MACThenDecrypt (MAC key cache hit)", benchVerifyCacheHit);
+  report("MACThenDecrypt (MAC key cache miss)", benchVerifyCacheThrash);
+  report("encryptThenMAC (MAC key cache hit)", benchEncryptUncached);
+  report("encryptThenMAC (cached MACKey)", benchEncryptCached);
+  benchContactSearch(100);
+  benchContactSearch(350);
+  benchContactSearch(1000);
+  benchContactSearch(2000);
+  benchQueues(16);
+  benchQueues(64);
+  benchQueues(256);
+  benchHasSeen(160);
+  benchHasSeen(1024);
+#ifndef ARDUINO
+  benchHasSeen(4096);
+#endif
+#if defined(ESP32) || !defined(ARDUINO)
+  benchBlobStore();
+#endif
+}
+
+#ifdef ARDUINO
+void setup() {
+  Serial.begin(115200);
+  delay(3000);
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;   // enable the DWT cycle counter
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  runBenchmarks();
+}
+
+void loop() { }
+#else
+int main(int argc, char* argv[]) {
+  runBenchmarks();
+  return 0;
+}
+#endif
@@ -49,6 +49,7 @@
 #define REQ_TYPE_GET_ACCESS_LIST    0x05
 #define REQ_TYPE_GET_NEIGHBOURS     0x06
 #define REQ_TYPE_GET_OWNER_INFO     0x07     // FIRMWARE_VER_LEVEL >= 2
+#define REQ_TYPE_GET_LATENCY_STATS  0x08
 
 #define RESP_SERVER_LOGIN_OK        0 // response to ANON_REQ
 
@@ -60,30 +61,9 @@
 
 #define LAZY_CONTACTS_WRITE_DELAY    5000
 
-void MyMesh::putNeighbour(const mesh::Identity &id, uint32_t timestamp, float snr) {
+void MyMesh::putNeighbour(const mesh::Identity &id, uint32_t timestamp, const mesh::Packet* packet) {
 #if MAX_NEIGHBOURS // check if neighbours enabled
-  // find existing neighbour, else use least recently updated
-  uint32_t oldest_timestamp = 0xFFFFFFFF;
-  NeighbourInfo *neighbour = &neighbours[0];
-  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    // if neighbour already known, we should update it
-    if (id.matches(neighbours[i].id)) {
-      neighbour = &neighbours[i];
-      break;
-    }
-
-    // otherwise we should update the least recently updated neighbour
-    if (neighbours[i].heard_timestamp < oldest_timestamp) {
-      neighbour = &neighbours[i];
-      oldest_timestamp = neighbour->heard_timestamp;
-    }
-  }
-
-  // update neighbour info
-  neighbour->id = id;
-  neighbour->advert_timestamp = timestamp;
-  neighbour->heard_timestamp = getRTCClock()->getCurrentTime();
-  neighbour->snr = (int8_t)(snr * 4);
+  neighbours.put(id, timestamp, packet->getSNR(), packet->getRSSI());
 #endif
 }
 
@@ -240,6 +220,23 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
 
     return 4 + sizeof(stats); //  reply_len
   }
+  if (payload[0] == REQ_TYPE_GET_LATENCY_STATS) {
+    uint8_t request_version = payload[1];
+    uint8_t route = payload[2];        // LATENCY_ROUTE_*
+    uint8_t pri_class = payload[3];    // for queue wait, 0xFF = all priorities
+    if (request_version == 0 && (route == LATENCY_ROUTE_FLOOD || route == LATENCY_ROUTE_DIRECT)) {
+      int ofs = 4;
+      reply_data[ofs++] = route;
+      reply_data[ofs++] = LATENCY_NUM_STAGES;
+      reply_data[ofs++] = LATENCY_NUM_BUCKETS;
+      mesh::LatencyHistogram h;
+      for (int s = 0; s < LATENCY_NUM_STAGES; s++) {
+        if (!getLatencyStats().getHistogram(h, s, route, pri_class == 0xFF ? -1 : pri_class)) h.reset();
+        memcpy(&reply_data[ofs], h.counts, sizeof(h.counts)); ofs += sizeof(h.counts);
+      }
+      return ofs;   // 4 + 3 + 4*32
+    }
+  }
   if (payload[0] == REQ_TYPE_GET_TELEMETRY_DATA) {
     uint8_t perm_mask = ~(payload[1]); // NEW: first reserved byte (of 4), is now inverse mask to apply to permissions
 
@@ -277,8 +274,8 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
     }
   }
   if (payload[0] == REQ_TYPE_GET_NEIGHBOURS) {
-    uint8_t request_version = payload[1];
-    if (request_version == 0) {
+    uint8_t request_version = payload[1];   // 0 = prefix/heard/snr, 1 = also link quality (averages and ETX)
+    if (request_version <= 1) {
 
       // reply data offset (after response sender_timestamp/tag)
       int reply_offset = 4;
@@ -287,7 +284,7 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       uint8_t count = payload[2]; // how many neighbours to fetch (0-255)
       uint16_t offset;
       memcpy(&offset, &payload[3], 2); // offset from start of neighbours list (0-65535)
-      uint8_t order_by = payload[5]; // how to order neighbours. 0=newest_to_oldest, 1=oldest_to_newest, 2=strongest_to_weakest, 3=weakest_to_strongest
+      uint8_t order_by = payload[5]; // how to order neighbours. 0=newest_to_oldest, 1=oldest_to_newest, 2=strongest_to_weakest, 3=weakest_to_strongest, 4=best_to_worst_link, 5=worst_to_best_link
       uint8_t pubkey_prefix_length = payload[6]; // how many bytes of neighbour pub key we want
       // we also send a 4 byte random blob in payload[7...10] to help packet uniqueness
 
@@ -299,16 +296,12 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
         MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS invalid pubkey_prefix_length=%d clamping to %d", pubkey_prefix_length, PUB_KEY_SIZE);
       }
 
-      // create copy of neighbours list, skipping empty entries so we can sort it separately from main list
+      // create copy of neighbours list, so we can sort it separately from main list
       int16_t neighbours_count = 0;
 #if MAX_NEIGHBOURS
       NeighbourInfo* sorted_neighbours[MAX_NEIGHBOURS];
-      for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-        auto neighbour = &neighbours[i];
-        if (neighbour->heard_timestamp > 0) {
-          sorted_neighbours[neighbours_count] = neighbour;
-          neighbours_count++;
-        }
+      for (int i = 0; i < neighbours.getCount(); i++) {
+        sorted_neighbours[neighbours_count++] = neighbours.getByIdx(i);
       }
 
       // sort neighbours based on order
@@ -336,6 +329,18 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
         std::sort(sorted_neighbours, sorted_neighbours + neighbours_count, [](const NeighbourInfo* a, const NeighbourInfo* b) {
           return a->snr < b->snr; // asc
         });
+      } else if (order_by == 4) {
+        // sort by best to worst link, ie. lowest ETX first, then by average SNR
+        MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS sorting best to worst link");
+        std::sort(sorted_neighbours, sorted_neighbours + neighbours_count, [](const NeighbourInfo* a, const NeighbourInfo* b) {
+          return a->getETX() != b->getETX() ? a->getETX() < b->getETX() : a->snr_avg > b->snr_avg;
+        });
+      } else if (order_by == 5) {
+        // sort by worst to best link
+        MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS sorting worst to best link");
+        std::sort(sorted_neighbours, sorted_neighbours + neighbours_count, [](const NeighbourInfo* a, const NeighbourInfo* b) {
+          return a->getETX() != b->getETX() ? a->getETX() > b->getETX() : a->snr_avg < b->snr_avg;
+        });
       }
 #endif
 
@@ -346,7 +351,7 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
       for(int index = 0; index < count && index + offset < neighbours_count; index++){
         
         // stop if we can't fit another entry in results
-        int entry_size = pubkey_prefix_length + 4 + 1;
+        int entry_size = pubkey_prefix_length + 4 + 1 + (request_version >= 1 ? 4 : 0);
         if(results_offset + entry_size > sizeof(results_buffer)){
           MESH_DEBUG_PRINTLN("REQ_TYPE_GET_NEIGHBOURS no more entries can fit in results buffer");
           break;
@@ -359,6 +364,12 @@ int MyMesh::handleRequest(ClientInfo *sender, uint32_t sender_timestamp, uint8_t
         memcpy(&results_buffer[results_offset], neighbour->id.pub_key, pubkey_prefix_length); results_offset += pubkey_prefix_length;
         memcpy(&results_buffer[results_offset], &heard_seconds_ago, 4); results_offset += 4;
         memcpy(&results_buffer[results_offset], &neighbour->snr, 1); results_offset += 1;
+        if (request_version >= 1) {
+          results_buffer[results_offset++] = (int8_t)(neighbour->snr_avg * 4);    // also x4, like snr
+          results_buffer[results_offset++] = (int8_t) neighbour->rssi_avg;
+          uint16_t etx = neighbour->getETX();   // x100
+          memcpy(&results_buffer[results_offset], &etx, 2); results_offset += 2;
+        }
         results_count++;
 #endif
 
@@ -386,16 +397,6 @@ mesh::Packet *MyMesh::createSelfAdvert() {
   return createAdvert(self_id, app_data, app_data_len);
 }
 
-File MyMesh::openAppend(const char *fname) {
-#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
-  return _fs->open(fname, FILE_O_WRITE);
-#elif defined(RP2040_PLATFORM)
-  return _fs->open(fname, "a");
-#else
-  return _fs->open(fname, "a", true);
-#endif
-}
-
 static uint8_t max_loop_minimal[] =  { 0, /* 1-byte */  4, /* 2-byte */  2, /* 3-byte */  1 };
 static uint8_t max_loop_moderate[] = { 0, /* 1-byte */  2, /* 2-byte */  1, /* 3-byte */  1 };
 static uint8_t max_loop_strict[] =   { 0, /* 1-byte */  1, /* 2-byte */  1, /* 3-byte */  1 };
@@ -480,58 +481,26 @@ void MyMesh::logRx(mesh::Packet *pkt, int len, float score) {
 #endif
 
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": RX, len=%d (type=%d, route=%s, payload_len=%d) SNR=%d RSSI=%d score=%d", len,
-               pkt->getPayloadType(), pkt->isRouteDirect() ? "D" : "F", pkt->payload_len,
-               (int)_radio->getLastSNR(), (int)_radio->getLastRSSI(), (int)(score * 1000));
-
-      if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ ||
-          pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        f.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-      } else {
-        f.printf("\n");
-      }
-      f.close();
-    }
+    packet_trace.add(TRACE_EVENT_RX, pkt, NULL, len, _radio->getLastSNR(), _radio->getLastRSSI(), score,
+                     getRTCClock()->getCurrentTime(), millis());
   }
 }
 
 void MyMesh::logTx(mesh::Packet *pkt, int len) {
 #ifdef WITH_BRIDGE
   if (_prefs.bridge_pkt_src == 0) {
-    bridge.sendPacket(pkt);
+    bridge.sendEncodedPacket(pkt, getOutboundRaw(), len);
   }
 #endif
 
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": TX, len=%d (type=%d, route=%s, payload_len=%d)", len, pkt->getPayloadType(),
-               pkt->isRouteDirect() ? "D" : "F", pkt->payload_len);
-
-      if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH || pkt->getPayloadType() == PAYLOAD_TYPE_REQ ||
-          pkt->getPayloadType() == PAYLOAD_TYPE_RESPONSE || pkt->getPayloadType() == PAYLOAD_TYPE_TXT_MSG) {
-        f.printf(" [%02X -> %02X]\n", (uint32_t)pkt->payload[1], (uint32_t)pkt->payload[0]);
-      } else {
-        f.printf("\n");
-      }
-      f.close();
-    }
+    packet_trace.add(TRACE_EVENT_TX, pkt, getOutboundRaw(), len, 0, 0, 0, getRTCClock()->getCurrentTime(), millis());
   }
 }
 
 void MyMesh::logTxFail(mesh::Packet *pkt, int len) {
   if (_logging) {
-    File f = openAppend(PACKET_LOG_FILE);
-    if (f) {
-      f.print(getLogDateTime());
-      f.printf(": TX FAIL!, len=%d (type=%d, route=%s, payload_len=%d)\n", len, pkt->getPayloadType(),
-               pkt->isRouteDirect() ? "D" : "F", pkt->payload_len);
-      f.close();
-    }
+    packet_trace.add(TRACE_EVENT_TX_FAIL, pkt, getOutboundRaw(), len, 0, 0, 0, getRTCClock()->getCurrentTime(), millis());
   }
 }
 
@@ -542,6 +511,17 @@ int MyMesh::calcRxDelay(float score, uint32_t air_time) const {
 
 uint32_t MyMesh::getRetransmitDelay(const mesh::Packet *packet) {
   uint32_t t = (_radio->getEstAirtimeFor(packet->getPathByteLen() + packet->payload_len + 2) * _prefs.tx_delay_factor);
+#if MAX_NEIGHBOURS
+  uint8_t n = packet->getPathHashCount();
+  if (_prefs.flood_delay_snr && n >= 2) {   // path[n-1] is now this node, so path[n-2] is the neighbour it was heard from
+    uint8_t sz = packet->getPathHashSize();
+    const NeighbourInfo* from = neighbours.lookup(&packet->path[(n - 2) * sz], sz);
+    if (from) {
+      // the nearer that neighbour, the less new coverage our relay adds, so give further away repeaters the first go
+      t = (uint32_t)(t * constrain(1.0f + from->snr_avg / 20.0f, 0.5f, 1.5f));
+    }
+  }
+#endif
   return getRNG()->nextInt(0, 5*t + 1);
 }
 uint32_t MyMesh::getDirectRetransmitDelay(const mesh::Packet *packet) {
@@ -642,7 +622,7 @@ void MyMesh::onAdvertRecv(mesh::Packet *packet, const mesh::Identity &id, uint32
   if (packet->getPathHashCount() == 0 && !isShare(packet)) {
     AdvertDataParser parser(app_data, app_data_len);
     if (parser.isValid() && parser.getType() == ADV_TYPE_REPEATER) { // just keep neigbouring Repeaters
-      putNeighbour(id, timestamp, packet->getSNR());
+      putNeighbour(id, timestamp, packet);
     }
   }
 }
@@ -825,7 +805,7 @@ void MyMesh::onControlDataRecv(mesh::Packet* packet) {
     if (id.matches(self_id)) {
       return;
     }
-    putNeighbour(id, rtc_clock.getCurrentTime(), packet->getSNR());
+    putNeighbour(id, rtc_clock.getCurrentTime(), packet);
   }
 }
 
@@ -848,11 +828,14 @@ void MyMesh::sendNodeDiscoverReq() {
 MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondClock &ms, mesh::RNG &rng,
                mesh::RTCClock &rtc, mesh::MeshTables &tables)
     : mesh::Mesh(radio, ms, rng, rtc, *new StaticPoolPacketManager(32), tables),
-      region_map(key_store), temp_map(key_store),
+      region_map(key_store), temp_map(key_store), packet_trace(PACKET_LOG_FILE),
       _cli(board, rtc, sensors, region_map, acl, &_prefs, this),
       telemetry(MAX_PACKET_PAYLOAD - 4),
       discover_limiter(4, 120),  // max 4 every 2 minutes
       anon_limiter(4, 180)   // max 4 every 3 minutes
+#if MAX_NEIGHBOURS
+      , neighbours(MAX_NEIGHBOURS, rtc)
+#endif
 #if defined(WITH_RS232_BRIDGE)
       , bridge(&_prefs, WITH_RS232_BRIDGE, _mgr, &rtc)
 #endif
@@ -869,7 +852,7 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   region_load_active = false;
 
 #if MAX_NEIGHBOURS
-  memset(neighbours, 0, sizeof(neighbours));
+  setNeighbourTable(&neighbours);
 #endif
 
   // defaults
@@ -892,6 +875,10 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _prefs.flood_max = 64;
   _prefs.flood_max_unscoped = 64;
   _prefs.flood_max_advert = 8;
+  _prefs.flood_suppress = 0;         // disabled
+  _prefs.flood_suppress_snr = -30;   // any relay counts
+  _prefs.ack_bundle_window = 0;      // disabled
+  _prefs.flood_delay_snr = 0;        // disabled
   _prefs.interference_threshold = 0; // disabled
 
   // bridge defaults
@@ -927,6 +914,7 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
 void MyMesh::begin(FILESYSTEM *fs) {
   mesh::Mesh::begin();
   _fs = fs;
+  packet_trace.begin(fs);
   // load persisted prefs
   _cli.loadPrefs(_fs);
   acl.load(_fs, self_id);
@@ -1039,20 +1027,27 @@ void MyMesh::updateFloodAdvertTimer() {
   }
 }
 
+static void printTraceRecord(void* ctx, const PacketTraceRecord& rec, const uint8_t* raw) {
+  char line[112 + 2*PACKET_TRACE_RAW_BYTES];
+  DateTime dt = DateTime(rec.timestamp);
+  int n = sprintf(line, "%02d:%02d:%02d - %d/%d/%d U: ", dt.hour(), dt.minute(), dt.second(), dt.day(), dt.month(),
+                  dt.year());
+  PacketTraceBuffer::formatRecord(&line[n], rec, raw);
+  Serial.println(line);
+}
+
+static void printTraceRecordHex(void* ctx, const PacketTraceRecord& rec, const uint8_t* raw) {
+  mesh::Utils::printHex(Serial, (const uint8_t *) &rec, sizeof(rec));
+  mesh::Utils::printHex(Serial, raw, PACKET_TRACE_RAW_BYTES);
+  Serial.println();
+}
+
 void MyMesh::dumpLogFile() {
-#if defined(RP2040_PLATFORM)
-  File f = _fs->open(PACKET_LOG_FILE, "r");
-#else
-  File f = _fs->open(PACKET_LOG_FILE);
-#endif
-  if (f) {
-    while (f.available()) {
-      int c = f.read();
-      if (c < 0) break;
-      Serial.print((char)c);
-    }
-    f.close();
-  }
+  packet_trace.forEachRecord(printTraceRecord, NULL);
+}
+
+void MyMesh::dumpLogFileHex() {
+  packet_trace.forEachRecord(printTraceRecordHex, NULL);
 }
 
 void MyMesh::setTxPower(int8_t power_dbm) {
@@ -1069,15 +1064,11 @@ void MyMesh::formatNeighborsReply(char *reply) {
   char *dp = reply;
 
 #if MAX_NEIGHBOURS
-  // create copy of neighbours list, skipping empty entries so we can sort it separately from main list
+  // create copy of neighbours list, so we can sort it separately from main list
   int16_t neighbours_count = 0;
   NeighbourInfo* sorted_neighbours[MAX_NEIGHBOURS];
-  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    auto neighbour = &neighbours[i];
-    if (neighbour->heard_timestamp > 0) {
-      sorted_neighbours[neighbours_count] = neighbour;
-      neighbours_count++;
-    }
+  for (int i = 0; i < neighbours.getCount(); i++) {
+    sorted_neighbours[neighbours_count++] = neighbours.getByIdx(i);
   }
 
   // sort neighbours newest to oldest
@@ -1111,12 +1102,7 @@ void MyMesh::formatNeighborsReply(char *reply) {
 
 void MyMesh::removeNeighbor(const uint8_t *pubkey, int key_len) {
 #if MAX_NEIGHBOURS
-  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
-    NeighbourInfo *neighbour = &neighbours[i];
-    if (memcmp(neighbour->id.pub_key, pubkey, key_len) == 0) {
-      neighbours[i] = NeighbourInfo(); // clear neighbour entry
-    }
-  }
+  neighbours.remove(pubkey, key_len);
 #endif
 }
 
@@ -1152,6 +1138,15 @@ void MyMesh::formatPacketStatsReply(char *reply) {
                                        getNumRecvFlood(), getNumRecvDirect());
 }
 
+void MyMesh::formatFloodStatsReply(char *reply) {
+  StatsFormatHelper::formatFloodStats(reply, ((SimpleMeshTables *)getTables())->getNumFloodDups(),
+                                      getNumRelayDups(), getNumRelaysCancelled());
+}
+
+void MyMesh::formatLatencyStatsReply(char *reply, int stage, int route, int pri_class) {
+  StatsFormatHelper::formatLatencyStats(reply, getLatencyStats(), stage, route, pri_class);
+}
+
 void MyMesh::saveIdentity(const mesh::LocalIdentity &new_id) {
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   IdentityStore store(*_fs, "");
@@ -1168,6 +1163,7 @@ void MyMesh::saveIdentity(const mesh::LocalIdentity &new_id) {
 void MyMesh::clearStats() {
   radio_driver.resetStats();
   resetStats();
+  resetRelayStats();
   ((SimpleMeshTables *)getTables())->resetStats();
 }
 
@@ -1301,6 +1297,8 @@ void MyMesh::loop() {
     dirty_contacts_expiry = 0;
   }
 
+  packet_trace.loop(millis());   // write out buffered trace records, in batches
+
   // update uptime
   uint32_t now = millis();
   uptime_millis += now - last_millis;
@@ -1314,3 +1312,13 @@ bool MyMesh::hasPendingWork() const {
 #endif
   return _mgr->getOutboundTotal() > 0;
 }
+
+unsigned long MyMesh::getNextWakeupMillis() const {
+  unsigned long next = mesh::Mesh::getNextWakeupMillis();
+  if (next_flood_advert) keepSooner(next, next_flood_advert);
+  if (next_local_advert) keepSooner(next, next_local_advert);
+  if (set_radio_at) keepSooner(next, set_radio_at);
+  if (revert_radio_at) keepSooner(next, revert_radio_at);
+  if (dirty_contacts_expiry) keepSooner(next, dirty_contacts_expiry);
+  return next;
+}
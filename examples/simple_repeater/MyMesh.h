@@ -28,7 +28,9 @@
 #include <helpers/ClientACL.h>
 #include <helpers/CommonCLI.h>
 #include <helpers/IdentityStore.h>
+#include <helpers/PacketTraceLog.h>
 #include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleNeighbourTable.h>
 #include <helpers/StaticPoolPacketManager.h>
 #include <helpers/StatsFormatHelper.h>
 #include <helpers/TxtDataHelpers.h>
@@ -61,13 +63,6 @@ struct RepeaterStats {
   #define MAX_CLIENTS           32
 #endif
 
-struct NeighbourInfo {
-  mesh::Identity id;
-  uint32_t advert_timestamp;
-  uint32_t heard_timestamp;
-  int8_t snr; // multiplied by 4, user should divide to get float value
-};
-
 #ifndef FIRMWARE_BUILD_DATE
   #define FIRMWARE_BUILD_DATE   "6 Jun 2026"
 #endif
@@ -86,6 +81,7 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   uint64_t uptime_millis;
   unsigned long next_local_advert, next_flood_advert;
   bool _logging;
+  PacketTraceLog packet_trace;
   NodePrefs _prefs;
   ClientACL  acl;
   CommonCLI _cli;
@@ -104,7 +100,7 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   bool region_load_active;
   unsigned long dirty_contacts_expiry;
 #if MAX_NEIGHBOURS
-  NeighbourInfo neighbours[MAX_NEIGHBOURS];
+  SimpleNeighbourTable neighbours;
 #endif
   CayenneLPP telemetry;
   unsigned long set_radio_at, revert_radio_at;
@@ -119,7 +115,7 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   ESPNowBridge bridge;
 #endif
 
-  void putNeighbour(const mesh::Identity& id, uint32_t timestamp, float snr);
+  void putNeighbour(const mesh::Identity& id, uint32_t timestamp, const mesh::Packet* packet);
   uint8_t handleLoginReq(const mesh::Identity& sender, const uint8_t* secret, uint32_t sender_timestamp, const uint8_t* data, bool is_flood);
   uint8_t handleAnonRegionsReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
   uint8_t handleAnonOwnerReq(const mesh::Identity& sender, uint32_t sender_timestamp, const uint8_t* data);
@@ -127,7 +123,6 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   int handleRequest(ClientInfo* sender, uint32_t sender_timestamp, uint8_t* payload, size_t payload_len);
   mesh::Packet* createSelfAdvert();
 
-  File openAppend(const char* fname);
   bool isLooped(const mesh::Packet* packet, const uint8_t max_counters[]);
 
 protected:
@@ -138,6 +133,9 @@ protected:
   bool allowPacketForward(const mesh::Packet* packet) override;
   const char* getLogDateTime() override;
   void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) override;
+#if MESH_PACKET_LOGGING
+  bool wantsRxRaw() const override { return true; }
+#endif
 
   void logRx(mesh::Packet* pkt, int len, float score) override;
   void logTx(mesh::Packet* pkt, int len) override;
@@ -156,6 +154,15 @@ protected:
   uint8_t getExtraAckTransmitCount() const override {
     return _prefs.multi_acks;
   }
+  uint8_t getFloodSuppressThreshold() const override {
+    return _prefs.flood_suppress;
+  }
+  float getFloodSuppressMinSNR() const override {
+    return _prefs.flood_suppress_snr;
+  }
+  uint32_t getAckBundleWindow() const override {
+    return _prefs.ack_bundle_window;
+  }
 
 #if ENV_INCLUDE_GPS == 1
   void applyGpsPrefs() {
@@ -201,19 +208,25 @@ public:
   void updateAdvertTimer() override;
   void updateFloodAdvertTimer() override;
 
-  void setLoggingOn(bool enable) override { _logging = enable; }
+  void setLoggingOn(bool enable) override {
+    _logging = enable;
+    if (!enable) packet_trace.flush();
+  }
 
   void eraseLogFile() override {
-    _fs->remove(PACKET_LOG_FILE);
+    packet_trace.erase();
   }
 
   void dumpLogFile() override;
+  void dumpLogFileHex() override;
   void setTxPower(int8_t power_dbm) override;
   void formatNeighborsReply(char *reply) override;
   void removeNeighbor(const uint8_t* pubkey, int key_len) override;
   void formatStatsReply(char *reply) override;
   void formatRadioStatsReply(char *reply) override;
   void formatPacketStatsReply(char *reply) override;
+  void formatFloodStatsReply(char *reply) override;
+  void formatLatencyStatsReply(char *reply, int stage, int route, int pri_class) override;
   void startRegionsLoad() override;
   bool saveRegions() override;
   void onDefaultRegionChanged(const RegionEntry* r) override;
@@ -248,6 +261,7 @@ public:
 
   // To check if there is pending work
   bool hasPendingWork() const;
+  unsigned long getNextWakeupMillis() const override;
 
 #if defined(USE_SX1262) || defined(USE_SX1268)
   void setRxBoostedGain(bool enable) override;
@@ -2,7 +2,11 @@
 
 #define REPLY_DELAY_MILLIS          1500
 #define PUSH_NOTIFY_DELAY_MILLIS    2000
-#define SYNC_PUSH_INTERVAL          1200
+#define PUSH_TICK_MILLIS            150    // how often push window of each client is checked
+
+#ifndef PUSH_MAX_QUEUED
+  #define PUSH_MAX_QUEUED             4    // max packets in send queue, before more pushes are started
+#endif
 
 #define PUSH_ACK_TIMEOUT_FLOOD      12000
 #define PUSH_TIMEOUT_BASE           4000
@@ -40,17 +44,13 @@ struct ServerStats {
 
 void MyMesh::addPost(ClientInfo *client, const char *postData) {
   // TODO: suggested postData format: <title>/<descrption>
-  posts[next_post_idx].author = client->id; // add to cyclic queue
-  StrHelper::strncpy(posts[next_post_idx].text, postData, MAX_POST_TEXT_LEN);
-
-  posts[next_post_idx].post_timestamp = getRTCClock()->getCurrentTimeUnique();
-  next_post_idx = (next_post_idx + 1) % MAX_UNSYNCED_POSTS;
+  posts.add(client->id, getRTCClock()->getCurrentTimeUnique(), postData);
 
   next_push = futureMillis(PUSH_NOTIFY_DELAY_MILLIS);
   _num_posted++; // stats
 }
 
-void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
+bool MyMesh::pushPostToClient(ClientInfo *client, const PostInfo &post, uint32_t &expected_ack) {
   int len = 0;
   memcpy(&reply_data[len], &post.post_timestamp, 4);
   len += 4; // this is a PAST timestamp... but should be accepted by client
@@ -68,46 +68,107 @@ void MyMesh::pushPostToClient(ClientInfo *client, PostInfo &post) {
   len += text_len;
 
   // calc expected ACK reply
-  mesh::Utils::sha256((uint8_t *)&client->extra.room.pending_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
-  client->extra.room.push_post_timestamp = post.post_timestamp;
+  mesh::Utils::sha256((uint8_t *)&expected_ack, 4, reply_data, len, client->id.pub_key, PUB_KEY_SIZE);
 
   auto reply = createDatagram(PAYLOAD_TYPE_TXT_MSG, client->id, client->shared_secret, reply_data, len);
-  if (reply) {
-    if (client->out_path_len == OUT_PATH_UNKNOWN) {
-      unsigned long delay_millis = 0;
-      sendFloodScoped(default_scope, reply, delay_millis, _prefs.path_hash_mode + 1); // REVISIT
-      client->extra.room.ack_timeout = futureMillis(PUSH_ACK_TIMEOUT_FLOOD);
-    } else {
-      sendDirect(reply, client->out_path, client->out_path_len);
+  if (reply == NULL) {
+    MESH_DEBUG_PRINTLN("Unable to push post to client");
+    return false;
+  }
+  if (client->out_path_len == OUT_PATH_UNKNOWN) {
+    unsigned long delay_millis = 0;
+    sendFloodScoped(default_scope, reply, delay_millis, _prefs.path_hash_mode + 1); // REVISIT
+    client->extra.room.ack_timeout = futureMillis(PUSH_ACK_TIMEOUT_FLOOD);
+  } else {
+    sendDirect(reply, client->out_path, client->out_path_len);
+
+    uint8_t path_hash_count = client->out_path_len & 63;
+    client->extra.room.ack_timeout = futureMillis(PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (path_hash_count + 1));
+  }
+  _num_post_pushes++; // stats
+  return true;
+}
+
+bool MyMesh::pushNextPost(ClientInfo *client) {
+  auto& win = client->extra.room.push;
 
-      uint8_t path_hash_count = client->out_path_len & 63;
-      client->extra.room.ack_timeout = futureMillis(PUSH_TIMEOUT_BASE + PUSH_ACK_TIMEOUT_FACTOR * (path_hash_count + 1));
+  // first, re-send any which timed out (keeping their prev ACK, in case it still arrives)
+  int i = win.getNextResend(posts);
+  if (i >= 0) {
+    PostInfo p;
+    if (!posts.get(win.in_flight[i].seq, p)) {   // unreadable, give up on it
+      win.giveUp(i);
+      return false;
     }
-    _num_post_pushes++; // stats
-  } else {
-    client->extra.room.pending_ack = 0;
-    MESH_DEBUG_PRINTLN("Unable to push post to client");
+    uint32_t ack;
+    if (!pushPostToClient(client, p, ack)) return false;   // try again next time
+
+    win.onResent(i, ack);
+    _num_push_retries++;
+    return true;
+  }
+
+  if (win.isFull()) return false;   // wait for ACKs
+
+  uint32_t seq = win.getSyncCursor(posts, client->id);   // next new post for this Client
+  if (seq >= posts.getNextSeq()) return false;   // none
+
+  uint32_t now = getRTCClock()->getCurrentTime();
+  uint32_t post_timestamp = posts.getTimestamp(seq);
+  if (now < post_timestamp + POST_SYNC_DELAY_SECS
+      && post_timestamp <= now + 60) {   // (unless post is from before our clock went backwards)
+    return false;   // too new
+  }
+
+  PostInfo p;
+  if (!posts.get(seq, p)) {
+    MESH_DEBUG_PRINTLN("unable to read post %u, skipped", seq);
+    win.next_post_seq = seq + 1;
+    return false;
+  }
+  uint32_t ack;
+  if (!pushPostToClient(client, p, ack)) return false;
+
+  win.onPushed(seq, p.post_timestamp, ack);
+  MESH_DEBUG_PRINTLN("pushed to client %02X: %s", (uint32_t)client->id.pub_key[0], p.text);
+  return true;
+}
+
+int MyMesh::getMaxNewPushes() {
+  int queued = _mgr->getOutboundTotal();
+  int n = PUSH_MAX_QUEUED - queued;   // leave room in send queue for other traffic
+
+  uint32_t est_airtime = _radio->getEstAirtimeFor(MAX_TRANS_UNIT);
+  if (est_airtime > 0) {
+    int by_budget = (int)(getAvailableTxBudget() / est_airtime) - queued;   // queued packets will use budget first
+    if (by_budget < n) n = by_budget;
   }
+  return n;
 }
 
 uint8_t MyMesh::getUnsyncedCount(ClientInfo *client) {
-  uint8_t count = 0;
-  for (int k = 0; k < MAX_UNSYNCED_POSTS; k++) {
-    if (posts[k].post_timestamp > client->extra.room.sync_since // is new post for this Client?
-        && !posts[k].author.matches(client->id)) {   // don't push posts to the author
-      count++;
-    }
+  int count = client->extra.room.push.getNumUnacked();
+  for (uint32_t seq = client->extra.room.push.getSyncCursor(posts, client->id); seq < posts.getNextSeq() && count < 255; seq++) {
+    if (!posts.isAuthor(seq, client->id)) count++;
   }
   return count;
 }
 
 bool MyMesh::processAck(const uint8_t *data) {
+  uint32_t ack;
+  memcpy(&ack, data, 4);
   for (int i = 0; i < acl.getNumClients(); i++) {
     auto client = acl.getClientByIdx(i);
-    if (client->extra.room.pending_ack && memcmp(data, &client->extra.room.pending_ack, 4) == 0) { // got an ACK from Client!
-      client->extra.room.pending_ack = 0; // clear this, so next push can happen
+    RoomPushEntry e;
+    if (client->extra.room.push.processAck(ack, e)) {
+      // got an ACK from Client!
       client->extra.room.push_failures = 0;
-      client->extra.room.sync_since = client->extra.room.push_post_timestamp; // advance Client's SINCE timestamp, to sync next post
+      _num_push_acks++;
+      if (ack != e.ack) _num_late_acks++;   // NOTE: a re-send can have the same ACK as the attempt before it
+      if (e.seq >= first_live_seq) {
+        uint32_t now = getRTCClock()->getCurrentTime();
+        fanout_secs.add(now > e.post_timestamp ? now - e.post_timestamp : 0);
+      }
       return true;
     }
   }
@@ -349,8 +410,7 @@ void MyMesh::onAnonDataRecv(mesh::Packet *packet, const uint8_t *secret, const m
 
       MESH_DEBUG_PRINTLN("Login success!");
       client->last_timestamp = sender_timestamp;
-      client->extra.room.sync_since = sender_sync_since;
-      client->extra.room.pending_ack = 0;
+      client->extra.room.push.reset(sender_sync_since);
       client->extra.room.push_failures = 0;
 
       client->last_activity = getRTCClock()->getCurrentTime();
@@ -541,11 +601,12 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
           memcpy(&data[5], &forceSince, 4); // make sure there are zeroes in payload (for ack_hash calc below)
         }
         if (forceSince > 0) {
-          client->extra.room.sync_since = forceSince; // force-update the 'sync since'
+          client->extra.room.push.reset(forceSince); // force-update the 'sync since'
+        } else {
+          // re-send un-ACK'd posts now, but keep their expected ACKs
+          client->extra.room.push.resendUnacked();
         }
 
-        client->extra.room.pending_ack = 0;
-
         // TODO: Throttle KEEP_ALIVE requests!
         // if client sends too quickly, evict()
 
@@ -618,6 +679,7 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
     : mesh::Mesh(radio, ms, rng, rtc, *new StaticPoolPacketManager(32), tables),
       region_map(key_store), temp_map(key_store),
       _cli(board, rtc, sensors, region_map, acl, &_prefs, this),
+      posts(POST_STORE_MAX_POSTS, MAX_UNSYNCED_POSTS),
       telemetry(MAX_PACKET_PAYLOAD - 4)
 {
   last_millis = 0;
@@ -649,6 +711,10 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _prefs.flood_max = 64;
   _prefs.flood_max_unscoped = 64;
   _prefs.flood_max_advert = 8;
+  _prefs.flood_suppress = 0;         // disabled
+  _prefs.flood_suppress_snr = -30;   // any relay counts
+  _prefs.ack_bundle_window = 0;      // disabled
+  _prefs.flood_delay_snr = 0;        // disabled
   _prefs.interference_threshold = 0; // disabled
 #ifdef ROOM_PASSWORD
   StrHelper::strncpy(_prefs.guest_password, ROOM_PASSWORD, sizeof(_prefs.guest_password));
@@ -659,11 +725,12 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
   _prefs.gps_interval = 0;
   _prefs.advert_loc_policy = ADVERT_LOC_PREFS;
 
-  next_post_idx = 0;
   next_client_idx = 0;
   next_push = 0;
-  memset(posts, 0, sizeof(posts));
   _num_posted = _num_post_pushes = 0;
+  _num_push_acks = _num_late_acks = _num_push_retries = 0;
+  fanout_secs.reset();
+  first_live_seq = 1;
 
   memset(default_scope.key, 0, sizeof(default_scope.key));
 }
@@ -675,6 +742,8 @@ void MyMesh::begin(FILESYSTEM *fs) {
   _cli.loadPrefs(_fs);
 
   acl.load(_fs, self_id);
+  posts.begin(_fs);
+  first_live_seq = posts.getNextSeq();
   region_map.load(_fs);
 
   // establish default-scope
@@ -840,6 +909,9 @@ void MyMesh::onDefaultRegionChanged(const RegionEntry* r) {
 void MyMesh::clearStats() {
   radio_driver.resetStats();
   resetStats();
+  _num_push_acks = _num_late_acks = _num_push_retries = 0;
+  fanout_secs.reset();
+  resetRelayStats();
   ((SimpleMeshTables *)getTables())->resetStats();
 }
 
@@ -856,6 +928,15 @@ void MyMesh::formatPacketStatsReply(char *reply) {
                                        getNumRecvFlood(), getNumRecvDirect());
 }
 
+void MyMesh::formatFloodStatsReply(char *reply) {
+  StatsFormatHelper::formatFloodStats(reply, ((SimpleMeshTables *)getTables())->getNumFloodDups(),
+                                      getNumRelayDups(), getNumRelaysCancelled());
+}
+
+void MyMesh::formatLatencyStatsReply(char *reply, int stage, int route, int pri_class) {
+  StatsFormatHelper::formatLatencyStats(reply, getLatencyStats(), stage, route, pri_class);
+}
+
 void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply) {
   if (region_load_active) {
     if (StrHelper::isBlank(command)) {  // empty/blank line, signal to terminate 'load' operation
@@ -934,6 +1015,14 @@ void MyMesh::handleCommand(uint32_t sender_timestamp, char *command, char *reply
       Serial.printf("\n");
     }
     reply[0] = 0;
+  } else if (sender_timestamp == 0 && strcmp(command, "stats-push") == 0) {
+    int in_flight = 0;
+    for (int i = 0; i < acl.getNumClients(); i++) {
+      in_flight += acl.getClientByIdx(i)->extra.room.push.getNumUnacked();
+    }
+    sprintf(reply, "{\"posted\":%u,\"pushes\":%u,\"acks\":%u,\"late_acks\":%u,\"retries\":%u,\"in_flight\":%d,\"fanout_secs\":[%u,%u]}",
+      (uint32_t)_num_posted, (uint32_t)_num_post_pushes, _num_push_acks, _num_late_acks, _num_push_retries, in_flight,
+      fanout_secs.getPercentile(50), fanout_secs.getPercentile(90));
   } else{
     _cli.handleCommand(sender_timestamp, command, reply);  // common CLI commands
   }
@@ -950,43 +1039,24 @@ void MyMesh::loop() {
     // check for ACK timeouts
     for (int i = 0; i < acl.getNumClients(); i++) {
       auto c = acl.getClientByIdx(i);
-      if (c->extra.room.pending_ack && millisHasNowPassed(c->extra.room.ack_timeout)) {
+      if (millisHasNowPassed(c->extra.room.ack_timeout) && c->extra.room.push.onAckTimeout()) {
         c->extra.room.push_failures++;
-        c->extra.room.pending_ack = 0; // reset  (TODO: keep prev expected_ack's in a list, incase they arrive LATER, after we retry)
         MESH_DEBUG_PRINTLN("pending ACK timed out: push_failures: %d", (uint32_t)c->extra.room.push_failures);
       }
     }
-    // check next Round-Robin client, and sync next new post
-    auto client = acl.getClientByIdx(next_client_idx);
-    bool did_push = false;
-    if (client->extra.room.pending_ack == 0 && client->last_activity != 0 &&
-        client->extra.room.push_failures < 3) { // not already waiting for ACK, AND not evicted, AND retries not max
-      MESH_DEBUG_PRINTLN("loop - checking for client %02X", (uint32_t)client->id.pub_key[0]);
-      uint32_t now = getRTCClock()->getCurrentTime();
-      for (int k = 0, idx = next_post_idx; k < MAX_UNSYNCED_POSTS; k++) {
-        auto p = &posts[idx];
-        if (now >= p->post_timestamp + POST_SYNC_DELAY_SECS &&
-            p->post_timestamp > client->extra.room.sync_since // is new post for this Client?
-            && !p->author.matches(client->id)) {   // don't push posts to the author
-          // push this post to Client, then wait for ACK
-          pushPostToClient(client, *p);
-          did_push = true;
-          MESH_DEBUG_PRINTLN("loop - pushed to client %02X: %s", (uint32_t)client->id.pub_key[0], p->text);
-          break;
-        }
-        idx = (idx + 1) % MAX_UNSYNCED_POSTS; // wrap to start of cyclic queue
-      }
-    } else {
-      MESH_DEBUG_PRINTLN("loop - skipping busy (or evicted) client %02X", (uint32_t)client->id.pub_key[0]);
-    }
-    next_client_idx = (next_client_idx + 1) % acl.getNumClients(); // round robin polling for each client
+    // visit clients Round-Robin, pushing next post to each, while send queue and TX budget allow
+    int max_pushes = getMaxNewPushes();
+    int num_pushed = 0;
+    for (int k = 0; k < acl.getNumClients() && num_pushed < max_pushes; k++) {
+      next_client_idx %= acl.getNumClients();
+      auto client = acl.getClientByIdx(next_client_idx);
+      next_client_idx++;
 
-    if (did_push) {
-      next_push = futureMillis(SYNC_PUSH_INTERVAL);
-    } else {
-      // were no unsynced posts for curr client, so process next client much quicker! (in next loop())
-      next_push = futureMillis(SYNC_PUSH_INTERVAL / 8);
+      if (client->last_activity == 0 || client->extra.room.push_failures >= 3) continue;  // evicted, or retries max
+
+      if (pushNextPost(client)) num_pushed++;
     }
+    next_push = futureMillis(PUSH_TICK_MILLIS);
   }
 
   if (next_flood_advert && millisHasNowPassed(next_flood_advert)) {
@@ -1028,3 +1098,14 @@ void MyMesh::loop() {
   uptime_millis += now - last_millis;
   last_millis = now;
 }
+
+unsigned long MyMesh::getNextWakeupMillis() const {
+  unsigned long next = mesh::Mesh::getNextWakeupMillis();
+  if (acl.getNumClients() > 0) keepSooner(next, next_push);
+  if (next_flood_advert) keepSooner(next, next_flood_advert);
+  if (next_local_advert) keepSooner(next, next_local_advert);
+  if (set_radio_at) keepSooner(next, set_radio_at);
+  if (revert_radio_at) keepSooner(next, revert_radio_at);
+  if (dirty_contacts_expiry) keepSooner(next, dirty_contacts_expiry);
+  return next;
+}
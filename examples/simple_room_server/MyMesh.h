@@ -23,6 +23,7 @@
 #include <helpers/RegionMap.h>
 #include <RTClib.h>
 #include <target.h>
+#include "PostStore.h"
 
 /* ------------------------------ Config -------------------------------- */
 
@@ -65,7 +66,7 @@
 #endif
 
 #ifndef MAX_UNSYNCED_POSTS
-  #define MAX_UNSYNCED_POSTS    32
+  #define MAX_UNSYNCED_POSTS    32    // most recent posts, also cached in RAM
 #endif
 
 #ifndef SERVER_RESPONSE_DELAY
@@ -80,14 +81,6 @@
 
 #define PACKET_LOG_FILE  "/packet_log"
 
-#define MAX_POST_TEXT_LEN    (160-9)
-
-struct PostInfo {
-  mesh::Identity author;
-  uint32_t post_timestamp;   // by OUR clock
-  char text[MAX_POST_TEXT_LEN+1];
-};
-
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   FILESYSTEM* _fs;
   uint32_t last_millis;
@@ -104,9 +97,11 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   uint8_t reply_data[MAX_PACKET_PAYLOAD];
   unsigned long next_push;
   uint16_t _num_posted, _num_post_pushes;
+  uint32_t _num_push_acks, _num_late_acks, _num_push_retries;
+  mesh::LatencyHistogram fanout_secs;   // post -> ACK from each client, for posts made since boot. NOTE: log2 buckets of seconds
+  uint32_t first_live_seq;
   int next_client_idx;  // for round-robin polling
-  int next_post_idx;
-  PostInfo posts[MAX_UNSYNCED_POSTS];   // cyclic queue
+  PostStore posts;
   CayenneLPP telemetry;
   RegionEntry* load_stack[8];
   RegionEntry* recv_pkt_region;
@@ -119,7 +114,9 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   int  matching_peer_indexes[MAX_CLIENTS];
 
   void addPost(ClientInfo* client, const char* postData);
-  void pushPostToClient(ClientInfo* client, PostInfo& post);
+  bool pushPostToClient(ClientInfo* client, const PostInfo& post, uint32_t& expected_ack);
+  bool pushNextPost(ClientInfo* client);
+  int getMaxNewPushes();
   uint8_t getUnsyncedCount(ClientInfo* client);
   bool processAck(const uint8_t *data);
   mesh::Packet* createSelfAdvert();
@@ -132,6 +129,9 @@ protected:
   }
 
   void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) override;
+#if MESH_PACKET_LOGGING
+  bool wantsRxRaw() const override { return true; }
+#endif
   void logRx(mesh::Packet* pkt, int len, float score) override;
   void logTx(mesh::Packet* pkt, int len) override;
   void logTxFail(mesh::Packet* pkt, int len) override;
@@ -150,6 +150,15 @@ protected:
   uint8_t getExtraAckTransmitCount() const override {
     return _prefs.multi_acks;
   }
+  uint8_t getFloodSuppressThreshold() const override {
+    return _prefs.flood_suppress;
+  }
+  float getFloodSuppressMinSNR() const override {
+    return _prefs.flood_suppress_snr;
+  }
+  uint32_t getAckBundleWindow() const override {
+    return _prefs.ack_bundle_window;
+  }
 
   bool filterRecvFloodPacket(mesh::Packet* pkt) override;
 
@@ -210,6 +219,8 @@ public:
   void formatStatsReply(char *reply) override;
   void formatRadioStatsReply(char *reply) override;
   void formatPacketStatsReply(char *reply) override;
+  void formatFloodStatsReply(char *reply) override;
+  void formatLatencyStatsReply(char *reply, int stage, int route, int pri_class) override;
   void startRegionsLoad() override;
   bool saveRegions() override;
   void onDefaultRegionChanged(const RegionEntry* r) override;
@@ -222,4 +233,5 @@ public:
   void clearStats() override;
   void handleCommand(uint32_t sender_timestamp, char* command, char* reply);
   void loop();
+  unsigned long getNextWakeupMillis() const override;
 };
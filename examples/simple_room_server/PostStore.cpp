@@ -0,0 +1,202 @@
+#include "PostStore.h"
+#include <helpers/TxtDataHelpers.h>
+
+#if defined(ESP32)
+  #include <SPIFFS.h>
+#endif
+
+PostStore::PostStore(int max_posts, int cache_size) {
+  _fs = NULL;
+  _max_posts = max_posts > 0 ? max_posts : 1;
+  _index = new IndexEntry[_max_posts]();
+  _cache_size = cache_size > 0 ? cache_size : 1;
+  _cache = new PostInfo[_cache_size]();   // value-initialized, all seq = 0
+  _first_seq = _next_seq = 1;
+  _file_slots = 0;
+}
+
+File PostStore::openRead() {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(POST_STORE_FILE, FILE_O_READ);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(POST_STORE_FILE, "r");
+#else
+  return _fs->open(POST_STORE_FILE, "r", false);
+#endif
+}
+
+File PostStore::openWrite() {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(POST_STORE_FILE, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  return _fs->open(POST_STORE_FILE, _file_slots > 0 ? "r+" : "w+");
+#else
+  return _fs->open(POST_STORE_FILE, _file_slots > 0 ? "r+" : "w+", true);
+#endif
+}
+
+void PostStore::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  _first_seq = _next_seq = 1;
+  _file_slots = 0;
+
+  File file = openRead();
+  if (!file) return;   // no history yet
+
+  int n = file.size() / POST_RECORD_SIZE;
+  if (n > _max_posts) n = _max_posts;
+  uint32_t* seqs = new uint32_t[n > 0 ? n : 1];   // only needed while loading
+  bool wrapped = false;
+  for (int slot = 0; slot < n; slot++) {
+    file.seek(slot * POST_RECORD_SIZE);
+    IndexEntry& e = _index[slot];
+    if (file.read((uint8_t *) &seqs[slot], 4) != 4 || file.read((uint8_t *) &e.timestamp, 4) != 4
+        || file.read(e.author_prefix, 4) != 4) break;
+
+    _file_slots = slot + 1;
+    if (seqs[slot] > (uint32_t) n) wrapped = true;
+  }
+  file.close();
+
+  if (wrapped && _file_slots > 0) _max_posts = _file_slots;   // ring stopped growing, eg. at free space limit
+
+  uint32_t newest = 0;
+  for (int slot = 0; slot < _file_slots; slot++) {
+    uint32_t seq = seqs[slot];
+    if (seq != 0 && slotOf(seq) == slot && seq > newest) newest = seq;  // mismatched slot, eg. if POST_STORE_MAX_POSTS changed
+  }
+
+  if (newest > 0) {
+    // walk back from newest post, while older ones are in their expected slots
+    uint32_t first = newest;
+    while (first > 1 && (int)(newest - first) + 1 < _max_posts) {
+      int slot = slotOf(first - 1);
+      if (slot >= _file_slots || seqs[slot] != first - 1 || _index[slot].timestamp >= getTimestamp(first)) break;
+      first--;
+    }
+    _first_seq = first;
+    _next_seq = newest + 1;
+  }
+  delete[] seqs;
+  MESH_DEBUG_PRINTLN("PostStore: loaded %d posts, seq %u..%u", getCount(), _first_seq, _next_seq - 1);
+}
+
+bool PostStore::readRecord(File& file, int slot, PostInfo& dest) {
+  file.seek(slot * POST_RECORD_SIZE);
+  bool success = file.read((uint8_t *) &dest.seq, 4) == 4
+                && file.read((uint8_t *) &dest.post_timestamp, 4) == 4
+                && file.read(dest.author.pub_key, PUB_KEY_SIZE) == PUB_KEY_SIZE
+                && file.read((uint8_t *) dest.text, MAX_POST_TEXT_LEN + 1) == MAX_POST_TEXT_LEN + 1;
+  dest.text[MAX_POST_TEXT_LEN] = 0;  // just in case
+  return success;
+}
+
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+static int countLfsBlock(void* p, lfs_block_t block) {
+  (*(lfs_size_t *) p)++;
+  return 0;
+}
+#endif
+
+bool PostStore::canGrowFile() const {
+  uint32_t total_kb, used_kb;
+#if defined(ESP32)
+  total_kb = SPIFFS.totalBytes() / 1024;
+  used_kb = SPIFFS.usedBytes() / 1024;
+#elif defined(RP2040_PLATFORM)
+  FSInfo info;
+  info.totalBytes = info.usedBytes = 0;
+  _fs->info(info);
+  total_kb = info.totalBytes / 1024;
+  used_kb = info.usedBytes / 1024;
+#elif defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  const lfs_config* config = _fs->_getFS()->cfg;
+  lfs_size_t used_blocks = 0;
+  if (lfs_traverse(_fs->_getFS(), countLfsBlock, &used_blocks) != 0) return false;
+  total_kb = config->block_size * config->block_count / 1024;
+  used_kb = config->block_size * used_blocks / 1024;
+#else
+  return true;
+#endif
+  return total_kb == 0 || (total_kb > used_kb && total_kb - used_kb > POST_STORE_MIN_FREE_KB);
+}
+
+bool PostStore::writeRecord(int slot, const PostInfo& post) {
+  if (slot > _file_slots) return false;   // can't leave a gap (eg. after a failed write), wait until ring wraps
+
+  File file = openWrite();
+  if (!file) return false;
+
+  uint8_t rec[POST_RECORD_SIZE];
+  int len = 0;
+  memcpy(&rec[len], &post.seq, 4); len += 4;
+  memcpy(&rec[len], &post.post_timestamp, 4); len += 4;
+  memcpy(&rec[len], post.author.pub_key, PUB_KEY_SIZE); len += PUB_KEY_SIZE;
+  memcpy(&rec[len], post.text, MAX_POST_TEXT_LEN + 1);
+
+  file.seek(slot * POST_RECORD_SIZE);
+  bool success = file.write(rec, POST_RECORD_SIZE) == POST_RECORD_SIZE;
+  file.close();
+
+  if (success && slot == _file_slots) _file_slots++;
+  return success;
+}
+
+const PostInfo& PostStore::add(const mesh::Identity& author, uint32_t timestamp, const char* text) {
+  if (getCount() > 0 && timestamp <= getTimestamp(_next_seq - 1)) {
+    timestamp = getTimestamp(_next_seq - 1) + 1;   // keep timestamps increasing, so index can be searched
+  }
+  uint32_t seq = _next_seq++;
+  if (_fs && _file_slots > 0 && seq - 1 == (uint32_t) _file_slots && _file_slots < _max_posts && !canGrowFile()) {
+    // file would grow, but storage is getting full. Ring hasn't wrapped yet, so can wrap at file size from here
+    MESH_DEBUG_PRINTLN("PostStore: storage low, keeping last %d posts", _file_slots);
+    _max_posts = _file_slots;
+  }
+  if (getCount() > _max_posts) _first_seq++;   // oldest post is overwritten
+
+  PostInfo& p = _cache[seq % _cache_size];
+  memset(p.text, 0, sizeof(p.text));   // zero padded in file
+  p.seq = seq;
+  p.author = author;
+  p.post_timestamp = timestamp;
+  StrHelper::strncpy(p.text, text, MAX_POST_TEXT_LEN);
+
+  IndexEntry& e = _index[slotOf(seq)];
+  e.timestamp = timestamp;
+  memcpy(e.author_prefix, author.pub_key, 4);
+
+  if (_fs && !writeRecord(slotOf(seq), p)) {
+    MESH_DEBUG_PRINTLN("PostStore: unable to write post %u", seq);   // will only be in RAM cache
+  }
+  return p;
+}
+
+bool PostStore::get(uint32_t seq, PostInfo& dest) {
+  if (seq < _first_seq || seq >= _next_seq) return false;
+
+  const PostInfo& c = _cache[seq % _cache_size];
+  if (c.seq == seq) {
+    dest = c;
+    return true;
+  }
+  if (_fs == NULL) return false;
+
+  File file = openRead();
+  if (!file) return false;
+  bool success = readRecord(file, slotOf(seq), dest) && dest.seq == seq;
+  file.close();
+  return success;
+}
+
+uint32_t PostStore::findFirstAfter(uint32_t since) const {
+  uint32_t lo = _first_seq, hi = _next_seq;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    if (getTimestamp(mid) > since) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
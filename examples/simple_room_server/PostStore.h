@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>   // needed for PlatformIO
+#include <Mesh.h>
+#include <helpers/IdentityStore.h>   // for FILESYSTEM
+#include <helpers/RoomPushWindow.h>
+
+#ifndef POST_STORE_MAX_POSTS
+  #if defined(ESP32)
+    #define POST_STORE_MAX_POSTS   2048   // ~380KB of flash, if the partition has room (see POST_STORE_MIN_FREE_KB)
+  #elif defined(RP2040_PLATFORM)
+    #define POST_STORE_MAX_POSTS   1024
+  #elif defined(NRF52_PLATFORM)
+    #define POST_STORE_MAX_POSTS     64   // InternalFS is small
+  #else
+    #define POST_STORE_MAX_POSTS     32
+  #endif
+#endif
+
+#ifndef POST_STORE_MIN_FREE_KB
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define POST_STORE_MIN_FREE_KB    8
+  #else
+    #define POST_STORE_MIN_FREE_KB   32   // file stops growing below this, leaving room for prefs, ACL, etc
+  #endif
+#endif
+
+#define POST_STORE_FILE   "/posts"
+
+#define MAX_POST_TEXT_LEN    (160-9)
+
+#define POST_RECORD_SIZE   (4 + 4 + PUB_KEY_SIZE + MAX_POST_TEXT_LEN + 1)   // seq, timestamp, author, text
+
+struct PostInfo {
+  uint32_t seq;              // assigned by PostStore, increases by one for each post
+  mesh::Identity author;
+  uint32_t post_timestamp;   // by OUR clock
+  char text[MAX_POST_TEXT_LEN+1];
+};
+
+/**
+ * \brief  History of room posts, in a ring of fixed size records in flash. Posts are numbered by 'seq', and their
+ *       timestamps always increase with seq, so the RAM index (timestamp + author prefix per post) can be
+ *       binary searched by timestamp. The most recent posts are also cached in RAM, so pushing new posts
+ *       needs no flash reads.
+ *       The file grows one record at a time, up to max_posts. If free space drops to POST_STORE_MIN_FREE_KB
+ *       first, the ring wraps at the file's current size instead (and stays that size after a reboot).
+*/
+class PostStore : public RoomPostSource {
+  struct IndexEntry {
+    uint32_t timestamp;
+    uint8_t author_prefix[4];
+  };
+
+  FILESYSTEM* _fs;
+  IndexEntry* _index;    // by slotOf(seq)
+  int _max_posts;        // ring size, can only shrink from the constructor's max_posts
+  PostInfo* _cache;      // by seq % _cache_size
+  int _cache_size;
+  uint32_t _first_seq, _next_seq;   // posts held are: _first_seq .. _next_seq-1
+  int _file_slots;                  // num records in file
+
+  int slotOf(uint32_t seq) const { return (seq - 1) % _max_posts; }
+  File openRead();
+  File openWrite();
+  bool readRecord(File& file, int slot, PostInfo& dest);
+  bool writeRecord(int slot, const PostInfo& post);
+  bool canGrowFile() const;
+
+public:
+  PostStore(int max_posts, int cache_size);
+
+  /**
+   * \brief  rebuilds the index from the posts file, if any
+  */
+  void begin(FILESYSTEM* fs);
+
+  /**
+   * \brief  stores a new post, evicting the oldest if full. The timestamp is bumped if needed, to be greater
+   *       than the newest post's (eg. if the clock went backwards)
+   * \returns  the stored post
+  */
+  const PostInfo& add(const mesh::Identity& author, uint32_t timestamp, const char* text);
+
+  bool get(uint32_t seq, PostInfo& dest);
+
+  uint32_t getFirstSeq() const override { return _first_seq; }
+  uint32_t getNextSeq() const override { return _next_seq; }
+  int getCount() const { return _next_seq - _first_seq; }
+  uint32_t getTimestamp(uint32_t seq) const { return _index[slotOf(seq)].timestamp; }
+
+  /**
+   * \brief  NOTE: compares the 4 byte prefix of the author's public key, same as what is pushed to clients
+  */
+  bool isAuthor(uint32_t seq, const mesh::Identity& id) const override {
+    return memcmp(_index[slotOf(seq)].author_prefix, id.pub_key, 4) == 0;
+  }
+
+  /**
+   * \returns  seq of the oldest post with timestamp after 'since', or getNextSeq() if none
+  */
+  uint32_t findFirstAfter(uint32_t since) const override;
+};
@@ -725,6 +725,10 @@ SensorMesh::SensorMesh(mesh::MainBoard& board, mesh::Radio& radio, mesh::Millise
   _prefs.flood_advert_interval = 0;   // disabled
   _prefs.disable_fwd = true;
   _prefs.flood_max = 64;
+  _prefs.flood_suppress = 0;          // disabled
+  _prefs.flood_suppress_snr = -30;    // any relay counts
+  _prefs.ack_bundle_window = 0;     // disabled
+  _prefs.flood_delay_snr = 0;       // disabled
   _prefs.interference_threshold = 0;  // disabled
 
   // GPS defaults
@@ -858,6 +862,15 @@ void SensorMesh::formatPacketStatsReply(char *reply) {
                                        getNumRecvFlood(), getNumRecvDirect());
 }
 
+void SensorMesh::formatFloodStatsReply(char *reply) {
+  StatsFormatHelper::formatFloodStats(reply, ((SimpleMeshTables *)getTables())->getNumFloodDups(),
+                                      getNumRelayDups(), getNumRelaysCancelled());
+}
+
+void SensorMesh::formatLatencyStatsReply(char *reply, int stage, int route, int pri_class) {
+  StatsFormatHelper::formatLatencyStats(reply, getLatencyStats(), stage, route, pri_class);
+}
+
 float SensorMesh::getTelemValue(uint8_t channel, uint8_t type) {
   auto buf = telemetry.getBuffer();
   uint8_t size = telemetry.getSize();
@@ -972,3 +985,21 @@ void SensorMesh::loop() {
     dirty_contacts_expiry = 0;
   }
 }
+
+unsigned long SensorMesh::getNextWakeupMillis() const {
+  unsigned long next = mesh::Mesh::getNextWakeupMillis();
+  if (next_flood_advert) keepSooner(next, next_flood_advert);
+  if (next_local_advert) keepSooner(next, next_local_advert);
+  if (set_radio_at) keepSooner(next, set_radio_at);
+  if (revert_radio_at) keepSooner(next, revert_radio_at);
+  if (dirty_contacts_expiry) keepSooner(next, dirty_contacts_expiry);
+  if (num_alert_tasks > 0) keepSooner(next, alert_tasks[0]->send_expiry);
+
+  uint32_t curr = getRTCClock()->getCurrentTime();
+  if (curr >= last_read_time + SENSOR_READ_INTERVAL_SECS) {
+    keepSooner(next, _ms->getMillis());   // sensors due for reading now
+  } else {
+    keepSooner(next, futureMillis((last_read_time + SENSOR_READ_INTERVAL_SECS - curr) * 1000));
+  }
+  return next;
+}
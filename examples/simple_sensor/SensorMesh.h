@@ -51,6 +51,7 @@ public:
   SensorMesh(mesh::MainBoard& board, mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::MeshTables& tables);
   void begin(FILESYSTEM* fs);
   void loop();
+  unsigned long getNextWakeupMillis() const override;
   void handleCommand(uint32_t sender_timestamp, char* command, char* reply);
 
   // CommonCLI callbacks
@@ -74,6 +75,8 @@ public:
   void formatStatsReply(char *reply) override;
   void formatRadioStatsReply(char *reply) override;
   void formatPacketStatsReply(char *reply) override;
+  void formatFloodStatsReply(char *reply) override;
+  void formatLatencyStatsReply(char *reply, int stage, int route, int pri_class) override;
   mesh::LocalIdentity& getSelfId() override { return self_id; }
   void saveIdentity(const mesh::LocalIdentity& new_id) override;
   void clearStats() override { }
@@ -117,6 +120,9 @@ protected:
   float getAirtimeBudgetFactor() const override;
   bool allowPacketForward(const mesh::Packet* packet) override;
   int calcRxDelay(float score, uint32_t air_time) const override;
+  uint8_t getFloodSuppressThreshold() const override { return _prefs.flood_suppress; }
+  float getFloodSuppressMinSNR() const override { return _prefs.flood_suppress_snr; }
+  uint32_t getAckBundleWindow() const override { return _prefs.ack_bundle_window; }
   uint32_t getRetransmitDelay(const mesh::Packet* packet) override;
   uint32_t getDirectRetransmitDelay(const mesh::Packet* packet) override;
   int getInterferenceThreshold() const override;
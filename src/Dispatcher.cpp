@@ -16,10 +16,78 @@ namespace mesh {
   #define NOISE_FLOOR_CALIB_INTERVAL   2000     // 2 seconds
 #endif
 
+int LatencyHistogram::getBucketFor(uint32_t millis) {
+  int b = 0;
+  while (millis > 0 && b < LATENCY_NUM_BUCKETS - 1) {
+    millis >>= 1;
+    b++;
+  }
+  return b;
+}
+
+void LatencyHistogram::add(uint32_t millis) {
+  uint16_t& c = counts[getBucketFor(millis)];
+  if (c < 0xFFFF) c++;
+}
+
+uint32_t LatencyHistogram::getTotal() const {
+  uint32_t n = 0;
+  for (int i = 0; i < LATENCY_NUM_BUCKETS; i++) n += counts[i];
+  return n;
+}
+
+uint32_t LatencyHistogram::getPercentile(int pct) const {
+  uint32_t total = getTotal();
+  if (total == 0) return 0;
+
+  uint32_t target = (total * pct + 99) / 100;   // rank, rounded up
+  if (target == 0) target = 1;
+  uint32_t n = 0;
+  for (int i = 0; i < LATENCY_NUM_BUCKETS; i++) {
+    n += counts[i];
+    if (n >= target) return getBucketMax(i);
+  }
+  return getBucketMax(LATENCY_NUM_BUCKETS - 1);
+}
+
+void LatencyStats::reset() {
+  memset(this, 0, sizeof(*this));
+}
+
+bool LatencyStats::getHistogram(LatencyHistogram& dest, int stage, int route, int pri_class) const {
+  if (route != LATENCY_ROUTE_FLOOD && route != LATENCY_ROUTE_DIRECT) return false;
+
+  switch (stage) {
+    case LATENCY_STAGE_RX_DELAY: dest = rx_delay[route]; return true;
+    case LATENCY_STAGE_CAD_WAIT: dest = cad_wait[route]; return true;
+    case LATENCY_STAGE_AIRTIME:  dest = airtime[route]; return true;
+    case LATENCY_STAGE_QUEUE_WAIT:
+      if (pri_class >= LATENCY_NUM_PRI_CLASSES) return false;
+      if (pri_class >= 0) {
+        dest = queue_wait[route][pri_class];
+      } else {
+        dest.reset();
+        for (int p = 0; p < LATENCY_NUM_PRI_CLASSES; p++) {
+          for (int i = 0; i < LATENCY_NUM_BUCKETS; i++) {
+            uint32_t c = (uint32_t)dest.counts[i] + queue_wait[route][p].counts[i];
+            dest.counts[i] = c < 0xFFFF ? c : 0xFFFF;
+          }
+        }
+      }
+      return true;
+  }
+  return false;
+}
+
+static inline int latencyRoute(const Packet* pkt) {
+  return pkt->isRouteFlood() ? LATENCY_ROUTE_FLOOD : LATENCY_ROUTE_DIRECT;
+}
+
 void Dispatcher::begin() {
   n_sent_flood = n_sent_direct = 0;
   n_recv_flood = n_recv_direct = 0;
   _err_flags = 0;
+  latency.reset();
   radio_nonrx_start = _ms->getMillis();
 
   duty_cycle_window_ms = getDutyCycleWindowMs();
@@ -52,6 +120,11 @@ void Dispatcher::updateTxBudget() {
   }
 }
 
+unsigned long Dispatcher::getAvailableTxBudget() {
+  updateTxBudget();
+  return tx_budget_ms;
+}
+
 int Dispatcher::calcRxDelay(float score, uint32_t air_time) const {
   return (int) ((pow(10, 0.85f - score) - 1.0) * air_time);
 }
@@ -104,8 +177,11 @@ void Dispatcher::loop() {
         next_tx_time = _ms->getMillis();
       }
 
+      latency.airtime[latencyRoute(outbound)].add(t);
+
       _radio->onSendFinished();
-      logTx(outbound, 2 + outbound->getPathByteLen() + outbound->payload_len);
+      onPacketSent(outbound);
+      logTx(outbound, outbound_len);
       if (outbound->isRouteFlood()) {
         n_sent_flood++;
       } else {
@@ -117,7 +193,7 @@ void Dispatcher::loop() {
       MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): WARNING: outbound packed send timed out!", getLogDateTime());
 
       _radio->onSendFinished();
-      logTxFail(outbound, 2 + outbound->getPathByteLen() + outbound->payload_len);
+      logTxFail(outbound, outbound_len);
 
       releasePacket(outbound);  // return to pool
       outbound = NULL;
@@ -145,9 +221,34 @@ void Dispatcher::loop() {
   checkSend();
 }
 
+unsigned long Dispatcher::getNextWakeupMillis() const {
+  unsigned long now = _ms->getMillis();
+  if (_radio->needsPolling()) return now;
+
+  unsigned long next = next_floor_calib_time;
+  if (outbound) {
+    keepSooner(next, outbound_expiry);   // otherwise, send complete is signalled by radio IRQ
+    return next;
+  }
+  if (getAGCResetInterval() > 0) {
+    keepSooner(next, next_agc_reset_time);
+  }
+
+  uint32_t t;
+  if (_mgr->getNextInboundTime(now, t)) {
+    keepSooner(next, t);
+  }
+  if (_mgr->getNextOutboundTime(now, t)) {
+    if ((long)(next_tx_time - t) > 0) t = next_tx_time;   // can't send before next_tx_time (budget, CAD busy)
+    keepSooner(next, t);
+  }
+  return next;
+}
+
 bool Dispatcher::tryParsePacket(Packet* pkt, const uint8_t* raw, int len) {
   int i = 0;
 
+  pkt->invalidateHash();
   pkt->header = raw[i++];
   if (pkt->getPayloadVer() > PAYLOAD_VER_1) {
     MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): unsupported packet version", getLogDateTime());
@@ -188,34 +289,49 @@ bool Dispatcher::tryParsePacket(Packet* pkt, const uint8_t* raw, int len) {
 }
 
 void Dispatcher::checkRecv() {
-  Packet* pkt;
-  float score;
-  uint32_t air_time;
-  {
+  Packet* pkt = NULL;
+  int len = _radio->getRecvLength();
+  if (len == RECV_RAW_ONLY) {   // Radio needs an intermediate buffer
     uint8_t raw[MAX_TRANS_UNIT+1];
-    int len = _radio->recvRaw(raw, MAX_TRANS_UNIT);
+    len = _radio->recvRaw(raw, MAX_TRANS_UNIT);
     if (len > 0) {
       logRxRaw(_radio->getLastSNR(), _radio->getLastRSSI(), raw, len);
 
       pkt = _mgr->allocNew();
       if (pkt == NULL) {
         MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): WARNING: received data, no unused packets available!", getLogDateTime());
-      } else {
-        if (tryParsePacket(pkt, raw, len)) {
-          pkt->_snr = _radio->getLastSNR() * 4.0f;
-          score = _radio->packetScore(_radio->getLastSNR(), len);
-          air_time = _radio->getEstAirtimeFor(len);
-          rx_air_time += air_time;
-        } else {
-          _mgr->free(pkt);  // put back into pool
-          pkt = NULL;
-        }
+      } else if (!tryParsePacket(pkt, raw, len)) {
+        _mgr->free(pkt);  // put back into pool
+        pkt = NULL;
       }
+    }
+  } else if (len > 0) {   // Radio can receive straight into a Packet
+    pkt = _mgr->allocNew();
+    if (pkt == NULL) {
+      MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): WARNING: received data, no unused packets available!", getLogDateTime());
+      _radio->recvPacket(NULL);   // discard it
     } else {
-      pkt = NULL;
+      len = _radio->recvPacket(pkt);
+      if (len <= 0 || pkt->getPayloadVer() > PAYLOAD_VER_1) {
+        MESH_DEBUG_PRINTLN("%s Dispatcher::checkRecv(): unsupported or corrupt packet received", getLogDateTime());
+        _mgr->free(pkt);  // put back into pool
+        pkt = NULL;
+      } else if (wantsRxRaw()) {
+        uint8_t raw[MAX_TRANS_UNIT];
+        logRxRaw(_radio->getLastSNR(), _radio->getLastRSSI(), raw, pkt->writeTo(raw));
+      }
     }
   }
+
   if (pkt) {
+    pkt->_stamp = _ms->getMillis();
+    pkt->_snr = _radio->getLastSNR() * 4.0f;
+    float rssi = _radio->getLastRSSI();
+    pkt->_rssi = rssi < -128.0f ? -128 : (int8_t) rssi;
+    float score = _radio->packetScore(_radio->getLastSNR(), len);
+    uint32_t air_time = _radio->getEstAirtimeFor(len);
+    rx_air_time += air_time;
+
     #if MESH_PACKET_LOGGING
     Serial.print(getLogDateTime());
     Serial.printf(": RX, len=%d (type=%d, route=%s, payload_len=%d) SNR=%d RSSI=%d score=%d time=%d", 
@@ -258,6 +374,8 @@ void Dispatcher::checkRecv() {
 }
 
 void Dispatcher::processRecvPacket(Packet* pkt) {
+  latency.rx_delay[latencyRoute(pkt)].add(_ms->getMillis() - pkt->_stamp);
+
   DispatcherAction action = onRecvPacket(pkt);
   if (action == ACTION_RELEASE) {
     _mgr->free(pkt);
@@ -267,12 +385,14 @@ void Dispatcher::processRecvPacket(Packet* pkt) {
     uint8_t priority = (action >> 24) - 1;
     uint32_t _delay = action & 0xFFFFFF;
 
+    pkt->_stamp = _ms->getMillis();
+    pkt->_priority = priority;
     _mgr->queueOutbound(pkt, priority, futureMillis(_delay));
   }
 }
 
 void Dispatcher::checkSend() {
-  if (_mgr->getOutboundCount(_ms->getMillis()) == 0) return;
+  if (!_mgr->hasOutboundReady(_ms->getMillis())) return;
   
   updateTxBudget();
   
@@ -301,35 +421,31 @@ void Dispatcher::checkSend() {
       return;
     }
   }
+  unsigned long busy_start = cad_busy_start;
   cad_busy_start = 0;  // reset busy state
 
   outbound = _mgr->getNextOutbound(_ms->getMillis());
   if (outbound) {
-    int len = 0;
-    uint8_t raw[MAX_TRANS_UNIT];
-
-    raw[len++] = outbound->header;
-    if (outbound->hasTransportCodes()) {
-      memcpy(&raw[len], &outbound->transport_codes[0], 2); len += 2;
-      memcpy(&raw[len], &outbound->transport_codes[1], 2); len += 2;
-    }
-    raw[len++] = outbound->path_len;
-    len += Packet::writePath(&raw[len], outbound->path, outbound->path_len);
-
-    if (len + outbound->payload_len > MAX_TRANS_UNIT) {
-      MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): FATAL: Invalid packet queued... too long, len=%d", getLogDateTime(), len + outbound->payload_len);
+    int route = latencyRoute(outbound);
+    uint8_t pri_class = outbound->_priority < LATENCY_NUM_PRI_CLASSES ? outbound->_priority : LATENCY_NUM_PRI_CLASSES - 1;
+    latency.queue_wait[route][pri_class].add(_ms->getMillis() - outbound->_stamp);
+    latency.cad_wait[route].add(busy_start ? _ms->getMillis() - busy_start : 0);
+
+    int len = outbound->getRawLength();
+    if (len > MAX_TRANS_UNIT) {
+      MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): FATAL: Invalid packet queued... too long, len=%d", getLogDateTime(), len);
       _mgr->free(outbound);
       outbound = NULL;
     } else {
-      memcpy(&raw[len], outbound->payload, outbound->payload_len); len += outbound->payload_len;
+      outbound_len = len = outbound->writeTo(outbound_raw);   // shared with radio, logTx() and logTxFail()
 
       uint32_t max_airtime = _radio->getEstAirtimeFor(len)*3/2;
       outbound_start = _ms->getMillis();
-      bool success = _radio->startSendRaw(raw, len);
+      bool success = _radio->startSendRaw(outbound_raw, len);
       if (!success) {
         MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): ERROR: send start failed!", getLogDateTime());
 
-        logTxFail(outbound, outbound->getRawLength());
+        logTxFail(outbound, len);
   
         releasePacket(outbound);  // return to pool
         outbound = NULL;
@@ -358,7 +474,8 @@ Packet* Dispatcher::obtainNewPacket() {
     _err_flags |= ERR_EVENT_FULL;
   } else {
     pkt->payload_len = pkt->path_len = 0;
-    pkt->_snr = 0;
+    pkt->_snr = pkt->_rssi = 0;
+    pkt->invalidateHash();
   }
   return pkt;
 }
@@ -372,6 +489,8 @@ void Dispatcher::sendPacket(Packet* packet, uint8_t priority, uint32_t delay_mil
     MESH_DEBUG_PRINTLN("%s Dispatcher::sendPacket(): ERROR: invalid packet... path_len=%d, payload_len=%d", getLogDateTime(), (uint32_t) packet->path_len, (uint32_t) packet->payload_len);
     _mgr->free(packet);
   } else {
+    packet->_stamp = _ms->getMillis();
+    packet->_priority = priority;
     _mgr->queueOutbound(packet, priority, futureMillis(delay_millis));
   }
 }
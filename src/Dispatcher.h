@@ -16,6 +16,8 @@ public:
   virtual unsigned long getMillis() = 0;
 };
 
+#define RECV_RAW_ONLY   (-1)
+
 /**
  * \brief  Abstraction of this device's packet radio.
 */
@@ -31,6 +33,20 @@ public:
   */
   virtual int recvRaw(uint8_t* bytes, int sz) = 0;
 
+  /**
+   * \brief  polls for incoming packet, which can be read with recvPacket(), ie. straight into a Packet, without
+   *       an intermediate raw buffer. Radios which don't support this return RECV_RAW_ONLY, and recvRaw() is used.
+   * \returns 0 if no incoming data, RECV_RAW_ONLY, otherwise length of complete packet waiting.
+  */
+  virtual int getRecvLength() { return RECV_RAW_ONLY; }
+
+  /**
+   * \brief  reads the waiting packet (see getRecvLength()) directly into given Packet, parsing the header in place.
+   * \param  pkt  destination Packet, or NULL to just discard the waiting packet (eg. no unused packets)
+   * \returns 0 if packet could not be read or is malformed, otherwise the raw (wire format) length.
+  */
+  virtual int recvPacket(Packet* pkt) { return 0; }
+
   /**
    * \returns  estimated transmit air-time needed for packet of 'len_bytes', in milliseconds.
   */
@@ -74,6 +90,12 @@ public:
   */
   virtual bool isReceiving() { return false; }
 
+  /**
+   * \returns  true if loop() needs to keep being called, regardless of any deadlines (eg. while sampling noise floor,
+   *        or a received packet is waiting), ie. caller must not block waiting for the radio IRQ.
+  */
+  virtual bool needsPolling() { return false; }
+
   virtual float getLastRSSI() const { return 0; }
   virtual float getLastSNR() const { return 0; }
 };
@@ -90,12 +112,81 @@ public:
   virtual void queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for) = 0;
   virtual Packet* getNextOutbound(uint32_t now) = 0;    // by priority
   virtual int getOutboundCount(uint32_t now) const = 0;
+
+  /**
+   * \returns  true if any outbound packet is due by 'now'. (same as getOutboundCount(now) > 0, but impls can make it O(1))
+  */
+  virtual bool hasOutboundReady(uint32_t now) const { return getOutboundCount(now) > 0; }
   virtual int getOutboundTotal() const = 0;
   virtual int getFreeCount() const = 0;
   virtual Packet* getOutboundByIdx(int i) = 0;
   virtual Packet* removeOutboundByIdx(int i) = 0;
   virtual void queueInbound(Packet* packet, uint32_t scheduled_for) = 0;
   virtual Packet* getNextInbound(uint32_t now) = 0;
+
+  /**
+   * \brief  finds when the next outbound (or inbound) packet falls due. Default impls don't know, so assume 'now'.
+   * \param  scheduled_for  set to the earliest scheduled time (which may already be in the past)
+   * \returns  false if queue is empty.
+  */
+  virtual bool getNextOutboundTime(uint32_t now, uint32_t& scheduled_for) const {
+    scheduled_for = now;
+    return getOutboundTotal() > 0;
+  }
+  virtual bool getNextInboundTime(uint32_t now, uint32_t& scheduled_for) const {
+    scheduled_for = now;
+    return true;
+  }
+};
+
+#define LATENCY_NUM_BUCKETS      16   // log2 scale (millis): 0, 1, 2-3, 4-7, ... 16384+
+#define LATENCY_NUM_PRI_CLASSES   4   // priority 0, 1, 2, 3+
+
+#define LATENCY_STAGE_RX_DELAY    0   // received -> processed (ie. score delay)
+#define LATENCY_STAGE_QUEUE_WAIT  1   // queued -> taken from send queue (ie. tx delay, plus waiting for channel/budget)
+#define LATENCY_STAGE_CAD_WAIT    2   // channel busy back-off, before transmit
+#define LATENCY_STAGE_AIRTIME     3   // transmit start -> complete
+#define LATENCY_NUM_STAGES        4
+
+#define LATENCY_ROUTE_FLOOD       0
+#define LATENCY_ROUTE_DIRECT      1
+
+/**
+ * \brief  Fixed-bucket histogram of latencies, with log2 scale millis buckets. Counts saturate at 0xFFFF.
+*/
+struct LatencyHistogram {
+  uint16_t counts[LATENCY_NUM_BUCKETS];
+
+  void reset() { memset(counts, 0, sizeof(counts)); }
+  void add(uint32_t millis);
+  uint32_t getTotal() const;
+
+  /**
+   * \returns  upper bound (millis) of bucket which the 'pct' percentile falls in, or 0 if empty.
+  */
+  uint32_t getPercentile(int pct) const;
+
+  static int getBucketFor(uint32_t millis);
+  static uint32_t getBucketMax(int bucket) { return bucket == 0 ? 0 : (1UL << bucket) - 1; }
+};
+
+/**
+ * \brief  Per-stage latency histograms, by route type (LATENCY_ROUTE_*). Queue wait is also split by priority.
+*/
+struct LatencyStats {
+  LatencyHistogram rx_delay[2];
+  LatencyHistogram queue_wait[2][LATENCY_NUM_PRI_CLASSES];
+  LatencyHistogram cad_wait[2];
+  LatencyHistogram airtime[2];
+
+  void reset();
+
+  /**
+   * \brief  copies the histogram for given stage (LATENCY_STAGE_*) and route. For queue wait, 'pri_class' selects
+   *       one priority class, or if negative, the sum of all of them.
+   * \returns  false if stage/route/pri_class are invalid.
+  */
+  bool getHistogram(LatencyHistogram& dest, int stage, int route, int pri_class=-1) const;
 };
 
 typedef uint32_t  DispatcherAction;
@@ -115,6 +206,8 @@ typedef uint32_t  DispatcherAction;
 */
 class Dispatcher {
   Packet* outbound;  // current outbound packet
+  uint8_t outbound_raw[MAX_TRANS_UNIT];   // wire format of 'outbound', encoded once in checkSend()
+  int outbound_len;
   unsigned long outbound_expiry, outbound_start, total_air_time, rx_air_time;
   unsigned long next_tx_time;
   unsigned long cad_busy_start;
@@ -126,6 +219,7 @@ class Dispatcher {
   unsigned long tx_budget_ms;
   unsigned long last_budget_update;
   unsigned long duty_cycle_window_ms;
+  LatencyStats latency;
 
   void processRecvPacket(Packet* pkt);
   void updateTxBudget();
@@ -140,6 +234,7 @@ protected:
     : _radio(&radio), _ms(&ms), _mgr(&mgr)
   {
     outbound = NULL;
+    outbound_len = 0;
     total_air_time = rx_air_time = 0;
     next_tx_time = ms.getMillis();
     cad_busy_start = 0;
@@ -156,9 +251,27 @@ protected:
 
   virtual void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) { }   // custom hook
 
+  /**
+   * \returns  true, if logRxRaw() wants to be called. (only needed for Radios that receive straight into Packets,
+   *        where the raw bytes have to be re-encoded)
+   */
+  virtual bool wantsRxRaw() const { return false; }
+
+  /**
+   * \brief  called once the given packet has been transmitted (just before the logTx() hook)
+   */
+  virtual void onPacketSent(Packet* packet) { }
+
   virtual void logRx(Packet* packet, int len, float score) { }   // hooks for custom logging
   virtual void logTx(Packet* packet, int len) { }
   virtual void logTxFail(Packet* packet, int len) { }
+
+  /**
+   * \brief  the wire format of packet currently being transmitted, ie. valid inside the logTx() and logTxFail() hooks
+   *       (for their 'len' bytes), so it needn't be encoded again.
+   */
+  const uint8_t* getOutboundRaw() const { return outbound_raw; }
+
   virtual const char* getLogDateTime() { return ""; }
 
   virtual float getAirtimeBudgetFactor() const;
@@ -169,6 +282,10 @@ protected:
   virtual int getAGCResetInterval() const { return 0; }    // disabled by default
   virtual unsigned long getDutyCycleWindowMs() const { return 3600000; }
 
+  static void keepSooner(unsigned long& next, unsigned long timestamp) {
+    if ((long)(timestamp - next) < 0) next = timestamp;
+  }
+
 public:
   void begin();
   void loop();
@@ -180,19 +297,34 @@ public:
   unsigned long getTotalAirTime() const { return total_air_time; }
   unsigned long getReceiveAirTime() const {return rx_air_time; }
   unsigned long getRemainingTxBudget() const { return tx_budget_ms; }
+
+  /**
+   * \returns  TX budget (millis of airtime), refilled up to now. For sub-classes pacing their own sends.
+  */
+  unsigned long getAvailableTxBudget();
   uint32_t getNumSentFlood() const { return n_sent_flood; }
   uint32_t getNumSentDirect() const { return n_sent_direct; }
   uint32_t getNumRecvFlood() const { return n_recv_flood; }
   uint32_t getNumRecvDirect() const { return n_recv_direct; }
+  const LatencyStats& getLatencyStats() const { return latency; }
   void resetStats() {
     n_sent_flood = n_sent_direct = n_recv_flood = n_recv_direct = 0;
     _err_flags = 0;
+    latency.reset();
   }
 
   // helper methods
   bool millisHasNowPassed(unsigned long timestamp) const;
   unsigned long futureMillis(int millis_from_now) const;
 
+  /**
+   * \returns  the earliest millis at which loop() has something to do (queued packets, Tx back-off, noise floor
+   *        calibration, AGC reset, ...), or the current millis if it needs calling straight away. Apart from that,
+   *        loop() only needs calling when the radio IRQ fires, so main loops can sleep until then.
+   *        Sub-classes with their own timers should override, and fold theirs in with keepSooner().
+  */
+  virtual unsigned long getNextWakeupMillis() const;
+
   bool tryParsePacket(Packet* pkt, const uint8_t* raw, int len);
 
 private:
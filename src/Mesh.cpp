@@ -9,6 +9,8 @@ void Mesh::begin() {
 
 void Mesh::loop() {
   Dispatcher::loop();
+
+  if (_neighbours) _neighbours->checkTimeouts(_ms->getMillis());
 }
 
 bool Mesh::allowPacketForward(const mesh::Packet* packet) { 
@@ -25,6 +27,15 @@ uint32_t Mesh::getDirectRetransmitDelay(const Packet* packet) {
 uint8_t Mesh::getExtraAckTransmitCount() const {
   return 0;
 }
+uint8_t Mesh::getFloodSuppressThreshold() const {
+  return 0;  // by default, disabled
+}
+float Mesh::getFloodSuppressMinSNR() const {
+  return -100.0f;  // any
+}
+uint32_t Mesh::getAckBundleWindow() const {
+  return 0;  // by default, disabled
+}
 
 uint32_t Mesh::getCADFailRetryDelay() const {
   return _rng->nextInt(1, 4)*120;
@@ -38,7 +49,31 @@ int Mesh::searchChannelsByHash(const uint8_t* hash, GroupChannel channels[], int
   return 0;  // not found
 }
 
+void Mesh::learnNeighbourLinks(const Packet* pkt) {
+  if (pkt->isRouteFlood()) {
+    uint8_t n = pkt->getPathHashCount();
+    if (n > 0) {   // last hash in path is the neighbour which just relayed it
+      uint8_t sz = pkt->getPathHashSize();
+      _neighbours->onHeard(&pkt->path[(n - 1) * sz], sz, pkt->getSNR(), pkt->getRSSI());
+    }
+  } else if (pkt->getPayloadType() != PAYLOAD_TYPE_TRACE) {   // NOTE: TRACE path is SNRs, not hashes
+    _neighbours->onDirectHeard(pkt, _ms->getMillis());
+  }
+}
+
+void Mesh::onPacketSent(Packet* packet) {
+  if (_neighbours && packet->isRouteDirect() && packet->getPathHashCount() > 0) {
+    uint8_t type = packet->getPayloadType();
+    // next hop forwards these unchanged (ACKs can be merged/reworded, so aren't useful here)
+    if (type != PAYLOAD_TYPE_TRACE && type != PAYLOAD_TYPE_ACK && type != PAYLOAD_TYPE_MULTIPART) {
+      _neighbours->onDirectSent(packet, _ms->getMillis());
+    }
+  }
+}
+
 DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
+  if (_neighbours) learnNeighbourLinks(pkt);
+
   if (pkt->isRouteDirect() && pkt->getPayloadType() == PAYLOAD_TYPE_TRACE) {
     if (pkt->path_len < MAX_PATH_SIZE) {
       uint8_t i = 0;
@@ -58,6 +93,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
       } else if (self_id.isHashMatch(&pkt->payload[i + offset], 1 << path_sz) && allowPacketForward(pkt) && !_tables->hasSeen(pkt)) {
         // append SNR (Not hash!)
         pkt->path[pkt->path_len++] = (int8_t) (pkt->getSNR()*4);
+        pkt->invalidateHash();   // path_len is part of TRACE hash
 
         uint32_t d = getDirectRetransmitDelay(pkt);
         return ACTION_RETRANSMIT_DELAYED(5, d);  // schedule with priority 5 (for now), maybe make configurable?
@@ -106,7 +142,10 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
     return ACTION_RELEASE;   // this node is NOT the next hop (OR this packet has already been forwarded), so discard.
   }
 
-  if (pkt->isRouteFlood() && filterRecvFloodPacket(pkt)) return ACTION_RELEASE;
+  if (pkt->isRouteFlood()) {
+    checkQueuedRelay(pkt);
+    if (filterRecvFloodPacket(pkt)) return ACTION_RELEASE;
+  }
 
   DispatcherAction action = ACTION_RELEASE;
 
@@ -228,7 +267,7 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
         for (int j = 0; j < num; j++) {
           // decrypt, checking MAC is valid
           uint8_t data[MAX_PACKET_PAYLOAD];
-          int len = Utils::MACThenDecrypt(channels[j].secret, data, macAndData, pkt->payload_len - i);
+          int len = Utils::MACThenDecrypt(channels[j].secret, channels[j].mac_key, data, macAndData, pkt->payload_len - i);
           if (len > 0) {  // success!
             onGroupDataRecv(pkt, pkt->getPayloadType(), channels[j], data, len);
             break;
@@ -297,10 +336,12 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
           memcpy(tmp.payload, &pkt->payload[1], tmp.payload_len);
 
           if (!_tables->hasSeen(&tmp)) {
-            uint32_t ack_crc;
-            memcpy(&ack_crc, tmp.payload, 4);
+            for (int k = 0; k + 4 <= tmp.payload_len; k += 4) {   // can be a bundle of several ACKs
+              uint32_t ack_crc;
+              memcpy(&ack_crc, &tmp.payload[k], 4);
 
-            onAckRecv(&tmp, ack_crc);
+              onAckRecv(&tmp, ack_crc);
+            }
             //action = routeRecvPacket(&tmp);  // NOTE: currently not needed, as multipart ACKs not sent Flood
           }
         } else {
@@ -335,6 +376,7 @@ DispatcherAction Mesh::routeRecvPacket(Packet* packet) {
     self_id.copyHashTo(&packet->path[n * packet->getPathHashSize()], packet->getPathHashSize());
     packet->setPathHashCount(n + 1);
 
+    packet->_relay_dups = 0;
     uint32_t d = getRetransmitDelay(packet);
     // as this propagates outwards, give it lower and lower priority
     return ACTION_RETRANSMIT_DELAYED(packet->getPathHashCount(), d);   // give priority to closer sources, than ones further away
@@ -342,6 +384,95 @@ DispatcherAction Mesh::routeRecvPacket(Packet* packet) {
   return ACTION_RELEASE;
 }
 
+static bool getAckCRCs(const Packet* packet, uint8_t& remaining, int& offset) {
+  if (packet->getPayloadType() == PAYLOAD_TYPE_ACK && packet->payload_len == 4) {
+    remaining = 0;
+    offset = 0;
+    return true;
+  }
+  if (packet->getPayloadType() == PAYLOAD_TYPE_MULTIPART && packet->payload_len >= 5
+      && (packet->payload[0] & 0x0F) == PAYLOAD_TYPE_ACK && ((packet->payload_len - 1) % 4) == 0) {
+    remaining = packet->payload[0] >> 4;
+    offset = 1;
+    return true;
+  }
+  return false;
+}
+
+bool Mesh::bundleQueuedAck(Packet* ack) {
+  if (getAckBundleWindow() == 0 || !ack->isRouteDirect()) return false;
+
+  uint8_t remaining;
+  int offset;
+  if (!getAckCRCs(ack, remaining, offset)) return false;
+  int len = ack->payload_len - offset;
+
+  int n = _mgr->getOutboundTotal();
+  for (int i = 0; i < n; i++) {
+    Packet* queued = _mgr->getOutboundByIdx(i);
+    uint8_t q_remaining;
+    int q_offset;
+    if (!queued->isRouteDirect() || queued->path_len != ack->path_len
+      || memcmp(queued->path, ack->path, queued->getPathByteLen()) != 0) continue;   // must be same path
+    if (!getAckCRCs(queued, q_remaining, q_offset) || q_remaining != remaining) continue;
+    if (queued->payload_len - q_offset + len > MAX_ACK_BUNDLE*4) continue;   // full
+
+    if (q_offset == 0) {   // convert plain ACK to a multipart ACK
+      memmove(&queued->payload[1], queued->payload, 4);
+      queued->payload[0] = PAYLOAD_TYPE_ACK;   // remaining = 0
+      queued->payload_len = 5;
+      queued->header &= ~(PH_TYPE_MASK << PH_TYPE_SHIFT);
+      queued->header |= (PAYLOAD_TYPE_MULTIPART << PH_TYPE_SHIFT);
+    }
+    for (int k = 0; k < len; k += 4) {
+      bool dup = false;
+      for (int j = 1; j < queued->payload_len && !dup; j += 4) {
+        dup = memcmp(&queued->payload[j], &ack->payload[offset + k], 4) == 0;
+      }
+      if (!dup) {
+        memcpy(&queued->payload[queued->payload_len], &ack->payload[offset + k], 4);
+        queued->payload_len += 4;
+      }
+    }
+    queued->invalidateHash();
+
+    releasePacket(ack);
+    n_acks_bundled++;
+    return true;
+  }
+  return false;   // nothing to merge with, caller is to queue it
+}
+
+void Mesh::checkQueuedRelay(const Packet* packet) {
+  uint8_t threshold = getFloodSuppressThreshold();
+  if (threshold == 0 || packet->getSNR() < getFloodSuppressMinSNR()) return;
+
+  uint8_t hash[MAX_HASH_SIZE];
+  packet->calculatePacketHash(hash);
+
+  int n = _mgr->getOutboundTotal();
+  for (int i = 0; i < n; i++) {
+    Packet* queued = _mgr->getOutboundByIdx(i);
+    uint8_t count = queued->getPathHashCount();
+    if (!queued->isRouteFlood() || count == 0) continue;   // not a relay
+    uint8_t sz = queued->getPathHashSize();
+    if (!self_id.isHashMatch(&queued->path[(count - 1) * sz], sz)) continue;   // not relayed by us
+
+    uint8_t queued_hash[MAX_HASH_SIZE];
+    queued->calculatePacketHash(queued_hash);
+    if (memcmp(hash, queued_hash, MAX_HASH_SIZE) != 0) continue;
+
+    n_relay_dups++;
+    if (++queued->_relay_dups >= threshold) {   // enough neighbours have covered this area, cancel our retransmit
+      _mgr->removeOutboundByIdx(i);
+      releasePacket(queued);
+      n_relays_cancelled++;
+      MESH_DEBUG_PRINTLN("%s Mesh::checkQueuedRelay(): retransmit cancelled, after %d relays heard", getLogDateTime(), (int) threshold);
+    }
+    break;
+  }
+}
+
 DispatcherAction Mesh::forwardMultipartDirect(Packet* pkt) {
   uint8_t remaining = pkt->payload[0] >> 4;  // num of packets in this multipart sequence still to be sent
   uint8_t type = pkt->payload[0] & 0x0F;
@@ -371,17 +502,18 @@ void Mesh::routeDirectRecvAcks(Packet* packet, uint32_t delay_millis) {
         a1->path_len = Packet::copyPath(a1->path, packet->path, packet->path_len);
         a1->header &= ~PH_ROUTE_MASK;
         a1->header |= ROUTE_TYPE_DIRECT;
-        sendPacket(a1, 0, delay_millis);
+        if (!bundleQueuedAck(a1)) sendPacket(a1, 0, delay_millis + getAckBundleWindow());
       }
       extra--;
     }
 
-    auto a2 = createAck(packet->payload, packet->payload_len);
+    // a bundle of ACKs (from a multipart) must stay multipart
+    auto a2 = packet->payload_len > 4 ? createMultiAck(packet->payload, packet->payload_len, 0) : createAck(packet->payload, packet->payload_len);
     if (a2) {
       a2->path_len = Packet::copyPath(a2->path, packet->path, packet->path_len);
       a2->header &= ~PH_ROUTE_MASK;
       a2->header |= ROUTE_TYPE_DIRECT;
-      sendPacket(a2, 0, delay_millis);
+      if (!bundleQueuedAck(a2)) sendPacket(a2, 0, delay_millis + getAckBundleWindow());
     }
   }
 }
@@ -535,7 +667,7 @@ Packet* Mesh::createGroupDatagram(uint8_t type, const GroupChannel& channel, con
 
   int len = 0;
   memcpy(&packet->payload[len], channel.hash, PATH_HASH_SIZE); len += PATH_HASH_SIZE;
-  len += Utils::encryptThenMAC(channel.secret, &packet->payload[len], data, data_len);
+  len += Utils::encryptThenMAC(channel.secret, channel.mac_key, &packet->payload[len], data, data_len);
 
   packet->payload_len = len;
 
@@ -684,6 +816,7 @@ void Mesh::sendDirect(Packet* packet, const uint8_t* path, uint8_t path_len, uin
     // for TRACE packets, path is appended to end of PAYLOAD. (path is used for SNR's)
     memcpy(&packet->payload[packet->payload_len], path, path_len);  // NOTE: path_len here can be > 64, and NOT in the new scheme
     packet->payload_len += path_len;
+    packet->invalidateHash();
 
     packet->path_len = 0;
     pri = 5;   // maybe make this configurable
@@ -696,6 +829,13 @@ void Mesh::sendDirect(Packet* packet, const uint8_t* path, uint8_t path_len, uin
     }
   }
   _tables->hasSeen(packet); // mark this packet as already sent in case it is rebroadcast back to us
+  uint8_t remaining;
+  int offset;
+  if (getAckBundleWindow() > 0 && getAckCRCs(packet, remaining, offset)) {
+    if (bundleQueuedAck(packet)) return;   // merged into an ACK already queued for this path
+
+    if (delay_millis < getAckBundleWindow()) delay_millis = getAckBundleWindow();   // hold back, to collect others
+  }
   sendPacket(packet, pri, delay_millis);
 }
 
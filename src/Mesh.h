@@ -4,10 +4,15 @@
 
 namespace mesh {
 
+#ifndef MAX_ACK_BUNDLE
+  #define MAX_ACK_BUNDLE   8    // max ACK CRCs merged into one multipart ACK
+#endif
+
 class GroupChannel {
 public:
   uint8_t hash[PATH_HASH_SIZE];
   uint8_t secret[PUB_KEY_SIZE];
+  MACKey mac_key;   // NOTE: must be re-calculated, with Utils::calcMACKey(), whenever 'secret' changes
 };
 
 /**
@@ -17,6 +22,45 @@ class MeshTables {
 public:
   virtual bool hasSeen(const Packet* packet) = 0;
   virtual void clear(const Packet* packet) = 0;   // remove this packet hash from table
+
+  /**
+   * \brief  optional clock, for tables which age out their entries
+   */
+  virtual void setClock(MillisecondClock* ms) { }
+};
+
+/**
+ * \brief  An abstraction of link quality to neighbouring nodes. Mesh feeds it with what it learns from the
+ *     radio, ie. the SNR/RSSI of packets neighbours are heard transmitting, and whether they are heard forwarding
+ *     the Direct packets this node sends to them (an implicit ACK of that hop).
+*/
+class NeighbourTable {
+public:
+  /**
+   * \brief  a packet was heard being transmitted by the neighbour with the given hash (prefix of its pub_key)
+   */
+  virtual void onHeard(const uint8_t* hash, uint8_t hash_size, float snr, float rssi) = 0;
+
+  /**
+   * \brief  a Direct packet was transmitted to the next hop, ie. path[0]
+   */
+  virtual void onDirectSent(const Packet* packet, unsigned long now_millis) = 0;
+
+  /**
+   * \brief  any Direct packet was received (which may be a next hop forwarding one sent by this node)
+   */
+  virtual void onDirectHeard(const Packet* packet, unsigned long now_millis) = 0;
+
+  /**
+   * \brief  called regularly, to expire Direct packets which weren't heard forwarded in time
+   */
+  virtual void checkTimeouts(unsigned long now_millis) { }
+
+  /**
+   * \returns  expected number of transmissions (x100) for a packet to get through to the neighbour with given hash,
+   *       ie. 100 is a perfect link. Zero if not a known neighbour.
+   */
+  virtual uint16_t getETX(const uint8_t* hash, uint8_t hash_size) = 0;
 };
 
 /**
@@ -27,14 +71,21 @@ class Mesh : public Dispatcher {
   RTCClock* _rtc;
   RNG* _rng;
   MeshTables* _tables;
+  NeighbourTable* _neighbours;
+  uint32_t n_relay_dups, n_relays_cancelled;
+  uint32_t n_acks_bundled;
 
   void removeSelfFromPath(Packet* packet);
+  void learnNeighbourLinks(const Packet* packet);
+  void checkQueuedRelay(const Packet* packet);
+  bool bundleQueuedAck(Packet* ack);
   void routeDirectRecvAcks(Packet* packet, uint32_t delay_millis);
   //void routeRecvAcks(Packet* packet, uint32_t delay_millis);
   DispatcherAction forwardMultipartDirect(Packet* pkt);
 
 protected:
   DispatcherAction onRecvPacket(Packet* pkt) override;
+  void onPacketSent(Packet* packet) override;
 
   virtual uint32_t getCADFailRetryDelay() const override;
 
@@ -70,6 +121,24 @@ protected:
    */
   virtual uint8_t getExtraAckTransmitCount() const;
 
+  /**
+   * \returns  number of neighbours which need to be heard relaying a flood packet (that this node has queued
+   *       for retransmit) before the queued copy is cancelled. Zero means suppression is disabled.
+   */
+  virtual uint8_t getFloodSuppressThreshold() const;
+
+  /**
+   * \returns  minimum SNR of a relayed duplicate for it to count towards getFloodSuppressThreshold(), ie. only
+   *       near neighbours, whose coverage mostly overlaps ours.
+   */
+  virtual float getFloodSuppressMinSNR() const;
+
+  /**
+   * \returns  millis that Direct ACKs are held back for, so that other ACKs for the same path (queued in that time)
+   *       can be merged into one multipart ACK. Zero means ACKs are never merged.
+   */
+  virtual uint32_t getAckBundleWindow() const;
+
   /**
    * \brief  Perform search of local DB of peers/contacts.
    * \returns  Number of peers with matching hash
@@ -166,12 +235,21 @@ protected:
   virtual void onAckRecv(Packet* packet, uint32_t ack_crc) { }
 
   Mesh(Radio& radio, MillisecondClock& ms, RNG& rng, RTCClock& rtc, PacketManager& mgr, MeshTables& tables)
-    : Dispatcher(radio, ms, mgr), _rng(&rng), _rtc(&rtc), _tables(&tables)
+    : Dispatcher(radio, ms, mgr), _rng(&rng), _rtc(&rtc), _tables(&tables), _neighbours(NULL)
   {
+    tables.setClock(&ms);
+    n_relay_dups = n_relays_cancelled = 0;
+    n_acks_bundled = 0;
   }
 
   MeshTables* getTables() const { return _tables; }
 
+  /**
+   * \brief  optional table of neighbour link quality, for Mesh to keep updated
+   */
+  void setNeighbourTable(NeighbourTable* neighbours) { _neighbours = neighbours; }
+  NeighbourTable* getNeighbourTable() const { return _neighbours; }
+
 public:
   void begin();
   void loop();
@@ -181,6 +259,18 @@ public:
   RNG* getRNG() const { return _rng; }
   RTCClock* getRTCClock() const { return _rtc; }
 
+  uint32_t getNumRelayDups() const { return n_relay_dups; }    // relays heard of packets we had queued to retransmit
+  uint32_t getNumRelaysCancelled() const { return n_relays_cancelled; }
+  void resetRelayStats() { n_relay_dups = n_relays_cancelled = 0; }
+  uint32_t getNumAcksBundled() const { return n_acks_bundled; }   // ACKs merged into an already queued ACK
+
+  /**
+   * \returns  ETX (x100) of link to neighbour with given hash (eg. a path hash), or zero if unknown
+   */
+  uint16_t getNeighbourETX(const uint8_t* hash, uint8_t hash_size) const {
+    return _neighbours ? _neighbours->getETX(hash, hash_size) : 0;
+  }
+
   Packet* createAdvert(const LocalIdentity& id, const uint8_t* app_data=NULL, size_t app_data_len=0);
   Packet* createDatagram(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t len);
   Packet* createAnonDatagram(uint8_t type, const LocalIdentity& sender, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len);
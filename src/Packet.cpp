@@ -4,10 +4,18 @@
 
 namespace mesh {
 
+uint32_t Packet::_num_hash_calcs = 0;
+uint32_t Packet::_num_hash_lookups = 0;
+
 Packet::Packet() {
   header = 0;
   path_len = 0;
   payload_len = 0;
+  _snr = _rssi = 0;
+  _relay_dups = 0;
+  _stamp = 0;
+  _priority = 0;
+  _hash_valid = false;
 }
 
 bool Packet::isValidPathLen(uint8_t path_len) {
@@ -39,14 +47,20 @@ int Packet::getRawLength() const {
 }
 
 void Packet::calculatePacketHash(uint8_t* hash) const {
-  SHA256 sha;
-  uint8_t t = getPayloadType();
-  sha.update(&t, 1);
-  if (t == PAYLOAD_TYPE_TRACE) {
-    sha.update(&path_len, sizeof(path_len));   // CAVEAT: TRACE packets can revisit same node on return path
+  _num_hash_lookups++;
+  if (!_hash_valid) {
+    SHA256 sha;
+    uint8_t t = getPayloadType();
+    sha.update(&t, 1);
+    if (t == PAYLOAD_TYPE_TRACE) {
+      sha.update(&path_len, sizeof(path_len));   // CAVEAT: TRACE packets can revisit same node on return path
+    }
+    sha.update(payload, payload_len);
+    sha.finalize(_hash, MAX_HASH_SIZE);
+    _hash_valid = true;
+    _num_hash_calcs++;
   }
-  sha.update(payload, payload_len);
-  sha.finalize(hash, MAX_HASH_SIZE);
+  memcpy(hash, _hash, MAX_HASH_SIZE);
 }
 
 uint8_t Packet::writeTo(uint8_t dest[]) const {
@@ -63,6 +77,7 @@ uint8_t Packet::writeTo(uint8_t dest[]) const {
 }
 
 bool Packet::readFrom(const uint8_t src[], uint8_t len) {
+  invalidateHash();
   uint8_t i = 0;
   header = src[i++];
   if (hasTransportCodes()) {
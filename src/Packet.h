@@ -49,13 +49,27 @@ public:
   uint8_t path[MAX_PATH_SIZE];
   uint8_t payload[MAX_PACKET_PAYLOAD];
   int8_t _snr;
+  int8_t _rssi;          // dBm, of the radio transmission this was received in (clamped to -128)
+  uint8_t _relay_dups;   // while queued for flood retransmit: number of neighbours heard relaying it already
+  uint32_t _stamp;       // millis when received, or queued for send (for Dispatcher latency stats)
+  uint8_t _priority;     // while queued for send
 
   /**
-   * \brief calculate the hash of payload + type
+   * \brief calculate the hash of payload + type. (result is cached, until invalidateHash() is called)
    * \param  dest_hash   destination to store the hash (must be MAX_HASH_SIZE bytes)
    */
   void calculatePacketHash(uint8_t* dest_hash) const;
 
+  /**
+   * \brief  must be called if payload, type, or (for TRACE) path_len are changed after the hash may have been calculated.
+   *      NOTE: done already by readFrom(), Dispatcher::tryParsePacket() and Dispatcher::obtainNewPacket()
+   */
+  void invalidateHash() { _hash_valid = false; }
+
+  static uint32_t getNumHashCalcs() { return _num_hash_calcs; }     // number of actual SHA256 runs
+  static uint32_t getNumHashLookups() { return _num_hash_lookups; } // number of calculatePacketHash() calls
+  static void resetHashStats() { _num_hash_calcs = _num_hash_lookups = 0; }
+
   /**
    * \returns  one of ROUTE_ values
    */
@@ -86,10 +100,11 @@ public:
   static size_t writePath(uint8_t* dest, const uint8_t* src, uint8_t path_len);  // returns byte length written
   static bool isValidPathLen(uint8_t path_len);
 
-  void markDoNotRetransmit() { header = 0xFF; }
+  void markDoNotRetransmit() { header = 0xFF; invalidateHash(); }
   bool isMarkedDoNotRetransmit() const { return header == 0xFF; }
 
   float getSNR() const { return ((float)_snr) / 4.0f; }
+  float getRSSI() const { return (float)_rssi; }
 
   /**
    * \returns  the encoded/wire format length of this packet
@@ -109,6 +124,11 @@ public:
    * \param  len  the packet length (as returned by writeTo())
    */
   bool readFrom(const uint8_t src[], uint8_t len);
+
+private:
+  mutable uint8_t _hash[MAX_HASH_SIZE];
+  mutable bool _hash_valid;
+  static uint32_t _num_hash_calcs, _num_hash_lookups;
 };
 
 }
@@ -27,12 +27,39 @@ void Utils::sha256(uint8_t *hash, size_t hash_len, const uint8_t* frag1, int fra
   sha.finalize(hash, hash_len);
 }
 
-int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
+static struct {
+  uint8_t key[CIPHER_KEY_SIZE];
+  uint32_t last_used;   // zero = empty
   AES128 aes;
+} cipher_cache[CIPHER_CACHE_SIZE];
+static uint32_t cipher_cache_clock = 0;
+
+AES128& Utils::getCachedCipher(const uint8_t* shared_secret) {
+  int lru = 0;
+  for (int i = 0; i < CIPHER_CACHE_SIZE; i++) {
+    auto e = &cipher_cache[i];
+    if (e->last_used && memcmp(e->key, shared_secret, CIPHER_KEY_SIZE) == 0) {
+      e->last_used = ++cipher_cache_clock;
+      return e->aes;
+    }
+    if (e->last_used < cipher_cache[lru].last_used) lru = i;
+  }
+  // miss, so evict least recently used
+  auto e = &cipher_cache[lru];
+  memcpy(e->key, shared_secret, CIPHER_KEY_SIZE);
+  e->aes.setKey(shared_secret, CIPHER_KEY_SIZE);
+  e->last_used = ++cipher_cache_clock;
+  return e->aes;
+}
+
+int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
+  return decrypt(getCachedCipher(shared_secret), dest, src, src_len);
+}
+
+int Utils::decrypt(AES128& aes, uint8_t* dest, const uint8_t* src, int src_len) {
   uint8_t* dp = dest;
   const uint8_t* sp = src;
 
-  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
   while (sp - src < src_len) {
     aes.decryptBlock(dp, sp);
     dp += 16; sp += 16;
@@ -42,10 +69,12 @@ int Utils::decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* s
 }
 
 int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
-  AES128 aes;
+  return encrypt(getCachedCipher(shared_secret), dest, src, src_len);
+}
+
+int Utils::encrypt(AES128& aes, uint8_t* dest, const uint8_t* src, int src_len) {
   uint8_t* dp = dest;
 
-  aes.setKey(shared_secret, CIPHER_KEY_SIZE);
   while (src_len >= 16) {
     aes.encryptBlock(dp, src);
     dp += 16; src += 16; src_len -= 16;
@@ -60,13 +89,129 @@ int Utils::encrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* s
   return dp - dest;  // will always be multiple of 16
 }
 
+// SHA-256 compression function, for the HMAC midstates (the SHA256 class doesn't expose its chaining state)
+static const uint32_t sha256_k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t sha256_init[8] = {
+  0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+#define ROR32(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void sha256Block(uint32_t h[8], const uint8_t* block) {
+  uint32_t w[16];
+  for (int i = 0; i < 16; i++) {
+    w[i] = ((uint32_t)block[i*4] << 24) | ((uint32_t)block[i*4 + 1] << 16) | ((uint32_t)block[i*4 + 2] << 8) | block[i*4 + 3];
+  }
+  uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+  for (int i = 0; i < 64; i++) {
+    if (i >= 16) {   // message schedule, in a rolling window of 16 words
+      uint32_t w1 = w[(i - 15) & 15], w14 = w[(i - 2) & 15];
+      uint32_t s0 = ROR32(w1, 7) ^ ROR32(w1, 18) ^ (w1 >> 3);
+      uint32_t s1 = ROR32(w14, 17) ^ ROR32(w14, 19) ^ (w14 >> 10);
+      w[i & 15] += s0 + w[(i - 7) & 15] + s1;
+    }
+    uint32_t t1 = hh + (ROR32(e, 6) ^ ROR32(e, 11) ^ ROR32(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i & 15];
+    uint32_t t2 = (ROR32(a, 2) ^ ROR32(a, 13) ^ ROR32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    hh = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  h[0] += a; h[1] += b; h[2] += c; h[3] += d; h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+}
+
+// continues hash from 'state' (which has already consumed 'prior_len' bytes, a multiple of 64), over 'msg', then pads
+static void sha256Finish(uint8_t digest[32], const uint32_t state[8], uint32_t prior_len, const uint8_t* msg, int msg_len) {
+  uint32_t h[8];
+  memcpy(h, state, sizeof(h));
+  uint64_t bit_len = ((uint64_t)prior_len + msg_len) * 8;
+
+  while (msg_len >= 64) {
+    sha256Block(h, msg);
+    msg += 64; msg_len -= 64;
+  }
+  uint8_t block[64];
+  memcpy(block, msg, msg_len);
+  block[msg_len++] = 0x80;
+  if (msg_len > 56) {
+    memset(&block[msg_len], 0, 64 - msg_len);
+    sha256Block(h, block);
+    msg_len = 0;
+  }
+  memset(&block[msg_len], 0, 56 - msg_len);
+  for (int i = 0; i < 8; i++) {
+    block[56 + i] = (uint8_t)(bit_len >> (56 - i*8));
+  }
+  sha256Block(h, block);
+
+  for (int i = 0; i < 8; i++) {
+    digest[i*4] = h[i] >> 24; digest[i*4 + 1] = h[i] >> 16; digest[i*4 + 2] = h[i] >> 8; digest[i*4 + 3] = h[i];
+  }
+}
+
+void Utils::calcMACKey(MACKey& dest, const uint8_t* shared_secret) {
+  uint8_t block[64];
+  for (int i = 0; i < 64; i++) {
+    block[i] = (i < PUB_KEY_SIZE ? shared_secret[i] : 0) ^ 0x36;   // ipad
+  }
+  memcpy(dest.inner, sha256_init, sizeof(dest.inner));
+  sha256Block(dest.inner, block);
+
+  for (int i = 0; i < 64; i++) {
+    block[i] ^= 0x36 ^ 0x5C;   // opad
+  }
+  memcpy(dest.outer, sha256_init, sizeof(dest.outer));
+  sha256Block(dest.outer, block);
+}
+
+static struct {
+  uint8_t secret[PUB_KEY_SIZE];
+  uint32_t last_used;   // zero = empty
+  MACKey key;
+} mac_key_cache[MAC_KEY_CACHE_SIZE];
+static uint32_t mac_key_cache_clock = 0;
+
+const MACKey& Utils::getCachedMACKey(const uint8_t* shared_secret) {
+  int lru = 0;
+  for (int i = 0; i < MAC_KEY_CACHE_SIZE; i++) {
+    auto e = &mac_key_cache[i];
+    if (e->last_used && memcmp(e->secret, shared_secret, PUB_KEY_SIZE) == 0) {
+      e->last_used = ++mac_key_cache_clock;
+      return e->key;
+    }
+    if (e->last_used < mac_key_cache[lru].last_used) lru = i;
+  }
+  // miss, so evict least recently used
+  auto e = &mac_key_cache[lru];
+  memcpy(e->secret, shared_secret, PUB_KEY_SIZE);
+  calcMACKey(e->key, shared_secret);
+  e->last_used = ++mac_key_cache_clock;
+  return e->key;
+}
+
+void Utils::calcHMAC(uint8_t* mac, size_t mac_len, const MACKey& key, const uint8_t* msg, int msg_len) {
+  uint8_t digest[32];
+  sha256Finish(digest, key.inner, 64, msg, msg_len);
+  sha256Finish(digest, key.outer, 64, digest, sizeof(digest));
+  memcpy(mac, digest, mac_len > sizeof(digest) ? sizeof(digest) : mac_len);
+}
+
 int Utils::encryptThenMAC(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
+  return encryptThenMAC(shared_secret, getCachedMACKey(shared_secret), dest, src, src_len);
+}
+
+int Utils::encryptThenMAC(const uint8_t* shared_secret, const MACKey& mac_key, uint8_t* dest, const uint8_t* src, int src_len) {
   int enc_len = encrypt(shared_secret, dest + CIPHER_MAC_SIZE, src, src_len);
 
-  SHA256 sha;
-  sha.resetHMAC(shared_secret, PUB_KEY_SIZE);
-  sha.update(dest + CIPHER_MAC_SIZE, enc_len);
-  sha.finalizeHMAC(shared_secret, PUB_KEY_SIZE, dest, CIPHER_MAC_SIZE);
+  calcHMAC(dest, CIPHER_MAC_SIZE, mac_key, dest + CIPHER_MAC_SIZE, enc_len);
 
   return CIPHER_MAC_SIZE + enc_len;
 }
@@ -74,13 +219,14 @@ int Utils::encryptThenMAC(const uint8_t* shared_secret, uint8_t* dest, const uin
 int Utils::MACThenDecrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len) {
   if (src_len <= CIPHER_MAC_SIZE) return 0;  // invalid src bytes
 
+  return MACThenDecrypt(shared_secret, getCachedMACKey(shared_secret), dest, src, src_len);
+}
+
+int Utils::MACThenDecrypt(const uint8_t* shared_secret, const MACKey& mac_key, uint8_t* dest, const uint8_t* src, int src_len) {
+  if (src_len <= CIPHER_MAC_SIZE) return 0;  // invalid src bytes
+
   uint8_t hmac[CIPHER_MAC_SIZE];
-  {
-    SHA256 sha;
-    sha.resetHMAC(shared_secret, PUB_KEY_SIZE);
-    sha.update(src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
-    sha.finalizeHMAC(shared_secret, PUB_KEY_SIZE, hmac, CIPHER_MAC_SIZE);
-  }
+  calcHMAC(hmac, CIPHER_MAC_SIZE, mac_key, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
   if (memcmp(hmac, src, CIPHER_MAC_SIZE) == 0) {
     return decrypt(shared_secret, dest, src + CIPHER_MAC_SIZE, src_len - CIPHER_MAC_SIZE);
   }
@@ -4,6 +4,16 @@
 #include <Stream.h>
 #include <string.h>
 
+#ifndef CIPHER_CACHE_SIZE
+  #define CIPHER_CACHE_SIZE   8     // num of expanded AES key schedules kept (most recently used)
+#endif
+
+#ifndef MAC_KEY_CACHE_SIZE
+  #define MAC_KEY_CACHE_SIZE  8     // num of peer MAC keys kept (most recently used)
+#endif
+
+class AES128;
+
 namespace mesh {
 
 class RNG {
@@ -16,6 +26,15 @@ public:
   uint32_t nextInt(uint32_t _min, uint32_t _max);
 };
 
+/**
+ * \brief  An HMAC-SHA256 key, with the SHA-256 states after the inner (ipad) and outer (opad) key blocks
+ *       already calculated. Saves two of the four compression rounds, for each (short) MAC.
+*/
+struct MACKey {
+  uint32_t inner[8];
+  uint32_t outer[8];
+};
+
 class Utils {
 public:
   /**
@@ -42,18 +61,64 @@ public:
   */
   static int decrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len);
 
+  /**
+   * \brief  same as encrypt() above, but with a prepared cipher (ie. key already set)
+  */
+  static int encrypt(AES128& cipher, uint8_t* dest, const uint8_t* src, int src_len);
+
+  /**
+   * \brief  same as decrypt() above, but with a prepared cipher (ie. key already set)
+  */
+  static int decrypt(AES128& cipher, uint8_t* dest, const uint8_t* src, int src_len);
+
+  /**
+   * \brief  looks up the cipher for 'shared_secret' in a small LRU cache of expanded key schedules,
+   *        only expanding the key on a cache miss.
+   * \returns  the prepared cipher. NOTE: only valid until the next call.
+  */
+  static AES128& getCachedCipher(const uint8_t* shared_secret);
+
   /**
    * \brief  encrypts bytes in src, then calculates MAC on ciphertext, inserting into leading bytes of 'dest'.
+   *        The MAC key is from getCachedMACKey().
    * \returns  total length of bytes in 'dest' (MAC + ciphertext)
   */
   static int encryptThenMAC(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len);
 
   /**
    * \brief  checks the MAC (in leading bytes of 'src'), then if valid, decrypts remaining bytes in src.
+   *        The MAC key is from getCachedMACKey().
    * \returns  zero if MAC is invalid, otherwise the length of decrypted bytes in 'dest'
   */
   static int MACThenDecrypt(const uint8_t* shared_secret, uint8_t* dest, const uint8_t* src, int src_len);
 
+  /**
+   * \brief  pre-calculates the HMAC key for 'shared_secret' (of PUB_KEY_SIZE bytes), for the variants below.
+  */
+  static void calcMACKey(MACKey& dest, const uint8_t* shared_secret);
+
+  /**
+   * \brief  looks up the MAC key for 'shared_secret' (of PUB_KEY_SIZE bytes) in a small LRU cache,
+   *        only calculating it on a cache miss.
+   * \returns  the MAC key. NOTE: only valid until the next call.
+  */
+  static const MACKey& getCachedMACKey(const uint8_t* shared_secret);
+
+  /**
+   * \brief  calculates HMAC-SHA256 of 'msg', using the pre-calculated 'key', truncating to 'mac_len' bytes.
+  */
+  static void calcHMAC(uint8_t* mac, size_t mac_len, const MACKey& key, const uint8_t* msg, int msg_len);
+
+  /**
+   * \brief  same as encryptThenMAC() above, but with the MAC key already calculated from 'shared_secret'
+  */
+  static int encryptThenMAC(const uint8_t* shared_secret, const MACKey& mac_key, uint8_t* dest, const uint8_t* src, int src_len);
+
+  /**
+   * \brief  same as MACThenDecrypt() above, but with the MAC key already calculated from 'shared_secret'
+  */
+  static int MACThenDecrypt(const uint8_t* shared_secret, const MACKey& mac_key, uint8_t* dest, const uint8_t* src, int src_len);
+
   /**
    * \brief  converts 'src' bytes with given length to Hex representation, and null terminates.
   */
@@ -37,6 +37,16 @@ public:
    */
   virtual void sendPacket(mesh::Packet* packet) = 0;
 
+  /**
+   * @brief As sendPacket(), but with the packet already serialized in wire format (eg. by the Dispatcher,
+   *        for the packet just transmitted), so the bridge needn't encode it again.
+   *
+   * @param packet The packet that was transmitted.
+   * @param raw The packet in wire format (as per Packet::writeTo()).
+   * @param len The length of raw, in bytes.
+   */
+  virtual void sendEncodedPacket(mesh::Packet* packet, const uint8_t* raw, int len) { sendPacket(packet); }
+
   /**
    * @brief Processes a received packet from the bridge's medium.
    *
@@ -67,8 +67,32 @@ void BaseChatMesh::bootstrapRTCfromContacts() {
   }
 }
 
+void BaseChatMesh::begin() {
+#if defined(ESP32) && defined(CONTACTS_IN_PSRAM)
+  if (contacts == NULL) {
+    contacts = (ContactInfo *) ps_calloc(MAX_CONTACTS+MAX_ANON_CONTACTS, sizeof(ContactInfo));
+    if (contacts == NULL) {
+      MESH_DEBUG_PRINTLN("BaseChatMesh::begin(): no PSRAM, contacts table in internal RAM");
+      contacts = new ContactInfo[MAX_CONTACTS+MAX_ANON_CONTACTS];
+    }
+  }
+#endif
+  mesh::Mesh::begin();
+}
+
+void BaseChatMesh::updateContactIndex() {
+  if (!contact_index_dirty) return;
+
+  contact_index.clear();
+  for (int i = num_contacts - 1; i >= 0; i--) {   // in reverse, so each bucket chain is in ascending order
+    contact_index.add(i, contacts[i].id.pub_key[0]);
+  }
+  contact_index_dirty = false;
+}
+
 ContactInfo* BaseChatMesh::allocateContactSlot(bool transient_only) {
   if (num_contacts < MAX_CONTACTS) {
+    contact_index_dirty = true;   // caller is about to fill in the id
     return &contacts[num_contacts++];
   } else if (transient_only || shouldOverwriteWhenFull()) {
     // Find oldest non-favourite contact by oldest lastmod timestamp
@@ -90,6 +114,7 @@ ContactInfo* BaseChatMesh::allocateContactSlot(bool transient_only) {
     }
     if (oldest_idx >= 0) {
       onContactOverwrite(contacts[oldest_idx].id.pub_key);
+      contact_index_dirty = true;
       return &contacts[oldest_idx];
     }
   }
@@ -117,16 +142,10 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
     return;
   }
 
-  ContactInfo* from = NULL;
-  for (int i = 0; i < num_contacts; i++) {
-    if (id.matches(contacts[i].id)) {  // is from one of our contacts
-      from = &contacts[i];
-      if (timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
-        MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
-        return;
-      }
-      break;
-    }
+  ContactInfo* from = lookupContactByPubKey(id.pub_key, PUB_KEY_SIZE);
+  if (from && timestamp <= from->last_advert_timestamp) {  // check for replay attacks!!
+    MESH_DEBUG_PRINTLN("onAdvertRecv: Possible replay attack, name: %s", from->name);
+    return;
   }
 
   // save a copy of raw advert packet (to support "Share..." function)
@@ -187,8 +206,9 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
 }
 
 int BaseChatMesh::searchPeersByHash(const uint8_t* hash) {
+  updateContactIndex();
   int n = 0;
-  for (int i = 0; i < num_contacts && n < MAX_SEARCH_RESULTS; i++) {
+  for (int i = contact_index.first(hash[0]); i >= 0 && n < MAX_SEARCH_RESULTS; i = contact_index.next(i)) {
     if (contacts[i].id.isHashMatch(hash)) {
       matching_peer_indexes[n++] = i;  // store the INDEXES of matching contacts (for subsequent 'peer' methods)
     }
@@ -792,22 +812,23 @@ void BaseChatMesh::resetPathTo(ContactInfo& recipient) {
   recipient.out_path_len = OUT_PATH_UNKNOWN;
 }
 
-static ContactInfo* table;  // pass via global :-(
-
-static int cmp_adv_timestamp(const void *a, const void *b) {
-  int a_idx = *((int *)a);
-  int b_idx = *((int *)b);
-  if (table[b_idx].last_advert_timestamp > table[a_idx].last_advert_timestamp) return 1;
-  if (table[b_idx].last_advert_timestamp < table[a_idx].last_advert_timestamp) return -1;
-  return 0;
-}
-
 void BaseChatMesh::scanRecentContacts(int last_n, ContactVisitor* visitor) {
-  for (int i = 0; i < num_contacts; i++) {  // sort the INDEXES into contacts[]
-    sort_array[i] = i;
+  while (num_sorted < num_contacts) {   // append any new contacts
+    sort_array[num_sorted] = num_sorted;
+    num_sorted++;
+  }
+  // insertion sort, as the order from last time is mostly still valid (only contacts with a new
+  // advert since have to move), so is close to O(n), vs a full qsort() on every call
+  for (int i = 1; i < num_contacts; i++) {
+    int idx = sort_array[i];
+    uint32_t timestamp = contacts[idx].last_advert_timestamp;
+    int j = i;
+    while (j > 0 && contacts[sort_array[j - 1]].last_advert_timestamp < timestamp) {
+      sort_array[j] = sort_array[j - 1];
+      j--;
+    }
+    sort_array[j] = idx;
   }
-  table = contacts; // pass via global *sigh* :-(
-  qsort(sort_array, num_contacts, sizeof(sort_array[0]), cmp_adv_timestamp);
 
   if (last_n == 0) {
     last_n = num_contacts;   // scan ALL
@@ -829,6 +850,14 @@ ContactInfo* BaseChatMesh::searchContactsByPrefix(const char* name_prefix) {
 }
 
 ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int prefix_len) {
+  if (prefix_len > 0) {
+    updateContactIndex();
+    for (int i = contact_index.first(pub_key[0]); i >= 0; i = contact_index.next(i)) {
+      auto c = &contacts[i];
+      if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) return c;
+    }
+    return NULL;  // not found
+  }
   for (int i = 0; i < num_contacts; i++) {
     auto c = &contacts[i];
     if (memcmp(c->id.pub_key, pub_key, prefix_len) == 0) return c;
@@ -847,18 +876,18 @@ bool BaseChatMesh::addContact(const ContactInfo& contact) {
 }
 
 bool BaseChatMesh::removeContact(ContactInfo& contact) {
-  int idx = 0;
-  while (idx < num_contacts && !contacts[idx].id.matches(contact.id)) {
-    idx++;
-  }
-  if (idx >= num_contacts) return false;   // not found
+  ContactInfo* c = lookupContactByPubKey(contact.id.pub_key, PUB_KEY_SIZE);
+  if (c == NULL) return false;   // not found
 
   // remove from contacts array
+  int idx = c - contacts;
   num_contacts--;
   while (idx < num_contacts) {
     contacts[idx] = contacts[idx + 1];
     idx++;
   }
+  contact_index_dirty = true;   // indexes have shifted
+  num_sorted = 0;
   return true;  // Success
 }
 
@@ -873,6 +902,7 @@ ChannelDetails* BaseChatMesh::addChannel(const char* name, const char* psk_base6
     int len = decode_base64((unsigned char *) psk_base64, strlen(psk_base64), dest->channel.secret);
     if (len == 32 || len == 16) {
       mesh::Utils::sha256(dest->channel.hash, sizeof(dest->channel.hash), dest->channel.secret, len);
+      mesh::Utils::calcMACKey(dest->channel.mac_key, dest->channel.secret);
       StrHelper::strncpy(dest->name, name, sizeof(dest->name));
       num_channels++;
       return dest;
@@ -897,6 +927,7 @@ bool BaseChatMesh::setChannel(int idx, const ChannelDetails& src) {
     } else {
       mesh::Utils::sha256(channels[idx].channel.hash, sizeof(channels[idx].channel.hash), src.channel.secret, 32);  // 256-bit key
     }
+    mesh::Utils::calcMACKey(channels[idx].channel.mac_key, src.channel.secret);
     return true;
   }
   return false;
@@ -955,3 +986,11 @@ void BaseChatMesh::loop() {
     _pendingLoopback = NULL;
   }
 }
+
+unsigned long BaseChatMesh::getNextWakeupMillis() const {
+  if (_pendingLoopback) return _ms->getMillis();
+
+  unsigned long next = Mesh::getNextWakeupMillis();
+  if (txt_send_timeout) keepSooner(next, txt_send_timeout);
+  return next;
+}
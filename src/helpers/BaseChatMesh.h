@@ -8,6 +8,7 @@
 #define MAX_TEXT_LEN    (10*CIPHER_BLOCK_SIZE)  // must be LESS than (MAX_PACKET_PAYLOAD - 4 - CIPHER_MAC_SIZE - 1)
 
 #include "ContactInfo.h"
+#include "ContactIndex.h"
 
 #define MAX_SEARCH_RESULTS   8
 
@@ -60,9 +61,16 @@ class BaseChatMesh : public mesh::Mesh {
 
   friend class ContactsIterator;
 
+#if defined(ESP32) && defined(CONTACTS_IN_PSRAM)
+  ContactInfo* contacts;   // allocated in begin(), from PSRAM if available
+#else
   ContactInfo contacts[MAX_CONTACTS+MAX_ANON_CONTACTS];
+#endif
   int num_contacts;
-  int sort_array[MAX_CONTACTS+MAX_ANON_CONTACTS];
+  int sort_array[MAX_CONTACTS+MAX_ANON_CONTACTS];   // INDEXES into contacts[], most recent advert first
+  int num_sorted;    // num of contacts[] in sort_array[]
+  ContactIndex contact_index;
+  bool contact_index_dirty;
   int matching_peer_indexes[MAX_SEARCH_RESULTS];
   unsigned long txt_send_timeout;
 #ifdef MAX_GROUP_CHANNELS
@@ -75,12 +83,18 @@ class BaseChatMesh : public mesh::Mesh {
 
   mesh::Packet* composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack);
   void sendAckTo(const ContactInfo& dest, const uint8_t* ack_hash, uint8_t ack_len=4);
+  void updateContactIndex();
 
 protected:
   BaseChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
-      : mesh::Mesh(radio, ms, rng, rtc, mgr, tables)
+      : mesh::Mesh(radio, ms, rng, rtc, mgr, tables), contact_index(MAX_CONTACTS+MAX_ANON_CONTACTS)
   { 
+  #if defined(ESP32) && defined(CONTACTS_IN_PSRAM)
+    contacts = NULL;
+  #endif
     num_contacts = 0;
+    num_sorted = 0;
+    contact_index_dirty = true;
   #ifdef MAX_GROUP_CHANNELS
     memset(channels, 0, sizeof(channels));
     num_channels = 0;
@@ -91,7 +105,7 @@ protected:
   }
 
   void bootstrapRTCfromContacts();
-  void resetContacts() { num_contacts = 0; }
+  void resetContacts() { num_contacts = num_sorted = 0; contact_index_dirty = true; }
   void populateContactFromAdvert(ContactInfo& ci, const mesh::Identity& id, const AdvertDataParser& parser, uint32_t timestamp);
   ContactInfo* allocateContactSlot(bool transient_only=false); // helper to find slot for new contact
 
@@ -147,6 +161,7 @@ protected:
   void checkConnections();
 
 public:
+  void begin();
   mesh::Packet* createSelfAdvert(const char* name);
   mesh::Packet* createSelfAdvert(const char* name, double lat, double lon);
   int  sendMessage(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char* text, uint32_t& expected_ack, uint32_t& est_timeout);
@@ -175,4 +190,5 @@ public:
   int findChannelIdx(const mesh::GroupChannel& ch);
 
   void loop();
+  unsigned long getNextWakeupMillis() const override;
 };
@@ -1,9 +1,23 @@
 #pragma once
 
-#include <Arduino.h>
+#ifdef ARDUINO
+  #include <Arduino.h>
+#else
+  #include <stdint.h>
+  #include <stddef.h>
+#endif
 
 #define MAX_FRAME_SIZE  176   // +4 for transport codes (region scoping)
 
+struct SerialLinkStats {
+  uint32_t frames_sent, frames_recv;
+  uint32_t bytes_sent, bytes_recv;
+  uint32_t writes;          // eg. BLE notifications. Less than frames_sent when batching
+  uint32_t write_retries;
+  uint16_t mtu;             // max bytes per write, 0 if n/a
+  uint16_t interval_millis; // connection interval, 0 if n/a
+};
+
 class BaseSerialInterface {
 protected:
   BaseSerialInterface() { }
@@ -18,4 +32,16 @@ public:
   virtual bool isWriteBusy() const = 0;
   virtual size_t writeFrame(const uint8_t src[], size_t len) = 0;
   virtual size_t checkRecvFrame(uint8_t dest[]) = 0;
+
+  /**
+   * \brief  frame batching: each write carries one or more frames, each prefixed with a length byte, up to the link MTU.
+   *       Frames already queued are still sent one per write. Reverts to one frame per write on next connection.
+  */
+  virtual bool supportsFrameBatching() const { return false; }
+  virtual void setFrameBatching(bool enable) { }
+
+  /**
+   * \returns  false if not supported. Counters are reset on each new connection.
+  */
+  virtual bool getLinkStats(SerialLinkStats& stats) const { return false; }
 };
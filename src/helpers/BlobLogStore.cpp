@@ -0,0 +1,368 @@
+#include "BlobLogStore.h"
+
+#if defined(ESP32) || defined(RP2040_PLATFORM)
+
+#include <MeshCore.h>
+
+#define REC_SIZE(len)   (sizeof(BlobRecHeader) + (len))
+
+static uint16_t recordCheck(const BlobRecHeader& hdr, const uint8_t* data) {
+  uint16_t a = 0, b = 0;
+  const uint8_t* hp = (const uint8_t *) &hdr;
+  for (int i = 0; i < BLOB_KEY_SIZE + 2; i++) {   // key, type, len
+    a = (a + hp[i]) % 255;
+    b = (b + a) % 255;
+  }
+  for (int i = 0; i < hdr.len; i++) {
+    a = (a + data[i]) % 255;
+    b = (b + a) % 255;
+  }
+  return (b << 8) | a;
+}
+
+static void makeKey(uint8_t dest[], const uint8_t key[], int key_len) {
+  memset(dest, 0, BLOB_KEY_SIZE);
+  memcpy(dest, key, key_len < BLOB_KEY_SIZE ? key_len : BLOB_KEY_SIZE);  // just use first 8 bytes (prefix)
+}
+
+BlobLogStore::BlobLogStore(const char* filename, const char* tmp_filename, int max_keys)
+    : _fs(NULL), _filename(filename), _tmp_filename(tmp_filename), _max_keys(max_keys)
+{
+  _index = new IndexEntry[max_keys];
+  clearIndex();
+  _log_size = _dead_bytes = 0;
+  _buf_len = 0;
+  _first_buffered = 0;
+  _error_at = _retry_millis = 0;
+  _compacting = false;
+  _compact_idx = -1;
+}
+
+File BlobLogStore::openRead(const char* filename) {
+#if defined(RP2040_PLATFORM)
+  return _fs->open(filename, "r");
+#else
+  return _fs->open(filename, "r", false);
+#endif
+}
+
+File BlobLogStore::openAppend(const char* filename) {
+#if defined(RP2040_PLATFORM)
+  return _fs->open(filename, "a");
+#else
+  return _fs->open(filename, "a", true);
+#endif
+}
+
+void BlobLogStore::clearIndex() {
+  for (int i = 0; i < BLOB_INDEX_BUCKETS; i++) {
+    _buckets[i] = -1;
+  }
+  for (int i = 0; i < _max_keys; i++) {
+    _index[i].bucket_next = i + 1 < _max_keys ? i + 1 : -1;
+  }
+  _free_head = _max_keys > 0 ? 0 : -1;
+  _lru_head = _lru_tail = -1;
+  _num_keys = 0;
+}
+
+int BlobLogStore::findKey(const uint8_t key[]) const {
+  for (int i = _buckets[key[0]]; i >= 0; i = _index[i].bucket_next) {
+    if (memcmp(_index[i].key, key, BLOB_KEY_SIZE) == 0) return i;
+  }
+  return -1;  // not found
+}
+
+void BlobLogStore::addKey(const BlobRecHeader& hdr, uint32_t offset) {
+  int i = _free_head;
+  IndexEntry* e = &_index[i];
+  _free_head = e->bucket_next;
+
+  memcpy(e->key, hdr.key, BLOB_KEY_SIZE);
+  e->offset = offset;
+  e->len = hdr.len;
+  e->bucket_next = _buckets[hdr.key[0]];
+  _buckets[hdr.key[0]] = i;
+
+  e->lru_prev = _lru_tail;   // most recently put
+  e->lru_next = -1;
+  if (_lru_tail >= 0) {
+    _index[_lru_tail].lru_next = i;
+  } else {
+    _lru_head = i;
+  }
+  _lru_tail = i;
+  _num_keys++;
+}
+
+void BlobLogStore::removeKeyAt(int i) {
+  IndexEntry* e = &_index[i];
+  int16_t* pp = &_buckets[e->key[0]];
+  while (*pp != i) pp = &_index[*pp].bucket_next;
+  *pp = e->bucket_next;
+
+  if (_compacting && _compact_idx == i) _compact_idx = e->lru_next;
+  if (e->lru_prev >= 0) {
+    _index[e->lru_prev].lru_next = e->lru_next;
+  } else {
+    _lru_head = e->lru_next;
+  }
+  if (e->lru_next >= 0) {
+    _index[e->lru_next].lru_prev = e->lru_prev;
+  } else {
+    _lru_tail = e->lru_prev;
+  }
+
+  e->bucket_next = _free_head;
+  _free_head = i;
+  _num_keys--;
+}
+
+void BlobLogStore::onWriteError() {
+  _error_at = millis();
+  if (_retry_millis == 0) {
+    _retry_millis = BLOB_STORE_FLUSH_MILLIS;
+  } else if (_retry_millis < BLOB_STORE_RETRY_MAX_MILLIS / 2) {
+    _retry_millis *= 2;
+  } else {
+    _retry_millis = BLOB_STORE_RETRY_MAX_MILLIS;
+  }
+}
+
+bool BlobLogStore::applyRecord(const BlobRecHeader& hdr, uint32_t offset) {
+  int i = findKey(hdr.key);
+  if (i >= 0) {
+    _dead_bytes += REC_SIZE(_index[i].len);   // superseded
+  }
+  if (hdr.type == BLOB_REC_DEL) {
+    _dead_bytes += REC_SIZE(0);   // tombstone only needed until next compaction
+    if (i >= 0) removeKeyAt(i);
+    return true;
+  }
+
+  if (i >= 0) {
+    removeKeyAt(i);   // re-added at end, ie. most recently put
+  } else if (_num_keys >= _max_keys) {
+    _dead_bytes += REC_SIZE(hdr.len);
+    return false;  // index full
+  }
+  addKey(hdr, offset);
+  return true;
+}
+
+bool BlobLogStore::appendRecord(const uint8_t key[], uint8_t type, const uint8_t* data, int len) {
+  BlobRecHeader hdr;
+  memcpy(hdr.key, key, BLOB_KEY_SIZE);
+  hdr.type = type;
+  hdr.len = len;
+  hdr.check = recordCheck(hdr, data);
+
+  int n = REC_SIZE(len);
+  if (_buf_len + n > (int) sizeof(_buf)) {
+    if (isBackingOff(millis())) return false;   // last write failed, don't retry on every put()
+    flush();
+    if (_buf_len + n > (int) sizeof(_buf)) return false;   // flush failed
+  }
+  uint32_t offset = _log_size + _buf_len;
+  memcpy(&_buf[_buf_len], &hdr, sizeof(hdr));
+  if (len > 0) memcpy(&_buf[_buf_len + sizeof(hdr)], data, len);
+  if (_buf_len == 0) _first_buffered = millis();
+  _buf_len += n;
+
+  return applyRecord(hdr, offset);
+}
+
+bool BlobLogStore::loadIndex() {
+  clearIndex();
+  _log_size = _dead_bytes = 0;
+
+  File file = openRead(_filename);
+  if (!file) return true;   // no log yet
+
+  uint32_t file_size = file.size();
+  BlobRecHeader hdr;
+  uint8_t data[BLOB_MAX_LEN];
+  while (file.read((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr)) {
+    if (hdr.type != BLOB_REC_PUT && hdr.type != BLOB_REC_DEL) break;
+    if (file.read(data, hdr.len) != hdr.len || recordCheck(hdr, data) != hdr.check) break;
+
+    applyRecord(hdr, _log_size);
+    _log_size += REC_SIZE(hdr.len);
+  }
+  file.close();
+
+  return _log_size == file_size;   // false = torn record at end
+}
+
+void BlobLogStore::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  _buf_len = 0;
+  _compacting = false;
+
+  if (_fs->exists(_tmp_filename)) {
+    if (_fs->exists(_filename)) {
+      _fs->remove(_tmp_filename);   // compaction didn't complete, old log is still good
+    } else {
+      _fs->rename(_tmp_filename, _filename);   // interrupted just before rename
+    }
+  }
+  if (!loadIndex()) {
+    MESH_DEBUG_PRINTLN("BlobLogStore: torn record at %d, rewriting log", (int) _log_size);
+    startCompaction();
+    finishCompaction();
+  }
+  MESH_DEBUG_PRINTLN("BlobLogStore: %d keys, %d bytes (%d dead)", _num_keys, (int) _log_size, (int) _dead_bytes);
+}
+
+int BlobLogStore::get(const uint8_t key[], int key_len, uint8_t dest_buf[]) {
+  uint8_t k[BLOB_KEY_SIZE];
+  makeKey(k, key, key_len);
+  int i = findKey(k);
+  if (i < 0) return 0;  // not found
+
+  const IndexEntry* e = &_index[i];
+  if (e->offset >= _log_size) {   // not flushed yet
+    memcpy(dest_buf, &_buf[e->offset - _log_size + sizeof(BlobRecHeader)], e->len);
+    return e->len;
+  }
+
+  File file = openRead(_filename);
+  if (!file) return 0;
+  file.seek(e->offset + sizeof(BlobRecHeader));
+  int len = file.read(dest_buf, e->len);
+  file.close();
+
+  return len == e->len ? len : 0;
+}
+
+bool BlobLogStore::put(const uint8_t key[], int key_len, const uint8_t src_buf[], int len) {
+  if (len <= 0 || len > BLOB_MAX_LEN) return false;
+
+  uint8_t k[BLOB_KEY_SIZE];
+  makeKey(k, key, key_len);
+  if (findKey(k) < 0 && _num_keys >= _max_keys) {
+    uint8_t oldest[BLOB_KEY_SIZE];
+    memcpy(oldest, _index[_lru_head].key, BLOB_KEY_SIZE);   // least recently put
+    appendRecord(oldest, BLOB_REC_DEL, NULL, 0);   // evict
+  }
+  return appendRecord(k, BLOB_REC_PUT, src_buf, len);
+}
+
+bool BlobLogStore::remove(const uint8_t key[], int key_len) {
+  uint8_t k[BLOB_KEY_SIZE];
+  makeKey(k, key, key_len);
+  if (findKey(k) < 0) return true;  // nothing to do
+
+  return appendRecord(k, BLOB_REC_DEL, NULL, 0);
+}
+
+void BlobLogStore::flush() {
+  if (_compacting) finishCompaction();   // can only append to the new log
+  if (_buf_len == 0) return;
+
+  uint32_t file_size = _log_size;
+  File file = openAppend(_filename);
+  if (file) {
+    int n = file.write(_buf, _buf_len);
+    file_size = file.size();
+    file.close();
+
+    if (n == _buf_len && file_size == _log_size + _buf_len) {
+      _log_size += _buf_len;
+      _buf_len = 0;
+      _retry_millis = 0;
+      return;   // success
+    }
+  }
+  MESH_DEBUG_PRINTLN("BlobLogStore: flush failed");
+  onWriteError();   // buffer is kept, and retried after a back-off
+  if (file_size != _log_size) {
+    // log now has a partial record at end, so rewrite it (buffered records are re-applied after)
+    startCompaction();
+    finishCompaction();
+  }
+}
+
+void BlobLogStore::startCompaction() {
+#if defined(RP2040_PLATFORM)
+  _compact_file = _fs->open(_tmp_filename, "w");
+#else
+  _compact_file = _fs->open(_tmp_filename, "w", true);
+#endif
+  if (_compact_file) {
+    _compacting = true;
+    _compact_idx = _lru_head;
+  } else {
+    onWriteError();
+  }
+}
+
+bool BlobLogStore::compactStep(int max_records) {
+  if (_log_size == 0) return true;   // nothing in file
+
+  File src = openRead(_filename);
+  if (!src) {
+    abortCompaction();
+    return false;
+  }
+  uint8_t rec[REC_SIZE(BLOB_MAX_LEN)];
+  int n = 0;
+  while (_compact_idx >= 0 && n < max_records) {
+    const IndexEntry* e = &_index[_compact_idx];
+    _compact_idx = e->lru_next;
+    if (e->offset >= _log_size) continue;   // still in _buf, will be flushed after
+
+    int len = REC_SIZE(e->len);
+    src.seek(e->offset);
+    if ((int) src.read(rec, len) != len || (int) _compact_file.write(rec, len) != len) {
+      src.close();
+      abortCompaction();
+      return false;
+    }
+    n++;
+  }
+  src.close();
+  return _compact_idx < 0;
+}
+
+void BlobLogStore::abortCompaction() {
+  MESH_DEBUG_PRINTLN("BlobLogStore: compaction failed");
+  _compact_file.close();
+  _fs->remove(_tmp_filename);
+  _compacting = false;
+  onWriteError();
+}
+
+void BlobLogStore::finishCompaction() {
+  while (_compacting && !compactStep(64)) { }
+  if (!_compacting) return;   // aborted
+
+  _compact_file.close();
+  _compacting = false;
+  _fs->remove(_filename);
+  _fs->rename(_tmp_filename, _filename);
+
+  // new log has just the live records, then re-apply whatever is still buffered
+  loadIndex();
+  int pos = 0;
+  while (pos < _buf_len) {
+    BlobRecHeader hdr;
+    memcpy(&hdr, &_buf[pos], sizeof(hdr));
+    applyRecord(hdr, _log_size + pos);
+    pos += REC_SIZE(hdr.len);
+  }
+}
+
+void BlobLogStore::loop(unsigned long now_millis) {
+  if (_compacting) {
+    if (compactStep(BLOB_STORE_COMPACT_STEP)) finishCompaction();
+  } else if (isBackingOff(now_millis)) {
+    // wait, eg. for FS to have some free space
+  } else if (_buf_len > 0 && now_millis - _first_buffered >= BLOB_STORE_FLUSH_MILLIS) {
+    flush();
+  } else if (_dead_bytes >= BLOB_STORE_COMPACT_MIN && _dead_bytes > _log_size / 2) {
+    startCompaction();
+  }
+}
+
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <Arduino.h>
+#if defined(ESP32) || defined(RP2040_PLATFORM)
+  #include "IdentityStore.h"   // for FILESYSTEM
+#endif
+
+#ifndef BLOB_STORE_WRITE_BUF_SIZE
+  #define BLOB_STORE_WRITE_BUF_SIZE   1024    // appends are batched in RAM, up to this size
+#endif
+
+#ifndef BLOB_STORE_FLUSH_MILLIS
+  #define BLOB_STORE_FLUSH_MILLIS     5000    // max time appends stay buffered
+#endif
+
+#ifndef BLOB_STORE_COMPACT_MIN
+  #define BLOB_STORE_COMPACT_MIN      (8*1024)   // min dead bytes, before compaction is considered
+#endif
+
+#ifndef BLOB_STORE_COMPACT_STEP
+  #define BLOB_STORE_COMPACT_STEP     8       // num of records copied per loop(), while compacting
+#endif
+
+#ifndef BLOB_STORE_RETRY_MAX_MILLIS
+  #define BLOB_STORE_RETRY_MAX_MILLIS  (10*60*1000UL)   // max back-off after a failed write, eg. FS full
+#endif
+
+#define BLOB_KEY_SIZE     8
+#define BLOB_MAX_LEN    255
+
+#define BLOB_INDEX_BUCKETS   256    // one per value of first key byte
+
+#define BLOB_REC_PUT    0xB1
+#define BLOB_REC_DEL    0xB2
+
+struct BlobRecHeader {
+  uint8_t key[BLOB_KEY_SIZE];
+  uint8_t type;      // BLOB_REC_*
+  uint8_t len;       // num of data bytes following (0 for DEL)
+  uint16_t check;    // Fletcher-16 of key, type, len and data
+};
+
+#if defined(ESP32) || defined(RP2040_PLATFORM)
+
+/**
+ * \brief  Key/value blob store, packed into a single append-only log file, with an in-RAM index of
+ *       key -> offset. Deletes append a tombstone record. Dead records are removed by compaction, which
+ *       copies the live records to a new log a few at a time, from loop().
+ *       Index entries are hashed into buckets by first key byte, and also linked in order of last put(), so
+ *       when full the least recently put key is evicted.
+ *       After a failed write (eg. FS full), flushes and compactions are retried with an increasing back-off.
+*/
+class BlobLogStore {
+  struct IndexEntry {
+    uint8_t key[BLOB_KEY_SIZE];
+    uint32_t offset;   // of record header. If >= _log_size, the record is still in _buf
+    uint8_t len;
+    int16_t bucket_next;          // next entry in same bucket (or in free list), -1 = none
+    int16_t lru_prev, lru_next;   // in order of last put()
+  };
+
+  FILESYSTEM* _fs;
+  const char* _filename;
+  const char* _tmp_filename;
+  IndexEntry* _index;    // slots are stable, until removed
+  int16_t _buckets[BLOB_INDEX_BUCKETS];
+  int16_t _lru_head, _lru_tail;   // least, most recently put
+  int16_t _free_head;
+  int _num_keys, _max_keys;
+  uint32_t _log_size;     // valid bytes in file
+  uint32_t _dead_bytes;   // in file and _buf, superseded or deleted
+  uint8_t _buf[BLOB_STORE_WRITE_BUF_SIZE];
+  int _buf_len;
+  unsigned long _first_buffered;
+  unsigned long _error_at, _retry_millis;   // _retry_millis is 0 when no write has failed
+
+  File _compact_file;
+  bool _compacting;
+  int _compact_idx;   // next entry to copy (in LRU order), -1 = done
+
+  File openRead(const char* filename);
+  File openAppend(const char* filename);
+  void clearIndex();
+  int findKey(const uint8_t key[]) const;
+  void addKey(const BlobRecHeader& hdr, uint32_t offset);
+  void removeKeyAt(int i);
+  void onWriteError();
+  bool isBackingOff(unsigned long now_millis) const { return _retry_millis > 0 && now_millis - _error_at < _retry_millis; }
+  bool applyRecord(const BlobRecHeader& hdr, uint32_t offset);
+  bool appendRecord(const uint8_t key[], uint8_t type, const uint8_t* data, int len);
+  bool loadIndex();
+  void startCompaction();
+  bool compactStep(int max_records);
+  void abortCompaction();
+  void finishCompaction();
+
+public:
+  BlobLogStore(const char* filename, const char* tmp_filename, int max_keys);
+
+  /**
+   * \brief  builds the index, by scanning the log. Recovers from an interrupted compaction, or a torn append.
+  */
+  void begin(FILESYSTEM* fs);
+
+  /**
+   * \returns  length of blob copied to 'dest_buf' (must be BLOB_MAX_LEN bytes), or 0 if not found
+  */
+  int get(const uint8_t key[], int key_len, uint8_t dest_buf[]);
+
+  /**
+   * \brief  adds or replaces the blob for key. If index is full, the least recently put key is evicted.
+  */
+  bool put(const uint8_t key[], int key_len, const uint8_t src_buf[], int len);
+  bool remove(const uint8_t key[], int key_len);
+
+  void flush();
+  void loop(unsigned long now_millis);   // time-based flush, and background compaction
+
+  int getNumKeys() const { return _num_keys; }
+  uint32_t getLogSize() const { return _log_size + _buf_len; }
+  uint32_t getDeadBytes() const { return _dead_bytes; }
+  bool isCompacting() const { return _compacting; }
+};
+
+#endif
@@ -3,6 +3,7 @@
 #include <Arduino.h>   // needed for PlatformIO
 #include <Mesh.h>
 #include <helpers/IdentityStore.h>
+#include <helpers/RoomPushWindow.h>
 
 #define PERM_ACL_ROLE_MASK     3   // lower 2 bits
 #define PERM_ACL_GUEST         0
@@ -22,10 +23,8 @@ struct ClientInfo {
   uint32_t last_activity;    // by OUR clock    (transient)
   union  {
     struct {
-      uint32_t sync_since;  // sync messages SINCE this timestamp (by OUR clock)
-      uint32_t pending_ack;
-      uint32_t push_post_timestamp;
-      unsigned long ack_timeout;
+      RoomPushWindow push;   // only push.sync_since is persisted
+      unsigned long ack_timeout;   // of most recent push
       uint8_t  push_failures;
     } room;
   } extra;
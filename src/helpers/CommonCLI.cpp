@@ -91,7 +91,11 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     file.read((uint8_t *)&_prefs->rx_boosted_gain, sizeof(_prefs->rx_boosted_gain));              // 290
     file.read((uint8_t *)&_prefs->flood_max_unscoped, sizeof(_prefs->flood_max_unscoped));   // 291
     file.read((uint8_t *)&_prefs->flood_max_advert, sizeof(_prefs->flood_max_advert));       // 292
-    // next: 293
+    file.read((uint8_t *)&_prefs->flood_suppress, sizeof(_prefs->flood_suppress));           // 293
+    file.read((uint8_t *)&_prefs->flood_suppress_snr, sizeof(_prefs->flood_suppress_snr));   // 294
+    file.read((uint8_t *)&_prefs->ack_bundle_window, sizeof(_prefs->ack_bundle_window));     // 295
+    file.read((uint8_t *)&_prefs->flood_delay_snr, sizeof(_prefs->flood_delay_snr));         // 297
+    // next: 298
 
     // sanitise bad pref values
     _prefs->rx_delay_base = constrain(_prefs->rx_delay_base, 0, 20.0f);
@@ -106,6 +110,10 @@ void CommonCLI::loadPrefsInt(FILESYSTEM* fs, const char* filename) {
     _prefs->multi_acks = constrain(_prefs->multi_acks, 0, 1);
     _prefs->adc_multiplier = constrain(_prefs->adc_multiplier, 0.0f, 10.0f);
     _prefs->path_hash_mode = constrain(_prefs->path_hash_mode, 0, 2);   // NOTE: mode 3 reserved for future
+    _prefs->flood_suppress = constrain(_prefs->flood_suppress, 0, 8);
+    _prefs->flood_suppress_snr = constrain(_prefs->flood_suppress_snr, -30, 30);
+    _prefs->ack_bundle_window = constrain(_prefs->ack_bundle_window, 0, 2000);
+    _prefs->flood_delay_snr = constrain(_prefs->flood_delay_snr, 0, 1);
 
     // sanitise bad bridge pref values
     _prefs->bridge_enabled = constrain(_prefs->bridge_enabled, 0, 1);
@@ -184,7 +192,11 @@ void CommonCLI::savePrefs(FILESYSTEM* fs) {
     file.write((uint8_t *)&_prefs->rx_boosted_gain, sizeof(_prefs->rx_boosted_gain));              // 290
     file.write((uint8_t *)&_prefs->flood_max_unscoped, sizeof(_prefs->flood_max_unscoped));   // 291
     file.write((uint8_t *)&_prefs->flood_max_advert, sizeof(_prefs->flood_max_advert));       // 292
-    // next: 293
+    file.write((uint8_t *)&_prefs->flood_suppress, sizeof(_prefs->flood_suppress));           // 293
+    file.write((uint8_t *)&_prefs->flood_suppress_snr, sizeof(_prefs->flood_suppress_snr));   // 294
+    file.write((uint8_t *)&_prefs->ack_bundle_window, sizeof(_prefs->ack_bundle_window));     // 295
+    file.write((uint8_t *)&_prefs->flood_delay_snr, sizeof(_prefs->flood_delay_snr));         // 297
+    // next: 298
 
     file.close();
   }
@@ -464,6 +476,9 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, char* command, char* re
     } else if (memcmp(command, "log erase", 9) == 0) {
       _callbacks->eraseLogFile();
       strcpy(reply, "   log erased");
+    } else if (sender_timestamp == 0 && memcmp(command, "log hex", 7) == 0) {
+      _callbacks->dumpLogFileHex();
+      strcpy(reply, "   EOF");
     } else if (sender_timestamp == 0 && memcmp(command, "log", 3) == 0) {
       _callbacks->dumpLogFile();
       strcpy(reply, "   EOF");
@@ -473,6 +488,24 @@ void CommonCLI::handleCommand(uint32_t sender_timestamp, char* command, char* re
       _callbacks->formatRadioStatsReply(reply);
     } else if (sender_timestamp == 0 && memcmp(command, "stats-core", 10) == 0 && (command[10] == 0 || command[10] == ' ')) {
       _callbacks->formatStatsReply(reply);
+    } else if (sender_timestamp == 0 && memcmp(command, "stats-floods", 12) == 0 && (command[12] == 0 || command[12] == ' ')) {
+      _callbacks->formatFloodStatsReply(reply);
+    } else if (sender_timestamp == 0 && memcmp(command, "stats-latency", 13) == 0 && (command[13] == 0 || command[13] == ' ')) {
+      // stats-latency [rx|queue|cad|air] [flood|direct] [priority 0-3]
+      StrHelper::strncpy(tmp, command[13] ? &command[14] : &command[13], sizeof(tmp));
+      const char *parts[3];
+      int num = mesh::Utils::parseTextParts(tmp, parts, 3, ' ');
+      int stage = -1;    // summary
+      if (num > 0) {
+        if (strcmp(parts[0], "rx") == 0) stage = LATENCY_STAGE_RX_DELAY;
+        else if (strcmp(parts[0], "queue") == 0) stage = LATENCY_STAGE_QUEUE_WAIT;
+        else if (strcmp(parts[0], "cad") == 0) stage = LATENCY_STAGE_CAD_WAIT;
+        else if (strcmp(parts[0], "air") == 0) stage = LATENCY_STAGE_AIRTIME;
+        else stage = LATENCY_NUM_STAGES;   // invalid
+      }
+      int route = (num > 1 && strcmp(parts[1], "direct") == 0) ? LATENCY_ROUTE_DIRECT : LATENCY_ROUTE_FLOOD;
+      int pri_class = num > 2 ? atoi(parts[2]) : -1;
+      _callbacks->formatLatencyStatsReply(reply, stage, route, pri_class);
     } else {
       strcpy(reply, "Unknown command");
     }
@@ -508,6 +541,15 @@ void CommonCLI::handleSetCmd(uint32_t sender_timestamp, char* command, char* rep
     _prefs->multi_acks = atoi(&config[11]);
     savePrefs();
     strcpy(reply, "OK");
+  } else if (memcmp(config, "ack.bundle ", 11) == 0) {
+    int ms = _atoi(&config[11]);
+    if (ms >= 0 && ms <= 2000) {
+      _prefs->ack_bundle_window = ms;
+      savePrefs();
+      strcpy(reply, "OK");
+    } else {
+      strcpy(reply, "Error, must be 0-2000");
+    }
   } else if (memcmp(config, "allow.read.only ", 16) == 0) {
     _prefs->allow_read_only = memcmp(&config[16], "on", 2) == 0;
     savePrefs();
@@ -639,6 +681,28 @@ void CommonCLI::handleSetCmd(uint32_t sender_timestamp, char* command, char* rep
     } else {
       strcpy(reply, "Error, max 64");
     }
+  } else if (memcmp(config, "flood.delay.snr ", 16) == 0) {
+    _prefs->flood_delay_snr = memcmp(&config[16], "on", 2) == 0;
+    savePrefs();
+    strcpy(reply, "OK");
+  } else if (memcmp(config, "flood.suppress.snr ", 19) == 0) {
+    int snr = atoi(&config[19]);
+    if (snr >= -30 && snr <= 30) {
+      _prefs->flood_suppress_snr = snr;
+      savePrefs();
+      strcpy(reply, "OK");
+    } else {
+      strcpy(reply, "Error, must be -30 to 30");
+    }
+  } else if (memcmp(config, "flood.suppress ", 15) == 0) {
+    uint8_t n = atoi(&config[15]);
+    if (n <= 8) {
+      _prefs->flood_suppress = n;
+      savePrefs();
+      strcpy(reply, "OK");
+    } else {
+      strcpy(reply, "Error, max 8");
+    }
   } else if (memcmp(config, "direct.txdelay ", 15) == 0) {
     float f = atof(&config[15]);
     if (f >= 0 && f <= 2.0f) {
@@ -780,6 +844,8 @@ void CommonCLI::handleGetCmd(uint32_t sender_timestamp, char* command, char* rep
     sprintf(reply, "> %d", ((uint32_t) _prefs->agc_reset_interval) * 4);
   } else if (memcmp(config, "multi.acks", 10) == 0) {
     sprintf(reply, "> %d", (uint32_t) _prefs->multi_acks);
+  } else if (memcmp(config, "ack.bundle", 10) == 0) {
+    sprintf(reply, "> %d", (uint32_t) _prefs->ack_bundle_window);
   } else if (memcmp(config, "allow.read.only", 15) == 0) {
     sprintf(reply, "> %s", _prefs->allow_read_only ? "on" : "off");
   } else if (memcmp(config, "flood.advert.interval", 21) == 0) {
@@ -820,6 +886,12 @@ void CommonCLI::handleGetCmd(uint32_t sender_timestamp, char* command, char* rep
     sprintf(reply, "> %d", (uint32_t)_prefs->flood_max_unscoped);
   } else if (memcmp(config, "flood.max", 9) == 0) {
     sprintf(reply, "> %d", (uint32_t)_prefs->flood_max);
+  } else if (memcmp(config, "flood.delay.snr", 15) == 0) {
+    sprintf(reply, "> %s", _prefs->flood_delay_snr ? "on" : "off");
+  } else if (memcmp(config, "flood.suppress.snr", 18) == 0) {
+    sprintf(reply, "> %d", (int)_prefs->flood_suppress_snr);
+  } else if (memcmp(config, "flood.suppress", 14) == 0) {
+    sprintf(reply, "> %d", (uint32_t)_prefs->flood_suppress);
   } else if (memcmp(config, "direct.txdelay", 14) == 0) {
     sprintf(reply, "> %s", StrHelper::ftoa(_prefs->direct_tx_delay_factor));
   } else if (memcmp(config, "owner.info", 10) == 0) {
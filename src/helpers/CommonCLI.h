@@ -63,6 +63,10 @@ struct NodePrefs { // persisted to file
   uint8_t rx_boosted_gain; // power settings
   uint8_t path_hash_mode;   // which path mode to use when sending
   uint8_t loop_detect;
+  uint8_t flood_suppress;       // num of neighbour relays heard before cancelling own flood retransmit (0 = off)
+  int8_t flood_suppress_snr;    // min SNR (dB) of relays which count
+  uint16_t ack_bundle_window;   // millis to hold Direct ACKs, to merge others to same path (0 = off)
+  uint8_t flood_delay_snr;      // boolean, scale flood retransmit delay by SNR of neighbour it was heard from
 };
 
 class CommonCLICallbacks {
@@ -78,6 +82,9 @@ public:
   virtual void setLoggingOn(bool enable) = 0;
   virtual void eraseLogFile() = 0;
   virtual void dumpLogFile() = 0;
+  virtual void dumpLogFileHex() {
+    // no op by default
+  }
   virtual void setTxPower(int8_t power_dbm) = 0;
   virtual void formatNeighborsReply(char *reply) = 0;
   virtual void removeNeighbor(const uint8_t* pubkey, int key_len) {
@@ -86,6 +93,8 @@ public:
   virtual void formatStatsReply(char *reply) = 0;
   virtual void formatRadioStatsReply(char *reply) = 0;
   virtual void formatPacketStatsReply(char *reply) = 0;
+  virtual void formatFloodStatsReply(char *reply) = 0;
+  virtual void formatLatencyStatsReply(char *reply, int stage, int route, int pri_class) = 0;
   virtual mesh::LocalIdentity& getSelfId() = 0;
   virtual void saveIdentity(const mesh::LocalIdentity& new_id) = 0;
   virtual void clearStats() = 0;
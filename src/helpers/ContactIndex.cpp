@@ -0,0 +1,20 @@
+#include "ContactIndex.h"
+
+ContactIndex::ContactIndex(int max_entries) {
+  _max = max_entries;
+  _next = new int16_t[max_entries];
+  clear();
+}
+
+void ContactIndex::clear() {
+  for (int i = 0; i < CONTACT_INDEX_BUCKETS; i++) {
+    _heads[i] = -1;
+  }
+}
+
+void ContactIndex::add(int idx, uint8_t hash) {
+  if (idx < 0 || idx >= _max) return;
+
+  _next[idx] = _heads[hash];
+  _heads[hash] = idx;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+#define CONTACT_INDEX_BUCKETS   256    // one per value of first pub_key byte (ie. the 1 byte path hash)
+
+/**
+ * \brief  Hash-bucket index over a contacts table, keyed on the first byte of the pub_key. Each bucket is a
+ *      chain of table indexes, in ascending order, so a hash lookup only visits contacts which can match.
+ *      The index doesn't track the table itself: rebuild it with clear() and add() (in DESCENDING idx order)
+ *      whenever entries are added, removed or moved.
+*/
+class ContactIndex {
+  int16_t _heads[CONTACT_INDEX_BUCKETS];
+  int16_t* _next;
+  int _max;
+
+public:
+  ContactIndex(int max_entries);
+
+  void clear();
+  void add(int idx, uint8_t hash);    // pushes onto front of bucket chain
+
+  /**
+   * \returns  the first table index with given hash, or -1 if none
+   */
+  int first(uint8_t hash) const { return _heads[hash]; }
+
+  /**
+   * \returns  the next table index in same bucket as 'idx', or -1 if no more
+   */
+  int next(int idx) const { return _next[idx]; }
+};
@@ -0,0 +1,69 @@
+#include "FrameBatcher.h"
+#include <string.h>
+
+FrameBatcher::FrameBatcher(int queue_size, int max_batch_size) {
+  _queue_size = queue_size > 0 ? queue_size : 1;
+  _queue = new Frame[_queue_size];
+  _max_batch = max_batch_size;
+  _batch_buf = new uint8_t[_max_batch];
+  _dropped = 0;
+  clear();
+}
+
+void FrameBatcher::clear() {
+  _queue_len = 0;
+  _batching = false;
+  _num_unbatched = 0;
+}
+
+bool FrameBatcher::push(const uint8_t src[], size_t len) {
+  if (len == 0 || len > MAX_FRAME_SIZE || _queue_len >= _queue_size) return false;
+
+  Frame* f = &_queue[_queue_len++];
+  f->len = len;
+  memcpy(f->buf, src, len);
+  return true;
+}
+
+void FrameBatcher::setBatching(bool enable) {
+  if (enable && !_batching) {
+    _num_unbatched = _queue_len;
+  }
+  _batching = enable;
+}
+
+const uint8_t* FrameBatcher::nextWrite(int max_write_len, int& len, int& num_frames) {
+  if (_queue_len == 0) return NULL;
+
+  if (!_batching || _num_unbatched > 0) {
+    num_frames = 1;
+    len = _queue[0].len;
+    return _queue[0].buf;
+  }
+
+  if (max_write_len > _max_batch) max_write_len = _max_batch;
+  while (_queue_len > 0 && 1 + _queue[0].len > max_write_len) {
+    pop(1);   // can't ever fit (eg. MTU shrank), and app can't parse it unbatched
+    _dropped++;
+  }
+  len = 0;
+  num_frames = 0;
+  while (num_frames < _queue_len && len + 1 + _queue[num_frames].len <= max_write_len) {
+    const Frame* f = &_queue[num_frames++];
+    _batch_buf[len++] = f->len;
+    memcpy(&_batch_buf[len], f->buf, f->len);
+    len += f->len;
+  }
+  return num_frames > 0 ? _batch_buf : NULL;
+}
+
+void FrameBatcher::pop(int num_frames) {
+  if (num_frames > _queue_len) num_frames = _queue_len;
+  if (num_frames <= 0) return;
+
+  _queue_len -= num_frames;
+  for (int i = 0; i < _queue_len; i++) {
+    _queue[i] = _queue[i + num_frames];
+  }
+  _num_unbatched = _num_unbatched > num_frames ? _num_unbatched - num_frames : 0;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "BaseSerialInterface.h"
+
+/**
+ * \brief  send queue of companion frames, for links where each write is a whole packet (eg. BLE notify).
+ *       With batching on, a write carries as many [len][frame] entries as fit in the link's max write size.
+ *       Frames queued before batching was enabled still go one per write (without the len byte), so the
+ *       app sees the switch-over at a clean boundary.
+*/
+class FrameBatcher {
+  struct Frame {
+    uint8_t len;
+    uint8_t buf[MAX_FRAME_SIZE];
+  };
+
+  Frame* _queue;
+  int _queue_size, _queue_len;
+  uint8_t* _batch_buf;
+  int _max_batch;
+  bool _batching;
+  int _num_unbatched;   // frames at head of queue, queued before batching was enabled
+  uint32_t _dropped;
+
+public:
+  FrameBatcher(int queue_size, int max_batch_size);
+
+  void clear();   // also turns batching off, ie. for a new connection
+  bool push(const uint8_t src[], size_t len);   // false if queue full, or frame too big
+  int size() const { return _queue_len; }
+  int capacity() const { return _queue_size; }
+  bool isEmpty() const { return _queue_len == 0; }
+
+  void setBatching(bool enable);
+  bool isBatching() const { return _batching; }
+
+  /**
+   * \brief  prepares the next write, at most 'max_write_len' bytes (and at most max_batch_size from constructor).
+   *        When batching, a frame too big to ever fit is dropped.
+   * \param  num_frames  OUT - num of frames the write carries, to be passed to pop() once written
+   * \returns  pointer to bytes to write (valid until next call), or NULL if queue is empty
+  */
+  const uint8_t* nextWrite(int max_write_len, int& len, int& num_frames);
+
+  /**
+   * \brief  removes frames from head of queue, once written (or to drop them)
+  */
+  void pop(int num_frames);
+
+  uint32_t getNumDropped() const { return _dropped; }
+};
@@ -0,0 +1,233 @@
+#include "FrameMux.h"
+#include <string.h>
+
+#define MAX_ENCODED_FRAME   (FRAME_MUX_HEADER_SIZE + MAX_FRAME_SIZE)
+
+FrameMux::FrameMux(int max_clients) {
+  _max_clients = max_clients > 0 ? max_clients : 1;
+  _clients = new Client[_max_clients];
+  for (int i = 0; i < _max_clients; i++) {
+    resetClient(_clients[i], NULL);
+  }
+  _reply_to = -1;
+  _next_recv = 0;
+  _now = 0;
+}
+
+void FrameMux::resetClient(Client& c, FrameMuxConn* conn) {
+  c.conn = conn;
+  c.send_head = c.send_len = 0;
+  c.first_pending = 0;
+  c.last_progress = c.last_recv = _now;
+  c.recv_hdr_len = 0;
+  c.recv_len = c.recv_pos = 0;
+  memset(&c.stats, 0, sizeof(c.stats));
+}
+
+int FrameMux::getNumClients() const {
+  int n = 0;
+  for (int i = 0; i < _max_clients; i++) {
+    if (_clients[i].conn) n++;
+  }
+  return n;
+}
+
+int FrameMux::getSlotForNewClient() const {
+  int idx = 0;
+  for (int i = 0; i < _max_clients; i++) {
+    if (_clients[i].conn == NULL) return i;   // free slot
+
+    if ((long)(_clients[i].last_recv - _clients[idx].last_recv) < 0) idx = i;
+  }
+  return idx;   // all in use, replace least recently active
+}
+
+void FrameMux::attach(int idx, FrameMuxConn* conn, unsigned long now_millis) {
+  _now = now_millis;
+  detach(idx);
+  resetClient(_clients[idx], conn);
+}
+
+void FrameMux::detach(int idx) {
+  Client& c = _clients[idx];
+  if (c.conn) {
+    c.conn->stop();
+    c.conn = NULL;
+  }
+  if (_reply_to == idx) _reply_to = -1;
+}
+
+bool FrameMux::enqueue(Client& c, const uint8_t src[], int len) {
+  int n = FRAME_MUX_HEADER_SIZE + len;
+  if (c.send_len + n > FRAME_MUX_SEND_BUF_SIZE) return false;  // no room
+
+  uint8_t hdr[FRAME_MUX_HEADER_SIZE];
+  hdr[0] = FRAME_MUX_TYPE_OUT;
+  hdr[1] = len & 0xFF;   // LSB
+  hdr[2] = len >> 8;     // MSB
+  int tail = (c.send_head + c.send_len) % FRAME_MUX_SEND_BUF_SIZE;
+  for (int i = 0; i < n; i++) {
+    c.send_buf[tail] = i < FRAME_MUX_HEADER_SIZE ? hdr[i] : src[i - FRAME_MUX_HEADER_SIZE];
+    tail = (tail + 1) % FRAME_MUX_SEND_BUF_SIZE;
+  }
+  if (c.send_len == 0) {
+    c.first_pending = c.last_progress = _now;
+  }
+  c.send_len += n;
+  c.stats.frames_sent++;
+  return true;
+}
+
+size_t FrameMux::writeFrame(const uint8_t src[], size_t len, bool to_all) {
+  if (len == 0 || len > MAX_FRAME_SIZE) return 0;
+
+  if (!to_all && _reply_to >= 0) {
+    return enqueue(_clients[_reply_to], src, len) ? len : 0;
+  }
+
+  bool queued = false;
+  for (int i = 0; i < _max_clients; i++) {
+    Client& c = _clients[i];
+    if (c.conn == NULL) continue;
+
+    if (enqueue(c, src, len)) {
+      queued = true;
+    } else {
+      c.stats.frames_dropped++;   // slow client, don't hold back the others
+    }
+  }
+  return queued ? len : 0;
+}
+
+bool FrameMux::isWriteBusy() const {
+  for (int i = 0; i < _max_clients; i++) {
+    if (_reply_to >= 0 && i != _reply_to) continue;
+
+    const Client& c = _clients[i];
+    if (c.conn && c.send_len + MAX_ENCODED_FRAME > FRAME_MUX_SEND_BUF_SIZE) return true;
+  }
+  return false;
+}
+
+void FrameMux::flush(int idx) {
+  Client& c = _clients[idx];
+  if (c.send_len == 0) {
+    c.last_progress = _now;
+    return;
+  }
+  if (c.send_len < FRAME_MUX_COALESCE_BYTES && _now - c.first_pending < FRAME_MUX_COALESCE_MILLIS) {
+    return;   // wait for more frames, to coalesce
+  }
+
+  while (c.send_len > 0) {
+    int n = c.send_head + c.send_len > FRAME_MUX_SEND_BUF_SIZE ? FRAME_MUX_SEND_BUF_SIZE - c.send_head : c.send_len;  // contiguous part
+    int room = c.conn->availableForWrite();
+    if (room <= 0) {
+      c.stats.stalls++;
+      break;
+    }
+    if (n > room) n = room;
+
+    int written = c.conn->write(&c.send_buf[c.send_head], n);
+    if (written <= 0) {
+      c.stats.stalls++;
+      break;
+    }
+    c.stats.writes++;
+    c.stats.bytes_sent += written;
+    c.send_head = (c.send_head + written) % FRAME_MUX_SEND_BUF_SIZE;
+    c.send_len -= written;
+    c.last_progress = _now;
+    if (written < n) break;   // socket buffer full
+  }
+  c.first_pending = _now;   // anything left is retried after another coalesce period
+}
+
+bool FrameMux::readFrame(Client& c) {
+  while (c.conn->available() > 0) {
+    if (c.recv_hdr_len < FRAME_MUX_HEADER_SIZE) {
+      int n = c.conn->read(&c.recv_hdr[c.recv_hdr_len], FRAME_MUX_HEADER_SIZE - c.recv_hdr_len);
+      if (n <= 0) break;
+      c.recv_hdr_len += n;
+      c.stats.bytes_recv += n;
+      if (c.recv_hdr_len == FRAME_MUX_HEADER_SIZE) {
+        c.recv_len = c.recv_hdr[1] | (c.recv_hdr[2] << 8);
+        c.recv_pos = 0;
+      }
+    } else {
+      // NOTE: oversize or unexpected frame types are read, but discarded
+      bool keep = c.recv_hdr[0] == FRAME_MUX_TYPE_IN && c.recv_len <= MAX_FRAME_SIZE;
+      uint8_t skip[32];
+      int want = c.recv_len - c.recv_pos;
+      if (!keep && want > (int) sizeof(skip)) want = sizeof(skip);
+
+      int n = want > 0 ? c.conn->read(keep ? &c.recv_buf[c.recv_pos] : skip, want) : 0;
+      if (n < 0) break;
+      c.recv_pos += n;
+      c.stats.bytes_recv += n;
+      if (c.recv_pos >= c.recv_len) {
+        c.recv_hdr_len = 0;   // ready for next header
+        if (keep && c.recv_len > 0) {
+          c.stats.frames_recv++;
+          return true;
+        }
+      } else if (n == 0) {
+        break;
+      }
+    }
+  }
+  return false;
+}
+
+size_t FrameMux::loop(uint8_t dest[], unsigned long now_millis) {
+  _now = now_millis;
+
+  for (int i = 0; i < _max_clients; i++) {
+    Client& c = _clients[i];
+    if (c.conn == NULL) continue;
+
+    if (!c.conn->connected()) {
+      detach(i);
+      continue;
+    }
+    flush(i);
+    if (c.send_len > 0 && _now - c.last_progress >= FRAME_MUX_STALL_MILLIS) {
+      detach(i);   // not reading, give up on it
+    }
+  }
+
+  for (int k = 0; k < _max_clients; k++) {
+    int i = (_next_recv + k) % _max_clients;
+    Client& c = _clients[i];
+    if (c.conn && readFrame(c)) {
+      c.last_recv = _now;
+      _reply_to = i;
+      _next_recv = (i + 1) % _max_clients;   // so one busy client can't starve the others
+      memcpy(dest, c.recv_buf, c.recv_len);
+      return c.recv_len;
+    }
+  }
+  return 0;
+}
+
+bool FrameMux::getClientStats(int idx, FrameMuxClientStats& stats) const {
+  if (idx < 0 || idx >= _max_clients || _clients[idx].conn == NULL) return false;
+  stats = _clients[idx].stats;
+  return true;
+}
+
+void FrameMux::getTotalStats(FrameMuxClientStats& stats) const {
+  memset(&stats, 0, sizeof(stats));
+  for (int i = 0; i < _max_clients; i++) {
+    const Client& c = _clients[i];
+    if (c.conn == NULL) continue;
+
+    stats.frames_sent += c.stats.frames_sent;
+    stats.frames_recv += c.stats.frames_recv;
+    stats.bytes_sent += c.stats.bytes_sent;
+    stats.bytes_recv += c.stats.bytes_recv;
+    stats.writes += c.stats.writes;
+    stats.frames_dropped += c.stats.frames_dropped;
+    stats.stalls += c.stats.stalls;
+  }
+}
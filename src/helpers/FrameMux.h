@@ -0,0 +1,117 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "BaseSerialInterface.h"
+
+#ifndef FRAME_MUX_SEND_BUF_SIZE
+  #define FRAME_MUX_SEND_BUF_SIZE   2048    // per client, encoded frames waiting to be written
+#endif
+
+#ifndef FRAME_MUX_COALESCE_BYTES
+  #define FRAME_MUX_COALESCE_BYTES   512    // write as soon as this many bytes are pending
+#endif
+
+#ifndef FRAME_MUX_COALESCE_MILLIS
+  #define FRAME_MUX_COALESCE_MILLIS   10    // otherwise, max time bytes are held back for coalescing
+#endif
+
+#ifndef FRAME_MUX_STALL_MILLIS
+  #define FRAME_MUX_STALL_MILLIS   15000    // client which can't take any bytes for this long is disconnected
+#endif
+
+#define FRAME_MUX_HEADER_SIZE   3    // type, len (16 bit LE)
+#define FRAME_MUX_TYPE_OUT     '>'   // radio -> app
+#define FRAME_MUX_TYPE_IN      '<'   // app -> radio
+
+/**
+ * \brief  a byte stream connection to one client, eg. a TCP socket
+*/
+class FrameMuxConn {
+public:
+  virtual bool connected() = 0;
+  virtual int available() = 0;
+  virtual int read(uint8_t* dest, int len) = 0;
+  virtual int availableForWrite() = 0;
+  virtual int write(const uint8_t* src, int len) = 0;   // returns num bytes accepted
+  virtual void stop() = 0;
+};
+
+struct FrameMuxClientStats {
+  uint32_t frames_sent, frames_recv;   // frames_sent: queued for the client
+  uint32_t bytes_sent, bytes_recv;
+  uint32_t writes;           // calls to FrameMuxConn::write() which took some bytes
+  uint32_t frames_dropped;   // pushes which didn't fit in the send buffer
+  uint32_t stalls;           // times a write was deferred, because client couldn't take more
+};
+
+/**
+ * \brief  serves companion frames to several stream clients at once. Each client has its own send ring, which is
+ *       written in coalesced chunks (many frames per write). Incoming frames are parsed per-client, without blocking.
+ *       Replies go to the client which sent the last command, 'to_all' frames (eg. pushes) to all clients.
+*/
+class FrameMux {
+  struct Client {
+    FrameMuxConn* conn;
+    uint8_t send_buf[FRAME_MUX_SEND_BUF_SIZE];
+    int send_head, send_len;
+    unsigned long first_pending;   // when oldest un-written byte was queued
+    unsigned long last_progress;   // when a write last succeeded (or nothing was pending)
+    unsigned long last_recv;
+
+    uint8_t recv_hdr[FRAME_MUX_HEADER_SIZE];
+    int recv_hdr_len;
+    int recv_len, recv_pos;     // of frame body
+    uint8_t recv_buf[MAX_FRAME_SIZE];
+
+    FrameMuxClientStats stats;
+  };
+
+  Client* _clients;
+  int _max_clients;
+  int _reply_to;    // client which sent last command
+  int _next_recv;   // round-robin start for reading
+  unsigned long _now;
+
+  void resetClient(Client& c, FrameMuxConn* conn);
+  bool enqueue(Client& c, const uint8_t src[], int len);
+  void flush(int idx);
+  bool readFrame(Client& c);
+
+public:
+  FrameMux(int max_clients);
+
+  int getMaxClients() const { return _max_clients; }
+  int getNumClients() const;
+  bool isActive(int idx) const { return _clients[idx].conn != NULL; }
+
+  /**
+   * \returns  slot for a newly connected client. If all slots are in use, the least recently active one.
+  */
+  int getSlotForNewClient() const;
+
+  /**
+   * \brief  starts serving 'conn' in slot 'idx', first disconnecting any client already in that slot
+  */
+  void attach(int idx, FrameMuxConn* conn, unsigned long now_millis);
+  void detach(int idx);
+
+  /**
+   * \returns  len if queued for at least one client, or 0 if no client could take it
+  */
+  size_t writeFrame(const uint8_t src[], size_t len, bool to_all);
+
+  /**
+   * \brief  true if a client that writeFrame() would send to doesn't have room for another full size frame
+  */
+  bool isWriteBusy() const;
+
+  /**
+   * \brief  writes pending bytes, drops disconnected or stalled clients, then reads at most one complete frame
+   * \returns  length of frame copied to 'dest', or 0 if none
+  */
+  size_t loop(uint8_t dest[], unsigned long now_millis);
+
+  bool getClientStats(int idx, FrameMuxClientStats& stats) const;
+  void getTotalStats(FrameMuxClientStats& stats) const;   // sum of current clients
+};
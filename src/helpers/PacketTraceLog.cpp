@@ -0,0 +1,227 @@
+#include "PacketTraceLog.h"
+#include <Utils.h>
+#include <stdio.h>
+#include <string.h>
+
+static_assert(sizeof(PacketTraceRecord) == 24, "PacketTraceRecord layout is part of file format");
+static_assert(sizeof(PacketTraceFileHeader) == 16, "PacketTraceFileHeader layout is part of file format");
+
+bool PacketTraceBuffer::add(uint8_t event, const mesh::Packet* pkt, const uint8_t* raw, int len, float snr, float rssi,
+                            float score, uint32_t timestamp, unsigned long millis) {
+  if (isFull()) {
+    _num_dropped++;
+    return false;
+  }
+  uint8_t* slot = &_buf[_num_buffered * PACKET_TRACE_SLOT_SIZE];
+  memset(slot, 0, PACKET_TRACE_SLOT_SIZE);
+
+  PacketTraceRecord* rec = (PacketTraceRecord *) slot;
+  rec->seq = _next_seq++;
+  rec->timestamp = timestamp;
+  rec->millis = (uint16_t) millis;
+  rec->event = event;
+  rec->header = pkt->header;
+
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+  memcpy(rec->hash, hash, sizeof(rec->hash));
+
+  rec->snr = (int8_t) (snr * 4.0f);
+  rec->rssi = rssi < -128 ? -128 : (rssi > 127 ? 127 : (int8_t) rssi);
+  int s = (int) (score * 100.0f);
+  rec->score = s < 0 ? 0 : (s > 255 ? 255 : s);
+  rec->len = len;
+  rec->path_len = pkt->path_len;
+
+#if PACKET_TRACE_RAW_BYTES > 0
+  uint8_t tmp[MAX_TRANS_UNIT];
+  if (raw == NULL) {
+    len = pkt->writeTo(tmp);
+    raw = tmp;
+  }
+  rec->raw_len = len < PACKET_TRACE_RAW_BYTES ? len : PACKET_TRACE_RAW_BYTES;
+  memcpy(&slot[sizeof(PacketTraceRecord)], raw, rec->raw_len);
+#endif
+
+  _num_buffered++;
+  return true;
+}
+
+void PacketTraceBuffer::formatRecord(char* dest, const PacketTraceRecord& rec, const uint8_t* raw) {
+  static const char* events[] = { "?", "RX", "TX", "TX FAIL!" };
+  const char* ev = rec.event < sizeof(events)/sizeof(events[0]) ? events[rec.event] : events[0];
+  uint8_t route = rec.header & PH_ROUTE_MASK;
+  bool direct = route == ROUTE_TYPE_DIRECT || route == ROUTE_TYPE_TRANSPORT_DIRECT;
+
+  dest += sprintf(dest, "%s, len=%d (type=%d, route=%s, path_len=%d)", ev, (uint32_t) rec.len,
+                  (uint32_t) ((rec.header >> PH_TYPE_SHIFT) & PH_TYPE_MASK), direct ? "D" : "F", (uint32_t) rec.path_len);
+  if (rec.event == TRACE_EVENT_RX) {
+    dest += sprintf(dest, " SNR=%d RSSI=%d score=%d", (int) rec.snr / 4, (int) rec.rssi, ((int) rec.score) * 10);
+  }
+  dest += sprintf(dest, " hash=");
+  mesh::Utils::toHex(dest, rec.hash, sizeof(rec.hash));
+  dest += 2*sizeof(rec.hash);
+
+  if (raw && rec.raw_len > 0) {
+    *dest++ = ' ';
+    mesh::Utils::toHex(dest, raw, rec.raw_len);
+  }
+}
+
+#ifdef FILESYSTEM
+
+File PacketTraceLog::openRW() {
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  return _fs->open(_filename, FILE_O_WRITE);
+#else
+  return _fs->open(_filename, "r+");
+#endif
+}
+
+bool PacketTraceLog::loadFile() {
+  if (!_fs->exists(_filename)) return false;
+
+#if defined(RP2040_PLATFORM)
+  File f = _fs->open(_filename, "r");
+#else
+  File f = _fs->open(_filename);
+#endif
+  if (!f) return false;
+
+  PacketTraceFileHeader hdr;
+  bool valid = f.read((uint8_t *) &hdr, sizeof(hdr)) == sizeof(hdr) && hdr.magic == TRACE_FILE_MAGIC
+             && hdr.version == TRACE_FILE_VERSION && hdr.slot_size == PACKET_TRACE_SLOT_SIZE
+             && hdr.num_slots == PACKET_TRACE_SLOTS && f.size() == sizeof(hdr) + PACKET_TRACE_SLOTS*PACKET_TRACE_SLOT_SIZE;
+  f.close();
+  if (valid && (int32_t)(hdr.next_seq - _next_seq) > 0) {   // carry on from where previous run left off
+    for (int i = 0; i < _num_buffered; i++) {
+      ((PacketTraceRecord *) &_buf[i * PACKET_TRACE_SLOT_SIZE])->seq = hdr.next_seq + i;
+    }
+    _next_seq = hdr.next_seq + _num_buffered;
+  }
+  return valid;
+}
+
+void PacketTraceLog::begin(FILESYSTEM* fs) {
+  _fs = fs;
+  _file_ok = loadFile();
+}
+
+bool PacketTraceLog::initFile() {
+  if (loadFile()) return true;
+  if (_fs->exists(_filename)) _fs->remove(_filename);   // old (text) log, or different config
+
+  // pre-allocate the whole ring, so that it can't grow
+#if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  File f = _fs->open(_filename, FILE_O_WRITE);
+#elif defined(RP2040_PLATFORM)
+  File f = _fs->open(_filename, "w");
+#else
+  File f = _fs->open(_filename, "w", true);
+#endif
+  if (!f) return false;
+
+  PacketTraceFileHeader hdr;
+  hdr.magic = TRACE_FILE_MAGIC;
+  hdr.version = TRACE_FILE_VERSION;
+  hdr.reserved = 0;
+  hdr.slot_size = PACKET_TRACE_SLOT_SIZE;
+  hdr.num_slots = PACKET_TRACE_SLOTS;
+  hdr.next_seq = _next_seq - _num_buffered;
+  f.write((uint8_t *) &hdr, sizeof(hdr));
+
+  uint8_t zeros[PACKET_TRACE_SLOT_SIZE];
+  memset(zeros, 0, sizeof(zeros));
+  for (int i = 0; i < PACKET_TRACE_SLOTS; i++) {
+    f.write(zeros, sizeof(zeros));
+  }
+  f.close();
+  return true;
+}
+
+void PacketTraceLog::add(uint8_t event, const mesh::Packet* pkt, const uint8_t* raw, int len, float snr, float rssi,
+                         float score, uint32_t timestamp, unsigned long millis) {
+  if (isFull()) flush();
+  if (_num_buffered == 0) _first_buffered = millis;
+  PacketTraceBuffer::add(event, pkt, raw, len, snr, rssi, score, timestamp, millis);
+}
+
+void PacketTraceLog::loop(unsigned long millis) {
+  if (_num_buffered > 0 && millis - _first_buffered >= PACKET_TRACE_FLUSH_MILLIS) {
+    flush();
+  }
+}
+
+void PacketTraceLog::flush() {
+  if (_num_buffered == 0 || _fs == NULL) return;
+
+  if (!_file_ok) _file_ok = initFile();
+  if (_file_ok) {
+    File f = openRW();
+    if (f) {
+      // write out buffered records, in at most two contiguous runs (ie. when ring wraps)
+      int i = 0;
+      while (i < _num_buffered) {
+        uint32_t slot = (getRecord(i)->seq - 1) % PACKET_TRACE_SLOTS;
+        int n = _num_buffered - i;
+        if (slot + n > PACKET_TRACE_SLOTS) n = PACKET_TRACE_SLOTS - slot;
+
+        f.seek(sizeof(PacketTraceFileHeader) + slot * PACKET_TRACE_SLOT_SIZE);
+        f.write(&_buf[i * PACKET_TRACE_SLOT_SIZE], n * PACKET_TRACE_SLOT_SIZE);
+        i += n;
+      }
+
+      PacketTraceFileHeader hdr;
+      hdr.magic = TRACE_FILE_MAGIC;
+      hdr.version = TRACE_FILE_VERSION;
+      hdr.reserved = 0;
+      hdr.slot_size = PACKET_TRACE_SLOT_SIZE;
+      hdr.num_slots = PACKET_TRACE_SLOTS;
+      hdr.next_seq = _next_seq;
+      f.seek(0);
+      f.write((uint8_t *) &hdr, sizeof(hdr));
+      f.close();
+
+      _num_buffered = 0;
+      return;
+    }
+  }
+  MESH_DEBUG_PRINTLN("PacketTraceLog::flush(): unable to open %s", _filename);
+  _num_dropped += _num_buffered;
+  _num_buffered = 0;
+}
+
+void PacketTraceLog::erase() {
+  _fs->remove(_filename);
+  _file_ok = false;
+  _num_buffered = 0;
+  _next_seq = 1;
+}
+
+void PacketTraceLog::forEachRecord(PacketTraceHandler handler, void* ctx) {
+  flush();
+  if (!_file_ok) return;
+
+#if defined(RP2040_PLATFORM)
+  File f = _fs->open(_filename, "r");
+#else
+  File f = _fs->open(_filename);
+#endif
+  if (!f) return;
+
+  // oldest record is in slot after the newest, ie. where next one will go
+  uint32_t start = (_next_seq - 1) % PACKET_TRACE_SLOTS;
+  uint8_t slot[PACKET_TRACE_SLOT_SIZE];
+  const PacketTraceRecord* rec = (const PacketTraceRecord *) slot;
+  for (uint32_t k = 0; k < PACKET_TRACE_SLOTS; k++) {
+    uint32_t idx = (start + k) % PACKET_TRACE_SLOTS;
+    f.seek(sizeof(PacketTraceFileHeader) + idx * PACKET_TRACE_SLOT_SIZE);
+    if (f.read(slot, sizeof(slot)) != sizeof(slot)) break;
+    if (rec->seq == 0) continue;   // empty slot
+
+    handler(ctx, *rec, &slot[sizeof(PacketTraceRecord)]);
+  }
+  f.close();
+}
+
+#endif
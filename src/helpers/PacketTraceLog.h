@@ -0,0 +1,137 @@
+#pragma once
+
+#include <Packet.h>
+#if defined(ESP32) || defined(RP2040_PLATFORM) || defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+  #include "IdentityStore.h"   // for FILESYSTEM
+#endif
+
+#ifndef PACKET_TRACE_SLOTS
+  #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
+    #define PACKET_TRACE_SLOTS   256    // InternalFS is small
+  #else
+    #define PACKET_TRACE_SLOTS  1024
+  #endif
+#endif
+
+#ifndef PACKET_TRACE_RAW_BYTES
+  #define PACKET_TRACE_RAW_BYTES   0    // num of raw (wire format) bytes to keep per record, 0 = none
+#endif
+
+#ifndef PACKET_TRACE_BUF_RECORDS
+  #define PACKET_TRACE_BUF_RECORDS  16   // records buffered in RAM, between flushes
+#endif
+
+#ifndef PACKET_TRACE_FLUSH_MILLIS
+  #define PACKET_TRACE_FLUSH_MILLIS  10000
+#endif
+
+#define TRACE_EVENT_RX        1
+#define TRACE_EVENT_TX        2
+#define TRACE_EVENT_TX_FAIL   3
+
+#define TRACE_FILE_MAGIC     0x5254434D    // "MCTR"
+#define TRACE_FILE_VERSION   1
+
+/**
+ * \brief  one fixed size record of the trace log. In each slot, it's followed by PACKET_TRACE_RAW_BYTES.
+ *       NOTE: written to file as-is (little endian), see also: bin/trace2pcap.py
+*/
+struct PacketTraceRecord {
+  uint32_t seq;          // 1-based, 0 = empty slot
+  uint32_t timestamp;    // RTC clock (epoch secs)
+  uint16_t millis;       // low 16 bits of millis(), to order records within the same second
+  uint8_t event;         // TRACE_EVENT_*
+  uint8_t header;
+  uint8_t hash[4];       // prefix of packet hash
+  int8_t snr;            // x 4
+  int8_t rssi;
+  uint8_t score;         // x 100, capped at 255 (RX only)
+  uint8_t len;           // raw (wire) length
+  uint8_t path_len;
+  uint8_t raw_len;       // num of raw bytes kept
+  uint8_t reserved[2];
+};
+
+struct PacketTraceFileHeader {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t slot_size;    // sizeof(PacketTraceRecord) + PACKET_TRACE_RAW_BYTES
+  uint32_t num_slots;
+  uint32_t next_seq;
+};
+
+#define PACKET_TRACE_SLOT_SIZE  (sizeof(PacketTraceRecord) + PACKET_TRACE_RAW_BYTES)
+
+/**
+ * \brief  RAM side of the packet trace log: builds compact records, and buffers them for writing in batches.
+*/
+class PacketTraceBuffer {
+protected:
+  uint8_t _buf[PACKET_TRACE_BUF_RECORDS * PACKET_TRACE_SLOT_SIZE];
+  int _num_buffered;
+  uint32_t _next_seq;
+  uint32_t _num_dropped;
+
+public:
+  PacketTraceBuffer() { _num_buffered = 0; _next_seq = 1; _num_dropped = 0; }
+
+  /**
+   * \brief  adds a record to the buffer. Caller should flush when isFull().
+   * \param  raw   the wire format of 'pkt', or NULL (will be re-encoded, if raw bytes are being kept)
+   * \returns  false if buffer already full (record is dropped)
+  */
+  bool add(uint8_t event, const mesh::Packet* pkt, const uint8_t* raw, int len, float snr, float rssi, float score,
+           uint32_t timestamp, unsigned long millis);
+
+  bool isFull() const { return _num_buffered >= PACKET_TRACE_BUF_RECORDS; }
+  int getNumBuffered() const { return _num_buffered; }
+  uint32_t getNumDropped() const { return _num_dropped; }
+  const PacketTraceRecord* getRecord(int i) const { return (const PacketTraceRecord *) &_buf[i * PACKET_TRACE_SLOT_SIZE]; }
+
+  /**
+   * \brief  formats record as text, eg. "RX, len=40 (type=4, route=F, path_len=2) SNR=8 RSSI=-90 score=850 hash=AABBCCDD"
+   * \param  dest  must be at least 80 + 2*PACKET_TRACE_RAW_BYTES chars
+  */
+  static void formatRecord(char* dest, const PacketTraceRecord& rec, const uint8_t* raw);
+};
+
+#ifdef FILESYSTEM
+
+typedef void (*PacketTraceHandler)(void* ctx, const PacketTraceRecord& rec, const uint8_t* raw);
+
+/**
+ * \brief  A fixed size, pre-allocated ring of binary trace records in a file. Records are buffered in RAM, and
+ *       written in batches (ie. when buffer fills, or after PACKET_TRACE_FLUSH_MILLIS).
+*/
+class PacketTraceLog : public PacketTraceBuffer {
+  FILESYSTEM* _fs;
+  const char* _filename;
+  bool _file_ok;
+  unsigned long _first_buffered;   // millis when oldest buffered record was added
+
+  File openRW();
+  bool loadFile();
+  bool initFile();
+
+public:
+  PacketTraceLog(const char* filename) : _fs(NULL), _filename(filename) { _file_ok = false; _first_buffered = 0; }
+
+  /**
+   * \brief  picks up the existing trace file (if valid), so records from before a reboot can be viewed
+  */
+  void begin(FILESYSTEM* fs);
+
+  void add(uint8_t event, const mesh::Packet* pkt, const uint8_t* raw, int len, float snr, float rssi, float score,
+           uint32_t timestamp, unsigned long millis);
+  void loop(unsigned long millis);   // flushes, once buffered records are old enough
+  void flush();
+  void erase();
+
+  /**
+   * \brief  calls 'handler' for each record in the file, oldest first.
+  */
+  void forEachRecord(PacketTraceHandler handler, void* ctx);
+};
+
+#endif
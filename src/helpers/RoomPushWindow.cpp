@@ -0,0 +1,98 @@
+#include "RoomPushWindow.h"
+#include <string.h>
+
+void RoomPushWindow::reset(uint32_t since) {
+  sync_since = since;
+  num_in_flight = 0;
+  acked_mask = resend_mask = 0;
+  next_post_seq = 0;   // find from sync_since
+}
+
+int RoomPushWindow::getNumUnacked() const {
+  int count = 0;
+  for (int i = 0; i < num_in_flight; i++) {
+    if ((acked_mask & (1 << i)) == 0) count++;
+  }
+  return count;
+}
+
+uint32_t RoomPushWindow::getSyncCursor(const RoomPostSource& posts, const mesh::Identity& client) {
+  uint32_t seq = next_post_seq;
+  if (seq == 0 || seq < posts.getFirstSeq()) {   // sync_since has changed, or post at cursor was overwritten
+    seq = posts.findFirstAfter(num_in_flight > 0 ? in_flight[num_in_flight - 1].post_timestamp : sync_since);
+  }
+  while (seq < posts.getNextSeq() && posts.isAuthor(seq, client)) {   // don't push posts to the author
+    seq++;
+  }
+  next_post_seq = seq;
+  return seq;
+}
+
+void RoomPushWindow::onPushed(uint32_t seq, uint32_t post_timestamp, uint32_t ack) {
+  if (isFull()) return;
+
+  auto e = &in_flight[num_in_flight++];
+  e->seq = seq;
+  e->post_timestamp = post_timestamp;
+  e->ack = ack;
+  e->prev_ack = 0;
+  next_post_seq = seq + 1;
+}
+
+bool RoomPushWindow::onAckTimeout() {
+  uint8_t unacked = getUnackedMask();
+  if (unacked == 0 || resend_mask != 0) return false;
+
+  resend_mask = unacked;   // re-send these (their prev expected ACKs are kept, incase they arrive LATER)
+  return true;
+}
+
+int RoomPushWindow::getNextResend(const RoomPostSource& posts) {
+  for (int i = 0; i < num_in_flight; i++) {
+    if ((resend_mask & (1 << i)) == 0) continue;
+
+    if (in_flight[i].seq < posts.getFirstSeq()) {   // has since been overwritten, give up on it
+      giveUp(i);
+      i = -1;   // window may have slid, start again
+      continue;
+    }
+    return i;
+  }
+  return -1;
+}
+
+void RoomPushWindow::onResent(int idx, uint32_t ack) {
+  resend_mask &= ~(1 << idx);
+  in_flight[idx].prev_ack = in_flight[idx].ack;
+  in_flight[idx].ack = ack;
+}
+
+void RoomPushWindow::giveUp(int idx) {
+  acked_mask |= (1 << idx);
+  resend_mask &= ~(1 << idx);
+  slide();
+}
+
+bool RoomPushWindow::processAck(uint32_t ack, RoomPushEntry& acked) {
+  for (int k = 0; k < num_in_flight; k++) {
+    auto e = &in_flight[k];
+    if ((acked_mask & (1 << k)) || !(ack == e->ack || (e->prev_ack && ack == e->prev_ack))) continue;
+
+    acked_mask |= (1 << k);
+    resend_mask &= ~(1 << k);   // no need to re-send, if late ACK arrived
+    acked = *e;
+    slide();
+    return true;
+  }
+  return false;
+}
+
+void RoomPushWindow::slide() {
+  while (num_in_flight > 0 && (acked_mask & 1)) {
+    sync_since = in_flight[0].post_timestamp;
+    memmove(&in_flight[0], &in_flight[1], (num_in_flight - 1) * sizeof(in_flight[0]));
+    num_in_flight--;
+    acked_mask >>= 1;
+    resend_mask >>= 1;
+  }
+}
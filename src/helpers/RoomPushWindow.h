@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <Identity.h>
+
+#ifndef ROOM_PUSH_WINDOW
+  #define ROOM_PUSH_WINDOW   3    // max posts pushed to a client, which haven't been ACK'd yet
+#endif
+
+/**
+ * \brief  the room's posts, as needed for choosing what to push to a client
+*/
+class RoomPostSource {
+public:
+  virtual uint32_t getFirstSeq() const = 0;   // older posts have been overwritten
+  virtual uint32_t getNextSeq() const = 0;
+  virtual bool isAuthor(uint32_t seq, const mesh::Identity& id) const = 0;
+  virtual uint32_t findFirstAfter(uint32_t since) const = 0;   // or getNextSeq() if none
+};
+
+struct RoomPushEntry {
+  uint32_t seq;
+  uint32_t post_timestamp;
+  uint32_t ack;        // expected ACK
+  uint32_t prev_ack;   // expected ACK of previous attempt, in case it arrives late
+};
+
+/**
+ * \brief  posts pushed to one room client, awaiting their ACKs. ACKs can arrive out of order, but sync_since
+ *       only advances past the ACK'd posts at the start of the window. Posts whose ACK timed out are re-sent,
+ *       and keep the expected ACK of their previous attempt, so a late ACK still counts.
+ *       NOTE: plain struct, lives in ClientInfo
+*/
+struct RoomPushWindow {
+  uint32_t sync_since;      // sync messages SINCE this timestamp (by OUR clock)
+  uint32_t next_post_seq;   // cursor into room's posts (next to push), or 0 if needs to be found from sync_since
+  RoomPushEntry in_flight[ROOM_PUSH_WINDOW];   // pushed posts, oldest first
+  uint8_t  num_in_flight;
+  uint8_t  acked_mask, resend_mask;   // bits by in_flight[] index
+
+  /**
+   * \brief  empties the window, and syncs from 'since', eg. on login or a forced sync from the client
+  */
+  void reset(uint32_t since);
+
+  bool isFull() const { return num_in_flight >= ROOM_PUSH_WINDOW; }
+  uint8_t getUnackedMask() const { return ((1 << num_in_flight) - 1) & ~acked_mask; }
+  int getNumUnacked() const;
+
+  /**
+   * \returns  seq of next new post to push to 'client' (skipping their own), or posts.getNextSeq() if none
+  */
+  uint32_t getSyncCursor(const RoomPostSource& posts, const mesh::Identity& client);
+
+  void onPushed(uint32_t seq, uint32_t post_timestamp, uint32_t ack);
+
+  /**
+   * \brief  marks all un-ACK'd posts to be re-sent, unless re-sends are already pending
+   * \returns  true if any were marked
+  */
+  bool onAckTimeout();
+  void resendUnacked() { resend_mask = getUnackedMask(); }
+
+  /**
+   * \returns  in_flight[] index of next post to re-send, or -1 if none. Posts which have since been
+   *        overwritten are given up on.
+  */
+  int getNextResend(const RoomPostSource& posts);
+  void onResent(int idx, uint32_t ack);
+  void giveUp(int idx);
+
+  /**
+   * \brief  matches 'ack' against the expected ACKs (current, or previous attempt) of the un-ACK'd posts
+   * \param  acked  OUT - the ACK'd entry (before window slides). Late if acked.ack != 'ack'
+   * \returns  false if no match
+  */
+  bool processAck(uint32_t ack, RoomPushEntry& acked);
+
+  /**
+   * \brief  removes the ACK'd posts at start of window, advancing sync_since
+  */
+  void slide();
+};
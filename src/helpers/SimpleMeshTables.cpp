@@ -0,0 +1,114 @@
+#include "SimpleMeshTables.h"
+
+#define SLOT_EMPTY   0xFFFF
+
+// packet hashes are (truncated) SHA256, so any 4 bytes are already well distributed
+static int homeSlot(const uint8_t* hash, int num_slots) {
+  uint32_t key;
+  memcpy(&key, hash, 4);
+  return key % num_slots;
+}
+
+SimpleMeshTables::SimpleMeshTables(int max_entries) {
+  if (max_entries > 32000) max_entries = 32000;   // slots are 16-bit indexes
+  _size = max_entries;
+  _num_slots = max_entries*2;   // keep load factor <= 0.5
+  _entries = new Entry[_size];
+  _slots = new uint16_t[_num_slots];
+  memset(_entries, 0, sizeof(Entry)*_size);
+  memset(_slots, 0xFF, sizeof(uint16_t)*_num_slots);
+  _head = _num = 0;
+  _max_age_millis = ((uint32_t)PACKET_HASH_MAX_AGE_SECS) * 1000;
+  _ms = NULL;
+  _direct_dups = _flood_dups = 0;
+}
+
+int SimpleMeshTables::findSlot(const uint8_t* hash) const {
+  int i = homeSlot(hash, _num_slots);
+  while (_slots[i] != SLOT_EMPTY) {
+    if (memcmp(_entries[_slots[i]].hash, hash, MAX_HASH_SIZE) == 0) return i;
+    if (++i == _num_slots) i = 0;
+  }
+  return -1;  // not found
+}
+
+void SimpleMeshTables::removeSlot(int slot) {
+  // backward-shift deletion, so that no 'tombstones' are needed
+  int j = slot;
+  for (;;) {
+    _slots[slot] = SLOT_EMPTY;
+    for (;;) {
+      if (++j == _num_slots) j = 0;
+      if (_slots[j] == SLOT_EMPTY) return;
+
+      int k = homeSlot(_entries[_slots[j]].hash, _num_slots);
+      // can entry at 'j' stay where it is? (ie. is its home slot cyclically in (slot, j])
+      bool stays = slot <= j ? (slot < k && k <= j) : (slot < k || k <= j);
+      if (!stays) break;
+    }
+    _slots[slot] = _slots[j];
+    slot = j;
+  }
+}
+
+void SimpleMeshTables::removeOldest() {
+  if (isLive(_head)) {
+    removeSlot(findSlot(_entries[_head].hash));
+  }
+  _head = (_head + 1) % _size;
+  _num--;
+}
+
+void SimpleMeshTables::insert(const uint8_t* hash, uint32_t seen_at) {
+  // drop entries that have aged out, then the oldest if still full
+  uint32_t now = getNow();
+  while (_num > 0 && isExpired(_entries[_head], now)) {
+    removeOldest();
+  }
+  if (_num == _size) {
+    removeOldest();
+  }
+
+  int idx = (_head + _num) % _size;
+  memcpy(_entries[idx].hash, hash, MAX_HASH_SIZE);
+  _entries[idx].seen_at = seen_at;
+  _num++;
+
+  int i = homeSlot(hash, _num_slots);
+  while (_slots[i] != SLOT_EMPTY) {
+    if (++i == _num_slots) i = 0;
+  }
+  _slots[i] = idx;
+}
+
+bool SimpleMeshTables::hasSeen(const mesh::Packet* packet) {
+  uint8_t hash[MAX_HASH_SIZE];
+  packet->calculatePacketHash(hash);
+
+  uint32_t now = getNow();
+  int slot = findSlot(hash);
+  if (slot >= 0) {
+    if (!isExpired(_entries[_slots[slot]], now)) {
+      if (packet->isRouteDirect()) {
+        _direct_dups++;   // keep some stats
+      } else {
+        _flood_dups++;
+      }
+      return true;
+    }
+    removeSlot(slot);   // has aged out, re-insert as new
+  }
+
+  insert(hash, now);
+  return false;
+}
+
+void SimpleMeshTables::clear(const mesh::Packet* packet) {
+  uint8_t hash[MAX_HASH_SIZE];
+  packet->calculatePacketHash(hash);
+
+  int slot = findSlot(hash);
+  if (slot >= 0) {
+    removeSlot(slot);   // NOTE: entry itself is left in FIFO, and just skipped when evicted
+  }
+}
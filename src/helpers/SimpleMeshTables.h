@@ -6,65 +6,87 @@
   #include <FS.h>
 #endif
 
-#define MAX_PACKET_HASHES  (128+32)
+#ifndef MAX_PACKET_HASHES
+  #ifdef ESP32
+    #define MAX_PACKET_HASHES  1024
+  #else
+    #define MAX_PACKET_HASHES  (128+32)
+  #endif
+#endif
+
+#ifndef PACKET_HASH_MAX_AGE_SECS
+  #define PACKET_HASH_MAX_AGE_SECS  (20*60)    // 20 minutes
+#endif
 
+/**
+ * \brief  The 'seen packets' table. Packet hashes are kept in FIFO order (oldest evicted when full), with an
+ *      open-addressing (linear probe) index over them, so hasSeen()/clear() are O(1) regardless of capacity.
+ *      Entries also expire once older than 'max age' (if a clock is set).
+*/
 class SimpleMeshTables : public mesh::MeshTables {
-  uint8_t _hashes[MAX_PACKET_HASHES*MAX_HASH_SIZE];
-  int _next_idx;
+  struct Entry {
+    uint8_t hash[MAX_HASH_SIZE];
+    uint32_t seen_at;    // millis
+  };
+  Entry* _entries;     // cyclic, in order of insertion
+  uint16_t* _slots;    // index into _entries, or 0xFFFF if empty
+  int _size, _num_slots, _head, _num;
+  uint32_t _max_age_millis;
+  mesh::MillisecondClock* _ms;
   uint32_t _direct_dups, _flood_dups;
 
+  uint32_t getNow() const { return _ms ? _ms->getMillis() : 0; }
+  bool isExpired(const Entry& e, uint32_t now) const { return _max_age_millis > 0 && now - e.seen_at > _max_age_millis; }
+  int findSlot(const uint8_t* hash) const;
+  bool isLive(int idx) const { int s = findSlot(_entries[idx].hash); return s >= 0 && _slots[s] == idx; }
+  void removeSlot(int slot);
+  void removeOldest();
+  void insert(const uint8_t* hash, uint32_t seen_at);
+
 public:
-  SimpleMeshTables() { 
-    memset(_hashes, 0, sizeof(_hashes));
-    _next_idx = 0;
-    _direct_dups = _flood_dups = 0;
-  }
+  SimpleMeshTables(int max_entries=MAX_PACKET_HASHES);
+
+  void setClock(mesh::MillisecondClock* ms) override { _ms = ms; }
+  void setMaxAge(uint32_t secs) { _max_age_millis = secs * 1000; }
 
 #ifdef ESP32
+  // NOTE: ages (not absolute times) are persisted, as millis() restarts from zero after reboot
   void restoreFrom(File f) {
-    f.read(_hashes, sizeof(_hashes));
-    f.read((uint8_t *) &_next_idx, sizeof(_next_idx));
+    uint32_t n;
+    if (f.read((uint8_t *) &n, sizeof(n)) != sizeof(n)) return;
+    uint32_t now = getNow();
+    while (n > 0) {
+      uint8_t hash[MAX_HASH_SIZE];
+      uint32_t age;
+      if (f.read(hash, sizeof(hash)) != sizeof(hash) || f.read((uint8_t *) &age, sizeof(age)) != sizeof(age)) break;
+      if (findSlot(hash) < 0) insert(hash, now - age);
+      n--;
+    }
   }
   void saveTo(File f) {
-    f.write(_hashes, sizeof(_hashes));
-    f.write((const uint8_t *) &_next_idx, sizeof(_next_idx));
-  }
-#endif
-
-  bool hasSeen(const mesh::Packet* packet) override {
-    uint8_t hash[MAX_HASH_SIZE];
-    packet->calculatePacketHash(hash);
-
-    const uint8_t* sp = _hashes;
-    for (int i = 0; i < MAX_PACKET_HASHES; i++, sp += MAX_HASH_SIZE) {
-      if (memcmp(hash, sp, MAX_HASH_SIZE) == 0) { 
-        if (packet->isRouteDirect()) {
-          _direct_dups++;   // keep some stats
-        } else {
-          _flood_dups++;
-        }
-        return true;
-      }
+    uint32_t n = 0;
+    for (int i = 0; i < _num; i++) {
+      if (isLive((_head + i) % _size)) n++;
     }
+    f.write((const uint8_t *) &n, sizeof(n));
+    uint32_t now = getNow();
+    for (int i = 0; i < _num; i++) {
+      int idx = (_head + i) % _size;
+      if (!isLive(idx)) continue;   // was removed by clear()
 
-    memcpy(&_hashes[_next_idx*MAX_HASH_SIZE], hash, MAX_HASH_SIZE);
-    _next_idx = (_next_idx + 1) % MAX_PACKET_HASHES;  // cyclic table
-    return false;
-  }
-
-  void clear(const mesh::Packet* packet) override {
-    uint8_t hash[MAX_HASH_SIZE];
-    packet->calculatePacketHash(hash);
-
-    uint8_t* sp = _hashes;
-    for (int i = 0; i < MAX_PACKET_HASHES; i++, sp += MAX_HASH_SIZE) {
-      if (memcmp(hash, sp, MAX_HASH_SIZE) == 0) { 
-        memset(sp, 0, MAX_HASH_SIZE);
-        break;
-      }
+      const Entry& e = _entries[idx];
+      uint32_t age = now - e.seen_at;
+      f.write(e.hash, sizeof(e.hash));
+      f.write((const uint8_t *) &age, sizeof(age));
     }
   }
+#endif
+
+  bool hasSeen(const mesh::Packet* packet) override;
+  void clear(const mesh::Packet* packet) override;
 
+  int getCount() const { return _num; }
+  int getCapacity() const { return _size; }
   uint32_t getNumDirectDups() const { return _direct_dups; }
   uint32_t getNumFloodDups() const { return _flood_dups; }
 
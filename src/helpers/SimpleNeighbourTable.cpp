@@ -0,0 +1,155 @@
+#include "SimpleNeighbourTable.h"
+#include <string.h>
+
+SimpleNeighbourTable::SimpleNeighbourTable(int max_entries, mesh::RTCClock& rtc) {
+  _max = max_entries > 0 ? max_entries : 1;
+  _entries = new NeighbourInfo[_max];
+  _num = 0;
+  _rtc = &rtc;
+  _num_pending = 0;
+}
+
+int SimpleNeighbourTable::lowerBound(const uint8_t* key, int key_len) const {
+  int lo = 0, hi = _num;
+  while (lo < hi) {
+    int mid = (lo + hi) / 2;
+    if (memcmp(_entries[mid].id.pub_key, key, key_len) < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return lo;
+}
+
+NeighbourInfo* SimpleNeighbourTable::lookup(const uint8_t* hash, uint8_t hash_size) {
+  int i = lowerBound(hash, hash_size);
+  if (i >= _num || memcmp(_entries[i].id.pub_key, hash, hash_size) != 0) return NULL;   // not found
+  if (i + 1 < _num && memcmp(_entries[i + 1].id.pub_key, hash, hash_size) == 0) return NULL;  // ambiguous
+  return &_entries[i];
+}
+
+void SimpleNeighbourTable::addSample(NeighbourInfo& n, float snr, float rssi) {
+  if (n.num_heard == 0) {
+    n.snr_avg = snr;
+    n.rssi_avg = rssi;
+  } else {
+    n.snr_avg += NEIGHBOUR_AVG_WEIGHT * (snr - n.snr_avg);
+    n.rssi_avg += NEIGHBOUR_AVG_WEIGHT * (rssi - n.rssi_avg);
+  }
+  if (n.num_heard < 0xFFFF) n.num_heard++;
+  n.snr = (int8_t)(snr * 4);
+  n.heard_timestamp = _rtc->getCurrentTime();
+}
+
+NeighbourInfo* SimpleNeighbourTable::put(const mesh::Identity& id, uint32_t advert_timestamp, float snr, float rssi) {
+  int i = lowerBound(id.pub_key, PUB_KEY_SIZE);
+  if (i >= _num || !id.matches(_entries[i].id)) {   // new neighbour
+    if (_num >= _max) {   // replace the least recently heard
+      int oldest = 0;
+      for (int j = 1; j < _num; j++) {
+        if (_entries[j].heard_timestamp < _entries[oldest].heard_timestamp) oldest = j;
+      }
+      for (int j = oldest; j < _num - 1; j++) _entries[j] = _entries[j + 1];
+      _num--;
+      if (oldest < i) i--;
+    }
+    for (int j = _num; j > i; j--) _entries[j] = _entries[j - 1];
+    _num++;
+
+    NeighbourInfo& n = _entries[i];
+    n = NeighbourInfo();
+    n.id = id;
+    n.delivery = 1.0f;   // optimistic, until Direct packets have been sent to it
+  }
+
+  NeighbourInfo& n = _entries[i];
+  n.advert_timestamp = advert_timestamp;
+  addSample(n, snr, rssi);
+  return &n;
+}
+
+int SimpleNeighbourTable::remove(const uint8_t* prefix, int prefix_len) {
+  int j = 0;
+  for (int i = 0; i < _num; i++) {
+    if (memcmp(_entries[i].id.pub_key, prefix, prefix_len) != 0) {
+      if (j < i) _entries[j] = _entries[i];
+      j++;
+    }
+  }
+  int removed = _num - j;
+  _num = j;
+  return removed;
+}
+
+void SimpleNeighbourTable::onHeard(const uint8_t* hash, uint8_t hash_size, float snr, float rssi) {
+  NeighbourInfo* n = lookup(hash, hash_size);
+  if (n) addSample(*n, snr, rssi);
+}
+
+void SimpleNeighbourTable::addOutcome(const uint8_t* hash, uint8_t hash_size, bool forwarded) {
+  NeighbourInfo* n = lookup(hash, hash_size);
+  if (n == NULL) return;
+
+  n->delivery += NEIGHBOUR_AVG_WEIGHT * ((forwarded ? 1.0f : 0.0f) - n->delivery);
+  if (n->delivery < NEIGHBOUR_MIN_DELIVERY) n->delivery = NEIGHBOUR_MIN_DELIVERY;
+
+  uint16_t& count = forwarded ? n->num_fwd_ok : n->num_fwd_fail;
+  if (count < 0xFFFF) count++;
+}
+
+void SimpleNeighbourTable::removePending(int i) {
+  _num_pending--;
+  for ( ; i < _num_pending; i++) _pending[i] = _pending[i + 1];
+}
+
+void SimpleNeighbourTable::onDirectSent(const mesh::Packet* packet, unsigned long now_millis) {
+  checkTimeouts(now_millis);
+
+  uint8_t sz = packet->getPathHashSize();
+  if (sz > sizeof(_pending[0].next_hop) || lookup(packet->path, sz) == NULL) return;   // next hop not a known neighbour
+
+  if (_num_pending >= NEIGHBOUR_MAX_PENDING) removePending(0);   // oldest, no outcome
+
+  PendingFwd& p = _pending[_num_pending++];
+  uint8_t hash[MAX_HASH_SIZE];
+  packet->calculatePacketHash(hash);
+  memcpy(p.packet_hash, hash, sizeof(p.packet_hash));
+  memcpy(p.next_hop, packet->path, sz);
+  p.hash_size = sz;
+  p.path_count = packet->getPathHashCount() - 1;   // next hop removes itself from path
+  p.sent_at = now_millis;
+}
+
+void SimpleNeighbourTable::onDirectHeard(const mesh::Packet* packet, unsigned long now_millis) {
+  if (_num_pending == 0) return;
+
+  uint8_t hash[MAX_HASH_SIZE];
+  packet->calculatePacketHash(hash);
+  for (int i = 0; i < _num_pending; i++) {
+    PendingFwd& p = _pending[i];
+    if (p.path_count == packet->getPathHashCount() && memcmp(p.packet_hash, hash, sizeof(p.packet_hash)) == 0) {
+      addOutcome(p.next_hop, p.hash_size, true);
+      onHeard(p.next_hop, p.hash_size, packet->getSNR(), packet->getRSSI());   // was transmitted by next hop
+      removePending(i);
+      return;
+    }
+  }
+}
+
+void SimpleNeighbourTable::checkTimeouts(unsigned long now_millis) {
+  int i = 0;
+  while (i < _num_pending) {
+    if (now_millis - _pending[i].sent_at >= NEIGHBOUR_FWD_TIMEOUT_MILLIS) {
+      addOutcome(_pending[i].next_hop, _pending[i].hash_size, false);
+      removePending(i);
+    } else {
+      i++;
+    }
+  }
+}
+
+uint16_t SimpleNeighbourTable::getETX(const uint8_t* hash, uint8_t hash_size) {
+  NeighbourInfo* n = lookup(hash, hash_size);
+  return n ? n->getETX() : 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Mesh.h>
+
+#ifndef NEIGHBOUR_AVG_WEIGHT
+  #define NEIGHBOUR_AVG_WEIGHT   0.125f    // weight of each new sample, in the exponentially weighted averages
+#endif
+
+#ifndef NEIGHBOUR_MIN_DELIVERY
+  #define NEIGHBOUR_MIN_DELIVERY   0.05f   // ie. max ETX of 20
+#endif
+
+#ifndef NEIGHBOUR_MAX_PENDING
+  #define NEIGHBOUR_MAX_PENDING   8        // Direct packets waiting to be heard forwarded by next hop
+#endif
+
+#ifndef NEIGHBOUR_FWD_TIMEOUT_MILLIS
+  #define NEIGHBOUR_FWD_TIMEOUT_MILLIS   8000
+#endif
+
+struct NeighbourInfo {
+  mesh::Identity id;
+  uint32_t advert_timestamp;
+  uint32_t heard_timestamp;  // by OUR clock
+  int8_t snr;                // last heard, multiplied by 4, user should divide to get float value
+  float snr_avg, rssi_avg;   // exponentially weighted
+  float delivery;            // estimated ratio of Direct packets sent to it, which were heard forwarded
+  uint16_t num_heard, num_fwd_ok, num_fwd_fail;
+
+  /**
+   * \returns  expected number of transmissions, x100
+   */
+  uint16_t getETX() const { return (uint16_t) (100.0f / delivery + 0.5f); }
+};
+
+/**
+ * \brief  Link quality of neighbouring nodes. Entries are added from zero-hop adverts (or discover responses), and
+ *      then kept updated by Mesh with the SNR/RSSI of relayed floods and the implicit ACKs of Direct packets
+ *      (ie. hearing the next hop forward them). Entries are kept sorted by pub_key, so the lookups by path hash
+ *      (on every flood heard) are a binary search. When full, the least recently heard neighbour is replaced.
+*/
+class SimpleNeighbourTable : public mesh::NeighbourTable {
+  struct PendingFwd {
+    uint8_t packet_hash[4];
+    uint8_t next_hop[4];
+    uint8_t hash_size;
+    uint8_t path_count;      // expected in the forwarded packet
+    unsigned long sent_at;
+  };
+
+  NeighbourInfo* _entries;
+  int _max, _num;
+  mesh::RTCClock* _rtc;
+  PendingFwd _pending[NEIGHBOUR_MAX_PENDING];
+  int _num_pending;
+
+  int lowerBound(const uint8_t* key, int key_len) const;
+  void addSample(NeighbourInfo& n, float snr, float rssi);
+  void addOutcome(const uint8_t* hash, uint8_t hash_size, bool forwarded);
+  void removePending(int i);
+
+public:
+  SimpleNeighbourTable(int max_entries, mesh::RTCClock& rtc);
+
+  /**
+   * \brief  adds (or refreshes) neighbour, eg. from its zero-hop advert
+   * \returns  the entry
+   */
+  NeighbourInfo* put(const mesh::Identity& id, uint32_t advert_timestamp, float snr, float rssi);
+
+  /**
+   * \returns  the neighbour with given hash, or NULL if none (or more than one) matches
+   */
+  NeighbourInfo* lookup(const uint8_t* hash, uint8_t hash_size);
+
+  /**
+   * \returns  number of neighbours removed, ie. all which match the given pub_key prefix
+   */
+  int remove(const uint8_t* prefix, int prefix_len);
+
+  int getCount() const { return _num; }
+  NeighbourInfo* getByIdx(int i) { return &_entries[i]; }
+
+  // mesh::NeighbourTable
+  void onHeard(const uint8_t* hash, uint8_t hash_size, float snr, float rssi) override;
+  void onDirectSent(const mesh::Packet* packet, unsigned long now_millis) override;
+  void onDirectHeard(const mesh::Packet* packet, unsigned long now_millis) override;
+  void checkTimeouts(unsigned long now_millis) override;
+  uint16_t getETX(const uint8_t* hash, uint8_t hash_size) override;
+};
@@ -1,4 +1,5 @@
 #include "StaticPoolPacketManager.h"
+#include <string.h>
 
 PacketQueue::PacketQueue(int max_entries) {
   _table = new mesh::Packet*[max_entries];
@@ -68,19 +69,206 @@ bool PacketQueue::add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled
   return true;
 }
 
-StaticPoolPacketManager::StaticPoolPacketManager(int pool_size): unused(pool_size), send_queue(pool_size), rx_queue(pool_size) {
+PacketScheduler::PacketScheduler(int max_entries) {
+  _table = new Entry[max_entries];
+  _size = max_entries;
+  _num_ready = _num_waiting = 0;
+  _next_seq = 0;
+}
+
+bool PacketScheduler::isBefore(const Entry& a, const Entry& b) {
+  if (a.priority != b.priority) return a.priority < b.priority;
+  return (int32_t)(a.seq - b.seq) < 0;   // same priority, so first-in first-out
+}
+
+bool PacketScheduler::isSooner(const Entry& a, const Entry& b) {
+  return (int32_t)(a.scheduled_for - b.scheduled_for) < 0;   // handles millis() wrap-around
+}
+
+void PacketScheduler::readyUp(int i) {
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!isBefore(ready(i), ready(parent))) break;
+    Entry tmp = ready(i); ready(i) = ready(parent); ready(parent) = tmp;
+    i = parent;
+  }
+}
+
+void PacketScheduler::readyDown(int i) {
+  for (;;) {
+    int best = i;
+    int c = 2*i + 1;
+    if (c < _num_ready && isBefore(ready(c), ready(best))) best = c;
+    c++;
+    if (c < _num_ready && isBefore(ready(c), ready(best))) best = c;
+    if (best == i) break;
+    Entry tmp = ready(i); ready(i) = ready(best); ready(best) = tmp;
+    i = best;
+  }
+}
+
+void PacketScheduler::waitingUp(int i) {
+  while (i > 0) {
+    int parent = (i - 1) / 2;
+    if (!isSooner(waiting(i), waiting(parent))) break;
+    Entry tmp = waiting(i); waiting(i) = waiting(parent); waiting(parent) = tmp;
+    i = parent;
+  }
+}
+
+void PacketScheduler::waitingDown(int i) {
+  for (;;) {
+    int best = i;
+    int c = 2*i + 1;
+    if (c < _num_waiting && isSooner(waiting(c), waiting(best))) best = c;
+    c++;
+    if (c < _num_waiting && isSooner(waiting(c), waiting(best))) best = c;
+    if (best == i) break;
+    Entry tmp = waiting(i); waiting(i) = waiting(best); waiting(best) = tmp;
+    i = best;
+  }
+}
+
+PacketScheduler::Entry PacketScheduler::readyRemove(int i) {
+  Entry e = ready(i);
+  _num_ready--;
+  if (i < _num_ready) {
+    ready(i) = ready(_num_ready);   // fill hole with last, then restore heap order
+    readyDown(i);
+    readyUp(i);
+  }
+  return e;
+}
+
+PacketScheduler::Entry PacketScheduler::waitingRemove(int i) {
+  Entry e = waiting(i);
+  _num_waiting--;
+  if (i < _num_waiting) {
+    waiting(i) = waiting(_num_waiting);
+    waitingDown(i);
+    waitingUp(i);
+  }
+  return e;
+}
+
+void PacketScheduler::promoteDue(uint32_t now) {
+  while (_num_waiting > 0 && (int32_t)(waiting(0).scheduled_for - now) <= 0) {
+    Entry e = waitingRemove(0);
+    ready(_num_ready) = e;
+    readyUp(_num_ready++);
+  }
+}
+
+int PacketScheduler::countDue(int i, uint32_t now) const {
+  if (i >= _num_waiting || (int32_t)(waiting(i).scheduled_for - now) > 0) return 0;  // sub-tree is all in future
+  return 1 + countDue(2*i + 1, now) + countDue(2*i + 2, now);
+}
+
+int PacketScheduler::countBefore(uint32_t now) const {
+  if (now == 0xFFFFFFFF) return count();  // sentinel: count all entries regardless of schedule
+
+  return _num_ready + countDue(0, now);
+}
+
+bool PacketScheduler::hasReady(uint32_t now) const {
+  return _num_ready > 0 || (_num_waiting > 0 && (int32_t)(waiting(0).scheduled_for - now) <= 0);
+}
+
+bool PacketScheduler::getNextTime(uint32_t now, uint32_t& scheduled_for) const {
+  if (_num_ready > 0) {
+    scheduled_for = now;   // already due
+    return true;
+  }
+  if (_num_waiting > 0) {
+    scheduled_for = waiting(0).scheduled_for;
+    return true;
+  }
+  return false;
+}
+
+mesh::Packet* PacketScheduler::get(uint32_t now) {
+  promoteDue(now);
+  if (_num_ready == 0) return NULL;   // empty, or all items are still in the future
+
+  return readyRemove(0).packet;
+}
+
+bool PacketScheduler::add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
+  if (count() == _size) {
+    return false;
+  }
+  Entry& e = waiting(_num_waiting);
+  e.packet = packet;
+  e.priority = priority;
+  e.scheduled_for = scheduled_for;
+  e.seq = _next_seq++;
+  waitingUp(_num_waiting++);   // promoted to 'ready' heap lazily, in get()
+  return true;
+}
+
+mesh::Packet* PacketScheduler::itemAt(int i) const {
+  if (i < _num_ready) return ready(i).packet;
+  i -= _num_ready;
+  if (i < _num_waiting) return waiting(i).packet;
+  return NULL;  // invalid index
+}
+
+mesh::Packet* PacketScheduler::removeByIdx(int i) {
+  if (i < _num_ready) return readyRemove(i).packet;
+  i -= _num_ready;
+  if (i < _num_waiting) return waitingRemove(i).packet;
+  return NULL;  // invalid index
+}
+
+StaticPoolPacketManager::StaticPoolPacketManager(int pool_size): send_queue(pool_size), rx_queue(pool_size) {
   // load up our unusued Packet pool
+  _pool = new mesh::Packet[pool_size];
+  _unused = new mesh::Packet*[pool_size];
   for (int i = 0; i < pool_size; i++) {
-    unused.add(new mesh::Packet(), 0, 0);
+    _unused[i] = &_pool[i];
   }
+  _pool_size = pool_size;
+  _unused_head = 0;
+  _num_unused = _min_unused = pool_size;
+#if MESH_DEBUG
+  _is_unused = new uint8_t[pool_size];
+  memset(_is_unused, 1, pool_size);
+  _double_frees = 0;
+#endif
 }
 
 mesh::Packet* StaticPoolPacketManager::allocNew() {
-  return unused.removeByIdx(0);  // just get first one (returns NULL if empty)
+  if (_num_unused == 0) return NULL;   // pool is empty
+
+  mesh::Packet* packet = _unused[_unused_head];
+  if (++_unused_head == _pool_size) _unused_head = 0;
+  _num_unused--;
+  if (_num_unused < _min_unused) _min_unused = _num_unused;
+#if MESH_DEBUG
+  _is_unused[packet - _pool] = 0;
+#endif
+  return packet;
 }
 
 void StaticPoolPacketManager::free(mesh::Packet* packet) {
-  unused.add(packet, 0, 0);
+  if (packet < _pool || packet >= &_pool[_pool_size]) {
+    MESH_DEBUG_PRINTLN("StaticPoolPacketManager::free(): ERROR: packet not from this pool");
+    return;
+  }
+#if MESH_DEBUG
+  if (_is_unused[packet - _pool]) {
+    MESH_DEBUG_PRINTLN("StaticPoolPacketManager::free(): ERROR: double free of packet %d", (int)(packet - _pool));
+    _double_frees++;
+    return;
+  }
+  _is_unused[packet - _pool] = 1;
+#endif
+  if (_num_unused == _pool_size) return;   // can only be a double free (non-debug build)
+
+  int tail = _unused_head + _num_unused;
+  if (tail >= _pool_size) tail -= _pool_size;
+  _unused[tail] = packet;
+  _num_unused++;
 }
 
 void StaticPoolPacketManager::queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) {
@@ -99,12 +287,16 @@ int  StaticPoolPacketManager::getOutboundCount(uint32_t now) const {
   return send_queue.countBefore(now);
 }
 
+bool StaticPoolPacketManager::hasOutboundReady(uint32_t now) const {
+  return send_queue.hasReady(now);
+}
+
 int  StaticPoolPacketManager::getOutboundTotal() const {
   return send_queue.count();
 }
 
 int StaticPoolPacketManager::getFreeCount() const {
-  return unused.count();
+  return _num_unused;
 }
 
 mesh::Packet* StaticPoolPacketManager::getOutboundByIdx(int i) {
@@ -123,3 +315,10 @@ void StaticPoolPacketManager::queueInbound(mesh::Packet* packet, uint32_t schedu
 mesh::Packet* StaticPoolPacketManager::getNextInbound(uint32_t now) {
   return rx_queue.get(now);
 }
+
+bool StaticPoolPacketManager::getNextOutboundTime(uint32_t now, uint32_t& scheduled_for) const {
+  return send_queue.getNextTime(now, scheduled_for);
+}
+bool StaticPoolPacketManager::getNextInboundTime(uint32_t now, uint32_t& scheduled_for) const {
+  return rx_queue.getNextTime(now, scheduled_for);
+}
@@ -18,8 +18,61 @@ public:
   mesh::Packet* removeByIdx(int i);
 };
 
+/**
+ * \brief  A deadline/priority scheduler, with same semantics as PacketQueue, but using two binary heaps
+ *      sharing one table.  Entries still in the future sit in a 'waiting' min-heap (by scheduled_for), and
+ *      are promoted to a 'ready' min-heap (by priority, then insertion order) once they fall due.
+ *      'Anything ready?' checks are O(1), add/get/removeByIdx are O(log n).
+*/
+class PacketScheduler {
+  struct Entry {
+    mesh::Packet* packet;
+    uint32_t scheduled_for;
+    uint32_t seq;       // insertion order, keeps FIFO ordering within same priority
+    uint8_t priority;
+  };
+  Entry* _table;      // ready heap grows up from [0], waiting heap grows down from [_size-1]
+  int _size, _num_ready, _num_waiting;
+  uint32_t _next_seq;
+
+  Entry& ready(int i) const { return _table[i]; }
+  Entry& waiting(int i) const { return _table[_size - 1 - i]; }
+
+  static bool isBefore(const Entry& a, const Entry& b);   // ready heap order
+  static bool isSooner(const Entry& a, const Entry& b);   // waiting heap order
+
+  void readyUp(int i);
+  void readyDown(int i);
+  void waitingUp(int i);
+  void waitingDown(int i);
+  Entry readyRemove(int i);
+  Entry waitingRemove(int i);
+  void promoteDue(uint32_t now);
+  int countDue(int i, uint32_t now) const;
+
+public:
+  PacketScheduler(int max_entries);
+  mesh::Packet* get(uint32_t now);
+  bool add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for);
+  int count() const { return _num_ready + _num_waiting; }
+  int countBefore(uint32_t now) const;
+  bool hasReady(uint32_t now) const;
+  bool getNextTime(uint32_t now, uint32_t& scheduled_for) const;   // false if empty
+
+  // NOTE: indexes are only stable until next add/get/removeByIdx
+  mesh::Packet* itemAt(int i) const;
+  mesh::Packet* removeByIdx(int i);
+};
+
 class StaticPoolPacketManager : public mesh::PacketManager {
-  PacketQueue unused, send_queue, rx_queue;
+  mesh::Packet* _pool;        // contiguous, so packet index is just (packet - _pool)
+  mesh::Packet** _unused;     // ring of free packets, allocNew() takes from head, free() appends to tail
+  int _pool_size, _unused_head, _num_unused, _min_unused;
+#if MESH_DEBUG
+  uint8_t* _is_unused;        // per-packet flag, to catch double free()
+  uint32_t _double_frees;
+#endif
+  PacketScheduler send_queue, rx_queue;
 
 public:
   StaticPoolPacketManager(int pool_size);
@@ -29,10 +82,19 @@ public:
   void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
   mesh::Packet* getNextOutbound(uint32_t now) override;
   int getOutboundCount(uint32_t now) const override;
+  bool hasOutboundReady(uint32_t now) const override;
   int getOutboundTotal() const override;
   int getFreeCount() const override;
   mesh::Packet* getOutboundByIdx(int i) override;
   mesh::Packet* removeOutboundByIdx(int i) override;
   void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override;
   mesh::Packet* getNextInbound(uint32_t now) override;
-};
\ No newline at end of file
+  bool getNextOutboundTime(uint32_t now, uint32_t& scheduled_for) const override;
+  bool getNextInboundTime(uint32_t now, uint32_t& scheduled_for) const override;
+
+  int getMinFreeCount() const { return _min_unused; }   // low-water mark of unused pool
+  void resetMinFreeCount() { _min_unused = _num_unused; }
+#if MESH_DEBUG
+  uint32_t getNumDoubleFrees() const { return _double_frees; }
+#endif
+};
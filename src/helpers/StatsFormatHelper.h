@@ -52,4 +52,45 @@ public:
       driver.getPacketsRecvErrors()
     );
   }
+
+  /**
+   * \brief  with 'stage' < 0, a summary of p50/p90 (millis) per stage, for flood then direct. Otherwise the
+   *       bucket counts of one histogram (see LatencyStats::getHistogram()).
+  */
+  static void formatLatencyStats(char* reply, const mesh::LatencyStats& stats, int stage, int route, int pri_class) {
+    mesh::LatencyHistogram h, d;
+    if (stage < 0) {
+      static const char* names[LATENCY_NUM_STAGES] = { "rx", "queue", "cad", "air" };
+      char* dp = reply;
+      *dp++ = '{';
+      for (int s = 0; s < LATENCY_NUM_STAGES; s++) {
+        stats.getHistogram(h, s, LATENCY_ROUTE_FLOOD);
+        stats.getHistogram(d, s, LATENCY_ROUTE_DIRECT);
+        dp += sprintf(dp, "%s\"%s\":[%u,%u,%u,%u]", s > 0 ? "," : "", names[s],
+          h.getPercentile(50), h.getPercentile(90), d.getPercentile(50), d.getPercentile(90));
+      }
+      strcpy(dp, "}");
+    } else if (!stats.getHistogram(h, stage, route, pri_class)) {
+      strcpy(reply, "Error: unknown stage/route/priority");
+    } else {
+      char* dp = reply;
+      dp += sprintf(dp, "{\"n\":%u,\"buckets\":[", h.getTotal());
+      for (int i = 0; i < LATENCY_NUM_BUCKETS; i++) {
+        dp += sprintf(dp, "%s%u", i > 0 ? "," : "", (uint32_t) h.counts[i]);
+      }
+      strcpy(dp, "]}");
+    }
+  }
+
+  static void formatFloodStats(char* reply,
+                               uint32_t n_flood_dups,
+                               uint32_t n_relay_dups,
+                               uint32_t n_relays_cancelled) {
+    sprintf(reply,
+      "{\"flood_dups\":%u,\"relay_dups\":%u,\"relays_cancelled\":%u}",
+      n_flood_dups,
+      n_relay_dups,
+      n_relays_cancelled
+    );
+  }
 };
@@ -168,47 +168,69 @@ void ESPNowBridge::sendPacket(mesh::Packet *packet) {
   }
 
   if (!_seen_packets.hasSeen(packet)) {
-    // Create a temporary buffer just for size calculation and reuse for actual writing
-    uint8_t sizingBuffer[MAX_PAYLOAD_SIZE];
-    uint16_t meshPacketLen = packet->writeTo(sizingBuffer);
-
     // Check if packet fits within our maximum payload size
-    if (meshPacketLen > MAX_PAYLOAD_SIZE) {
-      BRIDGE_DEBUG_PRINTLN("TX packet too large (payload=%d, max=%d)\n", meshPacketLen,
+    if (packet->getRawLength() > MAX_PAYLOAD_SIZE) {
+      BRIDGE_DEBUG_PRINTLN("TX packet too large (payload=%d, max=%d)\n", packet->getRawLength(),
                            MAX_PAYLOAD_SIZE);
       return;
     }
 
+    // Write packet payload starting after magic header and checksum
     uint8_t buffer[MAX_ESPNOW_PACKET_SIZE];
+    sendFrame(buffer, packet->writeTo(buffer + BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE));
+  }
+}
 
-    // Write magic header (2 bytes)
-    buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF;
-    buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;
+void ESPNowBridge::sendEncodedPacket(mesh::Packet *packet, const uint8_t *raw, int len) {
+  // Guard against uninitialized state
+  if (_initialized == false) {
+    return;
+  }
 
-    // Write packet payload starting after magic header and checksum
-    const size_t packetOffset = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE;
-    memcpy(buffer + packetOffset, sizingBuffer, meshPacketLen);
+  // First validate the packet pointer
+  if (!packet) {
+    BRIDGE_DEBUG_PRINTLN("TX invalid packet pointer\n");
+    return;
+  }
 
-    // Calculate and add checksum (only of the payload)
-    uint16_t checksum = fletcher16(buffer + packetOffset, meshPacketLen);
-    buffer[2] = (checksum >> 8) & 0xFF; // High byte
-    buffer[3] = checksum & 0xFF;        // Low byte
+  if (!_seen_packets.hasSeen(packet)) {
+    // Check if packet fits within our maximum payload size
+    if (len > MAX_PAYLOAD_SIZE) {
+      BRIDGE_DEBUG_PRINTLN("TX packet too large (payload=%d, max=%d)\n", len, MAX_PAYLOAD_SIZE);
+      return;
+    }
 
-    // Encrypt payload and checksum (not including magic header)
-    xorCrypt(buffer + BRIDGE_MAGIC_SIZE, meshPacketLen + BRIDGE_CHECKSUM_SIZE);
+    uint8_t buffer[MAX_ESPNOW_PACKET_SIZE];
+    memcpy(buffer + BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE, raw, len);
+    sendFrame(buffer, len);
+  }
+}
 
-    // Total packet size: magic header + checksum + payload
-    const size_t totalPacketSize = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE + meshPacketLen;
+void ESPNowBridge::sendFrame(uint8_t *buffer, size_t meshPacketLen) {
+  // Write magic header (2 bytes)
+  buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF;
+  buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;
 
-    // Broadcast using ESP-NOW
-    uint8_t broadcastAddress[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
-    esp_err_t result = esp_now_send(broadcastAddress, buffer, totalPacketSize);
+  // Calculate and add checksum (only of the payload)
+  const size_t packetOffset = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE;
+  uint16_t checksum = fletcher16(buffer + packetOffset, meshPacketLen);
+  buffer[2] = (checksum >> 8) & 0xFF; // High byte
+  buffer[3] = checksum & 0xFF;        // Low byte
 
-    if (result == ESP_OK) {
-      BRIDGE_DEBUG_PRINTLN("TX, len=%d\n", meshPacketLen);
-    } else {
-      BRIDGE_DEBUG_PRINTLN("TX FAILED!\n");
-    }
+  // Encrypt payload and checksum (not including magic header)
+  xorCrypt(buffer + BRIDGE_MAGIC_SIZE, meshPacketLen + BRIDGE_CHECKSUM_SIZE);
+
+  // Total packet size: magic header + checksum + payload
+  const size_t totalPacketSize = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE + meshPacketLen;
+
+  // Broadcast using ESP-NOW
+  uint8_t broadcastAddress[] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+  esp_err_t result = esp_now_send(broadcastAddress, buffer, totalPacketSize);
+
+  if (result == ESP_OK) {
+    BRIDGE_DEBUG_PRINTLN("TX, len=%d\n", meshPacketLen);
+  } else {
+    BRIDGE_DEBUG_PRINTLN("TX FAILED!\n");
   }
 }
 
@@ -82,6 +82,15 @@ private:
    */
   void xorCrypt(uint8_t *data, size_t len);
 
+  /**
+   * Adds magic header and checksum around the mesh packet (already at offset 4), encrypts
+   * and broadcasts it
+   *
+   * @param buffer Frame buffer (MAX_ESPNOW_PACKET_SIZE)
+   * @param meshPacketLen Length of the mesh packet
+   */
+  void sendFrame(uint8_t *buffer, size_t meshPacketLen);
+
   /**
    * ESP-NOW receive callback
    * Called by ESP-NOW when a packet is received
@@ -152,6 +161,16 @@ public:
    * @param packet The mesh packet to transmit
    */
   void sendPacket(mesh::Packet *packet) override;
+
+  /**
+   * Called when a packet needs to be transmitted via ESP-NOW, and is already in wire format
+   * (eg. the packet just transmitted by the Dispatcher)
+   *
+   * @param packet The mesh packet to transmit
+   * @param raw The packet in wire format
+   * @param len Length of raw in bytes
+   */
+  void sendEncodedPacket(mesh::Packet *packet, const uint8_t *raw, int len) override;
 };
 
 #endif
@@ -116,32 +116,58 @@ void RS232Bridge::sendPacket(mesh::Packet *packet) {
   }
 
   if (!_seen_packets.hasSeen(packet)) {
+    // Check if packet fits within our maximum payload size
+    if (packet->getRawLength() > (MAX_TRANS_UNIT + 1)) {
+      BRIDGE_DEBUG_PRINTLN("TX packet too large (payload=%d, max=%d)\n", packet->getRawLength(), MAX_TRANS_UNIT + 1);
+      return;
+    }
 
     uint8_t buffer[MAX_SERIAL_PACKET_SIZE];
-    uint16_t len = packet->writeTo(buffer + 4);
+    sendFrame(buffer, packet->writeTo(buffer + 4));
+  }
+}
+
+void RS232Bridge::sendEncodedPacket(mesh::Packet *packet, const uint8_t *raw, int len) {
+  // Guard against uninitialized state
+  if (_initialized == false) {
+    return;
+  }
+
+  // First validate the packet pointer
+  if (!packet) {
+    BRIDGE_DEBUG_PRINTLN("TX invalid packet pointer\n");
+    return;
+  }
 
+  if (!_seen_packets.hasSeen(packet)) {
     // Check if packet fits within our maximum payload size
     if (len > (MAX_TRANS_UNIT + 1)) {
       BRIDGE_DEBUG_PRINTLN("TX packet too large (payload=%d, max=%d)\n", len, MAX_TRANS_UNIT + 1);
       return;
     }
 
-    // Build packet header
-    buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF; // Magic high byte
-    buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;        // Magic low byte
-    buffer[2] = (len >> 8) & 0xFF;                 // Length high byte
-    buffer[3] = len & 0xFF;                        // Length low byte
+    uint8_t buffer[MAX_SERIAL_PACKET_SIZE];
+    memcpy(buffer + 4, raw, len);
+    sendFrame(buffer, len);
+  }
+}
 
-    // Calculate checksum over the payload
-    uint16_t checksum = fletcher16(buffer + 4, len);
-    buffer[4 + len] = (checksum >> 8) & 0xFF; // Checksum high byte
-    buffer[5 + len] = checksum & 0xFF;        // Checksum low byte
+void RS232Bridge::sendFrame(uint8_t *buffer, uint16_t len) {
+  // Build packet header
+  buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF; // Magic high byte
+  buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;        // Magic low byte
+  buffer[2] = (len >> 8) & 0xFF;                 // Length high byte
+  buffer[3] = len & 0xFF;                        // Length low byte
 
-    // Send complete packet
-    _serial->write(buffer, len + SERIAL_OVERHEAD);
+  // Calculate checksum over the payload
+  uint16_t checksum = fletcher16(buffer + 4, len);
+  buffer[4 + len] = (checksum >> 8) & 0xFF; // Checksum high byte
+  buffer[5 + len] = checksum & 0xFF;        // Checksum low byte
 
-    BRIDGE_DEBUG_PRINTLN("TX, len=%d crc=0x%04x\n", len, checksum);
-  }
+  // Send complete packet
+  _serial->write(buffer, len + SERIAL_OVERHEAD);
+
+  BRIDGE_DEBUG_PRINTLN("TX, len=%d crc=0x%04x\n", len, checksum);
 }
 
 void RS232Bridge::onPacketReceived(mesh::Packet *packet) {
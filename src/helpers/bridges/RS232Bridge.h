@@ -99,6 +99,15 @@ public:
    */
   void sendPacket(mesh::Packet *packet) override;
 
+  /**
+   * @brief As sendPacket(), but framing the given (already encoded) wire bytes
+   *
+   * @param packet The mesh packet to transmit
+   * @param raw The packet in wire format
+   * @param len Length of raw in bytes
+   */
+  void sendEncodedPacket(mesh::Packet *packet, const uint8_t *raw, int len) override;
+
   /**
    * @brief Called when a complete valid packet has been received from serial
    *
@@ -138,6 +147,14 @@ private:
   /** Hardware serial port interface */
   Stream *_serial;
 
+  /**
+   * @brief Adds framing (magic, length, checksum) around the mesh packet at buffer+4, and writes it out
+   *
+   * @param buffer Frame buffer (MAX_SERIAL_PACKET_SIZE), with mesh packet already at offset 4
+   * @param len Length of the mesh packet
+   */
+  void sendFrame(uint8_t *buffer, uint16_t len);
+
   /** Buffer for building received packets */
   uint8_t _rx_buffer[MAX_SERIAL_PACKET_SIZE];
 
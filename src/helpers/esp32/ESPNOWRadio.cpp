@@ -99,6 +99,10 @@ bool ESPNOWRadio::isInRecvMode() const {
   return is_send_complete;    // if NO send in progress, then we're in Rx mode
 }
 
+bool ESPNOWRadio::needsPolling() {
+  return last_rx_len > 0 || !is_send_complete;   // no IRQ line, so poll until the callbacks have fired
+}
+
 float ESPNOWRadio::getLastRSSI() const { return 0; }
 float ESPNOWRadio::getLastSNR() const { return 0; }
 
@@ -112,6 +116,23 @@ int ESPNOWRadio::recvRaw(uint8_t* bytes, int sz) {
   return len;
 }
 
+int ESPNOWRadio::getRecvLength() {
+  return last_rx_len;
+}
+
+int ESPNOWRadio::recvPacket(mesh::Packet* pkt) {
+  int len = last_rx_len;
+  last_rx_len = 0;
+  if (pkt == NULL || len == 0) return 0;   // discarded
+
+  if (!pkt->readFrom(rx_buf, len)) {   // parse straight from rx_buf, no intermediate copy
+    n_recv_errors++;
+    return 0;
+  }
+  n_recv++;
+  return len;
+}
+
 uint32_t ESPNOWRadio::getEstAirtimeFor(int len_bytes) {
   return 4;  // Fast AF
 }
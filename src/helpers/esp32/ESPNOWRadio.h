@@ -18,11 +18,14 @@ public:
 
   void init();
   int recvRaw(uint8_t* bytes, int sz) override;
+  int getRecvLength() override;
+  int recvPacket(mesh::Packet* pkt) override;
   uint32_t getEstAirtimeFor(int len_bytes) override;
   bool startSendRaw(const uint8_t* bytes, int len) override;
   bool isSendComplete() override;
   void onSendFinished() override;
   bool isInRecvMode() const override;
+  bool needsPolling() override;
 
   uint32_t getPacketsRecv() const { return n_recv; }
   uint32_t getPacketsSent() const { return n_sent; }
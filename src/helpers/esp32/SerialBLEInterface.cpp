@@ -10,6 +10,9 @@
 
 #define ADVERT_RESTART_DELAY  1000   // millis
 
+#define BLE_BATCH_WRITE_INTERVALS   2    // when batching, space writes by this many connection intervals
+#define BLE_BATCH_WRITE_MIN_MILLIS  15
+
 void SerialBLEInterface::begin(const char* prefix, char* name, uint32_t pin_code) {
   _pin_code = pin_code;
 
@@ -26,7 +29,7 @@ void SerialBLEInterface::begin(const char* prefix, char* name, uint32_t pin_code
   // Create the BLE Device
   BLEDevice::init(dev_name);
   BLEDevice::setSecurityCallbacks(this);
-  BLEDevice::setMTU(MAX_FRAME_SIZE);
+  BLEDevice::setMTU(BLE_BATCH_MAX_SIZE + 3);
 
   BLESecurity  sec;
   sec.setStaticPIN(pin_code);
@@ -95,10 +98,15 @@ void SerialBLEInterface::onConnect(BLEServer* pServer) {
 void SerialBLEInterface::onConnect(BLEServer* pServer, esp_ble_gatts_cb_param_t *param) {
   BLE_DEBUG_PRINTLN("onConnect(), conn_id=%d, mtu=%d", param->connect.conn_id, pServer->getPeerMTU(param->connect.conn_id));
   last_conn_id = param->connect.conn_id;
+  _mtu = pServer->getPeerMTU(param->connect.conn_id);
+  _conn_interval = param->connect.conn_params.interval * 5 / 4;   // 1.25ms units
+  send_queue.setBatching(false);   // app must re-negotiate
+  memset(&_stats, 0, sizeof(_stats));
 }
 
 void SerialBLEInterface::onMtuChanged(BLEServer* pServer, esp_ble_gatts_cb_param_t* param) {
   BLE_DEBUG_PRINTLN("onMtuChanged(), mtu=%d", pServer->getPeerMTU(param->mtu.conn_id));
+  _mtu = param->mtu.mtu;
 }
 
 void SerialBLEInterface::onDisconnect(BLEServer* pServer) {
@@ -124,6 +132,8 @@ void SerialBLEInterface::onWrite(BLECharacteristic* pCharacteristic, esp_ble_gat
     recv_queue[recv_queue_len].len = len;
     memcpy(recv_queue[recv_queue_len].buf, rxValue, len);
     recv_queue_len++;
+    _stats.frames_recv++;
+    _stats.bytes_recv += len;
   }
 }
 
@@ -166,15 +176,10 @@ size_t SerialBLEInterface::writeFrame(const uint8_t src[], size_t len) {
   }
 
   if (deviceConnected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
+    if (!send_queue.push(src, len)) {
       BLE_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
       return 0;
     }
-
-    send_queue[send_queue_len].len = len;  // add to send queue
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
-
     return len;
   }
   return 0;
@@ -182,23 +187,38 @@ size_t SerialBLEInterface::writeFrame(const uint8_t src[], size_t len) {
 
 #define  BLE_WRITE_MIN_INTERVAL   60
 
+unsigned long SerialBLEInterface::getWriteInterval() const {
+  if (!send_queue.isBatching() || _conn_interval == 0) return BLE_WRITE_MIN_INTERVAL;
+
+  unsigned long interval = _conn_interval * BLE_BATCH_WRITE_INTERVALS;   // pace to the connection events
+  if (interval < BLE_BATCH_WRITE_MIN_MILLIS) return BLE_BATCH_WRITE_MIN_MILLIS;
+  return interval > BLE_WRITE_MIN_INTERVAL ? BLE_WRITE_MIN_INTERVAL : interval;
+}
+
 bool SerialBLEInterface::isWriteBusy() const {
+  if (send_queue.isBatching()) {
+    return send_queue.size() >= (FRAME_QUEUE_SIZE * 2 / 3);   // frames get packed together, so keep queue topped up
+  }
   return millis() < _last_write + BLE_WRITE_MIN_INTERVAL;   // still too soon to start another write?
 }
 
 size_t SerialBLEInterface::checkRecvFrame(uint8_t dest[]) {
-  if (send_queue_len > 0   // first, check send queue
-    && millis() >= _last_write + BLE_WRITE_MIN_INTERVAL    // space the writes apart
+  if (!send_queue.isEmpty()   // first, check send queue
+    && millis() >= _last_write + getWriteInterval()    // space the writes apart
   ) {
     _last_write = millis();
-    pTxCharacteristic->setValue(send_queue[0].buf, send_queue[0].len);
-    pTxCharacteristic->notify();
-
-    BLE_DEBUG_PRINTLN("writeBytes: sz=%d, hdr=%d", (uint32_t)send_queue[0].len, (uint32_t) send_queue[0].buf[0]);
-
-    send_queue_len--;
-    for (int i = 0; i < send_queue_len; i++) {   // delete top item from queue
-      send_queue[i] = send_queue[i + 1];
+    int len, num_frames;
+    const uint8_t* data = send_queue.nextWrite(_mtu - 3, len, num_frames);   // minus ATT header
+    if (data) {
+      pTxCharacteristic->setValue((uint8_t *) data, len);
+      pTxCharacteristic->notify();
+      _stats.writes++;
+      _stats.frames_sent += num_frames;
+      _stats.bytes_sent += len;
+
+      BLE_DEBUG_PRINTLN("writeBytes: sz=%d, hdr=%d, frames=%d", len, (uint32_t) data[0], num_frames);
+
+      send_queue.pop(num_frames);   // delete sent items from queue
     }
   }
 
@@ -251,3 +271,18 @@ size_t SerialBLEInterface::checkRecvFrame(uint8_t dest[]) {
 bool SerialBLEInterface::isConnected() const {
   return deviceConnected;  //pServer != NULL && pServer->getConnectedCount() > 0;
 }
+
+bool SerialBLEInterface::supportsFrameBatching() const {
+  return deviceConnected && _mtu - 3 >= MAX_FRAME_SIZE + 1;   // any frame must fit in one notify
+}
+
+void SerialBLEInterface::setFrameBatching(bool enable) {
+  send_queue.setBatching(enable);
+}
+
+bool SerialBLEInterface::getLinkStats(SerialLinkStats& stats) const {
+  stats = _stats;
+  stats.mtu = deviceConnected ? _mtu : 0;
+  stats.interval_millis = deviceConnected ? _conn_interval : 0;
+  return true;
+}
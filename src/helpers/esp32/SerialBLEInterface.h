@@ -1,11 +1,16 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FrameBatcher.h"
 #include <BLEDevice.h>
 #include <BLEServer.h>
 #include <BLEUtils.h>
 #include <BLE2902.h>
 
+#ifndef BLE_BATCH_MAX_SIZE
+  #define BLE_BATCH_MAX_SIZE  244   // max notify payload (ATT MTU 247)
+#endif
+
 class SerialBLEInterface : public BaseSerialInterface, BLESecurityCallbacks, BLEServerCallbacks, BLECharacteristicCallbacks {
   BLEServer *pServer;
   BLEService *pService;
@@ -17,19 +22,22 @@ class SerialBLEInterface : public BaseSerialInterface, BLESecurityCallbacks, BLE
   uint32_t _pin_code;
   unsigned long _last_write;
   unsigned long adv_restart_time;
+  uint16_t _mtu;
+  uint16_t _conn_interval;   // in millis
+  SerialLinkStats _stats;
 
   struct Frame {
     uint8_t len;
     uint8_t buf[MAX_FRAME_SIZE];
   };
 
-  #define FRAME_QUEUE_SIZE  4
+  #define FRAME_QUEUE_SIZE  8
   int recv_queue_len;
   Frame recv_queue[FRAME_QUEUE_SIZE];
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
+  FrameBatcher send_queue;
 
-  void clearBuffers() { recv_queue_len = 0; send_queue_len = 0; }
+  void clearBuffers() { recv_queue_len = 0; send_queue.clear(); }
+  unsigned long getWriteInterval() const;
 
 protected:
   // BLESecurityCallbacks methods
@@ -49,7 +57,7 @@ protected:
   void onWrite(BLECharacteristic* pCharacteristic, esp_ble_gatts_cb_param_t* param) override;
 
 public:
-  SerialBLEInterface() {
+  SerialBLEInterface() : send_queue(FRAME_QUEUE_SIZE, BLE_BATCH_MAX_SIZE) {
     pServer = NULL;
     pService = NULL;
     deviceConnected = false;
@@ -58,7 +66,10 @@ public:
     _isEnabled = false;
     _last_write = 0;
     last_conn_id = 0;
-    send_queue_len = recv_queue_len = 0;
+    recv_queue_len = 0;
+    _mtu = 23;
+    _conn_interval = 0;
+    memset(&_stats, 0, sizeof(_stats));
   }
 
   /**
@@ -79,6 +90,9 @@ public:
   bool isWriteBusy() const override;
   size_t writeFrame(const uint8_t src[], size_t len) override;
   size_t checkRecvFrame(uint8_t dest[]) override;
+  bool supportsFrameBatching() const override;
+  void setFrameBatching(bool enable) override;
+  bool getLinkStats(SerialLinkStats& stats) const override;
 };
 
 #if BLE_DEBUG_LOGGING && ARDUINO
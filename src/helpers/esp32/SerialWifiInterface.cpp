@@ -1,5 +1,24 @@
 #include "SerialWifiInterface.h"
 #include <WiFi.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+
+int SerialWifiInterface::ClientConn::write(const uint8_t* src, int len) {
+  // NOTE: WiFiClient::write() blocks (for up to its timeout) until the whole buffer is sent, which would
+  //   stall the main loop behind one slow client. FrameMux retries whatever isn't taken here.
+  int fd = client.fd();
+  if (fd < 0) return 0;
+
+  int n = send(fd, src, len, MSG_DONTWAIT);
+  if (n < 0) {
+    if (errno != EAGAIN && errno != EWOULDBLOCK) {
+      WIFI_DEBUG_PRINTLN("ClientConn::write(), send error: %d", errno);
+      client.stop();   // connected() is now false, so gets dropped
+    }
+    return 0;
+  }
+  return n;
+}
 
 void SerialWifiInterface::begin(int port) {
   // wifi setup is handled outside of this class, only starts the server
@@ -11,7 +30,6 @@ void SerialWifiInterface::enable() {
   if (_isEnabled) return;
 
   _isEnabled = true;
-  clearBuffers();
 }
 
 void SerialWifiInterface::disable() {
@@ -24,149 +42,57 @@ size_t SerialWifiInterface::writeFrame(const uint8_t src[], size_t len) {
     return 0;
   }
 
-  if (deviceConnected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
-      WIFI_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
-      return 0;
-    }
-
-    send_queue[send_queue_len].len = len;  // add to send queue
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
-
-    return len;
+  // push codes (0x80+) go to all clients, replies just to the client which sent the last command
+  size_t n = mux.writeFrame(src, len, len > 0 && src[0] >= 0x80);
+  if (n == 0 && len > 0 && deviceConnected) {
+    WIFI_DEBUG_PRINTLN("writeFrame(), send buffer is full!");
   }
-  return 0;
+  return n;
 }
 
 bool SerialWifiInterface::isWriteBusy() const {
-  return false;
-}
-
-bool SerialWifiInterface::hasReceivedFrameHeader() {
-  return received_frame_header.type != 0 && received_frame_header.length != 0;
-}
-
-void SerialWifiInterface::resetReceivedFrameHeader() {
-  received_frame_header.type = 0;
-  received_frame_header.length = 0;
+  return mux.isWriteBusy();
 }
 
 size_t SerialWifiInterface::checkRecvFrame(uint8_t dest[]) {
   // check if new client connected
   auto newClient = server.available();
   if (newClient) {
-
-    // disconnect existing client
-    deviceConnected = false;
-    client.stop();
-
-    // switch active connection to new client
-    client = newClient;
-
-    // forget received frame header
-    resetReceivedFrameHeader();
-    
-  }
-
-  if (client.connected()) {
-    if (!deviceConnected) {
-      WIFI_DEBUG_PRINTLN("Got connection");
-      deviceConnected = true;
-    }
-  } else {
-    if (deviceConnected) {
-      deviceConnected = false;
-      WIFI_DEBUG_PRINTLN("Disconnected");
-    }
+    int idx = mux.getSlotForNewClient();   // if all in use, disconnects least recently active
+    mux.detach(idx);
+    clients[idx].client = newClient;
+    mux.attach(idx, &clients[idx], millis());
+    WIFI_DEBUG_PRINTLN("Got connection, slot=%d", idx);
   }
 
-  if (deviceConnected) {
-    if (send_queue_len > 0) {   // first, check send queue
-      
-      _last_write = millis();
-      int len = send_queue[0].len;
+  size_t len = mux.loop(dest, millis());
 
-      uint8_t pkt[3+len]; // use same header as serial interface so client can delimit frames
-      pkt[0] = '>';
-      pkt[1] = (len & 0xFF);  // LSB
-      pkt[2] = (len >> 8);    // MSB
-      memcpy(&pkt[3], send_queue[0].buf, send_queue[0].len);
-      client.write(pkt, 3 + len);
-      send_queue_len--;
-      for (int i = 0; i < send_queue_len; i++) {   // delete top item from queue
-        send_queue[i] = send_queue[i + 1];
-      }
+  bool connected = mux.getNumClients() > 0;
+  if (connected != deviceConnected) {
+    deviceConnected = connected;
+    if (connected) {
+      WIFI_DEBUG_PRINTLN("Connected");
     } else {
-
-      // check if we are waiting for a frame header
-      if(!hasReceivedFrameHeader()){
-
-        // make sure we have received enough bytes for a frame header
-        // 3 bytes frame header = (1 byte frame type) + (2 bytes frame length as unsigned 16-bit little endian)
-        int frame_header_length = 3;
-        if(client.available() >= frame_header_length){
-
-          // read frame header
-          client.readBytes(&received_frame_header.type, 1);
-          client.readBytes((uint8_t*)&received_frame_header.length, 2);
-
-        }
-
-      }
-
-      // check if we have received a frame header
-      if(hasReceivedFrameHeader()){
-
-        // make sure we have received enough bytes for the required frame length
-        int available = client.available();
-        int frame_type = received_frame_header.type;
-        int frame_length = received_frame_header.length;
-        if(frame_length > available){
-          WIFI_DEBUG_PRINTLN("Waiting for %d more bytes", frame_length - available);
-          return 0;
-        }
-
-        // skip frames that are larger than MAX_FRAME_SIZE
-        if(frame_length > MAX_FRAME_SIZE){
-          WIFI_DEBUG_PRINTLN("Skipping frame: length=%d is larger than MAX_FRAME_SIZE=%d", frame_length, MAX_FRAME_SIZE);
-          while(frame_length > 0){
-            uint8_t skip[1];
-            int skipped = client.read(skip, 1);
-            frame_length -= skipped;
-          }
-          resetReceivedFrameHeader();
-          return 0;
-        }
-
-        // skip frames that are not expected type
-        // '<' is 0x3c which indicates a frame sent from app to radio
-        if(frame_type != '<'){
-          WIFI_DEBUG_PRINTLN("Skipping frame: type=0x%x is unexpected", frame_type);
-          while(frame_length > 0){
-            uint8_t skip[1];
-            int skipped = client.read(skip, 1);
-            frame_length -= skipped;
-          }
-          resetReceivedFrameHeader();
-          return 0;
-        }
-
-        // read frame data to provided buffer
-        client.readBytes(dest, frame_length);
-
-        // ready for next frame
-        resetReceivedFrameHeader();
-        return frame_length;
-
-      }
-      
+      WIFI_DEBUG_PRINTLN("Disconnected");
     }
   }
-
-  return 0;
+  return len;
 }
 
 bool SerialWifiInterface::isConnected() const {
   return deviceConnected;  //pServer != NULL && pServer->getConnectedCount() > 0;
-}
\ No newline at end of file
+}
+
+bool SerialWifiInterface::getLinkStats(SerialLinkStats& stats) const {
+  FrameMuxClientStats total;
+  mux.getTotalStats(total);
+  stats.frames_sent = total.frames_sent;
+  stats.frames_recv = total.frames_recv;
+  stats.bytes_sent = total.bytes_sent;
+  stats.bytes_recv = total.bytes_recv;
+  stats.writes = total.writes;
+  stats.write_retries = total.stalls;
+  stats.mtu = 0;
+  stats.interval_millis = 0;
+  return true;
+}
@@ -1,47 +1,41 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FrameMux.h"
 #include <WiFi.h>
 
-class SerialWifiInterface : public BaseSerialInterface {
-  bool deviceConnected;
-  bool _isEnabled;
-  unsigned long _last_write;
-  unsigned long adv_restart_time;
-
-  WiFiServer server;
-  WiFiClient client;
+#ifndef WIFI_MAX_CLIENTS
+  #define WIFI_MAX_CLIENTS  1    // eg. 4 for gateways: app + logger + bridge script
+#endif
 
-  struct FrameHeader {
-    uint8_t type;
-    uint16_t length;
-  };
+#ifndef WIFI_WRITE_CHUNK
+  #define WIFI_WRITE_CHUNK  1436   // max bytes per socket write (one TCP segment)
+#endif
 
-  struct Frame {
-    uint8_t len;
-    uint8_t buf[MAX_FRAME_SIZE];
+class SerialWifiInterface : public BaseSerialInterface {
+  class ClientConn : public FrameMuxConn {
+  public:
+    WiFiClient client;
+
+    bool connected() override { return client.connected(); }
+    int available() override { return client.available(); }
+    int read(uint8_t* dest, int len) override { return client.read(dest, len); }
+    int availableForWrite() override { return WIFI_WRITE_CHUNK; }   // write() returns what the socket actually took
+    int write(const uint8_t* src, int len) override;   // never blocks, returns 0 if socket send buffer is full
+    void stop() override { client.stop(); }
   };
 
-  FrameHeader received_frame_header;
-
-  #define FRAME_QUEUE_SIZE  4
-  int recv_queue_len;
-  Frame recv_queue[FRAME_QUEUE_SIZE];
-  int send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
-
-  void clearBuffers() { recv_queue_len = 0; send_queue_len = 0; }
+  bool deviceConnected;
+  bool _isEnabled;
 
-protected:
+  WiFiServer server;
+  ClientConn clients[WIFI_MAX_CLIENTS];
+  FrameMux mux;
 
 public:
-  SerialWifiInterface() : server(WiFiServer()), client(WiFiClient()) {
+  SerialWifiInterface() : server(WiFiServer()), mux(WIFI_MAX_CLIENTS) {
     deviceConnected = false;
     _isEnabled = false;
-    _last_write = 0;
-    send_queue_len = recv_queue_len = 0;
-    received_frame_header.type = 0;
-    received_frame_header.length = 0;
   }
 
   void begin(int port);
@@ -56,9 +50,10 @@ public:
 
   size_t writeFrame(const uint8_t src[], size_t len) override;
   size_t checkRecvFrame(uint8_t dest[]) override;
+  bool getLinkStats(SerialLinkStats& stats) const override;
 
-  bool hasReceivedFrameHeader();
-  void resetReceivedFrameHeader();
+  int getNumClients() const { return mux.getNumClients(); }
+  bool getClientStats(int idx, FrameMuxClientStats& stats) const { return mux.getClientStats(idx, stats); }
 };
 
 #if WIFI_DEBUG_LOGGING && ARDUINO
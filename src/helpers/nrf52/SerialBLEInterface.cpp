@@ -7,6 +7,8 @@
 // Magic numbers came from actual testing
 #define BLE_HEALTH_CHECK_INTERVAL  10000  // Advertising watchdog check every 10 seconds
 #define BLE_RETRY_THROTTLE_MS      250    // Throttle retries to 250ms when queue buildup detected
+#define BLE_BATCH_RETRY_INTERVALS  2      // when batching, retry after this many connection intervals
+#define BLE_BATCH_RETRY_MIN_MS     15
 
 // Connection parameters (units: interval=1.25ms, timeout=10ms)
 #define BLE_MIN_CONN_INTERVAL      12     // 15ms
@@ -29,7 +31,8 @@ void SerialBLEInterface::onConnect(uint16_t connection_handle) {
   if (instance) {
     instance->_conn_handle = connection_handle;
     instance->_isDeviceConnected = false;
-    instance->clearBuffers();
+    instance->clearBuffers();   // also turns batching off, app must re-negotiate
+    memset(&instance->_stats, 0, sizeof(instance->_stats));
   }
 }
 
@@ -202,19 +205,21 @@ void SerialBLEInterface::begin(const char* prefix, char* name, uint32_t pin_code
 }
 
 void SerialBLEInterface::clearBuffers() {
-  send_queue_len = 0;
+  send_queue.clear();
   recv_queue_len = 0;
   _last_retry_attempt = 0;
   bleuart.flush();
 }
 
-void SerialBLEInterface::shiftSendQueueLeft() {
-  if (send_queue_len > 0) {
-    send_queue_len--;
-    for (uint8_t i = 0; i < send_queue_len; i++) {
-      send_queue[i] = send_queue[i + 1];
-    }
-  }
+uint16_t SerialBLEInterface::getNotifyPayloadSize() const {
+  BLEConnection* conn = Bluefruit.Connection(_conn_handle);
+  uint16_t mtu = conn ? conn->getMtu() : BLE_GATT_ATT_MTU_DEFAULT;
+  return mtu - 3;   // minus ATT header
+}
+
+uint16_t SerialBLEInterface::getConnIntervalMillis() const {
+  BLEConnection* conn = Bluefruit.Connection(_conn_handle);
+  return conn ? conn->getConnectionInterval() * 5 / 4 : 0;   // 1.25ms units
 }
 
 void SerialBLEInterface::shiftRecvQueueLeft() {
@@ -281,49 +286,53 @@ size_t SerialBLEInterface::writeFrame(const uint8_t src[], size_t len) {
 
   bool connected = isConnected();
   if (connected && len > 0) {
-    if (send_queue_len >= FRAME_QUEUE_SIZE) {
+    if (!send_queue.push(src, len)) {
       BLE_DEBUG_PRINTLN("writeFrame(), send_queue is full!");
       return 0;
     }
-
-    send_queue[send_queue_len].len = len;
-    memcpy(send_queue[send_queue_len].buf, src, len);
-    send_queue_len++;
-    
     return len;
   }
   return 0;
 }
 
 size_t SerialBLEInterface::checkRecvFrame(uint8_t dest[]) {
-  if (send_queue_len > 0) {
+  if (!send_queue.isEmpty()) {
     if (!isConnected()) {
       BLE_DEBUG_PRINTLN("writeBytes: connection invalid, clearing send queue");
-      send_queue_len = 0;
+      send_queue.pop(send_queue.size());
     } else {
       unsigned long now = millis();
-      bool throttle_active = (_last_retry_attempt > 0 && (now - _last_retry_attempt) < BLE_RETRY_THROTTLE_MS);
-
-      if (!throttle_active) {
-        Frame frame_to_send = send_queue[0];
-
-        size_t written = bleuart.write(frame_to_send.buf, frame_to_send.len);
-        if (written == frame_to_send.len) {
-          BLE_DEBUG_PRINTLN("writeBytes: sz=%u, hdr=%u", (unsigned)frame_to_send.len, (unsigned)frame_to_send.buf[0]);
+      unsigned long throttle_ms = BLE_RETRY_THROTTLE_MS;
+      if (send_queue.isBatching()) {   // just wait for the next couple of connection events
+        throttle_ms = getConnIntervalMillis() * BLE_BATCH_RETRY_INTERVALS;
+        if (throttle_ms < BLE_BATCH_RETRY_MIN_MS) throttle_ms = BLE_BATCH_RETRY_MIN_MS;
+      }
+      bool throttle_active = (_last_retry_attempt > 0 && (now - _last_retry_attempt) < throttle_ms);
+
+      int len, num_frames;
+      const uint8_t* data = throttle_active ? NULL : send_queue.nextWrite(getNotifyPayloadSize(), len, num_frames);
+      if (data) {
+        size_t written = bleuart.write(data, len);
+        if (written == (size_t) len) {
+          BLE_DEBUG_PRINTLN("writeBytes: sz=%u, hdr=%u, frames=%d", (unsigned)len, (unsigned)data[0], num_frames);
           _last_retry_attempt = 0;
-          shiftSendQueueLeft();
+          _stats.writes++;
+          _stats.frames_sent += num_frames;
+          _stats.bytes_sent += len;
+          send_queue.pop(num_frames);
         } else if (written > 0) {
-          BLE_DEBUG_PRINTLN("writeBytes: partial write, sent=%u of %u, dropping corrupted frame", (unsigned)written, (unsigned)frame_to_send.len);
+          BLE_DEBUG_PRINTLN("writeBytes: partial write, sent=%u of %u, dropping corrupted frame", (unsigned)written, (unsigned)len);
           _last_retry_attempt = 0;
-          shiftSendQueueLeft();
+          send_queue.pop(num_frames);
         } else {
           if (!isConnected()) {
             BLE_DEBUG_PRINTLN("writeBytes failed: connection lost, dropping frame");
             _last_retry_attempt = 0;
-            shiftSendQueueLeft();
+            send_queue.pop(num_frames);
           } else {
             BLE_DEBUG_PRINTLN("writeBytes failed (buffer full), keeping frame for retry");
             _last_retry_attempt = now;
+            _stats.write_retries++;
           }
         }
       }
@@ -394,6 +403,8 @@ void SerialBLEInterface::onBleUartRX(uint16_t conn_handle) {
     instance->recv_queue[instance->recv_queue_len].len = read_len;
     instance->bleuart.readBytes(instance->recv_queue[instance->recv_queue_len].buf, read_len);
     instance->recv_queue_len++;
+    instance->_stats.frames_recv++;
+    instance->_stats.bytes_recv += read_len;
   }
 }
 
@@ -402,5 +413,20 @@ bool SerialBLEInterface::isConnected() const {
 }
 
 bool SerialBLEInterface::isWriteBusy() const {
-  return send_queue_len >= (FRAME_QUEUE_SIZE * 2 / 3);
+  return send_queue.size() >= (FRAME_QUEUE_SIZE * 2 / 3);
+}
+
+bool SerialBLEInterface::supportsFrameBatching() const {
+  return isConnected() && getNotifyPayloadSize() >= MAX_FRAME_SIZE + 1;   // any frame must fit in one notify
+}
+
+void SerialBLEInterface::setFrameBatching(bool enable) {
+  send_queue.setBatching(enable);
+}
+
+bool SerialBLEInterface::getLinkStats(SerialLinkStats& stats) const {
+  stats = _stats;
+  stats.mtu = isConnected() ? getNotifyPayloadSize() + 3 : 0;
+  stats.interval_millis = isConnected() ? getConnIntervalMillis() : 0;
+  return true;
 }
@@ -1,12 +1,17 @@
 #pragma once
 
 #include "../BaseSerialInterface.h"
+#include "../FrameBatcher.h"
 #include <bluefruit.h>
 
 #ifndef BLE_TX_POWER
 #define BLE_TX_POWER 4
 #endif
 
+#ifndef BLE_BATCH_MAX_SIZE
+#define BLE_BATCH_MAX_SIZE 244   // max notify payload, with BANDWIDTH_MAX (ATT MTU 247)
+#endif
+
 class SerialBLEInterface : public BaseSerialInterface {
   BLEDfu bledfu;
   BLEUart bleuart;
@@ -23,14 +28,16 @@ class SerialBLEInterface : public BaseSerialInterface {
 
   #define FRAME_QUEUE_SIZE  12
   
-  uint8_t send_queue_len;
-  Frame send_queue[FRAME_QUEUE_SIZE];
+  FrameBatcher send_queue;
   
   uint8_t recv_queue_len;
   Frame recv_queue[FRAME_QUEUE_SIZE];
 
+  SerialLinkStats _stats;
+
   void clearBuffers();
-  void shiftSendQueueLeft();
+  uint16_t getNotifyPayloadSize() const;
+  uint16_t getConnIntervalMillis() const;
   void shiftRecvQueueLeft();
   bool isValidConnection(uint16_t handle, bool requireWaitingForSecurity = false) const;
   bool isAdvertising() const;
@@ -43,14 +50,14 @@ class SerialBLEInterface : public BaseSerialInterface {
   static void onBleUartRX(uint16_t conn_handle);
 
 public:
-  SerialBLEInterface() {
+  SerialBLEInterface() : send_queue(FRAME_QUEUE_SIZE, BLE_BATCH_MAX_SIZE) {
     _isEnabled = false;
     _isDeviceConnected = false;
     _conn_handle = BLE_CONN_HANDLE_INVALID;
     _last_health_check = 0;
     _last_retry_attempt = 0;
-    send_queue_len = 0;
     recv_queue_len = 0;
+    memset(&_stats, 0, sizeof(_stats));
   }
 
   /**
@@ -69,6 +76,9 @@ public:
   bool isWriteBusy() const override;
   size_t writeFrame(const uint8_t src[], size_t len) override;
   size_t checkRecvFrame(uint8_t dest[]) override;
+  bool supportsFrameBatching() const override;
+  void setFrameBatching(bool enable) override;
+  bool getLinkStats(SerialLinkStats& stats) const override;
 };
 
 #if BLE_DEBUG_LOGGING && ARDUINO
@@ -103,6 +103,12 @@ void RadioLibWrapper::loop() {
   }
 }
 
+bool RadioLibWrapper::needsPolling() {
+  if (state & STATE_INT_READY) return true;   // packet received (or sent), not yet handled
+  if (state == STATE_IDLE) return true;       // startReceive() still needed
+  return _num_floor_samples < NUM_NOISE_FLOOR_SAMPLES || _floor_sample_sum != 0;   // noise floor sampling in progress
+}
+
 void RadioLibWrapper::startRecv() {
   int err = _radio->startReceive();
   if (err == RADIOLIB_ERR_NONE) {
@@ -52,6 +52,7 @@ public:
   void resetAGC() override;
 
   void loop() override;
+  bool needsPolling() override;
 
   uint32_t getPacketsRecv() const { return n_recv; }
   uint32_t getPacketsRecvErrors() const { return n_recv_errors; }
@@ -2,12 +2,18 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <string.h>
 
 // Mock AES128 class for testing
-// Provides minimal interface to allow Utils.cpp to compile
+// Provides minimal interface to allow Utils.cpp to compile.
+// NOTE: not real AES! just XORs with the key, so that decryptBlock() reverses encryptBlock()
 class AES128 {
+  uint8_t _key[16];
 public:
-  void setKey(const uint8_t* key, size_t keySize) {}
-  void encryptBlock(uint8_t* output, const uint8_t* input) {}
-  void decryptBlock(uint8_t* output, const uint8_t* input) {}
+  AES128() { memset(_key, 0, sizeof(_key)); }
+  void setKey(const uint8_t* key, size_t keySize) { memcpy(_key, key, keySize < 16 ? keySize : 16); }
+  void encryptBlock(uint8_t* output, const uint8_t* input) {
+    for (int i = 0; i < 16; i++) output[i] = input[i] ^ _key[i];
+  }
+  void decryptBlock(uint8_t* output, const uint8_t* input) { encryptBlock(output, input); }
 };
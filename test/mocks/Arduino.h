@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+// Mock Arduino.h for native tests of the file backed helpers, only provides what they use.
+// Tests can move the clock forward with: mockMillis() += ...
+
+inline unsigned long& mockMillis() {
+    static unsigned long now = 0;
+    return now;
+}
+
+inline unsigned long millis() { return mockMillis(); }
+
+inline char* ltoa(long value, char* dest, int base) {
+    char tmp[34];
+    int i = 0;
+    unsigned long v = value < 0 && base == 10 ? -value : value;
+    do {
+        int d = v % base;
+        tmp[i++] = d < 10 ? '0' + d : 'a' + d - 10;
+        v /= base;
+    } while (v > 0);
+    char* dp = dest;
+    if (value < 0 && base == 10) *dp++ = '-';
+    while (i > 0) *dp++ = tmp[--i];
+    *dp = 0;
+    return dest;
+}
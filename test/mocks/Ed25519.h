@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <ed_25519.h>
+
+// Mock Ed25519 class (of the Crypto lib) for native builds
+// Just forwards to the bundled lib/ed25519 impl.
+class Ed25519 {
+public:
+  static bool verify(const uint8_t* signature, const uint8_t* publicKey, const void* message, size_t len) {
+    return ed25519_verify(signature, (const unsigned char *) message, len, publicKey) != 0;
+  }
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+// In-memory mock of the Arduino ESP32/RP2040 'fs::FS' API, for native tests of the file backed helpers.
+// Tests select this API by defining RP2040_PLATFORM before including the helper's header (and source).
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "Stream.h"
+
+namespace fs {
+
+struct FSInfo {
+  size_t totalBytes;
+  size_t usedBytes;
+};
+
+class FS;
+
+class File : public Stream {
+  FS* _fs;
+  std::string _path;
+  size_t _pos;
+  bool _append;
+  bool _is_dir;
+  std::string _last_child;   // dir iteration
+
+  std::vector<uint8_t>* data() const;
+
+public:
+  File() : _fs(NULL), _pos(0), _append(false), _is_dir(false) { }
+  File(FS* fs, const std::string& path, bool append, bool is_dir = false)
+    : _fs(fs), _path(path), _pos(0), _append(append), _is_dir(is_dir) { }
+
+  operator bool() const { return _fs != NULL && (_is_dir || data() != NULL); }
+
+  size_t read(uint8_t* dest, size_t len);
+  int read() { uint8_t c; return read(&c, 1) == 1 ? c : -1; }
+  size_t readBytes(uint8_t* dest, size_t len) override { return read(dest, len); }
+  size_t write(const uint8_t* src, size_t len) override;
+  size_t write(uint8_t c) { return write(&c, 1); }
+  bool seek(uint32_t pos) { _pos = pos; return pos <= size(); }
+  size_t position() const { return _pos; }
+  size_t size() const { return *this && !_is_dir ? data()->size() : 0; }
+  int available() const { return size() > _pos ? size() - _pos : 0; }
+  void flush() { }
+  void close() { _fs = NULL; }
+  bool isDirectory() const { return _is_dir; }
+  const char* name() const { return _path.c_str(); }
+  File openNextFile();
+};
+
+class FS {
+public:
+  std::map<std::string, std::vector<uint8_t> > files;
+  size_t capacity;        // total bytes, writes beyond this are short (ie. FS full)
+  int num_writes;         // File::write() calls, for tests to check how much flash activity there was
+
+  FS() : capacity(1024*1024), num_writes(0) { }
+
+  size_t usedBytes() const {
+    size_t n = 0;
+    for (auto& f : files) n += f.second.size();
+    return n;
+  }
+  size_t totalBytes() const { return capacity; }
+  bool info(FSInfo& info) const { info.totalBytes = capacity; info.usedBytes = usedBytes(); return true; }
+
+  // dirs are implicit, ie. exist while there are files with the "<dir>/" prefix
+  bool isDir(const char* path) const {
+    std::string prefix = std::string(path) + "/";
+    auto it = files.lower_bound(prefix);
+    return it != files.end() && it->first.compare(0, prefix.size(), prefix) == 0;
+  }
+
+  File open(const char* path, const char* mode = "r", bool create = false) {
+    auto it = files.find(path);
+    if (mode[0] == 'r') {
+      if (it == files.end()) return isDir(path) ? File(this, path, false, true) : File();
+    } else if (mode[0] == 'w') {
+      files[path].clear();
+    } else {   // "a"
+      files[path];
+    }
+    File f(this, path, mode[0] == 'a');
+    if (mode[0] == 'a') f.seek(files[path].size());
+    return f;
+  }
+  bool exists(const char* path) const { return files.count(path) > 0 || isDir(path); }
+  bool remove(const char* path) { return files.erase(path) > 0; }
+  bool rename(const char* from, const char* to) {
+    auto it = files.find(from);
+    if (it == files.end()) return false;
+    std::vector<uint8_t> tmp = it->second;
+    files.erase(it);
+    files[to] = tmp;
+    return true;
+  }
+  bool mkdir(const char* path) { return true; }
+  bool rmdir(const char* path) { return !isDir(path); }
+  bool format() { files.clear(); return true; }
+};
+
+inline std::vector<uint8_t>* File::data() const {
+  auto it = _fs->files.find(_path);
+  return it == _fs->files.end() ? NULL : &it->second;
+}
+
+inline File File::openNextFile() {
+  if (!_is_dir) return File();
+  std::string prefix = _path + "/";
+  auto it = _last_child.empty() ? _fs->files.lower_bound(prefix) : _fs->files.upper_bound(_last_child);
+  if (it == _fs->files.end() || it->first.compare(0, prefix.size(), prefix) != 0) return File();
+  _last_child = it->first;
+  return File(_fs, it->first, false);
+}
+
+inline size_t File::read(uint8_t* dest, size_t len) {
+  if (!*this) return 0;
+  std::vector<uint8_t>& d = *data();
+  if (_pos >= d.size()) return 0;
+  if (len > d.size() - _pos) len = d.size() - _pos;
+  memcpy(dest, &d[_pos], len);
+  _pos += len;
+  return len;
+}
+
+inline size_t File::write(const uint8_t* src, size_t len) {
+  if (!*this) return 0;
+  std::vector<uint8_t>& d = *data();
+  if (_append) _pos = d.size();
+  _fs->num_writes++;
+
+  size_t grow = _pos + len > d.size() ? _pos + len - d.size() : 0;
+  size_t used = _fs->usedBytes();
+  size_t room = _fs->capacity > used ? _fs->capacity - used : 0;
+  if (grow > room) len -= grow - room;   // FS full, short write
+
+  if (_pos + len > d.size()) d.resize(_pos + len);
+  if (len > 0) memcpy(&d[_pos], src, len);
+  _pos += len;
+  return len;
+}
+
+}
+
+using fs::File;
+using fs::FSInfo;
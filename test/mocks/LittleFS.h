@@ -0,0 +1,6 @@
+#pragma once
+
+#include "FS.h"
+
+// Mock of the RP2040 core's global LittleFS instance
+inline fs::FS LittleFS;
@@ -4,11 +4,38 @@
 #include <stddef.h>
 
 // Mock SHA256 class for testing
-// Provides minimal interface to allow Utils.cpp to compile
+// Provides minimal interface to allow Utils.cpp to compile.
+// NOTE: not a real SHA256! just a deterministic (FNV-1a + mixing) digest, so different inputs give different hashes
 class SHA256 {
+  uint64_t _state = 0xcbf29ce484222325ULL;
 public:
-  void update(const uint8_t* data, size_t len) {}
-  void finalize(uint8_t* hash, size_t hashLen) {}
-  void resetHMAC(const uint8_t* key, size_t keyLen) {}
-  void finalizeHMAC(const uint8_t* key, size_t keyLen, uint8_t* hash, size_t hashLen) {}
+  void update(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*) data;
+    while (len-- > 0) {
+      _state ^= *p++;
+      _state *= 0x100000001b3ULL;
+    }
+  }
+  void finalize(uint8_t* hash, size_t hashLen) {
+    uint64_t x = _state;
+    for (size_t i = 0; i < hashLen; i++) {
+      if ((i & 7) == 0) {   // splitmix64 step for each 8 bytes
+        x += 0x9e3779b97f4a7c15ULL;
+        uint64_t z = x;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        _state = z ^ (z >> 31);
+      }
+      hash[i] = (uint8_t)(_state >> ((i & 7) * 8));
+    }
+  }
+  // keyed variant of the above digest (not a real HMAC)
+  void resetHMAC(const uint8_t* key, size_t keyLen) {
+    _state = 0xcbf29ce484222325ULL;
+    update(key, keyLen);
+  }
+  void finalizeHMAC(const uint8_t* key, size_t keyLen, uint8_t* hash, size_t hashLen) {
+    update(key, keyLen);
+    finalize(hash, hashLen);
+  }
 };
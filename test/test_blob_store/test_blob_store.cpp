@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <helpers/BlobLogStore.h>
+
+#define REC_SIZE(len)   (sizeof(BlobRecHeader) + (len))
+
+static void makeKey(uint8_t key[], int n) {
+  memset(key, 0, BLOB_KEY_SIZE);
+  key[0] = n;
+  key[1] = n >> 8;
+  key[7] = 0xA5;
+}
+
+static bool putBlob(BlobLogStore& store, int n, int len, uint8_t fill) {
+  uint8_t key[BLOB_KEY_SIZE], data[BLOB_MAX_LEN];
+  makeKey(key, n);
+  memset(data, fill, len);
+  return store.put(key, BLOB_KEY_SIZE, data, len);
+}
+
+// returns the blob's fill byte, or -1 if not found
+static int getBlob(BlobLogStore& store, int n, int expected_len) {
+  uint8_t key[BLOB_KEY_SIZE], data[BLOB_MAX_LEN];
+  makeKey(key, n);
+  int len = store.get(key, BLOB_KEY_SIZE, data);
+  if (len == 0) return -1;
+  EXPECT_EQ(len, expected_len);
+  return data[len - 1];
+}
+
+class BlobLogStoreTest : public ::testing::Test {
+protected:
+  fs::FS fs;
+  BlobLogStore* store;
+
+  void SetUp() override {
+    mockMillis() = 1000;
+    store = new BlobLogStore("/blobs", "/blobs.tmp", 16);
+    store->begin(&fs);
+  }
+  void TearDown() override { delete store; }
+
+  void reboot() {
+    delete store;
+    store = new BlobLogStore("/blobs", "/blobs.tmp", 16);
+    store->begin(&fs);
+  }
+};
+
+TEST_F(BlobLogStoreTest, PutGetRemoveAndReload) {
+  for (int i = 0; i < 10; i++) ASSERT_TRUE(putBlob(*store, i, 20 + i, i));
+  EXPECT_FALSE(fs.exists("/blobs"));   // still buffered
+  EXPECT_EQ(getBlob(*store, 3, 23), 3);
+
+  store->flush();
+  EXPECT_EQ(fs.files["/blobs"].size(), store->getLogSize());
+  EXPECT_EQ(getBlob(*store, 3, 23), 3);   // now from file
+
+  ASSERT_TRUE(putBlob(*store, 3, 50, 0x33));
+  ASSERT_TRUE(store->remove((const uint8_t *) "\x05\x00\x00\x00\x00\x00\x00\xA5", BLOB_KEY_SIZE));
+  store->flush();
+
+  reboot();
+  EXPECT_EQ(store->getNumKeys(), 9);
+  EXPECT_EQ(getBlob(*store, 3, 50), 0x33);
+  EXPECT_EQ(getBlob(*store, 5, 25), -1);
+  EXPECT_EQ(getBlob(*store, 9, 29), 9);
+  EXPECT_GT(store->getDeadBytes(), 0u);
+}
+
+TEST_F(BlobLogStoreTest, EvictsLeastRecentlyPut) {
+  for (int i = 0; i < 16; i++) putBlob(*store, i, 10, i);
+  putBlob(*store, 0, 10, 0x10);   // update moves it to most recent
+  putBlob(*store, 100, 10, 100);  // full, so evicts 1
+  EXPECT_EQ(store->getNumKeys(), 16);
+  EXPECT_EQ(getBlob(*store, 0, 10), 0x10);
+  EXPECT_EQ(getBlob(*store, 1, 10), -1);
+  EXPECT_EQ(getBlob(*store, 2, 10), 2);
+
+  store->flush();
+  reboot();   // order of last put() survives a reboot
+  putBlob(*store, 101, 10, 101);
+  EXPECT_EQ(getBlob(*store, 2, 10), -1);
+  EXPECT_EQ(getBlob(*store, 0, 10), 0x10);
+  EXPECT_EQ(getBlob(*store, 100, 10), 100);
+}
+
+TEST_F(BlobLogStoreTest, CompactsInBackground) {
+  for (int round = 0; round < 12; round++) {
+    for (int i = 0; i < 16; i++) putBlob(*store, i, 100, round);
+    store->flush();
+  }
+  EXPECT_GE(store->getDeadBytes(), (uint32_t) BLOB_STORE_COMPACT_MIN);
+
+  store->loop(mockMillis());
+  ASSERT_TRUE(store->isCompacting());
+  putBlob(*store, 3, 40, 0x77);   // while compacting
+  while (store->isCompacting()) store->loop(mockMillis());
+  store->flush();
+
+  EXPECT_EQ(store->getDeadBytes(), 0u);
+  EXPECT_EQ(store->getLogSize(), 15*REC_SIZE(100) + REC_SIZE(40));
+  EXPECT_FALSE(fs.exists("/blobs.tmp"));
+  reboot();
+  EXPECT_EQ(getBlob(*store, 3, 40), 0x77);
+  EXPECT_EQ(getBlob(*store, 4, 100), 11);
+}
+
+TEST_F(BlobLogStoreTest, SameBucketKeys) {
+  for (int i = 0; i < 6; i++) ASSERT_TRUE(putBlob(*store, 7 + i*256, 10, i));   // all same first key byte
+  ASSERT_TRUE(store->remove((const uint8_t *) "\x07\x02\x00\x00\x00\x00\x00\xA5", BLOB_KEY_SIZE));   // mid chain
+  EXPECT_EQ(getBlob(*store, 7 + 2*256, 10), -1);
+  for (int i = 0; i < 6; i++) {
+    if (i != 2) EXPECT_EQ(getBlob(*store, 7 + i*256, 10), i);
+  }
+  EXPECT_EQ(getBlob(*store, 7 + 6*256, 10), -1);
+
+  for (int i = 0; i < 16; i++) putBlob(*store, 7 + i*256, 10, 0x40 + i);   // evicts from the same bucket
+  EXPECT_EQ(store->getNumKeys(), 16);
+  for (int i = 0; i < 16; i++) EXPECT_EQ(getBlob(*store, 7 + i*256, 10), 0x40 + i);
+}
+
+TEST_F(BlobLogStoreTest, RemoveWhileCompacting) {
+  for (int round = 0; round < 12; round++) {
+    for (int i = 0; i < 16; i++) putBlob(*store, i, 100, round);
+    store->flush();
+  }
+  store->loop(mockMillis());
+  ASSERT_TRUE(store->isCompacting());
+  store->loop(mockMillis());   // first few records copied
+  uint8_t key[BLOB_KEY_SIZE];
+  makeKey(key, 1);   // already copied
+  store->remove(key, BLOB_KEY_SIZE);
+  makeKey(key, BLOB_STORE_COMPACT_STEP);   // next to be copied
+  store->remove(key, BLOB_KEY_SIZE);
+  while (store->isCompacting()) store->loop(mockMillis());
+  store->flush();
+  EXPECT_EQ(store->getLogSize(), 15*REC_SIZE(100) + 2*REC_SIZE(0));   // key 1 was copied before its tombstone, next one never
+
+  reboot();
+  EXPECT_EQ(store->getNumKeys(), 14);
+  EXPECT_EQ(getBlob(*store, 1, 100), -1);
+  EXPECT_EQ(getBlob(*store, BLOB_STORE_COMPACT_STEP, 100), -1);
+  EXPECT_EQ(getBlob(*store, 11, 100), 11);
+  EXPECT_EQ(getBlob(*store, 13, 100), 11);
+}
+
+TEST_F(BlobLogStoreTest, RecoversTornRecordAndInterruptedCompaction) {
+  for (int i = 0; i < 4; i++) putBlob(*store, i, 30, i);
+  store->flush();
+  fs.files["/blobs"].resize(fs.files["/blobs"].size() - 5);   // power lost mid-append
+  reboot();
+  EXPECT_EQ(store->getNumKeys(), 3);
+  EXPECT_EQ(fs.files["/blobs"].size(), 3*REC_SIZE(30));
+
+  fs.rename("/blobs", "/blobs.tmp");   // power lost between remove and rename
+  reboot();
+  EXPECT_EQ(store->getNumKeys(), 3);
+  EXPECT_EQ(getBlob(*store, 2, 30), 2);
+}
+
+TEST_F(BlobLogStoreTest, BacksOffWhenFull) {
+  for (int i = 0; i < 4; i++) putBlob(*store, i, 100, i);
+  store->flush();
+  fs.capacity = fs.usedBytes();   // FS now full
+  putBlob(*store, 5, 100, 5);
+
+  mockMillis() += BLOB_STORE_FLUSH_MILLIS;
+  store->loop(mockMillis());   // flush fails
+  int writes = fs.num_writes;
+  for (int i = 0; i < 100; i++) {
+    mockMillis() += 10;
+    store->loop(mockMillis());
+  }
+  EXPECT_EQ(fs.num_writes, writes);   // not retried on every loop()
+  EXPECT_EQ(getBlob(*store, 5, 100), 5);   // still buffered
+
+  mockMillis() += 2*BLOB_STORE_FLUSH_MILLIS;   // retried, and fails again
+  store->loop(mockMillis());
+  EXPECT_GT(fs.num_writes, writes);
+  writes = fs.num_writes;
+  mockMillis() += BLOB_STORE_FLUSH_MILLIS + 1000;   // back-off has doubled
+  store->loop(mockMillis());
+  EXPECT_EQ(fs.num_writes, writes);
+
+  fs.capacity = 1024*1024;   // space freed
+  mockMillis() += BLOB_STORE_RETRY_MAX_MILLIS;
+  store->loop(mockMillis());
+  reboot();
+  EXPECT_EQ(getBlob(*store, 5, 100), 5);
+  EXPECT_EQ(store->getNumKeys(), 5);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
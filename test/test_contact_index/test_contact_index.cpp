@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+#include <vector>
+#include <helpers/ContactIndex.h>
+
+static std::vector<int> chain(const ContactIndex& index, uint8_t hash) {
+  std::vector<int> v;
+  for (int i = index.first(hash); i >= 0; i = index.next(i)) v.push_back(i);
+  return v;
+}
+
+TEST(ContactIndex, EmptyBuckets) {
+  ContactIndex index(16);
+  for (int h = 0; h < CONTACT_INDEX_BUCKETS; h++) {
+    EXPECT_EQ(index.first(h), -1);
+  }
+}
+
+TEST(ContactIndex, ChainsInAscendingOrder) {
+  const uint8_t hashes[] = { 0x10, 0xAB, 0x10, 0x00, 0xAB, 0x10 };
+  const int n = sizeof(hashes);
+  ContactIndex index(n);
+  for (int i = n - 1; i >= 0; i--) {
+    index.add(i, hashes[i]);
+  }
+  EXPECT_EQ(chain(index, 0x10), std::vector<int>({ 0, 2, 5 }));
+  EXPECT_EQ(chain(index, 0xAB), std::vector<int>({ 1, 4 }));
+  EXPECT_EQ(chain(index, 0x00), std::vector<int>({ 3 }));
+  EXPECT_TRUE(chain(index, 0x11).empty());
+
+  index.clear();
+  EXPECT_TRUE(chain(index, 0x10).empty());
+  index.add(n, 0x10);   // out of range, ignored
+  EXPECT_TRUE(chain(index, 0x10).empty());
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
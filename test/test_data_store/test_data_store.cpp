@@ -0,0 +1,258 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include "../../examples/companion_radio/DataStore.h"
+
+class FakeRTC : public mesh::RTCClock {
+public:
+  uint32_t getCurrentTime() override { return 1700000000; }
+  void setCurrentTime(uint32_t time) override { }
+};
+
+#define TEST_MAX_CHANNELS  4
+
+class FakeHost : public DataStoreHost {
+public:
+  std::vector<ContactInfo> contacts;
+  ChannelDetails channels[TEST_MAX_CHANNELS];
+
+  FakeHost() : channels() { }
+
+  int find(const uint8_t* prefix, int prefix_len) const {
+    for (size_t i = 0; i < contacts.size(); i++) {
+      if (memcmp(contacts[i].id.pub_key, prefix, prefix_len) == 0) return i;
+    }
+    return -1;
+  }
+
+  bool onContactLoaded(const ContactInfo& contact) override {
+    int i = find(contact.id.pub_key, PUB_KEY_SIZE);
+    if (i >= 0) {
+      contacts[i] = contact;
+    } else {
+      if (contacts.size() >= MAX_CONTACTS) return false;
+      contacts.push_back(contact);
+    }
+    return true;
+  }
+  bool onContactDeleted(const uint8_t* pub_key_prefix, int prefix_len) override {
+    int i = find(pub_key_prefix, prefix_len);
+    if (i < 0) return false;
+    contacts.erase(contacts.begin() + i);
+    return true;
+  }
+  bool getContactForSave(uint32_t idx, ContactInfo& contact) override {
+    if (idx >= contacts.size()) return false;
+    contact = contacts[idx];
+    return true;
+  }
+  bool onChannelLoaded(uint8_t channel_idx, const ChannelDetails& ch) override {
+    if (channel_idx >= TEST_MAX_CHANNELS) return false;
+    channels[channel_idx] = ch;
+    return true;
+  }
+  bool getChannelForSave(uint8_t channel_idx, ChannelDetails& ch) override {
+    if (channel_idx >= TEST_MAX_CHANNELS) return false;
+    ch = channels[channel_idx];
+    return true;
+  }
+};
+
+static ContactInfo makeContact(int n) {
+  ContactInfo c = ContactInfo();
+  uint8_t key[PUB_KEY_SIZE];
+  for (int i = 0; i < PUB_KEY_SIZE; i++) key[i] = n*7 + i*13;
+  c.id = mesh::Identity(key);
+  sprintf(c.name, "contact%d", n);
+  c.type = 1;
+  return c;
+}
+
+static void expectSame(const FakeHost& a, const FakeHost& b) {
+  ASSERT_EQ(a.contacts.size(), b.contacts.size());
+  for (size_t i = 0; i < a.contacts.size(); i++) {
+    int j = b.find(a.contacts[i].id.pub_key, PUB_KEY_SIZE);
+    ASSERT_GE(j, 0);
+    EXPECT_STREQ(a.contacts[i].name, b.contacts[j].name);
+    EXPECT_EQ(a.contacts[i].lastmod, b.contacts[j].lastmod);
+  }
+  for (int i = 0; i < TEST_MAX_CHANNELS; i++) {
+    EXPECT_STREQ(a.channels[i].name, b.channels[i].name);
+  }
+}
+
+static void reload(fs::FS& fs, FakeHost& host) {
+  FakeRTC rtc;
+  DataStore store(fs, rtc);
+  store.loadContacts(&host);
+  store.loadChannels(&host);
+}
+
+class DataStoreTest : public ::testing::Test {
+protected:
+  fs::FS fs;
+  FakeRTC rtc;
+  FakeHost host;
+  DataStore* store;
+
+  void SetUp() override {
+    for (int i = 0; i < 50; i++) host.contacts.push_back(makeContact(i));
+    strcpy(host.channels[0].name, "Public");
+    store = new DataStore(fs, rtc);
+    store->loadContacts(&host);
+    store->loadChannels(&host);
+    store->saveContacts(&host);
+    store->saveChannels(&host);
+  }
+  void TearDown() override { delete store; }
+
+  std::vector<uint8_t>& journal() { return fs.files["/contacts3.jnl"]; }
+};
+
+TEST_F(DataStoreTest, SnapshotThenJournalOfChanges) {
+  EXPECT_EQ(fs.files["/contacts3"].size(), 50u * CONTACT_REC_SIZE);
+  EXPECT_EQ(journal().size(), (size_t) JNL_HEADER_SIZE + 8);   // just the JNL_SNAPSHOT record
+  EXPECT_FALSE(fs.exists("/contacts3.tmp"));
+
+  size_t snapshot_size = fs.files["/contacts3"].size();
+  host.contacts[3].lastmod = 1234;
+  store->saveContacts(&host);
+  host.contacts.erase(host.contacts.begin() + 7);
+  host.contacts.push_back(makeContact(100));
+  store->saveContacts(&host);
+  strcpy(host.channels[2].name, "Local");
+  store->saveChannels(&host);
+
+  EXPECT_EQ(fs.files["/contacts3"].size(), snapshot_size);   // only appended to journal
+  EXPECT_EQ(journal().size(), (size_t) JNL_HEADER_SIZE + 8 + 2*(JNL_HEADER_SIZE + CONTACT_REC_SIZE) + JNL_HEADER_SIZE + CONTACT_KEY_LEN);
+
+  FakeHost loaded;
+  reload(fs, loaded);
+  expectSame(host, loaded);
+}
+
+TEST_F(DataStoreTest, TornRecordIsDropped) {
+  host.contacts[1].lastmod = 1;
+  store->saveContacts(&host);
+  FakeHost before = host;
+  host.contacts[2].lastmod = 2;
+  store->saveContacts(&host);
+
+  journal().resize(journal().size() - 20);   // power lost mid-write
+  FakeHost loaded;
+  FakeRTC rtc2;
+  DataStore store2(fs, rtc2);
+  store2.loadContacts(&loaded);
+  store2.loadChannels(&loaded);
+  expectSame(before, loaded);
+
+  store2.saveContacts(&loaded);   // not synced, so a new snapshot
+  EXPECT_EQ(journal().size(), (size_t) JNL_HEADER_SIZE + 8);
+  FakeHost reloaded;
+  reload(fs, reloaded);
+  expectSame(before, reloaded);
+}
+
+TEST_F(DataStoreTest, CorruptRecordIsDropped) {
+  FakeHost before = host;
+  host.contacts[2].lastmod = 2;
+  store->saveContacts(&host);
+
+  journal()[journal().size() - 10] ^= 0x40;   // fails the Fletcher-16 check
+  FakeHost loaded;
+  reload(fs, loaded);
+  expectSame(before, loaded);
+}
+
+TEST_F(DataStoreTest, CompactsJournal) {
+  for (int i = 0; i < 200; i++) {
+    host.contacts[i % 50].lastmod = 1000 + i;
+    store->saveContacts(&host);
+    EXPECT_LE(journal().size(), (size_t) STORE_JOURNAL_MAX_SIZE + JNL_HEADER_SIZE + CONTACT_REC_SIZE);
+  }
+  EXPECT_LT(journal().size(), 200u * (JNL_HEADER_SIZE + CONTACT_REC_SIZE));
+  FakeHost loaded;
+  reload(fs, loaded);
+  expectSame(host, loaded);
+}
+
+TEST_F(DataStoreTest, OldJournalNotReplayedOntoNewSnapshot) {
+  host.contacts[4].lastmod = 4;
+  store->saveContacts(&host);
+  std::vector<uint8_t> old_journal = journal();
+
+  host.contacts.erase(host.contacts.begin() + 4);   // a change the old journal would undo
+  FakeRTC rtc2;
+  DataStore store2(fs, rtc2);   // not loaded, so next save writes a new snapshot
+  store2.saveContacts(&host);
+
+  journal() = old_journal;   // ie. power lost after the rename, before the journal was reset
+  FakeHost loaded;
+  reload(fs, loaded);
+  expectSame(host, loaded);
+}
+
+TEST_F(DataStoreTest, FailedSnapshotKeepsOldFiles) {
+  host.contacts[5].lastmod = 5;
+  store->saveContacts(&host);
+  FakeHost before = host;
+
+  for (int i = 50; i < 60; i++) host.contacts.push_back(makeContact(i));
+  fs.capacity = fs.usedBytes() + 100;   // FS nearly full
+  FakeRTC rtc2;
+  DataStore store2(fs, rtc2);
+  store2.saveContacts(&host);
+  EXPECT_FALSE(fs.exists("/contacts3.tmp"));
+
+  FakeHost loaded;
+  reload(fs, loaded);
+  expectSame(before, loaded);
+}
+
+TEST_F(DataStoreTest, RecoversInterruptedRename) {
+  std::vector<uint8_t> snapshot = fs.files["/contacts3"];
+  fs.remove("/contacts3");
+  fs.files["/contacts3.tmp"] = snapshot;   // power lost between the remove and rename
+
+  FakeHost loaded;
+  reload(fs, loaded);
+  expectSame(host, loaded);
+  EXPECT_TRUE(fs.exists("/contacts3"));
+}
+
+TEST(DataStoreBlobs, MigratesOldBlobDirOnce) {
+  fs::FS fs;
+  FakeRTC rtc;
+  for (int i = 0; i < 30; i++) {
+    char path[32];
+    sprintf(path, "/bl/%02x00000000000000", i);
+    fs.files[path] = std::vector<uint8_t>(40 + i, (uint8_t) i);
+  }
+  fs.files["/bl/readme"] = std::vector<uint8_t>(4, 0);   // not a blob, just removed
+
+  DataStore store(fs, rtc);
+  store.begin();
+  EXPECT_FALSE(fs.exists("/bl"));
+  EXPECT_TRUE(fs.exists("/blobs"));
+  uint8_t key[BLOB_KEY_SIZE] = { 7 }, buf[BLOB_MAX_LEN];
+  ASSERT_EQ(store.getBlobByKey(key, BLOB_KEY_SIZE, buf), 47);
+  EXPECT_EQ(buf[0], 7);
+
+  fs.files["/bl/0100000000000000"] = std::vector<uint8_t>(4, 0xEE);
+  DataStore store2(fs, rtc);
+  store2.begin();   // already migrated, so '/bl' is left alone
+  EXPECT_TRUE(fs.exists("/bl"));
+  key[0] = 1;
+  EXPECT_EQ(store2.getBlobByKey(key, BLOB_KEY_SIZE, buf), 41);
+
+  fs::FS empty_fs;
+  DataStore store3(empty_fs, rtc);
+  store3.begin();
+  EXPECT_TRUE(empty_fs.exists("/blobs"));   // nothing to migrate, but marked as done
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
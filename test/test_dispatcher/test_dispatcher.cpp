@@ -0,0 +1,330 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <Dispatcher.h>
+#include <helpers/StaticPoolPacketManager.h>
+
+using namespace mesh;
+
+class FakeClock : public MillisecondClock {
+public:
+  unsigned long now = 1000;
+  unsigned long getMillis() override { return now; }
+};
+
+// radio with a single 'pending' frame, optionally supporting recvPacket()
+class FakeRadio : public Radio {
+public:
+  bool direct;
+  uint8_t frame[MAX_TRANS_UNIT];
+  int frame_len = 0;
+  int num_raw_reads = 0, num_direct_reads = 0, num_discards = 0;
+
+  FakeRadio(bool direct_recv) : direct(direct_recv) { }
+
+  void inject(const uint8_t* bytes, int len) { memcpy(frame, bytes, len); frame_len = len; }
+
+  int recvRaw(uint8_t* bytes, int sz) override {
+    int len = frame_len;
+    if (len > 0) {
+      memcpy(bytes, frame, len);
+      frame_len = 0;
+      num_raw_reads++;
+    }
+    return len;
+  }
+  int getRecvLength() override { return direct ? frame_len : RECV_RAW_ONLY; }
+  int recvPacket(Packet* pkt) override {
+    int len = frame_len;
+    frame_len = 0;
+    if (pkt == NULL) { num_discards++; return 0; }
+    num_direct_reads++;
+    return pkt->readFrom(frame, len) ? len : 0;
+  }
+
+  uint32_t getEstAirtimeFor(int len_bytes) override { return len_bytes; }
+  float packetScore(float snr, int packet_len) override { return 1.0f; }
+  uint8_t sent[MAX_TRANS_UNIT];
+  int sent_len = 0;
+
+  bool startSendRaw(const uint8_t* bytes, int len) override {
+    memcpy(sent, bytes, len);
+    sent_len = len;
+    return true;
+  }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+
+  bool polling = false;
+  bool needsPolling() override { return polling; }
+};
+
+class TestDispatcher : public Dispatcher {
+public:
+  Packet last;
+  int num_recv = 0, num_raw_logged = 0;
+  bool want_raw = false;
+  uint8_t last_raw[MAX_TRANS_UNIT];
+  int last_raw_len = 0;
+
+  TestDispatcher(Radio& radio, MillisecondClock& ms, PacketManager& mgr) : Dispatcher(radio, ms, mgr) { }
+
+protected:
+  DispatcherAction onRecvPacket(Packet* pkt) override {
+    num_recv++;
+    last.header = pkt->header;
+    last.path_len = pkt->path_len;
+    memcpy(last.path, pkt->path, pkt->getPathByteLen());
+    last.payload_len = pkt->payload_len;
+    memcpy(last.payload, pkt->payload, pkt->payload_len);
+    return ACTION_RELEASE;
+  }
+  void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) override {
+    num_raw_logged++;
+    memcpy(last_raw, raw, len);
+    last_raw_len = len;
+  }
+  bool wantsRxRaw() const override { return want_raw; }
+
+public:
+  uint8_t tx_raw[MAX_TRANS_UNIT];
+  int tx_len = 0;
+
+protected:
+  void logTx(Packet* pkt, int len) override {
+    memcpy(tx_raw, getOutboundRaw(), len);
+    tx_len = len;
+  }
+};
+
+static const uint8_t direct_frame[] = {
+  (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT,
+  2, 0xAA, 0xBB,          // path
+  1, 2, 3, 4, 5, 6, 7     // payload
+};
+
+static void checkReceived(const TestDispatcher& d) {
+  EXPECT_EQ(d.last.getRouteType(), ROUTE_TYPE_DIRECT);
+  EXPECT_EQ(d.last.getPayloadType(), PAYLOAD_TYPE_TXT_MSG);
+  ASSERT_EQ(d.last.getPathByteLen(), 2);
+  EXPECT_EQ(d.last.path[0], 0xAA);
+  EXPECT_EQ(d.last.path[1], 0xBB);
+  ASSERT_EQ(d.last.payload_len, 7);
+  EXPECT_EQ(memcmp(d.last.payload, &direct_frame[4], 7), 0);
+}
+
+TEST(DispatcherRecv, RawFallback) {
+  FakeClock clock;
+  FakeRadio radio(false);
+  StaticPoolPacketManager mgr(4);
+  TestDispatcher d(radio, clock, mgr);
+  d.begin();
+
+  radio.inject(direct_frame, sizeof(direct_frame));
+  d.loop();
+  EXPECT_EQ(radio.num_raw_reads, 1);
+  EXPECT_EQ(radio.num_direct_reads, 0);
+  EXPECT_EQ(d.num_recv, 1);
+  EXPECT_EQ(d.num_raw_logged, 1);    // always logged on raw path
+  checkReceived(d);
+  EXPECT_EQ(mgr.getFreeCount(), 4);
+  EXPECT_EQ(d.getReceiveAirTime(), sizeof(direct_frame));
+}
+
+TEST(DispatcherRecv, DirectIntoPacket) {
+  FakeClock clock;
+  FakeRadio radio(true);
+  StaticPoolPacketManager mgr(4);
+  TestDispatcher d(radio, clock, mgr);
+  d.begin();
+
+  radio.inject(direct_frame, sizeof(direct_frame));
+  d.loop();
+  EXPECT_EQ(radio.num_raw_reads, 0);
+  EXPECT_EQ(radio.num_direct_reads, 1);
+  EXPECT_EQ(d.num_recv, 1);
+  EXPECT_EQ(d.num_raw_logged, 0);    // not wanted
+  checkReceived(d);
+  EXPECT_EQ(mgr.getFreeCount(), 4);
+  EXPECT_EQ(d.getReceiveAirTime(), sizeof(direct_frame));
+
+  d.want_raw = true;
+  radio.inject(direct_frame, sizeof(direct_frame));
+  d.loop();
+  EXPECT_EQ(d.num_recv, 2);
+  ASSERT_EQ(d.num_raw_logged, 1);
+  ASSERT_EQ(d.last_raw_len, (int)sizeof(direct_frame));   // re-encoded raw matches the wire bytes
+  EXPECT_EQ(memcmp(d.last_raw, direct_frame, sizeof(direct_frame)), 0);
+}
+
+TEST(DispatcherRecv, DirectDropsBadPackets) {
+  FakeClock clock;
+  FakeRadio radio(true);
+  StaticPoolPacketManager mgr(4);
+  TestDispatcher d(radio, clock, mgr);
+  d.begin();
+
+  uint8_t bad_ver[sizeof(direct_frame)];
+  memcpy(bad_ver, direct_frame, sizeof(bad_ver));
+  bad_ver[0] |= (PAYLOAD_VER_2 << PH_VER_SHIFT);
+  radio.inject(bad_ver, sizeof(bad_ver));
+  d.loop();
+
+  uint8_t bad_path[] = { direct_frame[0], 0xC1, 0xAA, 1, 2 };   // reserved path hash size
+  radio.inject(bad_path, sizeof(bad_path));
+  d.loop();
+
+  EXPECT_EQ(radio.num_direct_reads, 2);
+  EXPECT_EQ(d.num_recv, 0);
+  EXPECT_EQ(mgr.getFreeCount(), 4);   // both put back in pool
+}
+
+TEST(DispatcherRecv, DirectDiscardsWhenPoolEmpty) {
+  FakeClock clock;
+  FakeRadio radio(true);
+  StaticPoolPacketManager mgr(1);
+  TestDispatcher d(radio, clock, mgr);
+  d.begin();
+
+  Packet* held = mgr.allocNew();
+  radio.inject(direct_frame, sizeof(direct_frame));
+  d.loop();
+  EXPECT_EQ(radio.num_discards, 1);
+  EXPECT_EQ(radio.num_direct_reads, 0);
+  EXPECT_EQ(radio.frame_len, 0);    // radio is free for next packet
+  EXPECT_EQ(d.num_recv, 0);
+  mgr.free(held);
+}
+TEST(DispatcherSend, WireFormatEncodedOnce) {
+  FakeClock clock;
+  FakeRadio radio(true);
+  StaticPoolPacketManager mgr(4);
+  TestDispatcher d(radio, clock, mgr);
+  d.begin();
+
+  Packet* pkt = d.obtainNewPacket();
+  pkt->header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_TRANSPORT_DIRECT;
+  pkt->transport_codes[0] = 0x1234;
+  pkt->transport_codes[1] = 0x5678;
+  pkt->path_len = 2;
+  pkt->path[0] = 0xAA; pkt->path[1] = 0xBB;
+  pkt->payload_len = 5;
+  memcpy(pkt->payload, "hello", 5);
+  uint8_t expected[MAX_TRANS_UNIT];
+  int expected_len = pkt->writeTo(expected);
+
+  d.sendPacket(pkt, 0);
+  clock.now += 10;
+  d.loop();    // starts send
+  ASSERT_EQ(radio.sent_len, expected_len);
+  EXPECT_EQ(radio.sent_len, pkt->getRawLength());
+  EXPECT_EQ(memcmp(radio.sent, expected, expected_len), 0);
+
+  clock.now += 10;
+  d.loop();    // send complete
+  ASSERT_EQ(d.tx_len, expected_len);    // includes the transport codes
+  EXPECT_EQ(memcmp(d.tx_raw, expected, expected_len), 0);
+  EXPECT_EQ(d.getNumSentDirect(), 1);
+  EXPECT_EQ(mgr.getFreeCount(), 4);
+}
+
+TEST(DispatcherWakeup, EarliestDeadline) {
+  FakeClock clock;
+  FakeRadio radio(true);
+  StaticPoolPacketManager mgr(4);
+  TestDispatcher d(radio, clock, mgr);
+  d.begin();
+
+  d.loop();
+  EXPECT_EQ(d.getNextWakeupMillis(), 3000u);    // only the noise floor calibration
+
+  Packet* pkt = d.obtainNewPacket();
+  pkt->header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT;
+  pkt->payload_len = 1;
+  d.sendPacket(pkt, 0, 500);
+  EXPECT_EQ(d.getNextWakeupMillis(), 1500u);
+
+  radio.polling = true;
+  EXPECT_EQ(d.getNextWakeupMillis(), 1000u);    // radio can't wait for IRQ
+  radio.polling = false;
+
+  clock.now = 1499;
+  d.loop();    // not due yet
+  EXPECT_EQ(radio.sent_len, 0);
+  clock.now = 1500;
+  d.loop();
+  EXPECT_GT(radio.sent_len, 0);
+  clock.now += 10;
+  d.loop();    // send complete
+  EXPECT_EQ(d.getNextWakeupMillis(), 3000u);
+}
+
+TEST(LatencyHistogram, Buckets) {
+  EXPECT_EQ(LatencyHistogram::getBucketFor(0), 0);
+  EXPECT_EQ(LatencyHistogram::getBucketFor(1), 1);
+  EXPECT_EQ(LatencyHistogram::getBucketFor(3), 2);
+  EXPECT_EQ(LatencyHistogram::getBucketFor(500), 9);
+  EXPECT_EQ(LatencyHistogram::getBucketFor(0xFFFFFFFF), LATENCY_NUM_BUCKETS - 1);
+  EXPECT_EQ(LatencyHistogram::getBucketMax(9), 511u);
+
+  LatencyHistogram h;
+  h.reset();
+  EXPECT_EQ(h.getPercentile(50), 0u);
+  for (int i = 0; i < 9; i++) h.add(5);
+  h.add(3000);
+  EXPECT_EQ(h.getTotal(), 10u);
+  EXPECT_EQ(h.getPercentile(50), 7u);
+  EXPECT_EQ(h.getPercentile(90), 7u);
+  EXPECT_EQ(h.getPercentile(99), 4095u);
+
+  h.counts[3] = 0xFFFF;
+  h.add(5);
+  EXPECT_EQ(h.counts[3], 0xFFFF);    // saturates
+}
+
+TEST(DispatcherLatency, StagesRecorded) {
+  FakeClock clock;
+  FakeRadio radio(true);
+  StaticPoolPacketManager mgr(4);
+  TestDispatcher d(radio, clock, mgr);
+  d.begin();
+
+  radio.inject(direct_frame, sizeof(direct_frame));
+  d.loop();    // processed immediately
+
+  Packet* pkt = d.obtainNewPacket();
+  pkt->header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT;
+  pkt->payload_len = 1;
+  d.sendPacket(pkt, 2, 500);
+  clock.now += 500;
+  d.loop();    // starts send
+  clock.now += 10;
+  d.loop();    // send complete
+
+  LatencyHistogram h;
+  ASSERT_TRUE(d.getLatencyStats().getHistogram(h, LATENCY_STAGE_RX_DELAY, LATENCY_ROUTE_DIRECT));
+  EXPECT_EQ(h.getTotal(), 1u);
+  EXPECT_EQ(h.counts[0], 1);
+  ASSERT_TRUE(d.getLatencyStats().getHistogram(h, LATENCY_STAGE_QUEUE_WAIT, LATENCY_ROUTE_DIRECT, 2));
+  EXPECT_EQ(h.counts[9], 1);    // 500 millis
+  ASSERT_TRUE(d.getLatencyStats().getHistogram(h, LATENCY_STAGE_QUEUE_WAIT, LATENCY_ROUTE_DIRECT));
+  EXPECT_EQ(h.getTotal(), 1u);  // all priorities
+  ASSERT_TRUE(d.getLatencyStats().getHistogram(h, LATENCY_STAGE_QUEUE_WAIT, LATENCY_ROUTE_DIRECT, 0));
+  EXPECT_EQ(h.getTotal(), 0u);
+  ASSERT_TRUE(d.getLatencyStats().getHistogram(h, LATENCY_STAGE_CAD_WAIT, LATENCY_ROUTE_DIRECT));
+  EXPECT_EQ(h.counts[0], 1);    // channel was clear
+  ASSERT_TRUE(d.getLatencyStats().getHistogram(h, LATENCY_STAGE_AIRTIME, LATENCY_ROUTE_DIRECT));
+  EXPECT_EQ(h.counts[4], 1);    // 10 millis
+  ASSERT_TRUE(d.getLatencyStats().getHistogram(h, LATENCY_STAGE_AIRTIME, LATENCY_ROUTE_FLOOD));
+  EXPECT_EQ(h.getTotal(), 0u);
+  EXPECT_FALSE(d.getLatencyStats().getHistogram(h, LATENCY_NUM_STAGES, LATENCY_ROUTE_FLOOD));
+
+  d.resetStats();
+  ASSERT_TRUE(d.getLatencyStats().getHistogram(h, LATENCY_STAGE_AIRTIME, LATENCY_ROUTE_DIRECT));
+  EXPECT_EQ(h.getTotal(), 0u);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,217 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+#include <helpers/FrameBatcher.h>
+
+#define TEST_QUEUE_SIZE  12
+#define TEST_MAX_BATCH   244
+
+static std::vector<uint8_t> makeFrame(uint8_t id, int len) {
+  std::vector<uint8_t> f(len, id);
+  f[0] = id;
+  return f;
+}
+
+static void pushFrame(FrameBatcher& q, uint8_t id, int len) {
+  std::vector<uint8_t> f = makeFrame(id, len);
+  ASSERT_TRUE(q.push(f.data(), f.size()));
+}
+
+// splits a batched write back into frames, the way the app does
+static std::vector<std::vector<uint8_t>> unpack(const uint8_t* data, int len) {
+  std::vector<std::vector<uint8_t>> frames;
+  int i = 0;
+  while (i < len) {
+    int n = data[i++];
+    EXPECT_LE(i + n, len);
+    frames.push_back(std::vector<uint8_t>(&data[i], &data[i + n]));
+    i += n;
+  }
+  return frames;
+}
+
+TEST(FrameBatcher, UnbatchedIsOneRawFramePerWrite) {
+  FrameBatcher q(TEST_QUEUE_SIZE, TEST_MAX_BATCH);
+  pushFrame(q, 1, 10);
+  pushFrame(q, 2, 20);
+
+  int len, num_frames;
+  const uint8_t* data = q.nextWrite(TEST_MAX_BATCH, len, num_frames);
+  ASSERT_TRUE(data != NULL);
+  EXPECT_EQ(1, num_frames);
+  EXPECT_EQ(10, len);
+  EXPECT_EQ(makeFrame(1, 10), std::vector<uint8_t>(data, data + len));
+  q.pop(num_frames);
+
+  data = q.nextWrite(TEST_MAX_BATCH, len, num_frames);
+  ASSERT_TRUE(data != NULL);
+  EXPECT_EQ(20, len);
+  q.pop(num_frames);
+
+  EXPECT_TRUE(q.isEmpty());
+  EXPECT_TRUE(q.nextWrite(TEST_MAX_BATCH, len, num_frames) == NULL);
+}
+
+TEST(FrameBatcher, ExactFitAtMTU) {
+  FrameBatcher q(TEST_QUEUE_SIZE, TEST_MAX_BATCH);
+  q.setBatching(true);
+  // 3 x (1 + 19) = 60 bytes, exactly the write size
+  pushFrame(q, 1, 19);
+  pushFrame(q, 2, 19);
+  pushFrame(q, 3, 19);
+
+  int len, num_frames;
+  const uint8_t* data = q.nextWrite(60, len, num_frames);
+  ASSERT_TRUE(data != NULL);
+  EXPECT_EQ(3, num_frames);
+  EXPECT_EQ(60, len);
+}
+
+TEST(FrameBatcher, OneByteOverMTUGoesInNextWrite) {
+  FrameBatcher q(TEST_QUEUE_SIZE, TEST_MAX_BATCH);
+  q.setBatching(true);
+  pushFrame(q, 1, 19);
+  pushFrame(q, 2, 19);
+  pushFrame(q, 3, 20);   // would make 61
+
+  int len, num_frames;
+  q.nextWrite(60, len, num_frames);
+  EXPECT_EQ(2, num_frames);
+  EXPECT_EQ(40, len);
+  q.pop(num_frames);
+
+  const uint8_t* data = q.nextWrite(60, len, num_frames);
+  ASSERT_TRUE(data != NULL);
+  EXPECT_EQ(1, num_frames);
+  EXPECT_EQ(21, len);
+  EXPECT_EQ(20, data[0]);
+}
+
+TEST(FrameBatcher, MaxBatchSizeCapsWrite) {
+  FrameBatcher q(TEST_QUEUE_SIZE, 64);
+  q.setBatching(true);
+  for (int i = 0; i < 4; i++) pushFrame(q, i + 1, 31);   // 32 bytes each
+
+  int len, num_frames;
+  q.nextWrite(512, len, num_frames);   // link allows more than the batch buffer
+  EXPECT_EQ(2, num_frames);
+  EXPECT_EQ(64, len);
+}
+
+TEST(FrameBatcher, OversizeFrameDroppedWhenBatching) {
+  FrameBatcher q(TEST_QUEUE_SIZE, TEST_MAX_BATCH);
+  q.setBatching(true);
+  pushFrame(q, 1, 60);   // 1 + 60 can't fit in a 60 byte write
+  pushFrame(q, 2, 10);
+
+  int len, num_frames;
+  const uint8_t* data = q.nextWrite(60, len, num_frames);
+  ASSERT_TRUE(data != NULL);
+  EXPECT_EQ(1, num_frames);
+  EXPECT_EQ(11, len);
+  EXPECT_EQ(2, data[1]);
+  EXPECT_EQ(1u, q.getNumDropped());
+}
+
+TEST(FrameBatcher, FirstBatchAfterEnabling) {
+  FrameBatcher q(TEST_QUEUE_SIZE, TEST_MAX_BATCH);
+  pushFrame(q, 1, 10);   // queued before app enabled batching
+  pushFrame(q, 2, 10);
+  q.setBatching(true);
+  pushFrame(q, 3, 10);
+  pushFrame(q, 4, 10);
+
+  int len, num_frames;
+  // pre-queued frames still go raw, one per write
+  for (int id = 1; id <= 2; id++) {
+    const uint8_t* data = q.nextWrite(TEST_MAX_BATCH, len, num_frames);
+    ASSERT_TRUE(data != NULL);
+    EXPECT_EQ(1, num_frames);
+    EXPECT_EQ(10, len);
+    EXPECT_EQ(id, data[0]);
+    q.pop(num_frames);
+  }
+
+  const uint8_t* data = q.nextWrite(TEST_MAX_BATCH, len, num_frames);
+  ASSERT_TRUE(data != NULL);
+  EXPECT_EQ(2, num_frames);
+  auto frames = unpack(data, len);
+  ASSERT_EQ(2u, frames.size());
+  EXPECT_EQ(makeFrame(3, 10), frames[0]);
+  EXPECT_EQ(makeFrame(4, 10), frames[1]);
+}
+
+TEST(FrameBatcher, ReEnablingKeepsBatching) {
+  FrameBatcher q(TEST_QUEUE_SIZE, TEST_MAX_BATCH);
+  q.setBatching(true);
+  pushFrame(q, 1, 10);
+  pushFrame(q, 2, 10);
+  q.setBatching(true);   // app re-sends the command, queued frames are already batched
+
+  int len, num_frames;
+  q.nextWrite(TEST_MAX_BATCH, len, num_frames);
+  EXPECT_EQ(2, num_frames);
+}
+
+TEST(FrameBatcher, OrderPreservedAcrossWrites) {
+  FrameBatcher q(TEST_QUEUE_SIZE, TEST_MAX_BATCH);
+  q.setBatching(true);
+
+  std::vector<std::vector<uint8_t>> sent, received;
+  uint8_t id = 0;
+  int len, num_frames;
+  for (int round = 0; round < 20; round++) {
+    while (q.size() < q.capacity()) {
+      id++;
+      sent.push_back(makeFrame(id, 5 + (id * 37) % 120));
+      ASSERT_TRUE(q.push(sent.back().data(), sent.back().size()));
+    }
+    const uint8_t* data = q.nextWrite(100 + (round * 13) % 144, len, num_frames);
+    ASSERT_TRUE(data != NULL);
+    auto frames = unpack(data, len);
+    EXPECT_EQ((size_t) num_frames, frames.size());
+    received.insert(received.end(), frames.begin(), frames.end());
+    q.pop(num_frames);
+  }
+  while (!q.isEmpty()) {
+    const uint8_t* data = q.nextWrite(TEST_MAX_BATCH, len, num_frames);
+    ASSERT_TRUE(data != NULL);
+    auto frames = unpack(data, len);
+    received.insert(received.end(), frames.begin(), frames.end());
+    q.pop(num_frames);
+  }
+  EXPECT_EQ(0u, q.getNumDropped());
+  EXPECT_EQ(sent, received);
+}
+
+TEST(FrameBatcher, PushRejectsWhenFull) {
+  FrameBatcher q(2, TEST_MAX_BATCH);
+  uint8_t f[4] = { 1, 2, 3, 4 };
+  EXPECT_TRUE(q.push(f, sizeof(f)));
+  EXPECT_TRUE(q.push(f, sizeof(f)));
+  EXPECT_FALSE(q.push(f, sizeof(f)));
+  EXPECT_FALSE(q.push(f, 0));
+  EXPECT_EQ(2, q.size());
+}
+
+TEST(FrameBatcher, ClearTurnsBatchingOff) {
+  FrameBatcher q(TEST_QUEUE_SIZE, TEST_MAX_BATCH);
+  pushFrame(q, 1, 10);
+  q.setBatching(true);
+  q.clear();   // eg. new connection
+  EXPECT_TRUE(q.isEmpty());
+  EXPECT_FALSE(q.isBatching());
+
+  q.setBatching(true);
+  pushFrame(q, 2, 10);
+  int len, num_frames;
+  const uint8_t* data = q.nextWrite(TEST_MAX_BATCH, len, num_frames);
+  ASSERT_TRUE(data != NULL);
+  EXPECT_EQ(11, len);   // batched straight away, no stale unbatched count
+  EXPECT_EQ(10, data[0]);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
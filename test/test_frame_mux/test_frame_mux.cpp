@@ -0,0 +1,271 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+#include <helpers/FrameMux.h>
+
+#define LOOPBACK_WRITE_CHUNK  1436
+
+// loopback stand-in for a non-blocking TCP client socket. Like the ESP32 one, it doesn't know the send buffer
+// space up front, so availableForWrite() is just a max chunk size, and write() may take only part of it.
+class LoopbackConn : public FrameMuxConn {
+public:
+  std::vector<uint8_t> to_radio;     // bytes the 'app' has sent
+  std::vector<uint8_t> from_radio;   // bytes written by the mux
+  int write_room = 1 << 20;          // simulates socket send buffer space (used up by writes)
+  int num_writes = 0;
+  bool is_connected = true;
+  bool stopped = false;
+
+  bool connected() override { return is_connected; }
+  int available() override { return to_radio.size(); }
+  int read(uint8_t* dest, int len) override {
+    if (len > (int) to_radio.size()) len = to_radio.size();
+    memcpy(dest, to_radio.data(), len);
+    to_radio.erase(to_radio.begin(), to_radio.begin() + len);
+    return len;
+  }
+  int availableForWrite() override { return LOOPBACK_WRITE_CHUNK; }
+  int write(const uint8_t* src, int len) override {
+    if (len > write_room) len = write_room;
+    from_radio.insert(from_radio.end(), src, src + len);
+    write_room -= len;
+    num_writes++;
+    return len;
+  }
+  void stop() override { stopped = true; is_connected = false; }
+
+  void sendCmd(const uint8_t* frame, int len, uint8_t type = FRAME_MUX_TYPE_IN) {
+    to_radio.push_back(type);
+    to_radio.push_back(len & 0xFF);
+    to_radio.push_back(len >> 8);
+    to_radio.insert(to_radio.end(), frame, frame + len);
+  }
+
+  // splits from_radio back into frames
+  std::vector<std::vector<uint8_t>> frames() const {
+    std::vector<std::vector<uint8_t>> v;
+    size_t i = 0;
+    while (i + FRAME_MUX_HEADER_SIZE <= from_radio.size()) {
+      EXPECT_EQ(from_radio[i], FRAME_MUX_TYPE_OUT);
+      int len = from_radio[i + 1] | (from_radio[i + 2] << 8);
+      i += FRAME_MUX_HEADER_SIZE;
+      v.push_back(std::vector<uint8_t>(from_radio.begin() + i, from_radio.begin() + i + len));
+      i += len;
+    }
+    return v;
+  }
+};
+
+TEST(FrameMux, ParsesFramesAcrossPartialReads) {
+  FrameMux mux(2);
+  LoopbackConn a;
+  mux.attach(0, &a, 0);
+
+  uint8_t cmd[] = { 22, 3 };
+  a.sendCmd(cmd, 2);
+  std::vector<uint8_t> all = a.to_radio;
+  a.to_radio.assign(all.begin(), all.begin() + 2);   // header only partly arrived
+
+  uint8_t dest[MAX_FRAME_SIZE];
+  EXPECT_EQ(mux.loop(dest, 1), 0u);
+  a.to_radio.insert(a.to_radio.end(), all.begin() + 2, all.end());
+  ASSERT_EQ(mux.loop(dest, 2), 2u);
+  EXPECT_EQ(dest[0], 22);
+  EXPECT_EQ(dest[1], 3);
+}
+
+TEST(FrameMux, SkipsBadFrames) {
+  FrameMux mux(1);
+  LoopbackConn a;
+  mux.attach(0, &a, 0);
+
+  uint8_t big[MAX_FRAME_SIZE + 10];
+  memset(big, 0xEE, sizeof(big));
+  a.sendCmd(big, sizeof(big));      // too big
+  a.sendCmd(big, 5, 'X');           // wrong type
+  uint8_t cmd[] = { 10 };
+  a.sendCmd(cmd, 1);
+
+  uint8_t dest[MAX_FRAME_SIZE];
+  size_t len = 0;
+  for (int i = 0; i < 10 && len == 0; i++) len = mux.loop(dest, i);
+  ASSERT_EQ(len, 1u);
+  EXPECT_EQ(dest[0], 10);
+}
+
+TEST(FrameMux, CoalescesWrites) {
+  FrameMux mux(1);
+  LoopbackConn a;
+  mux.attach(0, &a, 0);
+
+  uint8_t frame[20];
+  memset(frame, 0x42, sizeof(frame));
+  uint8_t dest[MAX_FRAME_SIZE];
+  for (int i = 0; i < 10; i++) {
+    EXPECT_EQ(mux.writeFrame(frame, sizeof(frame), true), sizeof(frame));
+  }
+  mux.loop(dest, 1);
+  EXPECT_EQ(a.num_writes, 0);   // held back, for more frames
+
+  mux.loop(dest, 1 + FRAME_MUX_COALESCE_MILLIS);
+  EXPECT_EQ(a.num_writes, 1);   // all 10 frames in one write
+  ASSERT_EQ(a.frames().size(), 10u);
+  EXPECT_EQ(a.frames()[9], std::vector<uint8_t>(frame, frame + sizeof(frame)));
+
+  FrameMuxClientStats stats;
+  ASSERT_TRUE(mux.getClientStats(0, stats));
+  EXPECT_EQ(stats.frames_sent, 10u);
+  EXPECT_EQ(stats.writes, 1u);
+  EXPECT_EQ(stats.bytes_sent, 10u * (FRAME_MUX_HEADER_SIZE + sizeof(frame)));
+}
+
+TEST(FrameMux, RepliesGoToSender) {
+  FrameMux mux(3);
+  LoopbackConn a, b, c;
+  mux.attach(0, &a, 0);
+  mux.attach(1, &b, 0);
+  mux.attach(2, &c, 0);
+  EXPECT_EQ(mux.getNumClients(), 3);
+
+  uint8_t cmd[] = { 5 };
+  b.sendCmd(cmd, 1);
+  uint8_t dest[MAX_FRAME_SIZE];
+  ASSERT_EQ(mux.loop(dest, 0), 1u);
+
+  uint8_t reply[] = { 9, 1, 2, 3, 4 };
+  uint8_t push[] = { 0x83 };
+  mux.writeFrame(reply, sizeof(reply), false);
+  mux.writeFrame(push, sizeof(push), true);
+  mux.loop(dest, 100);
+
+  EXPECT_EQ(a.frames().size(), 1u);
+  ASSERT_EQ(b.frames().size(), 2u);
+  EXPECT_EQ(b.frames()[0][0], 9);
+  EXPECT_EQ(c.frames().size(), 1u);
+  EXPECT_EQ(c.frames()[0][0], 0x83);
+}
+
+TEST(FrameMux, RoundRobinRecv) {
+  FrameMux mux(2);
+  LoopbackConn a, b;
+  mux.attach(0, &a, 0);
+  mux.attach(1, &b, 0);
+
+  uint8_t cmd_a[] = { 1 }, cmd_b[] = { 2 };
+  for (int i = 0; i < 3; i++) {
+    a.sendCmd(cmd_a, 1);
+    b.sendCmd(cmd_b, 1);
+  }
+  uint8_t dest[MAX_FRAME_SIZE];
+  std::vector<int> order;
+  for (int i = 0; i < 6; i++) {
+    ASSERT_EQ(mux.loop(dest, i), 1u);
+    order.push_back(dest[0]);
+  }
+  EXPECT_EQ(order, std::vector<int>({ 1, 2, 1, 2, 1, 2 }));
+}
+
+TEST(FrameMux, BackPressureAndSlowClient) {
+  FrameMux mux(2);
+  LoopbackConn fast, slow;
+  mux.attach(0, &fast, 0);
+  mux.attach(1, &slow, 0);
+  slow.write_room = 0;   // not reading
+
+  uint8_t cmd[] = { 4 };
+  slow.sendCmd(cmd, 1);
+  uint8_t dest[MAX_FRAME_SIZE];
+  ASSERT_EQ(mux.loop(dest, 0), 1u);   // slow is now the reply target
+
+  uint8_t frame[MAX_FRAME_SIZE];
+  memset(frame, 0, sizeof(frame));
+  int n = 0;
+  while (!mux.isWriteBusy()) {
+    ASSERT_EQ(mux.writeFrame(frame, sizeof(frame), false), sizeof(frame));
+    n++;
+  }
+  EXPECT_EQ(n, FRAME_MUX_SEND_BUF_SIZE / (FRAME_MUX_HEADER_SIZE + MAX_FRAME_SIZE));
+
+  // pushes still reach the fast client, and are counted as dropped for slow one
+  while (mux.writeFrame(frame, 10, false) > 0) { }
+  EXPECT_EQ(mux.writeFrame(frame, 10, true), 10u);
+  mux.loop(dest, 100);
+  EXPECT_EQ(fast.frames().size(), 1u);
+
+  FrameMuxClientStats stats;
+  ASSERT_TRUE(mux.getClientStats(1, stats));
+  EXPECT_EQ(stats.frames_dropped, 1u);
+  EXPECT_GT(stats.stalls, 0u);
+
+  // slow client catches up a bit, then stops reading altogether
+  slow.write_room = 500;
+  mux.loop(dest, 200);
+  EXPECT_EQ((int) slow.from_radio.size(), 500);
+  slow.write_room = 0;
+  mux.loop(dest, 200 + FRAME_MUX_STALL_MILLIS - 1);
+  EXPECT_FALSE(slow.stopped);
+  mux.loop(dest, 200 + FRAME_MUX_STALL_MILLIS);
+  EXPECT_TRUE(slow.stopped);
+  EXPECT_EQ(mux.getNumClients(), 1);
+  EXPECT_FALSE(mux.isWriteBusy());
+}
+
+TEST(FrameMux, PartialWrites) {
+  FrameMux mux(1);
+  LoopbackConn a;
+  mux.attach(0, &a, 0);
+  a.write_room = 0;
+
+  uint8_t frame[100];
+  for (int i = 0; i < 15; i++) {
+    memset(frame, i, sizeof(frame));
+    ASSERT_EQ(mux.writeFrame(frame, sizeof(frame), true), sizeof(frame));
+  }
+  uint8_t dest[MAX_FRAME_SIZE];
+  unsigned long now = 100;
+  int loops = 0;
+  while (a.from_radio.size() < 15 * (FRAME_MUX_HEADER_SIZE + sizeof(frame)) && loops < 1000) {
+    a.write_room += 37;   // socket drains a little between loops, so takes only part of each write
+    now += FRAME_MUX_COALESCE_MILLIS;
+    mux.loop(dest, now);
+    loops++;
+  }
+  ASSERT_EQ(a.frames().size(), 15u);
+  for (int i = 0; i < 15; i++) {
+    EXPECT_EQ(a.frames()[i], std::vector<uint8_t>(sizeof(frame), i));
+  }
+  EXPECT_FALSE(a.stopped);
+
+  FrameMuxClientStats stats;
+  ASSERT_TRUE(mux.getClientStats(0, stats));
+  EXPECT_EQ(stats.bytes_sent, a.from_radio.size());
+  EXPECT_GT(stats.writes, 15u);   // one partial write per loop()
+}
+
+TEST(FrameMux, ReplacesLeastRecentlyActive) {
+  FrameMux mux(2);
+  LoopbackConn a, b, c;
+  uint8_t dest[MAX_FRAME_SIZE];
+  uint8_t cmd[] = { 1 };
+
+  mux.attach(mux.getSlotForNewClient(), &a, 0);
+  mux.attach(mux.getSlotForNewClient(), &b, 0);
+  a.sendCmd(cmd, 1);
+  mux.loop(dest, 50);   // a is now more recently active
+
+  int slot = mux.getSlotForNewClient();
+  EXPECT_EQ(slot, 1);
+  mux.attach(slot, &c, 60);
+  EXPECT_TRUE(b.stopped);
+  EXPECT_FALSE(a.stopped);
+
+  a.is_connected = false;   // dropped by remote end
+  mux.loop(dest, 70);
+  EXPECT_EQ(mux.getNumClients(), 1);
+  EXPECT_EQ(mux.getSlotForNewClient(), 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,230 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+#include <Mesh.h>
+#include <helpers/SimpleMeshTables.h>
+#include <helpers/SimpleNeighbourTable.h>
+#include <helpers/StaticPoolPacketManager.h>
+
+using namespace mesh;
+
+class FakeClock : public MillisecondClock {
+public:
+  unsigned long now = 1000;
+  unsigned long getMillis() override { return now; }
+};
+
+class FakeRTC : public RTCClock {
+public:
+  uint32_t getCurrentTime() override { return 1700000000; }
+  void setCurrentTime(uint32_t time) override { }
+};
+
+class FakeRNG : public RNG {
+  uint8_t next = 1;
+public:
+  void random(uint8_t* dest, size_t sz) override {
+    while (sz--) *dest++ = next++;
+  }
+};
+
+class FakeRadio : public Radio {
+public:
+  uint8_t frame[MAX_TRANS_UNIT];
+  int frame_len = 0;
+  std::vector<std::vector<uint8_t> > sent;
+
+  void inject(const uint8_t* bytes, int len) { memcpy(frame, bytes, len); frame_len = len; }
+
+  int recvRaw(uint8_t* bytes, int sz) override {
+    int len = frame_len;
+    memcpy(bytes, frame, len);
+    frame_len = 0;
+    return len;
+  }
+  uint32_t getEstAirtimeFor(int len_bytes) override { return len_bytes; }
+  float packetScore(float snr, int packet_len) override { return 1.0f; }
+  bool startSendRaw(const uint8_t* bytes, int len) override {
+    sent.push_back(std::vector<uint8_t>(bytes, bytes + len));
+    return true;
+  }
+  bool isSendComplete() override { return true; }
+  void onSendFinished() override { }
+  bool isInRecvMode() const override { return true; }
+};
+
+class TestMesh : public Mesh {
+public:
+  uint32_t bundle_window = 0;
+  std::vector<uint32_t> acks;
+
+  TestMesh(Radio& radio, MillisecondClock& ms, RNG& rng, RTCClock& rtc, PacketManager& mgr, MeshTables& tables)
+    : Mesh(radio, ms, rng, rtc, mgr, tables) { }
+
+  using Mesh::setNeighbourTable;
+
+protected:
+  uint32_t getAckBundleWindow() const override { return bundle_window; }
+  bool allowPacketForward(const Packet* packet) override { return true; }
+  void onAckRecv(Packet* packet, uint32_t ack_crc) override { acks.push_back(ack_crc); }
+};
+
+struct MeshFixture : public ::testing::Test {
+  FakeClock clock;
+  FakeRTC rtc;
+  FakeRNG rng;
+  FakeRadio radio;
+  StaticPoolPacketManager mgr;
+  SimpleMeshTables tables;
+  TestMesh mesh;
+
+  MeshFixture() : mgr(8), mesh(radio, clock, rng, rtc, mgr, tables) {
+    mesh.self_id = LocalIdentity(&rng);
+    mesh.begin();
+  }
+
+  void sendAck(uint32_t crc, const uint8_t* path, uint8_t path_len) {
+    Packet* ack = mesh.createAck(crc);
+    ASSERT_TRUE(ack != NULL);
+    mesh.sendDirect(ack, path, path_len, 0);
+  }
+
+  void runFor(unsigned long millis) {
+    for (unsigned long t = 0; t < millis; t += 10) {
+      clock.now += 10;
+      mesh.loop();
+    }
+  }
+};
+
+static const uint8_t path_ab[] = { 0xA1, 0xB2 };
+static const uint8_t path_ac[] = { 0xA1, 0xC3 };
+
+TEST_F(MeshFixture, AcksNotBundledByDefault) {
+  sendAck(0x11111111, path_ab, 2);
+  sendAck(0x22222222, path_ab, 2);
+  EXPECT_EQ(mgr.getOutboundTotal(), 2);
+  EXPECT_EQ(mesh.getNumAcksBundled(), 0u);
+}
+
+TEST_F(MeshFixture, AcksToSamePathBundled) {
+  mesh.bundle_window = 200;
+  sendAck(0x11111111, path_ab, 2);
+  sendAck(0x22222222, path_ab, 2);
+  sendAck(0x33333333, path_ac, 2);   // different path
+  sendAck(0x22222222, path_ab, 2);   // already in bundle
+  EXPECT_EQ(mgr.getOutboundTotal(), 2);
+  EXPECT_EQ(mesh.getNumAcksBundled(), 2u);
+
+  runFor(100);
+  EXPECT_EQ(radio.sent.size(), 0u);   // held back for the window
+  runFor(200);
+  ASSERT_EQ(radio.sent.size(), 2u);
+
+  Packet p;
+  ASSERT_TRUE(p.readFrom(radio.sent[0].data(), radio.sent[0].size()));
+  ASSERT_EQ(p.getPayloadType(), PAYLOAD_TYPE_MULTIPART);
+  EXPECT_EQ(p.getPathByteLen(), 2);
+  EXPECT_EQ(memcmp(p.path, path_ab, 2), 0);
+  ASSERT_EQ(p.payload_len, 9);
+  EXPECT_EQ(p.payload[0], PAYLOAD_TYPE_ACK);   // remaining = 0
+  uint32_t crc;
+  memcpy(&crc, &p.payload[1], 4);
+  EXPECT_EQ(crc, 0x11111111u);
+  memcpy(&crc, &p.payload[5], 4);
+  EXPECT_EQ(crc, 0x22222222u);
+
+  ASSERT_TRUE(p.readFrom(radio.sent[1].data(), radio.sent[1].size()));
+  EXPECT_EQ(p.getPayloadType(), PAYLOAD_TYPE_ACK);   // nothing merged, so still plain
+  EXPECT_EQ(mgr.getFreeCount(), 8);
+}
+
+TEST_F(MeshFixture, BundleLimit) {
+  mesh.bundle_window = 200;
+  for (uint32_t i = 0; i < MAX_ACK_BUNDLE + 1; i++) {
+    sendAck(0x1000 + i, path_ab, 2);
+  }
+  EXPECT_EQ(mgr.getOutboundTotal(), 2);
+}
+
+TEST_F(MeshFixture, RecvBundleUnpacksAll) {
+  uint8_t frame[] = {
+    (PAYLOAD_TYPE_MULTIPART << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT,
+    0,    // zero hop, ie. to us
+    PAYLOAD_TYPE_ACK,
+    0x01, 0, 0, 0,
+    0x02, 0, 0, 0,
+    0x03, 0, 0, 0,
+  };
+  radio.inject(frame, sizeof(frame));
+  mesh.loop();
+  ASSERT_EQ(mesh.acks.size(), 3u);
+  EXPECT_EQ(mesh.acks[0], 1u);
+  EXPECT_EQ(mesh.acks[2], 3u);
+}
+
+TEST_F(MeshFixture, ForwardKeepsBundle) {
+  uint8_t frame[] = {
+    (PAYLOAD_TYPE_MULTIPART << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT,
+    2, mesh.self_id.pub_key[0], 0xB2,
+    PAYLOAD_TYPE_ACK,
+    0x01, 0, 0, 0,
+    0x02, 0, 0, 0,
+  };
+  radio.inject(frame, sizeof(frame));
+  mesh.loop();
+  runFor(1000);
+  ASSERT_EQ(radio.sent.size(), 1u);
+
+  Packet p;
+  ASSERT_TRUE(p.readFrom(radio.sent[0].data(), radio.sent[0].size()));
+  EXPECT_EQ(p.getPayloadType(), PAYLOAD_TYPE_MULTIPART);
+  ASSERT_EQ(p.getPathHashCount(), 1);
+  EXPECT_EQ(p.path[0], 0xB2);
+  ASSERT_EQ(p.payload_len, 9);
+  EXPECT_EQ(memcmp(p.payload, &frame[4], 9), 0);
+}
+
+TEST_F(MeshFixture, LearnsNeighbourLinks) {
+  SimpleNeighbourTable neighbours(4, rtc);
+  uint8_t key[PUB_KEY_SIZE];
+  memset(key, 0xB2, sizeof(key));
+  NeighbourInfo* n = neighbours.put(Identity(key), 1, 0, 0);
+  mesh.setNeighbourTable(&neighbours);
+
+  uint8_t frame[] = {
+    (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT,
+    2, mesh.self_id.pub_key[0], 0xB2,
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+  };
+  radio.inject(frame, sizeof(frame));
+  mesh.loop();
+  runFor(1000);
+  ASSERT_EQ(radio.sent.size(), 1u);   // forwarded to 0xB2
+
+  uint8_t fwd[] = {
+    (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT,
+    0,    // 0xB2 has removed itself
+    0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+  };
+  radio.inject(fwd, sizeof(fwd));
+  mesh.loop();
+  EXPECT_EQ(n->num_fwd_ok, 1);
+  EXPECT_EQ(n->num_heard, 2);
+  EXPECT_EQ(mesh.getNeighbourETX(&key[0], 1), 100);
+
+  uint8_t flood[] = {
+    (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD,
+    2, 0x44, 0xB2,    // relayed by 0xB2
+    0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+  };
+  radio.inject(flood, sizeof(flood));
+  mesh.loop();
+  EXPECT_EQ(n->num_heard, 3);
+  EXPECT_EQ(n->num_fwd_fail, 0);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <Simulator.h>
+
+static SimConfig smallMesh() {
+  SimConfig cfg;
+  cfg.num_nodes = 12;
+  cfg.seed = 7;
+  cfg.spacing = 300.0f;
+  cfg.repeater_fraction = 1.0f;
+  cfg.num_msgs = 5;
+  cfg.msg_interval = 10000;
+  cfg.drain_time = 20000;
+  return cfg;
+}
+
+TEST(MeshSim, Airtime) {
+  SimRadioParams params;   // SF8, BW62.5
+  SimChannel channel(params);
+  EXPECT_NEAR(channel.getAirtime(20), 304.1f, 0.5f);   // 36.25 preamble + 38 payload symbols, of 4.096 ms
+  EXPECT_GT(channel.getAirtime(100), channel.getAirtime(20));
+}
+
+TEST(MeshSim, Deterministic) {
+  SimConfig cfg = smallMesh();
+  cfg.num_nodes = 30;
+  cfg.spacing = 1000.0f;
+  cfg.repeater_fraction = 0.5f;
+
+  Simulator a(cfg);
+  SimReport ra = a.run();
+  Simulator b(cfg);
+  SimReport rb = b.run();
+  EXPECT_EQ(ra.num_delivered, rb.num_delivered);
+  EXPECT_EQ(ra.total_tx_airtime, rb.total_tx_airtime);
+  EXPECT_EQ(ra.num_flood_dups, rb.num_flood_dups);
+  EXPECT_EQ(ra.latency_p90, rb.latency_p90);
+  EXPECT_EQ(ra.num_collisions, rb.num_collisions);
+  EXPECT_EQ(ra.sim_millis, rb.sim_millis);
+
+  cfg.seed++;
+  Simulator c(cfg);
+  SimReport rc = c.run();
+  EXPECT_NE(ra.total_tx_airtime, rc.total_tx_airtime);
+}
+
+TEST(MeshSim, FloodReachesAll) {
+  SimConfig cfg = smallMesh();
+  Simulator sim(cfg);
+  SimReport r = sim.run();
+
+  EXPECT_EQ(r.num_expected, 5u * 11);
+  EXPECT_EQ(r.num_delivered, r.num_expected);
+  EXPECT_GT(r.num_flood_dups, 0u);    // everyone in range of everyone, so lots of dups
+  EXPECT_GT(r.latency_p50, 0u);
+  EXPECT_LE(r.latency_p50, r.latency_p99);
+  EXPECT_LT(r.pool_min_free, cfg.pool_size);
+}
+
+TEST(MeshSim, FloodMaxZeroLimitsToNeighbours) {
+  SimConfig cfg = smallMesh();
+  cfg.num_nodes = 40;
+  cfg.spacing = 1500.0f;
+  cfg.prefs.flood_max = 0;
+  Simulator sim(cfg);
+  SimReport r = sim.run();
+
+  EXPECT_EQ(r.avg_hops, 0.0f);    // nothing was forwarded
+  EXPECT_EQ(r.num_frames, (uint32_t) cfg.num_msgs);
+  EXPECT_LT(r.num_delivered, r.num_expected);
+}
+
+TEST(MeshSim, FloodSuppressionSavesAirtime) {
+  SimConfig cfg = smallMesh();
+  cfg.num_nodes = 60;
+  cfg.spacing = 600.0f;    // dense
+  cfg.repeater_fraction = 0.5f;
+  Simulator plain(cfg);
+  SimReport rp = plain.run();
+
+  cfg.prefs.flood_suppress = 2;
+  Simulator suppressed(cfg);
+  SimReport rs = suppressed.run();
+
+  EXPECT_EQ(rp.num_relays_cancelled, 0u);
+  EXPECT_GT(rs.num_relays_cancelled, 0u);
+  EXPECT_LT(rs.total_tx_airtime, rp.total_tx_airtime);
+  EXPECT_GT(rs.delivery_ratio, 0.95f);
+}
+
+TEST(MeshSim, NeighbourTablesSeededFromRadioRange) {
+  SimConfig cfg = smallMesh();
+  cfg.num_nodes = 30;
+  cfg.spacing = 1000.0f;
+  cfg.repeater_fraction = 0.5f;
+  cfg.max_neighbours = 50;
+  Simulator sim(cfg);
+
+  for (int i = 0; i < sim.getNumNodes(); i++) {
+    SimNode* node = sim.getNode(i);
+    if (!node->isRepeater()) {
+      EXPECT_TRUE(node->getNeighbours() == NULL);
+      continue;
+    }
+    int in_range = 0;
+    for (int j = 0; j < sim.getNumNodes(); j++) {
+      if (j != i && sim.getNode(j)->isRepeater() && sim.getChannel().canHear(j, i)) in_range++;
+    }
+    ASSERT_TRUE(node->getNeighbours() != NULL);
+    EXPECT_EQ(in_range, node->getNeighbours()->getCount());
+  }
+}
+
+TEST(MeshSim, FloodDelaySNROnlyReordersRelays) {
+  SimConfig cfg = smallMesh();
+  cfg.num_nodes = 60;
+  cfg.spacing = 800.0f;
+  cfg.repeater_fraction = 0.5f;
+  Simulator plain(cfg);
+  SimReport rp = plain.run();
+
+  cfg.max_neighbours = 50;   // table alone doesn't change flood timing
+  Simulator with_table(cfg);
+  SimReport rt = with_table.run();
+  EXPECT_EQ(rp.total_tx_airtime, rt.total_tx_airtime);
+  EXPECT_EQ(rp.num_delivered, rt.num_delivered);
+
+  cfg.prefs.flood_delay_snr = true;
+  Simulator scaled(cfg);
+  SimReport rs = scaled.run();
+  EXPECT_NE(rp.latency_p50, rs.latency_p50);
+  EXPECT_GT(rs.delivery_ratio, rp.delivery_ratio - 0.02f);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
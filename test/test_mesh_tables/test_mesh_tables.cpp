@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <deque>
+#include <stdlib.h>
+#include "helpers/SimpleMeshTables.h"
+
+using namespace mesh;
+
+class FakeClock : public MillisecondClock {
+public:
+    unsigned long now = 0;
+    unsigned long getMillis() override { return now; }
+};
+
+static void makePacket(Packet& pkt, uint32_t id, uint8_t route = ROUTE_TYPE_FLOOD) {
+    pkt.invalidateHash();
+    pkt.header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | route;
+    pkt.path_len = 0;
+    memcpy(pkt.payload, &id, 4);
+    pkt.payload_len = 4;
+}
+
+TEST(SimpleMeshTables, SecondSightingIsDuplicate) {
+    SimpleMeshTables tables(16);
+    Packet a, b;
+    makePacket(a, 1);
+    makePacket(b, 2, ROUTE_TYPE_DIRECT);
+
+    EXPECT_FALSE(tables.hasSeen(&a));
+    EXPECT_FALSE(tables.hasSeen(&b));
+    EXPECT_TRUE(tables.hasSeen(&a));
+    EXPECT_TRUE(tables.hasSeen(&b));
+    EXPECT_EQ(1u, tables.getNumFloodDups());
+    EXPECT_EQ(1u, tables.getNumDirectDups());
+}
+
+TEST(SimpleMeshTables, ClearForgetsPacket) {
+    SimpleMeshTables tables(16);
+    Packet a;
+    makePacket(a, 1);
+
+    tables.hasSeen(&a);
+    tables.clear(&a);
+    EXPECT_FALSE(tables.hasSeen(&a));
+    EXPECT_TRUE(tables.hasSeen(&a));
+}
+
+TEST(SimpleMeshTables, OldestEvictedWhenFull) {
+    SimpleMeshTables tables(8);
+    Packet pkt;
+    for (uint32_t i = 0; i < 9; i++) {
+        makePacket(pkt, i);
+        EXPECT_FALSE(tables.hasSeen(&pkt));
+    }
+    EXPECT_EQ(8, tables.getCount());
+
+    makePacket(pkt, 8);
+    EXPECT_TRUE(tables.hasSeen(&pkt));
+    makePacket(pkt, 0);
+    EXPECT_FALSE(tables.hasSeen(&pkt));   // was evicted
+}
+
+TEST(SimpleMeshTables, EntriesExpireByAge) {
+    FakeClock clock;
+    SimpleMeshTables tables(16);
+    tables.setClock(&clock);
+    tables.setMaxAge(60);
+
+    Packet a, b;
+    makePacket(a, 1);
+    makePacket(b, 2);
+    clock.now = 1000;
+    tables.hasSeen(&a);
+    clock.now = 40000;
+    tables.hasSeen(&b);
+
+    clock.now = 61000;
+    EXPECT_TRUE(tables.hasSeen(&a));    // exactly 60 secs old
+    clock.now = 61001;
+    EXPECT_FALSE(tables.hasSeen(&a));   // aged out, so is new again
+    EXPECT_TRUE(tables.hasSeen(&b));
+    EXPECT_TRUE(tables.hasSeen(&a));
+}
+
+TEST(PacketHash, CalculatedOncePerPacket) {
+    SimpleMeshTables tables(16);
+    SimpleMeshTables bridge_seen(16);
+    Packet a;
+    makePacket(a, 1);
+
+    Packet::resetHashStats();
+    tables.hasSeen(&a);
+    bridge_seen.hasSeen(&a);
+    tables.clear(&a);
+    tables.hasSeen(&a);
+    EXPECT_EQ(1u, Packet::getNumHashCalcs());
+    EXPECT_EQ(4u, Packet::getNumHashLookups());
+}
+
+TEST(PacketHash, InvalidatedByReadFrom) {
+    Packet a, b;
+    makePacket(a, 1);
+    makePacket(b, 2);
+    uint8_t h1[MAX_HASH_SIZE], h2[MAX_HASH_SIZE], raw[MAX_TRANS_UNIT];
+    a.calculatePacketHash(h1);
+    b.calculatePacketHash(h2);
+    EXPECT_NE(0, memcmp(h1, h2, MAX_HASH_SIZE));
+
+    uint8_t len = b.writeTo(raw);
+    ASSERT_TRUE(a.readFrom(raw, len));
+    a.calculatePacketHash(h1);
+    EXPECT_EQ(0, memcmp(h1, h2, MAX_HASH_SIZE));
+}
+
+TEST(PacketHash, TracePathLenChangeNeedsInvalidate) {
+    Packet a;
+    makePacket(a, 1, ROUTE_TYPE_DIRECT);
+    a.header = (PAYLOAD_TYPE_TRACE << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT;
+    a.invalidateHash();
+    uint8_t h1[MAX_HASH_SIZE], h2[MAX_HASH_SIZE];
+    a.calculatePacketHash(h1);
+    a.path_len++;
+    a.invalidateHash();
+    a.calculatePacketHash(h2);
+    EXPECT_NE(0, memcmp(h1, h2, MAX_HASH_SIZE));
+}
+
+// random hasSeen()/clear() sequence against a simple FIFO model
+TEST(SimpleMeshTables, MatchesFifoModel) {
+    const int cap = 64;
+    SimpleMeshTables tables(cap);
+    struct ModelEntry { uint32_t id; bool live; };
+    std::deque<ModelEntry> model;
+    srand(99);
+
+    Packet pkt;
+    for (int n = 0; n < 50000; n++) {
+        uint32_t id = rand() % 200;
+        makePacket(pkt, id);
+
+        auto it = model.begin();
+        for (; it != model.end(); ++it) {
+            if (it->live && it->id == id) break;
+        }
+        if (rand() % 5 == 0) {
+            if (it != model.end()) it->live = false;
+            tables.clear(&pkt);
+        } else {
+            bool expected = it != model.end();
+            if (!expected) {
+                if ((int)model.size() == cap) model.pop_front();
+                model.push_back({ id, true });
+            }
+            ASSERT_EQ(expected, tables.hasSeen(&pkt)) << "at step " << n;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
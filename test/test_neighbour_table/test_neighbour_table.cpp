@@ -0,0 +1,154 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <helpers/SimpleNeighbourTable.h>
+
+using namespace mesh;
+
+class FakeRTC : public RTCClock {
+public:
+  uint32_t now = 1700000000;
+  uint32_t getCurrentTime() override { return now; }
+  void setCurrentTime(uint32_t time) override { now = time; }
+};
+
+static Identity makeId(uint8_t first, uint8_t second = 0) {
+  uint8_t key[PUB_KEY_SIZE];
+  memset(key, 0x55, sizeof(key));
+  key[0] = first;
+  key[1] = second;
+  return Identity(key);
+}
+
+static void makeDirect(Packet& pkt, const uint8_t* path, uint8_t path_count, uint8_t tag) {
+  pkt.header = ROUTE_TYPE_DIRECT | (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT);
+  pkt.setPathHashSizeAndCount(1, path_count);
+  memcpy(pkt.path, path, path_count);
+  pkt.payload_len = 8;
+  memset(pkt.payload, tag, pkt.payload_len);
+  pkt.invalidateHash();
+}
+
+TEST(SimpleNeighbourTable, KeptSortedAndLookedUpByHash) {
+  FakeRTC rtc;
+  SimpleNeighbourTable table(8, rtc);
+  table.put(makeId(0x30), 1, 5.0f, -80.0f);
+  table.put(makeId(0x10), 1, 5.0f, -80.0f);
+  table.put(makeId(0x20), 1, 5.0f, -80.0f);
+  ASSERT_EQ(table.getCount(), 3);
+  EXPECT_EQ(table.getByIdx(0)->id.pub_key[0], 0x10);
+  EXPECT_EQ(table.getByIdx(1)->id.pub_key[0], 0x20);
+  EXPECT_EQ(table.getByIdx(2)->id.pub_key[0], 0x30);
+
+  uint8_t hash = 0x20;
+  ASSERT_NE(table.lookup(&hash, 1), (NeighbourInfo*)NULL);
+  EXPECT_EQ(table.lookup(&hash, 1)->id.pub_key[0], 0x20);
+  hash = 0x21;
+  EXPECT_EQ(table.lookup(&hash, 1), (NeighbourInfo*)NULL);
+
+  table.put(makeId(0x20, 0x01), 1, 5.0f, -80.0f);   // 1 byte hash now ambiguous
+  hash = 0x20;
+  EXPECT_EQ(table.lookup(&hash, 1), (NeighbourInfo*)NULL);
+  uint8_t hash2[] = { 0x20, 0x01 };
+  ASSERT_NE(table.lookup(hash2, 2), (NeighbourInfo*)NULL);
+  EXPECT_EQ(table.lookup(hash2, 2)->id.pub_key[1], 0x01);
+
+  EXPECT_EQ(table.remove(&hash, 1), 2);
+  EXPECT_EQ(table.getCount(), 2);
+  EXPECT_EQ(table.remove(&hash, 0), 2);   // empty prefix matches all
+  EXPECT_EQ(table.getCount(), 0);
+}
+
+TEST(SimpleNeighbourTable, ReplacesLeastRecentlyHeard) {
+  FakeRTC rtc;
+  SimpleNeighbourTable table(2, rtc);
+  table.put(makeId(0x10), 1, 0, 0);
+  rtc.now++;
+  table.put(makeId(0x20), 1, 0, 0);
+  rtc.now++;
+  uint8_t hash = 0x10;
+  table.onHeard(&hash, 1, 0, 0);   // 0x20 is now the least recently heard
+  rtc.now++;
+  table.put(makeId(0x30), 1, 0, 0);
+
+  ASSERT_EQ(table.getCount(), 2);
+  EXPECT_EQ(table.getByIdx(0)->id.pub_key[0], 0x10);
+  EXPECT_EQ(table.getByIdx(1)->id.pub_key[0], 0x30);
+}
+
+TEST(SimpleNeighbourTable, AveragesSignal) {
+  FakeRTC rtc;
+  SimpleNeighbourTable table(4, rtc);
+  NeighbourInfo* n = table.put(makeId(0x10), 1, 8.0f, -60.0f);
+  EXPECT_FLOAT_EQ(n->snr_avg, 8.0f);
+  EXPECT_FLOAT_EQ(n->rssi_avg, -60.0f);
+
+  uint8_t hash = 0x10;
+  table.onHeard(&hash, 1, 0.0f, -100.0f);
+  EXPECT_FLOAT_EQ(n->snr_avg, 8.0f - NEIGHBOUR_AVG_WEIGHT * 8.0f);
+  EXPECT_FLOAT_EQ(n->rssi_avg, -60.0f - NEIGHBOUR_AVG_WEIGHT * 40.0f);
+  EXPECT_EQ(n->snr, 0);   // last heard
+  EXPECT_EQ(n->num_heard, 2);
+
+  hash = 0x11;
+  table.onHeard(&hash, 1, 0.0f, -100.0f);   // unknown, ignored
+  EXPECT_EQ(table.getCount(), 1);
+}
+
+TEST(SimpleNeighbourTable, LearnsDeliveryFromForwardedDirectPackets) {
+  FakeRTC rtc;
+  SimpleNeighbourTable table(4, rtc);
+  NeighbourInfo* n = table.put(makeId(0x10), 1, 0, 0);
+  uint8_t hop = 0x10;
+  EXPECT_EQ(table.getETX(&hop, 1), 100);   // optimistic, until tried
+
+  const uint8_t path[] = { 0x10, 0x44 };
+  Packet sent, fwd;
+  makeDirect(sent, path, 2, 1);
+  table.onDirectSent(&sent, 1000);
+
+  makeDirect(fwd, &path[1], 1, 2);   // a different packet
+  table.onDirectHeard(&fwd, 1200);
+  makeDirect(fwd, &path[1], 1, 1);   // our packet, forwarded by next hop
+  table.onDirectHeard(&fwd, 1500);
+  EXPECT_EQ(n->num_fwd_ok, 1);
+  EXPECT_EQ(n->num_fwd_fail, 0);
+  EXPECT_EQ(table.getETX(&hop, 1), 100);
+
+  makeDirect(sent, path, 2, 3);
+  table.onDirectSent(&sent, 2000);
+  table.checkTimeouts(2000 + NEIGHBOUR_FWD_TIMEOUT_MILLIS - 1);
+  EXPECT_EQ(n->num_fwd_fail, 0);
+  table.checkTimeouts(2000 + NEIGHBOUR_FWD_TIMEOUT_MILLIS);
+  EXPECT_EQ(n->num_fwd_fail, 1);
+  EXPECT_FLOAT_EQ(n->delivery, 1.0f - NEIGHBOUR_AVG_WEIGHT);
+  EXPECT_EQ(table.getETX(&hop, 1), (uint16_t)(100.0f / n->delivery + 0.5f));
+
+  for (int i = 0; i < 100; i++) {   // never forwarded
+    makeDirect(sent, path, 2, 10 + i);
+    table.onDirectSent(&sent, 20000 + i*10000);
+  }
+  table.checkTimeouts(2000000);
+  EXPECT_FLOAT_EQ(n->delivery, NEIGHBOUR_MIN_DELIVERY);
+
+  hop = 0x44;
+  EXPECT_EQ(table.getETX(&hop, 1), 0);   // not a neighbour
+}
+
+TEST(SimpleNeighbourTable, IgnoresUnknownNextHop) {
+  FakeRTC rtc;
+  SimpleNeighbourTable table(4, rtc);
+  NeighbourInfo* n = table.put(makeId(0x10), 1, 0, 0);
+
+  const uint8_t path[] = { 0x22, 0x10 };
+  Packet sent;
+  makeDirect(sent, path, 2, 1);
+  table.onDirectSent(&sent, 1000);
+  table.checkTimeouts(1000 + NEIGHBOUR_FWD_TIMEOUT_MILLIS);
+  EXPECT_EQ(n->num_fwd_fail, 0);
+  EXPECT_FLOAT_EQ(n->delivery, 1.0f);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
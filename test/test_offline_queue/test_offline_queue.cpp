@@ -0,0 +1,101 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "../../examples/companion_radio/OfflineQueue.h"
+
+class FakeRTC : public mesh::RTCClock {
+public:
+  uint32_t getCurrentTime() override { return 1700000000; }
+  void setCurrentTime(uint32_t time) override { }
+};
+
+static bool addFrame(OfflineQueue& q, int n, bool is_channel_msg) {
+  uint8_t frame[8];
+  memset(frame, 0, sizeof(frame));
+  frame[0] = n;
+  frame[1] = n >> 8;
+  return q.add(frame, sizeof(frame), is_channel_msg);
+}
+
+static int getFrame(OfflineQueue& q) {
+  uint8_t frame[MAX_FRAME_SIZE];
+  int len = q.get(frame);
+  return len > 0 ? frame[0] | (frame[1] << 8) : -1;
+}
+
+class OfflineQueueTest : public ::testing::Test {
+protected:
+  fs::FS fs;
+  FakeRTC rtc;
+  DataStore* store;
+  OfflineQueue queue;
+
+  void SetUp() override {
+    store = new DataStore(fs, rtc);
+    queue.begin(store);
+  }
+  void TearDown() override { delete store; }
+};
+
+TEST_F(OfflineQueueTest, SpillsToFileInOrder) {
+  for (int i = 0; i < 40; i++) ASSERT_TRUE(addFrame(queue, i, (i % 3) == 0));
+  EXPECT_EQ(queue.size(), 40);
+  EXPECT_EQ(queue.getNumInFlash(), 40 - OFFLINE_QUEUE_SIZE);
+  EXPECT_TRUE(fs.exists("/offline_q"));
+  EXPECT_TRUE(fs.exists("/offline_qc"));
+
+  for (int i = 0; i < 40; i++) EXPECT_EQ(getFrame(queue), i);
+  EXPECT_EQ(getFrame(queue), -1);
+  EXPECT_EQ(queue.getNumInFlash(), 0);
+}
+
+TEST_F(OfflineQueueTest, SkipsUnreadableSlot) {
+  const int ram = OFFLINE_QUEUE_SIZE / 2;
+  for (int i = 0; i < ram + 4; i++) ASSERT_TRUE(addFrame(queue, i, false));
+  fs.files["/offline_q"][OFFLINE_SLOT_SIZE + 4] = 0xFF;   // 2nd slot's len, now invalid
+
+  for (int i = 0; i < ram; i++) EXPECT_EQ(getFrame(queue), i);
+  EXPECT_EQ(getFrame(queue), ram);
+  EXPECT_EQ(getFrame(queue), ram + 2);   // ram + 1 lost, but not the ones after it
+  EXPECT_EQ(getFrame(queue), ram + 3);
+  EXPECT_EQ(queue.size(), 0);
+}
+
+TEST_F(OfflineQueueTest, UnreadableSlotsDoNotStrandFile) {
+  const int ram = OFFLINE_QUEUE_SIZE / 2;
+  for (int i = 0; i < 2*ram + 2; i++) ASSERT_TRUE(addFrame(queue, i, false));
+  for (int i = 0; i < ram; i++) fs.files["/offline_q"][i*OFFLINE_SLOT_SIZE + 4] = 0xFF;   // as many as fit in RAM
+
+  for (int i = 0; i < ram; i++) ASSERT_EQ(getFrame(queue), i);
+  EXPECT_EQ(queue.size(), 2);
+  EXPECT_EQ(getFrame(queue), 2*ram);   // ie. peek() still sees the rest
+  EXPECT_EQ(getFrame(queue), 2*ram + 1);
+  EXPECT_EQ(queue.getNumInFlash(), 0);
+}
+
+TEST_F(OfflineQueueTest, ChannelMsgsEvictOldestChannelMsg) {
+  const int lane_max = OFFLINE_QUEUE_SIZE / 2 + OFFLINE_SPILL_FRAMES;
+  for (int i = 0; i < lane_max + 5; i++) addFrame(queue, i, true);
+  EXPECT_EQ(queue.getNumChannelMsgs(), lane_max);
+  EXPECT_EQ(queue.getNumEvicted(), 5u);
+  EXPECT_EQ(getFrame(queue), 5);
+}
+
+TEST_F(OfflineQueueTest, BulkReadThenAck) {
+  for (int i = 0; i < 20; i++) addFrame(queue, i, (i & 1) != 0);
+  QueuedFrame f;
+  for (int i = 0; i < 12; i++) {
+    ASSERT_TRUE(queue.readNext(f));
+    EXPECT_EQ(f.buf[0], i);
+  }
+  EXPECT_EQ(queue.getNumUnread(), 8);
+  EXPECT_EQ(queue.ack(f.seq), 12);
+  EXPECT_EQ(queue.getNumUnread(), 8);
+  ASSERT_TRUE(queue.readNext(f));
+  EXPECT_EQ(f.buf[0], 12);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
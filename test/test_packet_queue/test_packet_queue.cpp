@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include "helpers/StaticPoolPacketManager.h"
+
+using namespace mesh;
+
+#define NUM_PACKETS  64
+
+static Packet packets[NUM_PACKETS];
+
+TEST(PacketScheduler, EmptyReturnsNull) {
+    PacketScheduler q(8);
+
+    EXPECT_EQ(nullptr, q.get(1000));
+    EXPECT_FALSE(q.hasReady(1000));
+    EXPECT_EQ(0, q.count());
+}
+
+TEST(PacketScheduler, FutureEntriesAreHeld) {
+    PacketScheduler q(8);
+    q.add(&packets[0], 0, 2000);
+
+    EXPECT_FALSE(q.hasReady(1000));
+    EXPECT_EQ(0, q.countBefore(1000));
+    EXPECT_EQ(nullptr, q.get(1000));
+    EXPECT_EQ(1, q.countBefore(0xFFFFFFFF));
+
+    EXPECT_TRUE(q.hasReady(2000));
+    EXPECT_EQ(&packets[0], q.get(2000));
+    EXPECT_EQ(0, q.count());
+}
+
+TEST(PacketScheduler, BestPriorityFirstThenFifo) {
+    PacketScheduler q(8);
+    q.add(&packets[0], 3, 100);
+    q.add(&packets[1], 1, 200);
+    q.add(&packets[2], 1, 50);
+    q.add(&packets[3], 0, 5000);   // best priority, but not due yet
+
+    EXPECT_EQ(3, q.countBefore(1000));
+    EXPECT_EQ(&packets[1], q.get(1000));   // priority 1, added before packets[2]
+    EXPECT_EQ(&packets[2], q.get(1000));
+    EXPECT_EQ(&packets[0], q.get(1000));
+    EXPECT_EQ(nullptr, q.get(1000));
+    EXPECT_EQ(&packets[3], q.get(5000));
+}
+
+TEST(PacketScheduler, HandlesMillisWrapAround) {
+    PacketScheduler q(8);
+    q.add(&packets[0], 0, 0x00000010);      // after the wrap
+    q.add(&packets[1], 0, 0xFFFFFFF0);      // before the wrap
+
+    EXPECT_EQ(nullptr, q.get(0xFFFFFF00));
+    EXPECT_EQ(&packets[1], q.get(0xFFFFFFF8));
+    EXPECT_EQ(nullptr, q.get(0xFFFFFFF8));
+    EXPECT_EQ(&packets[0], q.get(0x00000020));
+}
+
+TEST(PacketScheduler, RejectsWhenFull) {
+    PacketScheduler q(2);
+
+    EXPECT_TRUE(q.add(&packets[0], 0, 0));
+    EXPECT_TRUE(q.add(&packets[1], 0, 0));
+    EXPECT_FALSE(q.add(&packets[2], 0, 0));
+    EXPECT_EQ(2, q.count());
+}
+
+TEST(PacketScheduler, RemoveByIdxCoversAllEntries) {
+    PacketScheduler q(8);
+    for (int i = 0; i < 6; i++) {
+        q.add(&packets[i], i % 3, i * 100);
+    }
+    q.get(250);   // promotes some entries to 'ready'
+
+    bool seen[6] = { };
+    seen[0] = true;   // the one just returned by get()
+    while (q.count() > 0) {
+        Packet* p = q.removeByIdx(q.count() - 1);
+        ASSERT_NE(nullptr, p);
+        int k = p - packets;
+        EXPECT_FALSE(seen[k]);
+        seen[k] = true;
+    }
+    for (int i = 0; i < 6; i++) EXPECT_TRUE(seen[i]);
+    EXPECT_EQ(nullptr, q.removeByIdx(0));
+}
+
+// random sequence of operations, must give same results as the original linear PacketQueue
+TEST(PacketScheduler, MatchesPacketQueue) {
+    PacketQueue ref(NUM_PACKETS);
+    PacketScheduler q(NUM_PACKETS);
+    srand(1234);
+
+    uint32_t now = 0xFFFF0000;   // so that millis wrap-around is exercised
+    int next_pkt = 0;
+    for (int n = 0; n < 20000; n++) {
+        int op = rand() % 10;
+        if (op < 5 && ref.count() < NUM_PACKETS) {
+            uint8_t pri = rand() % 6;
+            uint32_t sched = now + (rand() % 2000);
+            Packet* p = &packets[next_pkt];
+            next_pkt = (next_pkt + 1) % NUM_PACKETS;
+            ASSERT_EQ(ref.add(p, pri, sched), q.add(p, pri, sched));
+        } else if (op < 9) {
+            ASSERT_EQ(ref.countBefore(now), q.countBefore(now));
+            ASSERT_EQ(ref.countBefore(now) > 0, q.hasReady(now));
+            ASSERT_EQ(ref.get(now), q.get(now));
+        } else {
+            now += rand() % 500;
+        }
+        ASSERT_EQ(ref.count(), q.count());
+    }
+}
+
+TEST(StaticPoolPacketManager, AllocAndFreeAreFifo) {
+    StaticPoolPacketManager mgr(4);
+    Packet* a = mgr.allocNew();
+    Packet* b = mgr.allocNew();
+
+    EXPECT_EQ(2, mgr.getFreeCount());
+    mgr.free(a);
+    Packet* c = mgr.allocNew();
+    Packet* d = mgr.allocNew();
+    EXPECT_NE(a, c);   // freed packet goes to back of the pool
+    EXPECT_EQ(a, mgr.allocNew());
+    EXPECT_EQ(nullptr, mgr.allocNew());
+    EXPECT_EQ(0, mgr.getFreeCount());
+
+    mgr.free(b); mgr.free(c); mgr.free(d); mgr.free(a);
+    EXPECT_EQ(4, mgr.getFreeCount());
+}
+
+TEST(StaticPoolPacketManager, OutboundReady) {
+    StaticPoolPacketManager mgr(4);
+    EXPECT_FALSE(mgr.hasOutboundReady(1000));
+    mgr.queueOutbound(mgr.allocNew(), 1, 2000);
+    EXPECT_FALSE(mgr.hasOutboundReady(1999));
+    EXPECT_TRUE(mgr.hasOutboundReady(2000));
+    EXPECT_EQ(mgr.hasOutboundReady(2000), mgr.getOutboundCount(2000) > 0);
+}
+
+TEST(StaticPoolPacketManager, TracksLowWaterMark) {
+    StaticPoolPacketManager mgr(8);
+    Packet* held[5];
+    for (int i = 0; i < 5; i++) held[i] = mgr.allocNew();
+    for (int i = 0; i < 5; i++) mgr.free(held[i]);
+
+    EXPECT_EQ(8, mgr.getFreeCount());
+    EXPECT_EQ(3, mgr.getMinFreeCount());
+    mgr.resetMinFreeCount();
+    EXPECT_EQ(8, mgr.getMinFreeCount());
+}
+
+TEST(StaticPoolPacketManager, IgnoresForeignFree) {
+    StaticPoolPacketManager mgr(4);
+    Packet* a = mgr.allocNew();
+    mgr.free(&packets[0]);   // not from this pool
+    EXPECT_EQ(3, mgr.getFreeCount());
+    mgr.free(a);
+    EXPECT_EQ(4, mgr.getFreeCount());
+}
+
+TEST(StaticPoolPacketManager, IgnoresFreeWhenPoolFull) {
+    // the only double free() a release build can detect
+    StaticPoolPacketManager mgr(4);
+    Packet* a = mgr.allocNew();
+    mgr.free(a);
+    mgr.free(a);
+    EXPECT_EQ(4, mgr.getFreeCount());
+    for (int i = 0; i < 4; i++) {
+        EXPECT_NE(nullptr, mgr.allocNew());
+    }
+    EXPECT_EQ(nullptr, mgr.allocNew());
+}
+
+#if MESH_DEBUG
+TEST(StaticPoolPacketManager, CountsDoubleFree) {
+    StaticPoolPacketManager mgr(4);
+    Packet* a = mgr.allocNew();
+    Packet* b = mgr.allocNew();
+    mgr.free(a);
+    mgr.free(a);
+
+    EXPECT_EQ(3, mgr.getFreeCount());
+    mgr.free(b);
+    mgr.free(b);
+    EXPECT_EQ(4, mgr.getFreeCount());
+    EXPECT_EQ(2u, mgr.getNumDoubleFrees());
+}
+#endif
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
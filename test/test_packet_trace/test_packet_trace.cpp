@@ -0,0 +1,148 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+
+#include <helpers/PacketTraceLog.h>
+
+using namespace mesh;
+
+static void makePacket(Packet& pkt, uint8_t type, uint8_t route, uint8_t path_len) {
+  pkt.header = (type << PH_TYPE_SHIFT) | route;
+  pkt.path_len = path_len;
+  memset(pkt.path, 0xA5, path_len);
+  pkt.payload_len = 10;
+  for (int i = 0; i < pkt.payload_len; i++) pkt.payload[i] = i;
+}
+
+TEST(PacketTraceBuffer, AddRecord) {
+  PacketTraceBuffer buf;
+  Packet pkt;
+  makePacket(pkt, PAYLOAD_TYPE_ADVERT, ROUTE_TYPE_FLOOD, 2);
+
+  ASSERT_TRUE(buf.add(TRACE_EVENT_RX, &pkt, NULL, 14, 7.25f, -95.0f, 0.85f, 1700000000, 0x12345));
+  ASSERT_EQ(buf.getNumBuffered(), 1);
+
+  const PacketTraceRecord* rec = buf.getRecord(0);
+  EXPECT_EQ(rec->seq, 1u);
+  EXPECT_EQ(rec->timestamp, 1700000000u);
+  EXPECT_EQ(rec->millis, 0x2345);
+  EXPECT_EQ(rec->event, TRACE_EVENT_RX);
+  EXPECT_EQ(rec->header, pkt.header);
+  EXPECT_EQ(rec->snr, 29);
+  EXPECT_EQ(rec->rssi, -95);
+  EXPECT_EQ(rec->score, 85);
+  EXPECT_EQ(rec->len, 14);
+  EXPECT_EQ(rec->path_len, 2);
+
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt.calculatePacketHash(hash);
+  EXPECT_EQ(memcmp(rec->hash, hash, sizeof(rec->hash)), 0);
+
+  buf.add(TRACE_EVENT_TX, &pkt, NULL, 14, 0, 0, 0, 1700000001, 0);
+  EXPECT_EQ(buf.getRecord(1)->seq, 2u);
+}
+
+TEST(PacketTraceBuffer, Clamping) {
+  PacketTraceBuffer buf;
+  Packet pkt;
+  makePacket(pkt, PAYLOAD_TYPE_TXT_MSG, ROUTE_TYPE_DIRECT, 0);
+
+  buf.add(TRACE_EVENT_RX, &pkt, NULL, 12, -10.0f, -140.0f, 3.5f, 0, 0);
+  const PacketTraceRecord* rec = buf.getRecord(0);
+  EXPECT_EQ(rec->snr, -40);
+  EXPECT_EQ(rec->rssi, -128);
+  EXPECT_EQ(rec->score, 255);
+}
+
+TEST(PacketTraceBuffer, FullDrops) {
+  PacketTraceBuffer buf;
+  Packet pkt;
+  makePacket(pkt, PAYLOAD_TYPE_ACK, ROUTE_TYPE_DIRECT, 1);
+
+  for (int i = 0; i < PACKET_TRACE_BUF_RECORDS; i++) {
+    EXPECT_TRUE(buf.add(TRACE_EVENT_TX, &pkt, NULL, 8, 0, 0, 0, 0, 0));
+  }
+  EXPECT_TRUE(buf.isFull());
+  EXPECT_FALSE(buf.add(TRACE_EVENT_TX, &pkt, NULL, 8, 0, 0, 0, 0, 0));
+  EXPECT_EQ(buf.getNumBuffered(), PACKET_TRACE_BUF_RECORDS);
+  EXPECT_EQ(buf.getNumDropped(), 1u);
+}
+
+TEST(PacketTraceBuffer, FormatRecord) {
+  PacketTraceRecord rec;
+  memset(&rec, 0, sizeof(rec));
+  rec.seq = 1;
+  rec.event = TRACE_EVENT_RX;
+  rec.header = (PAYLOAD_TYPE_ADVERT << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+  rec.len = 40;
+  rec.path_len = 2;
+  rec.snr = 32;
+  rec.rssi = -90;
+  rec.score = 85;
+  rec.hash[0] = 0xAA; rec.hash[1] = 0xBB; rec.hash[2] = 0xCC; rec.hash[3] = 0xDD;
+
+  char text[120];
+  PacketTraceBuffer::formatRecord(text, rec, NULL);
+  EXPECT_STREQ(text, "RX, len=40 (type=4, route=F, path_len=2) SNR=8 RSSI=-90 score=850 hash=AABBCCDD");
+
+  rec.event = TRACE_EVENT_TX;
+  rec.header = (PAYLOAD_TYPE_TXT_MSG << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT;
+  PacketTraceBuffer::formatRecord(text, rec, NULL);
+  EXPECT_STREQ(text, "TX, len=40 (type=2, route=D, path_len=2) hash=AABBCCDD");
+}
+
+static void collectSeq(void* ctx, const PacketTraceRecord& rec, const uint8_t* raw) {
+  ((std::vector<uint32_t> *) ctx)->push_back(rec.seq);
+}
+
+TEST(PacketTraceLog, WrapsAndSurvivesReboot) {
+  fs::FS fs;
+  Packet pkt;
+  makePacket(pkt, PAYLOAD_TYPE_TXT_MSG, ROUTE_TYPE_FLOOD, 1);
+
+  PacketTraceLog* log = new PacketTraceLog("/trace");
+  log->begin(&fs);
+  const int n = PACKET_TRACE_SLOTS + 10;
+  for (int i = 0; i < n; i++) {
+    log->add(TRACE_EVENT_RX, &pkt, NULL, 20, 0, 0, 0, 1700000000, i);
+  }
+  log->flush();
+  EXPECT_EQ(fs.files["/trace"].size(), sizeof(PacketTraceFileHeader) + PACKET_TRACE_SLOTS*PACKET_TRACE_SLOT_SIZE);
+
+  std::vector<uint32_t> seqs;
+  log->forEachRecord(collectSeq, &seqs);
+  ASSERT_EQ(seqs.size(), (size_t) PACKET_TRACE_SLOTS);
+  EXPECT_EQ(seqs.front(), 11u);   // oldest ones overwritten
+  EXPECT_EQ(seqs.back(), (uint32_t) n);
+  delete log;
+
+  // after reboot, the old records can be viewed before anything new is logged
+  log = new PacketTraceLog("/trace");
+  log->begin(&fs);
+  seqs.clear();
+  log->forEachRecord(collectSeq, &seqs);
+  ASSERT_EQ(seqs.size(), (size_t) PACKET_TRACE_SLOTS);
+  EXPECT_EQ(seqs.back(), (uint32_t) n);
+
+  log->add(TRACE_EVENT_TX, &pkt, NULL, 20, 0, 0, 0, 1700000001, 0);   // carries on the numbering
+  seqs.clear();
+  log->forEachRecord(collectSeq, &seqs);
+  EXPECT_EQ(seqs.back(), (uint32_t) n + 1);
+  EXPECT_EQ(seqs.front(), 12u);
+  delete log;
+}
+
+TEST(PacketTraceLog, NoFileUntilFlushed) {
+  fs::FS fs;
+  PacketTraceLog log("/trace");
+  log.begin(&fs);
+  std::vector<uint32_t> seqs;
+  log.forEachRecord(collectSeq, &seqs);
+  EXPECT_TRUE(seqs.empty());
+  EXPECT_FALSE(fs.exists("/trace"));   // viewing doesn't create the file
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
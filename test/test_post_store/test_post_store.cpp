@@ -0,0 +1,122 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include "../../examples/simple_room_server/PostStore.h"
+
+static mesh::Identity makeAuthor(uint8_t first) {
+  uint8_t key[PUB_KEY_SIZE];
+  memset(key, 0x33, sizeof(key));
+  key[0] = first;
+  return mesh::Identity(key);
+}
+
+static void addPosts(PostStore& store, int from, int to) {
+  for (int i = from; i < to; i++) {
+    char text[32];
+    sprintf(text, "post %d", i);
+    store.add(makeAuthor(i & 3), 1000 + i*10, text);
+  }
+}
+
+static void expectPost(PostStore& store, uint32_t seq) {
+  PostInfo p;
+  ASSERT_TRUE(store.get(seq, p));
+  char text[32];
+  sprintf(text, "post %d", (int) seq - 1);
+  EXPECT_STREQ(p.text, text);
+  EXPECT_EQ(p.post_timestamp, 1000 + (seq - 1)*10);
+  EXPECT_EQ(p.author.pub_key[0], (seq - 1) & 3);
+}
+
+TEST(PostStore, RingWraps) {
+  fs::FS fs;
+  PostStore store(8, 2);
+  store.begin(&fs);
+  addPosts(store, 0, 20);
+
+  EXPECT_EQ(store.getCount(), 8);
+  EXPECT_EQ(store.getFirstSeq(), 13u);
+  EXPECT_EQ(store.getNextSeq(), 21u);
+  EXPECT_EQ(fs.files[POST_STORE_FILE].size(), 8u * POST_RECORD_SIZE);   // file doesn't grow past ring
+
+  PostInfo p;
+  EXPECT_FALSE(store.get(12, p));   // overwritten
+  for (uint32_t seq = 13; seq <= 20; seq++) expectPost(store, seq);   // mostly from file, as cache is small
+  EXPECT_TRUE(store.isAuthor(14, makeAuthor(13 & 3)));
+  EXPECT_FALSE(store.isAuthor(14, makeAuthor(14 & 3)));
+}
+
+TEST(PostStore, SyncCursorByTimestamp) {
+  fs::FS fs;
+  PostStore store(8, 2);
+  store.begin(&fs);
+  addPosts(store, 0, 20);
+
+  EXPECT_EQ(store.findFirstAfter(0), 13u);             // older ones are gone
+  EXPECT_EQ(store.findFirstAfter(1000 + 14*10), 16u);  // ie. after post 14, which is seq 15
+  EXPECT_EQ(store.findFirstAfter(1000 + 14*10 - 1), 15u);
+  EXPECT_EQ(store.findFirstAfter(1000 + 19*10), 21u);  // none
+
+  const PostInfo& p = store.add(makeAuthor(1), 500, "clock went back");
+  EXPECT_EQ(p.post_timestamp, 1000 + 19*10 + 1);       // still increasing
+  EXPECT_EQ(store.findFirstAfter(1000 + 19*10), 21u);
+}
+
+TEST(PostStore, ReloadsAfterReboot) {
+  fs::FS fs;
+  {
+    PostStore store(8, 2);
+    store.begin(&fs);
+    addPosts(store, 0, 5);
+  }
+  {
+    PostStore store(8, 2);
+    store.begin(&fs);
+    EXPECT_EQ(store.getFirstSeq(), 1u);
+    EXPECT_EQ(store.getNextSeq(), 6u);
+    addPosts(store, 5, 19);   // wraps
+  }
+  PostStore store(8, 2);
+  store.begin(&fs);
+  EXPECT_EQ(store.getFirstSeq(), 12u);
+  EXPECT_EQ(store.getNextSeq(), 20u);
+  for (uint32_t seq = 12; seq < 20; seq++) expectPost(store, seq);
+  EXPECT_EQ(store.findFirstAfter(1000 + 12*10), 14u);
+
+  PostStore bigger(16, 2);   // ie. POST_STORE_MAX_POSTS changed, keeps what is still in expected slots
+  bigger.begin(&fs);
+  EXPECT_EQ(bigger.getNextSeq(), 20u);
+  EXPECT_GT(bigger.getCount(), 0);
+  for (uint32_t seq = bigger.getFirstSeq(); seq < 20; seq++) expectPost(bigger, seq);
+}
+
+TEST(PostStore, StopsGrowingWhenStorageLow) {
+  fs::FS fs;
+  fs.capacity = (POST_STORE_MIN_FREE_KB + 2) * 1024;   // room for ~10 posts, above the floor
+  PostStore store(64, 2);
+  store.begin(&fs);
+  addPosts(store, 0, 40);
+
+  int slots = fs.files[POST_STORE_FILE].size() / POST_RECORD_SIZE;
+  EXPECT_GT(slots, 0);
+  EXPECT_LT(slots, 16);
+  EXPECT_GE(fs.capacity - fs.usedBytes() + POST_RECORD_SIZE, (size_t) POST_STORE_MIN_FREE_KB * 1024);   // checked before each record
+  EXPECT_EQ(store.getCount(), slots);   // ring wrapped at file size
+  EXPECT_EQ(store.getNextSeq(), 41u);
+  for (uint32_t seq = store.getFirstSeq(); seq < 41; seq++) expectPost(store, seq);
+
+  fs.capacity = 1024*1024;   // more space later, ring stays same size
+  PostStore reloaded(64, 2);
+  reloaded.begin(&fs);
+  EXPECT_EQ(reloaded.getFirstSeq(), store.getFirstSeq());
+  EXPECT_EQ(reloaded.getNextSeq(), 41u);
+  addPosts(reloaded, 40, 50);
+  EXPECT_EQ(reloaded.getCount(), slots);
+  EXPECT_EQ((int) (fs.files[POST_STORE_FILE].size() / POST_RECORD_SIZE), slots);
+  for (uint32_t seq = reloaded.getFirstSeq(); seq < 51; seq++) expectPost(reloaded, seq);
+}
+
+int main(int argc, char **argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,207 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <vector>
+#include <helpers/RoomPushWindow.h>
+
+// in-memory stand-in for the room's PostStore: post 'seq' has timestamp 1000 + seq, and a ring of 'max_posts'
+class FakePosts : public RoomPostSource {
+public:
+  uint32_t first_seq = 1, next_seq = 1;
+  int max_posts = 32;
+  std::vector<uint8_t> authors;   // by seq, first byte of author's pub_key
+
+  void add(uint8_t author) {
+    if (authors.size() <= next_seq) authors.resize(next_seq + 1);
+    authors[next_seq++] = author;
+    if ((int)(next_seq - first_seq) > max_posts) first_seq++;   // oldest overwritten
+  }
+  static uint32_t timestampOf(uint32_t seq) { return 1000 + seq; }
+
+  uint32_t getFirstSeq() const override { return first_seq; }
+  uint32_t getNextSeq() const override { return next_seq; }
+  bool isAuthor(uint32_t seq, const mesh::Identity& id) const override { return authors[seq] == id.pub_key[0]; }
+  uint32_t findFirstAfter(uint32_t since) const override {
+    for (uint32_t seq = first_seq; seq < next_seq; seq++) {
+      if (timestampOf(seq) > since) return seq;
+    }
+    return next_seq;
+  }
+};
+
+class RoomPushWindowTest : public ::testing::Test {
+protected:
+  FakePosts posts;
+  mesh::Identity client;
+  RoomPushWindow win;
+
+  void SetUp() override {
+    memset(client.pub_key, 0, sizeof(client.pub_key));
+    client.pub_key[0] = 0xC1;
+    win = RoomPushWindow();
+    win.reset(0);
+  }
+
+  static uint32_t ackFor(uint32_t seq, int attempt = 0) { return 0xA0000 + seq * 16 + attempt; }
+
+  // pushes next new post, as MyMesh::pushNextPost() does
+  uint32_t pushNext() {
+    uint32_t seq = win.getSyncCursor(posts, client);
+    EXPECT_LT(seq, posts.getNextSeq());
+    win.onPushed(seq, FakePosts::timestampOf(seq), ackFor(seq));
+    return seq;
+  }
+  void fillWindow() {
+    while (!win.isFull()) pushNext();
+  }
+};
+
+TEST_F(RoomPushWindowTest, InOrderAcksAdvanceSyncSince) {
+  for (int i = 0; i < 5; i++) posts.add(0x01);
+  fillWindow();
+  EXPECT_EQ(ROOM_PUSH_WINDOW, win.num_in_flight);
+
+  RoomPushEntry e;
+  ASSERT_TRUE(win.processAck(ackFor(1), e));
+  EXPECT_EQ(1u, e.seq);
+  EXPECT_EQ(FakePosts::timestampOf(1), win.sync_since);
+  EXPECT_FALSE(win.isFull());
+  EXPECT_EQ(4u, pushNext());
+}
+
+TEST_F(RoomPushWindowTest, SkipsOwnPosts) {
+  posts.add(0x01);
+  posts.add(0xC1);   // by the client
+  posts.add(0x01);
+  EXPECT_EQ(1u, pushNext());
+  EXPECT_EQ(3u, pushNext());
+  EXPECT_EQ(posts.getNextSeq(), win.getSyncCursor(posts, client));
+}
+
+TEST_F(RoomPushWindowTest, OutOfOrderAck) {
+  for (int i = 0; i < 3; i++) posts.add(0x01);
+  fillWindow();
+
+  RoomPushEntry e;
+  ASSERT_TRUE(win.processAck(ackFor(3), e));   // newest first
+  ASSERT_TRUE(win.processAck(ackFor(2), e));
+  EXPECT_EQ(0u, win.sync_since);   // held back by seq 1
+  EXPECT_EQ(3, win.num_in_flight);
+  EXPECT_EQ(1, win.getNumUnacked());
+  EXPECT_FALSE(win.processAck(ackFor(2), e));   // duplicate
+
+  ASSERT_TRUE(win.processAck(ackFor(1), e));
+  EXPECT_EQ(0, win.num_in_flight);
+  EXPECT_EQ(FakePosts::timestampOf(3), win.sync_since);
+}
+
+TEST_F(RoomPushWindowTest, TimeoutResendsOnlyUnacked) {
+  for (int i = 0; i < 3; i++) posts.add(0x01);
+  fillWindow();
+  RoomPushEntry e;
+  ASSERT_TRUE(win.processAck(ackFor(2), e));
+
+  ASSERT_TRUE(win.onAckTimeout());
+  EXPECT_FALSE(win.onAckTimeout());   // re-sends already pending
+  int i = win.getNextResend(posts);
+  ASSERT_EQ(0, i);
+  EXPECT_EQ(1u, win.in_flight[i].seq);
+  win.onResent(i, ackFor(1, 1));
+
+  i = win.getNextResend(posts);
+  ASSERT_EQ(2, i);
+  EXPECT_EQ(3u, win.in_flight[i].seq);
+  win.onResent(i, ackFor(3, 1));
+  EXPECT_EQ(-1, win.getNextResend(posts));
+}
+
+TEST_F(RoomPushWindowTest, LateAckAfterResend) {
+  for (int i = 0; i < 2; i++) posts.add(0x01);
+  pushNext();
+  pushNext();
+
+  ASSERT_TRUE(win.onAckTimeout());
+  int i = win.getNextResend(posts);
+  ASSERT_EQ(0, i);
+  win.onResent(i, ackFor(1, 1));
+
+  RoomPushEntry e;
+  ASSERT_TRUE(win.processAck(ackFor(1), e));   // ACK of the first attempt, arriving late
+  EXPECT_NE(ackFor(1), e.ack);
+  EXPECT_EQ(1u, e.seq);
+  EXPECT_FALSE(win.processAck(ackFor(1, 1), e));   // then the re-send's ACK, already counted
+
+  // seq 2 was also marked, but its late ACK cancels the re-send
+  ASSERT_TRUE(win.processAck(ackFor(2), e));
+  EXPECT_EQ(ackFor(2), e.ack);
+  EXPECT_EQ(-1, win.getNextResend(posts));
+  EXPECT_EQ(0, win.num_in_flight);
+  EXPECT_EQ(FakePosts::timestampOf(2), win.sync_since);
+}
+
+TEST_F(RoomPushWindowTest, PostOverwrittenWhileInFlight) {
+  posts.max_posts = 4;
+  for (int i = 0; i < 4; i++) posts.add(0x01);
+  fillWindow();   // seqs 1..3
+  RoomPushEntry e;
+  ASSERT_TRUE(win.processAck(ackFor(2), e));
+  ASSERT_TRUE(win.onAckTimeout());   // 1 and 3 to re-send
+
+  posts.add(0x01);   // seqs 1, 2 overwritten
+  posts.add(0x01);
+  ASSERT_EQ(3u, posts.getFirstSeq());
+
+  int i = win.getNextResend(posts);   // gives up on 1, so window slides past 2 as well
+  ASSERT_EQ(0, i);
+  EXPECT_EQ(3u, win.in_flight[i].seq);
+  EXPECT_EQ(1, win.num_in_flight);
+  EXPECT_EQ(FakePosts::timestampOf(2), win.sync_since);
+
+  win.onResent(i, ackFor(3, 1));
+  ASSERT_TRUE(win.processAck(ackFor(3, 1), e));
+  EXPECT_EQ(4u, pushNext());   // cursor carries on after the window
+}
+
+TEST_F(RoomPushWindowTest, CursorOverwrittenFindsFromWindow) {
+  posts.max_posts = 4;
+  for (int i = 0; i < 3; i++) posts.add(0x01);
+  pushNext();   // seq 1 in flight, cursor at 2
+  for (int i = 0; i < 4; i++) posts.add(0x01);   // seqs 1..3 overwritten
+  ASSERT_EQ(4u, posts.getFirstSeq());
+
+  EXPECT_EQ(4u, win.getSyncCursor(posts, client));
+}
+
+TEST_F(RoomPushWindowTest, ForcedSyncResets) {
+  for (int i = 0; i < 10; i++) posts.add(0x01);
+  fillWindow();
+  ASSERT_TRUE(win.onAckTimeout());
+
+  win.reset(FakePosts::timestampOf(5));   // client asks for everything after post 5
+  EXPECT_EQ(0, win.num_in_flight);
+  EXPECT_EQ(0, win.getNumUnacked());
+  EXPECT_EQ(-1, win.getNextResend(posts));
+  EXPECT_FALSE(win.onAckTimeout());
+
+  RoomPushEntry e;
+  EXPECT_FALSE(win.processAck(ackFor(1), e));   // ACKs from before the reset are ignored
+  EXPECT_EQ(6u, pushNext());
+
+  win.reset(0);   // and back to the start
+  EXPECT_EQ(1u, pushNext());
+}
+
+TEST_F(RoomPushWindowTest, KeepAliveResendsUnacked) {
+  for (int i = 0; i < 3; i++) posts.add(0x01);
+  fillWindow();
+  RoomPushEntry e;
+  ASSERT_TRUE(win.processAck(ackFor(1), e));
+
+  win.resendUnacked();
+  EXPECT_EQ(0x03, win.resend_mask);   // seqs 2, 3 (window slid by one)
+  EXPECT_EQ(2u, win.in_flight[win.getNextResend(posts)].seq);
+}
+
+int main(int argc, char **argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,38 @@
+#include <gtest/gtest.h>
+#include "Utils.h"
+#include <AES.h>
+
+using namespace mesh;
+
+TEST(UtilsCipher, CachedMatchesPrepared) {
+  uint8_t secret[PUB_KEY_SIZE];
+  memset(secret, 0x5A, sizeof(secret));
+  uint8_t plain[20], a[32], b[32];
+  for (int i = 0; i < (int) sizeof(plain); i++) plain[i] = i;
+
+  AES128 aes;
+  aes.setKey(secret, CIPHER_KEY_SIZE);
+  ASSERT_EQ(32, Utils::encrypt(aes, a, plain, sizeof(plain)));
+  ASSERT_EQ(32, Utils::encrypt(secret, b, plain, sizeof(plain)));
+  EXPECT_EQ(0, memcmp(a, b, sizeof(a)));
+}
+
+TEST(UtilsCipher, EvictionKeepsKeysStraight) {
+  uint8_t secrets[CIPHER_CACHE_SIZE*2][PUB_KEY_SIZE];
+  uint8_t enc[CIPHER_CACHE_SIZE*2][16];
+  uint8_t plain[16], dec[16];
+  memset(plain, 0x11, sizeof(plain));
+
+  for (int i = 0; i < CIPHER_CACHE_SIZE*2; i++) {
+    memset(secrets[i], i + 1, PUB_KEY_SIZE);
+    Utils::encrypt(secrets[i], enc[i], plain, sizeof(plain));
+  }
+  for (int i = 1; i < CIPHER_CACHE_SIZE*2; i++) {
+    EXPECT_NE(0, memcmp(enc[0], enc[i], 16));
+  }
+  // reverse order, so mix of hits and misses
+  for (int i = CIPHER_CACHE_SIZE*2 - 1; i >= 0; i--) {
+    Utils::decrypt(secrets[i], dec, enc[i], 16);
+    EXPECT_EQ(0, memcmp(dec, plain, 16)) << "secret " << i;
+  }
+}
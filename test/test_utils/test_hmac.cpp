@@ -0,0 +1,94 @@
+#include <gtest/gtest.h>
+#include "Utils.h"
+
+using namespace mesh;
+
+static void hmacHex(char* dest, const uint8_t* key, int key_len, const uint8_t* msg, int msg_len) {
+  uint8_t secret[PUB_KEY_SIZE];
+  memset(secret, 0, sizeof(secret));   // HMAC zero pads short keys anyway
+  memcpy(secret, key, key_len);
+
+  MACKey mac_key;
+  Utils::calcMACKey(mac_key, secret);
+  uint8_t mac[32];
+  Utils::calcHMAC(mac, sizeof(mac), mac_key, msg, msg_len);
+  Utils::toHex(dest, mac, sizeof(mac));
+}
+
+TEST(UtilsHMAC, RFC4231Vectors) {
+  char hex[65];
+
+  uint8_t key1[20];
+  memset(key1, 0x0b, sizeof(key1));
+  hmacHex(hex, key1, sizeof(key1), (const uint8_t *) "Hi There", 8);
+  EXPECT_STREQ("B0344C61D8DB38535CA8AFCEAF0BF12B881DC200C9833DA726E9376C2E32CFF7", hex);
+
+  const char* msg2 = "what do ya want for nothing?";
+  hmacHex(hex, (const uint8_t *) "Jefe", 4, (const uint8_t *) msg2, strlen(msg2));
+  EXPECT_STREQ("5BDCC146BF60754E6A042426089575C75A003F089D2739839DEC58B964EC3843", hex);
+
+  uint8_t key3[20], msg3[50];
+  memset(key3, 0xaa, sizeof(key3));
+  memset(msg3, 0xdd, sizeof(msg3));
+  hmacHex(hex, key3, sizeof(key3), msg3, sizeof(msg3));
+  EXPECT_STREQ("773EA91E36800E46854DB8EBD09181A72959098B3EF8C122D9635514CED565FE", hex);
+}
+
+TEST(UtilsHMAC, PaddingBoundaries) {
+  struct { int len; const char* prefix; } cases[] = {
+    { 55, "EF3CD5285B72CC9A" }, { 56, "4A0342CDC5A480D2" }, { 63, "20617142DF4CE5C8" }, { 64, "014883EE52A05403" },
+    { 65, "BC77A01A7E5FBE9F" }, { 119, "29B4F07158791B1A" }, { 120, "40E88C8A296799CD" }, { 184, "140621B0A3B044C8" }
+  };
+  uint8_t key[PUB_KEY_SIZE], msg[184];
+  for (int i = 0; i < PUB_KEY_SIZE; i++) key[i] = i;
+  for (int i = 0; i < (int) sizeof(msg); i++) msg[i] = i*7;
+
+  char hex[65];
+  for (auto& c : cases) {
+    hmacHex(hex, key, sizeof(key), msg, c.len);
+    EXPECT_EQ(0, strncmp(c.prefix, hex, 16)) << "len=" << c.len;
+  }
+}
+
+TEST(UtilsHMAC, PrecalculatedKeyMatches) {
+  uint8_t secret[PUB_KEY_SIZE];
+  for (int i = 0; i < PUB_KEY_SIZE; i++) secret[i] = 0x40 + i;
+  MACKey mac_key;
+  Utils::calcMACKey(mac_key, secret);
+
+  uint8_t plain[40], a[80], b[80], out[80];
+  for (int i = 0; i < (int) sizeof(plain); i++) plain[i] = i;
+  int len_a = Utils::encryptThenMAC(secret, a, plain, sizeof(plain));
+  int len_b = Utils::encryptThenMAC(secret, mac_key, b, plain, sizeof(plain));
+  ASSERT_EQ(len_a, len_b);
+  EXPECT_EQ(0, memcmp(a, b, len_a));
+
+  EXPECT_GT(Utils::MACThenDecrypt(secret, mac_key, out, a, len_a), 0);
+  EXPECT_EQ(0, memcmp(out, plain, sizeof(plain)));
+
+  a[len_a - 1] ^= 1;   // tamper
+  EXPECT_EQ(0, Utils::MACThenDecrypt(secret, mac_key, out, a, len_a));
+  EXPECT_EQ(0, Utils::MACThenDecrypt(secret, out, a, len_a));
+}
+
+TEST(UtilsHMAC, CachedKeyEviction) {
+  uint8_t secrets[MAC_KEY_CACHE_SIZE*2][PUB_KEY_SIZE];
+  uint8_t enc[MAC_KEY_CACHE_SIZE*2][CIPHER_MAC_SIZE + 16];
+  uint8_t plain[16], out[16];
+  memset(plain, 0x22, sizeof(plain));
+
+  for (int i = 0; i < MAC_KEY_CACHE_SIZE*2; i++) {
+    memset(secrets[i], 0x77, PUB_KEY_SIZE);
+    secrets[i][PUB_KEY_SIZE - 1] = i;   // same AES key, only the MAC key differs
+    Utils::encryptThenMAC(secrets[i], enc[i], plain, sizeof(plain));
+  }
+  // reverse order, so mix of hits and misses
+  for (int i = MAC_KEY_CACHE_SIZE*2 - 1; i >= 0; i--) {
+    EXPECT_GT(Utils::MACThenDecrypt(secrets[i], out, enc[i], sizeof(enc[i])), 0) << "secret " << i;
+    EXPECT_EQ(0, Utils::MACThenDecrypt(secrets[i ^ 1], out, enc[i], sizeof(enc[i]))) << "secret " << i;
+
+    MACKey key;
+    Utils::calcMACKey(key, secrets[i]);
+    EXPECT_EQ(0, memcmp(&key, &Utils::getCachedMACKey(secrets[i]), sizeof(key)));
+  }
+}